@@ -1,5 +1,5 @@
 TEMPLATE = app
-CONFIG += console c++14
+CONFIG += console c++17
 CONFIG -= app_bundle
 CONFIG -= qt
 CONFIG += static
@@ -14,12 +14,35 @@ QMAKE_LFLAGS_RELEASE += -O3
 QMAKE_CXXFLAGS += -static -static-libgcc -static-libstdc++
 @
 
+QMAKE_CXXFLAGS += -pthread
+QMAKE_LFLAGS += -pthread
+
 SOURCES += main.cpp \
     binarysearchtree.cpp \
+    concurrentavltree.cpp \
+    concurrenttree.cpp \
+    epochreclamation.cpp \
+    flatcombiningtree.cpp \
+    intervaltree.cpp \
+    lockfreetree.cpp \
+    mpscqueue.cpp \
+    multiversiontree.cpp \
+    nodehandle.cpp \
+    nodepool.cpp \
+    persistentavltree.cpp \
     redblacktree.cpp \
+    relaxedredblacktree.cpp \
     avltree.cpp \
+    wavltree.cpp \
     aatree.cpp \
+    weightbalancedtree.cpp \
+    scapegoattree.cpp \
+    shardedtree.cpp \
+    skiplist.cpp \
+    spscqueue.cpp \
+    threadaffinity.cpp \
     timer.cpp \
+    treeservice.cpp \
     treetest.cpp \
     randomvalue.cpp \
     treetest_template.cpp \
@@ -27,10 +50,32 @@ SOURCES += main.cpp \
 
 HEADERS += \
     binarysearchtree.hh \
+    concurrentavltree.hh \
+    concurrenttree.hh \
+    epochreclamation.hh \
+    flatcombiningtree.hh \
+    intervaltree.hh \
+    lockfreetree.hh \
+    monoid.hh \
+    mpscqueue.hh \
+    multiversiontree.hh \
+    nodehandle.hh \
+    nodepool.hh \
+    persistentavltree.hh \
+    prefixkey.hh \
     redblacktree.hh \
+    relaxedredblacktree.hh \
     avltree.hh \
+    wavltree.hh \
     aatree.hh \
+    weightbalancedtree.hh \
+    scapegoattree.hh \
+    shardedtree.hh \
+    skiplist.hh \
+    spscqueue.hh \
+    threadaffinity.hh \
     timer.hh \
+    treeservice.hh \
     treetest.hh \
     randomvalue.hh \
     treetesthelper.hh
@@ -10,68 +10,191 @@
 #include "aatree.hh"
 #include <algorithm>
 
-template<typename Node>
-AATree<Node>::AATree() :
-    BinarySearchTree<Node>{}
+template<typename Node, typename Compare, bool Multi>
+AATree<Node, Compare, Multi>::AATree() :
+    BinarySearchTree<Node, Compare, Multi>{}
 {
 }
 
-template<typename Node>
-AATree<Node>::~AATree()
+template<typename Node, typename Compare, bool Multi>
+AATree<Node, Compare, Multi>::AATree(const Compare& compare) :
+    BinarySearchTree<Node, Compare, Multi>{ compare }
 {
 }
 
-template<typename Node>
-bool AATree<Node>::insert(const value_type& value)
+template<typename Node, typename Compare, bool Multi>
+AATree<Node, Compare, Multi>::~AATree()
 {
-    if (this->find(value.first) != this->nil_)
-    {
-        return false;
-    }
+}
 
-    Node* node{
-        new Node{ value.first, value.second,
-                  this->nil_, this->nil_, this->nil_, 1 } };
+template<typename Node, typename Compare, bool Multi>
+bool AATree<Node, Compare, Multi>::insertNode(Node* node)
+{
+    node->parent_ = this->nil_;
+    node->left_ = this->nil_;
+    node->right_ = this->nil_;
+    node->level_ = Node::DEFAULT_LEVEL;
 
     if (this->root_ == this->nil_)
     {
         this->root_ = node;
         ++this->nodes_;
+        this->linkInOrder(node);
+        this->updatePath(node);
     }
     else
     {
+        // The recursive insert leaves the tree unchanged if the key already
+        // exists, which shows as an unchanged node count
+        size_type nodesBefore{ this->nodes_ };
         this->root_ = insertNode(node, this->root_);
+        return this->nodes_ != nodesBefore;
     }
 
     return true;
 }
 
-template<typename Node>
-typename AATree<Node>::size_type AATree<Node>::erase(const key_type& key)
+template<typename Node, typename Compare, bool Multi>
+bool AATree<Node, Compare, Multi>::insertNodeNear(Node* node, Node* hint)
 {
-    auto node{ this->find(key) };
-    if (node == this->nil_)
+    if (this->root_ == this->nil_)
+    {
+        return insertNode(node);
+    }
+
+    Node* parent{ this->nil_ };
+    int order{ 0 };
+    if (not this->findParent(node, hint, parent, order))
+    {
+        return false;
+    }
+
+    node->parent_ = parent;
+    node->left_ = this->nil_;
+    node->right_ = this->nil_;
+    node->level_ = Node::DEFAULT_LEVEL;
+    if (order < 0)
+    {
+        parent->left_ = node;
+    }
+    else
     {
-        return 0;
+        parent->right_ = node;
     }
+    ++this->nodes_;
+    this->linkInOrder(node);
+    this->updatePath(node);
 
-    --this->nodes_;
+    // A split raises the level of the new subtree root, which the parent and the
+    // grandparent of the subtree compare against. When neither of two consecutive
+    // ancestors is rotated, the levels above them are not affected.
+    Node* x{ parent };
+    int unchanged{ 0 };
+    while (x != this->nil_ and unchanged < 2)
+    {
+        Node* up{ x->parent_ };
+        bool isLeft{ up != this->nil_ and x == up->left_ };
+        unsigned long long rotations{ this->rotations_ };
+        Node* top{ split(skew(x)) };
 
-    int key1{ node->key_ };
+        if (up == this->nil_)
+        {
+            this->root_ = top;
+        }
+        else if (isLeft)
+        {
+            up->left_ = top;
+        }
+        else
+        {
+            up->right_ = top;
+        }
 
-    this->root_ = deleteNode(node, this->root_);
+        unchanged = (this->rotations_ == rotations) ? unchanged + 1 : 0;
+        x = up;
+    }
 
-    int key2{ (node != this->nil_) ? node->key_ : key1 - 1 };
-    if (key1 == key2)
+    return true;
+}
+
+// Removes node by swapping it with its in-order neighbour at level 1, which is
+// always a leaf, and then fixes the levels bottom-up from the parent of the leaf.
+// Nodes are moved instead of copying the keys and values between them.
+template<typename Node, typename Compare, bool Multi>
+void AATree<Node, Compare, Multi>::removeNode(Node* node)
+{
+    Node* leaf{ node };
+    if (node->left_ != this->nil_)
     {
-        delete node;
+        leaf = this->predecessor(node);
     }
+    else if (node->right_ != this->nil_)
+    {
+        leaf = this->successor(node);
+    }
+
+    Node* x{ leaf->parent_ };
+    replaceChild(leaf, this->nil_);
+
+    if (leaf != node)
+    {
+        if (x == node)
+        {
+            x = leaf;
+        }
+
+        leaf->parent_ = node->parent_;
+        leaf->left_ = node->left_;
+        leaf->right_ = node->right_;
+        leaf->level_ = node->level_;
+        replaceChild(node, leaf);
+        if (leaf->left_ != this->nil_)
+        {
+            leaf->left_->parent_ = leaf;
+        }
+        if (leaf->right_ != this->nil_)
+        {
+            leaf->right_->parent_ = leaf;
+        }
+    }
+
+    this->updatePath(x);
+
+    while (x != this->nil_)
+    {
+        Node* parent{ x->parent_ };
+        bool isLeft{ parent != this->nil_ and x == parent->left_ };
+
+        x = decreaseLevel(x);
+        x = skew(x);
+        x->right_ = skew(x->right_);
+
+        if (x->right_ != this->nil_)
+        {
+            x->right_->right_ = skew(x->right_->right_);
+        }
+
+        x = split(x);
+        x->right_ = split(x->right_);
 
-    return 1;
+        if (parent == this->nil_)
+        {
+            this->root_ = x;
+        }
+        else if (isLeft)
+        {
+            parent->left_ = x;
+        }
+        else
+        {
+            parent->right_ = x;
+        }
+        x = parent;
+    }
 }
 
-template<typename Node>
-Node* AATree<Node>::skew(Node* node)
+template<typename Node, typename Compare, bool Multi>
+Node* AATree<Node, Compare, Multi>::skew(Node* node)
 {
     if (node == this->nil_)
     {
@@ -92,6 +215,9 @@ Node* AATree<Node>::skew(Node* node)
         L->right_ = node;
         L->parent_ = node->parent_;
         L->right_->parent_ = L;
+        this->updateSummary(node);
+        this->updateSummary(L);
+        ++this->rotations_;
         return L;
     }
     else
@@ -100,8 +226,8 @@ Node* AATree<Node>::skew(Node* node)
     }
 }
 
-template<typename Node>
-Node* AATree<Node>::split(Node* node)
+template<typename Node, typename Compare, bool Multi>
+Node* AATree<Node, Compare, Multi>::split(Node* node)
 {
     if (node == this->nil_)
     {
@@ -123,6 +249,9 @@ Node* AATree<Node>::split(Node* node)
         R->parent_ = node->parent_;
         R->left_->parent_ = R;
         R->level_ += 1;
+        this->updateSummary(node);
+        this->updateSummary(R);
+        ++this->rotations_;
         return R;
     }
     else
@@ -131,16 +260,25 @@ Node* AATree<Node>::split(Node* node)
     }
 }
 
-template<typename Node>
-Node* AATree<Node>::insertNode(Node* node, Node* rootNode)
+template<typename Node, typename Compare, bool Multi>
+Node* AATree<Node, Compare, Multi>::insertNode(Node* node, Node* rootNode)
 {
-    if (node->key_ < rootNode->key_)
+    int order{ this->compareKeys(node->key_, rootNode->key_) };
+    if (order == 0 and not Multi)
+    {
+        // Key already exists in the tree. Skew and split do nothing on the
+        // unchanged path, so the callers return their subtrees as they are.
+        return rootNode;
+    }
+    else if (order < 0)
     {
         if (rootNode->left_ == this->nil_)
         {
             node->parent_ = rootNode;
             rootNode->left_ = node;
             ++this->nodes_;
+            this->linkInOrder(node);
+            this->updatePath(node);
 
             rootNode = skew(rootNode);
             rootNode = split(rootNode);
@@ -153,11 +291,14 @@ Node* AATree<Node>::insertNode(Node* node, Node* rootNode)
     }
     else
     {
+        // Equal keys of a multimap go after the existing ones
         if (rootNode->right_ == this->nil_)
         {
             node->parent_ = rootNode;
             rootNode->right_ = node;
             ++this->nodes_;
+            this->linkInOrder(node);
+            this->updatePath(node);
 
             rootNode = skew(rootNode);
             rootNode = split(rootNode);
@@ -174,71 +315,8 @@ Node* AATree<Node>::insertNode(Node* node, Node* rootNode)
     return rootNode;
 }
 
-template<typename Node>
-Node* AATree<Node>::deleteNode(Node* node, Node* rootNode)
-{
-    if (rootNode == this->nil_ or node == this->nil_)
-    {
-        return rootNode;
-    }
-
-    if (node == rootNode)
-    {
-        if (rootNode->left_ == this->nil_ and rootNode->right_ == this->nil_)
-        {
-            return this->nil_;
-        }
-        else if (rootNode->left_ == this->nil_)
-        {
-            Node* L{ this->successor(rootNode) };
-            rootNode->right_ = deleteNode(L, rootNode->right_);
-            if (rootNode->right_ != this->nil_)
-            {
-                rootNode->right_->parent_ = rootNode;
-            }
-            rootNode->key_ = L->key_;
-            delete L;
-            L = this->nil_;
-        }
-        else
-        {
-            Node* L{ this->predecessor(rootNode) };
-            rootNode->left_ = deleteNode(L, rootNode->left_);
-            if (rootNode->left_ != this->nil_)
-            {
-                rootNode->left_->parent_ = rootNode;
-            }
-            rootNode->key_ = L->key_;
-            delete L;
-            L = this->nil_;
-       }
-    }
-    else if (node->key_ > rootNode->key_)
-    {
-        rootNode->right_ = deleteNode(node, rootNode->right_);
-    }
-    else
-    {
-        rootNode->left_ = deleteNode(node, rootNode->left_);
-    }
-
-    rootNode = decreaseLevel(rootNode);
-    rootNode = skew(rootNode);
-    rootNode->right_ = skew(rootNode->right_);
-
-    if (rootNode->right_ != this->nil_)
-    {
-        rootNode->right_->right_ = skew(rootNode->right_->right_);
-    }
-
-    rootNode = split(rootNode);
-    rootNode->right_ = split(rootNode->right_);
-
-    return rootNode;
-}
-
-template<typename Node>
-Node* AATree<Node>::decreaseLevel(Node* node)
+template<typename Node, typename Compare, bool Multi>
+Node* AATree<Node, Compare, Multi>::decreaseLevel(Node* node)
 {
     if (node == this->nil_)
     {
@@ -260,4 +338,23 @@ Node* AATree<Node>::decreaseLevel(Node* node)
     return node;
 }
 
+// Replaces node with child in the child pointers of the parent of node
+template<typename Node, typename Compare, bool Multi>
+void AATree<Node, Compare, Multi>::replaceChild(Node* node, Node* child)
+{
+    Node* parent{ node->parent_ };
+    if (parent == this->nil_)
+    {
+        this->root_ = child;
+    }
+    else if (parent->left_ == node)
+    {
+        parent->left_ = child;
+    }
+    else
+    {
+        parent->right_ = child;
+    }
+}
+
 #endif // AATREE_CPP
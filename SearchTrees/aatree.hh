@@ -10,8 +10,9 @@
 #include "binarysearchtree.hh"
 #include <utility>
 
-template<typename Key, typename Value>
-struct AANode
+template<typename Key, typename Value, bool Threaded = false, typename Monoid = void>
+struct AANode : InOrderLinks<AANode<Key, Value, Threaded, Monoid>, Threaded>, NodeValue<Value>,
+               SubtreeSummary<Monoid>
 {
     using key_type = Key;
     using mapped_type = Value;
@@ -19,33 +20,32 @@ struct AANode
     const static int NULL_LEVEL = -10;
 
     key_type key_;
-    mapped_type value_;
-    AANode<key_type, mapped_type>* parent_;
-    AANode<key_type, mapped_type>* left_;
-    AANode<key_type, mapped_type>* right_;
+    AANode<key_type, mapped_type, Threaded, Monoid>* parent_;
+    AANode<key_type, mapped_type, Threaded, Monoid>* left_;
+    AANode<key_type, mapped_type, Threaded, Monoid>* right_;
     int level_;
 
     AANode() :
-        key_{}, value_{},
+        key_{},
         parent_{}, left_{}, right_{},
         level_{ NULL_LEVEL }
     {}
 
-    AANode(const key_type& key, const mapped_type& value,
-           AANode<key_type, mapped_type>* parent,
-           AANode<key_type, mapped_type>* left,
-           AANode<key_type, mapped_type>* right) :
-        key_{ key }, value_{ value },
+    AANode(const key_type& key, const typename NodeValue<Value>::argument_type& value,
+           AANode<key_type, mapped_type, Threaded, Monoid>* parent,
+           AANode<key_type, mapped_type, Threaded, Monoid>* left,
+           AANode<key_type, mapped_type, Threaded, Monoid>* right) :
+        NodeValue<Value>{ value }, key_{ key },
         parent_{ parent }, left_{ left }, right_{ right },
         level_{ DEFAULT_LEVEL }
     {}
 
-    AANode(const key_type& key, const mapped_type& value,
-            AANode<key_type, mapped_type>* parent,
-            AANode<key_type, mapped_type>* left,
-            AANode<key_type, mapped_type>* right,
+    AANode(const key_type& key, const typename NodeValue<Value>::argument_type& value,
+            AANode<key_type, mapped_type, Threaded, Monoid>* parent,
+            AANode<key_type, mapped_type, Threaded, Monoid>* left,
+            AANode<key_type, mapped_type, Threaded, Monoid>* right,
             int level) :
-        key_{ key }, value_{ value },
+        NodeValue<Value>{ value }, key_{ key },
         parent_{ parent }, left_{ left }, right_{ right },
         level_{ level }
     {}
@@ -64,28 +64,33 @@ struct AANode
     }
 };
 
-template<typename Node>
-class AATree : public BinarySearchTree<Node>
+template<typename Node, typename Compare = std::less<typename Node::key_type>, bool Multi = false>
+class AATree : public BinarySearchTree<Node, Compare, Multi>
 {
 public:
     using key_type = typename Node::key_type;
     using mapped_type = typename Node::mapped_type;
-    using value_type = std::pair<const key_type, mapped_type>;
-    using size_type = typename BinarySearchTree<Node>::size_type;
+    using value_type = typename BinarySearchTree<Node, Compare, Multi>::value_type;
+    using size_type = typename BinarySearchTree<Node, Compare, Multi>::size_type;
     using node_type = Node;
 
     AATree();
+    explicit AATree(const Compare& compare);
     virtual ~AATree();
 
-    virtual bool insert(const value_type& value);
-    virtual size_type erase(const key_type& key);
+protected:
+    virtual bool insertNode(Node* node);
+    // Links node as a leaf and skews and splits bottom-up from its parent,
+    // instead of the recursive insert from the root
+    virtual bool insertNodeNear(Node* node, Node* hint);
+    virtual void removeNode(Node* node);
 
 private:
     Node* skew(Node* node);
     Node* split(Node* node);
     Node* insertNode(Node* node, Node* rootNode);
-    Node* deleteNode(Node* node, Node* rootNode);
     Node* decreaseLevel(Node* node);
+    void replaceChild(Node* node, Node* child);
 };
 
 #include "aatree.cpp"
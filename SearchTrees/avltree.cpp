@@ -9,73 +9,91 @@
 
 #include "avltree.hh"
 
-template<typename Node>
-AVLTree<Node>::AVLTree() :
-    BinarySearchTree<Node>{}
+template<typename Node, typename Compare, bool Multi>
+AVLTree<Node, Compare, Multi>::AVLTree() :
+    BinarySearchTree<Node, Compare, Multi>{}
 {
 }
 
-template<typename Node>
-AVLTree<Node>::~AVLTree()
+template<typename Node, typename Compare, bool Multi>
+AVLTree<Node, Compare, Multi>::AVLTree(const Compare& compare) :
+    BinarySearchTree<Node, Compare, Multi>{ compare }
 {
 }
 
-template<typename Node>
-bool AVLTree<Node>::insert(const value_type& value)
+template<typename Node, typename Compare, bool Multi>
+AVLTree<Node, Compare, Multi>::~AVLTree()
 {
-    Node* x{ this->root_ };
-    Node* parent{ this->nil_ };
+}
+
+template<typename Node, typename Compare, bool Multi>
+void AVLTree<Node, Compare, Multi>::splitGreater(const key_type& key, AVLTree& other)
+{
+    this->splitInto(key, other, true);
+}
+
+template<typename Node, typename Compare, bool Multi>
+void AVLTree<Node, Compare, Multi>::splitLess(const key_type& key, AVLTree& other)
+{
+    this->splitInto(key, other, false);
+}
 
-    while (x != this->nil_)
+template<typename Node, typename Compare, bool Multi>
+void AVLTree<Node, Compare, Multi>::join(AVLTree& other)
+{
+    this->joinFrom(other);
+}
+
+template<typename Node, typename Compare, bool Multi>
+bool AVLTree<Node, Compare, Multi>::insertNode(Node* node)
+{
+    return insertNodeNear(node, this->nil_);
+}
+
+template<typename Node, typename Compare, bool Multi>
+bool AVLTree<Node, Compare, Multi>::insertNodeNear(Node* node, Node* hint)
+{
+    Node* parent{ this->nil_ };
+    int order{ 0 };
+    if (not this->findParent(node, hint, parent, order))
     {
-        parent = x;
-        if (value.first < x->key_)
-        {
-            x = x->left_;
-        }
-        else if (x->key_ < value.first)
-        {
-            x = x->right_;
-        }
-        else
-        {
-            return false;
-        }
+        return false;
     }
 
-    Node* node{
-        new Node{ value.first, value.second,
-                  parent, this->nil_, this->nil_, 0 } };
+    node->parent_ = parent;
+    node->left_ = this->nil_;
+    node->right_ = this->nil_;
+    node->balance_ = 0;
 
     ++this->nodes_;
 
     if (parent == this->nil_)
     {
         this->root_ = node;
+        this->linkInOrder(node);
+        this->updatePath(node);
     }
-    else if (node->key_ < parent->key_)
+    else if (order < 0)
     {
         parent->left_ = node;
+        this->linkInOrder(node);
+        this->updatePath(node);
         insertBalance(parent, 1);
     }
     else
     {
         parent->right_ = node;
+        this->linkInOrder(node);
+        this->updatePath(node);
         insertBalance(parent, -1);
     }
 
     return true;
 }
 
-template<typename Node>
-typename AVLTree<Node>::size_type AVLTree<Node>::erase(const key_type& key)
+template<typename Node, typename Compare, bool Multi>
+void AVLTree<Node, Compare, Multi>::removeNode(Node* node)
 {
-    auto node{ this->find(key) };
-    if (node == this->nil_)
-    {
-        return 0;
-    }
-
     Node* left{ node->left_ };
     Node* right{ node->right_ };
 
@@ -85,7 +103,6 @@ typename AVLTree<Node>::size_type AVLTree<Node>::erase(const key_type& key)
         {
             if (node == this->root_)
             {
-                delete this->root_;
                 this->root_ = this->nil_;
             }
             else
@@ -93,27 +110,29 @@ typename AVLTree<Node>::size_type AVLTree<Node>::erase(const key_type& key)
                 if (node->parent_->left_ == node)
                 {
                     node->parent_->left_ = this->nil_;
+                    this->updatePath(node->parent_);
                     deleteBalance(node->parent_, -1);
-                    delete node;
                 }
                 else
                 {
                     node->parent_->right_ = this->nil_;
+                    this->updatePath(node->parent_);
                     deleteBalance(node->parent_, 1);
-                    delete node;
                 }
             }
         }
         else
         {
             replace(node, right);
-            deleteBalance(node, 0);
+            this->updatePath(right->parent_);
+            deleteBalance(right, 0);
         }
     }
     else if (right == this->nil_)
     {
         replace(node, left);
-        deleteBalance(node, 0);
+        this->updatePath(left->parent_);
+        deleteBalance(left, 0);
     }
     else
     {
@@ -145,8 +164,8 @@ typename AVLTree<Node>::size_type AVLTree<Node>::erase(const key_type& key)
                 }
             }
 
+            this->updatePath(successor);
             deleteBalance(successor, 1);
-            delete node;
         }
         else
         {
@@ -199,17 +218,14 @@ typename AVLTree<Node>::size_type AVLTree<Node>::erase(const key_type& key)
                 }
             }
 
+            this->updatePath(successorParent);
             deleteBalance(successorParent, -1);
-            delete node;
         }
     }
-
-    --this->nodes_;
-    return 1;
 }
 
-template<typename Node>
-void AVLTree<Node>::insertBalance(Node* node, int balance)
+template<typename Node, typename Compare, bool Multi>
+void AVLTree<Node, Compare, Multi>::insertBalance(Node* node, int balance)
 {
     while (node != this->nil_)
     {
@@ -256,8 +272,8 @@ void AVLTree<Node>::insertBalance(Node* node, int balance)
     }
 }
 
-template<typename Node>
-Node* AVLTree<Node>::rotateLeft(Node* node)
+template<typename Node, typename Compare, bool Multi>
+Node* AVLTree<Node, Compare, Multi>::rotateLeft(Node* node)
 {
     Node* right{ node->right_ };
     Node* rightleft{ right->left_ };
@@ -288,12 +304,15 @@ Node* AVLTree<Node>::rotateLeft(Node* node)
 
     ++right->balance_;
     node->balance_ = -right->balance_;
+    this->updateSummary(node);
+    this->updateSummary(right);
+    ++this->rotations_;
 
     return right;
 }
 
-template<typename Node>
-Node* AVLTree<Node>::rotateRight(Node* node)
+template<typename Node, typename Compare, bool Multi>
+Node* AVLTree<Node, Compare, Multi>::rotateRight(Node* node)
 {
     Node* left{ node->left_ };
     Node* leftright{ left->right_ };
@@ -324,12 +343,15 @@ Node* AVLTree<Node>::rotateRight(Node* node)
 
     --left->balance_;
     node->balance_ = -left->balance_;
+    this->updateSummary(node);
+    this->updateSummary(left);
+    ++this->rotations_;
 
     return left;
 }
 
-template<typename Node>
-Node* AVLTree<Node>::rotateLeftRight(Node* node)
+template<typename Node, typename Compare, bool Multi>
+Node* AVLTree<Node, Compare, Multi>::rotateLeftRight(Node* node)
 {
     Node* left{ node->left_ };
     Node* leftright{ left->right_ };
@@ -385,12 +407,16 @@ Node* AVLTree<Node>::rotateLeftRight(Node* node)
     }
 
     leftright->balance_ = 0;
+    this->updateSummary(left);
+    this->updateSummary(node);
+    this->updateSummary(leftright);
+    this->rotations_ += 2;
 
     return leftright;
 }
 
-template<typename Node>
-Node* AVLTree<Node>::rotateRightLeft(Node* node)
+template<typename Node, typename Compare, bool Multi>
+Node* AVLTree<Node, Compare, Multi>::rotateRightLeft(Node* node)
 {
     Node* right{ node->right_ };
     Node* rightleft{ right->left_ };
@@ -446,12 +472,16 @@ Node* AVLTree<Node>::rotateRightLeft(Node* node)
     }
 
     rightleft->balance_ = 0;
+    this->updateSummary(node);
+    this->updateSummary(right);
+    this->updateSummary(rightleft);
+    this->rotations_ += 2;
 
     return rightleft;
 }
 
-template<typename Node>
-void AVLTree<Node>::deleteBalance(Node* node, int balance)
+template<typename Node, typename Compare, bool Multi>
+void AVLTree<Node, Compare, Multi>::deleteBalance(Node* node, int balance)
 {
     while (node != this->nil_)
     {
@@ -504,25 +534,94 @@ void AVLTree<Node>::deleteBalance(Node* node, int balance)
     }
 }
 
-template<typename Node>
-void AVLTree<Node>::replace(Node* target, Node* source)
+// If the heights differ by more than one, middle is linked in place of the first node
+// on the inner spine of the higher subtree that is at most one higher than the lower
+// subtree. That subtree grows by one like after an insertion, so insertBalance
+// rebalances the path above it.
+template<typename Node, typename Compare, bool Multi>
+Node* AVLTree<Node, Compare, Multi>::joinNodes(Node* left, Node* middle, Node* right)
 {
-    target->balance_ = source->balance_;
-    target->key_ = source->key_;
-    target->left_ = source->left_;
-    target->right_ = source->right_;
+    int leftHeight{ spineHeight(left) };
+    int rightHeight{ spineHeight(right) };
 
-    if (source->left_ != this->nil_)
+    if (leftHeight > rightHeight + 1)
     {
-        source->left_->parent_ = target;
+        Node* parent{ this->nil_ };
+        Node* x{ left };
+        while (leftHeight > rightHeight + 1)
+        {
+            leftHeight -= (x->balance_ == 1) ? 2 : 1;
+            parent = x;
+            x = x->right_;
+        }
+
+        BinarySearchTree<Node, Compare, Multi>::joinNodes(x, middle, right);
+        middle->balance_ = leftHeight - rightHeight;
+        middle->parent_ = parent;
+        parent->right_ = middle;
+        this->root_ = left;
+        this->updatePath(middle);
+        insertBalance(parent, -1);
+        return this->root_;
+    }
+    else if (rightHeight > leftHeight + 1)
+    {
+        Node* parent{ this->nil_ };
+        Node* x{ right };
+        while (rightHeight > leftHeight + 1)
+        {
+            rightHeight -= (x->balance_ == -1) ? 2 : 1;
+            parent = x;
+            x = x->left_;
+        }
+
+        BinarySearchTree<Node, Compare, Multi>::joinNodes(left, middle, x);
+        middle->balance_ = leftHeight - rightHeight;
+        middle->parent_ = parent;
+        parent->left_ = middle;
+        this->root_ = right;
+        this->updatePath(middle);
+        insertBalance(parent, 1);
+        return this->root_;
     }
 
-    if (source->right_ != this->nil_)
+    middle->balance_ = leftHeight - rightHeight;
+    return BinarySearchTree<Node, Compare, Multi>::joinNodes(left, middle, right);
+}
+
+template<typename Node, typename Compare, bool Multi>
+int AVLTree<Node, Compare, Multi>::spineHeight(Node* node) const
+{
+    int height{ 0 };
+    while (node != this->nil_)
     {
-        source->right_->parent_ = target;
+        ++height;
+        node = (node->balance_ < 0) ? node->right_ : node->left_;
     }
+    return height;
+}
+
+// Links source, the only child of target, to the place of target in the tree.
+// Nodes are moved instead of copying the keys and values between them,
+// so the node pointers held by the caller stay valid.
+template<typename Node, typename Compare, bool Multi>
+void AVLTree<Node, Compare, Multi>::replace(Node* target, Node* source)
+{
+    Node* parent{ target->parent_ };
+    source->parent_ = parent;
 
-    delete source;
+    if (target == this->root_)
+    {
+        this->root_ = source;
+    }
+    else if (parent->left_ == target)
+    {
+        parent->left_ = source;
+    }
+    else
+    {
+        parent->right_ = source;
+    }
 }
 
 #endif // AVTREE_CPP
@@ -10,40 +10,41 @@
 #include "binarysearchtree.hh"
 #include <utility>
 
-template<typename Key, typename Value>
-struct AVLNode
+template<typename Key, typename Value, bool Threaded = false, typename Monoid = void, bool AtomicLinks = false>
+struct AVLNode : InOrderLinks<AVLNode<Key, Value, Threaded, Monoid, AtomicLinks>, Threaded>, NodeValue<Value>,
+                SubtreeSummary<Monoid>
 {
     using key_type = Key;
     using mapped_type = Value;
+    using link_type = typename NodeLink<AVLNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>, AtomicLinks>::type;
 
     key_type key_;
-    mapped_type value_;
-    AVLNode<key_type, mapped_type>* parent_;
-    AVLNode<key_type, mapped_type>* left_;
-    AVLNode<key_type, mapped_type>* right_;
+    link_type parent_;
+    link_type left_;
+    link_type right_;
     int balance_;
 
     AVLNode() :
-        key_{}, value_{},
+        key_{},
         parent_{}, left_{}, right_{},
         balance_{ 0 }
     {}
 
-    AVLNode(const key_type& key, const mapped_type& value,
-            AVLNode<key_type, mapped_type>* parent,
-            AVLNode<key_type, mapped_type>* left,
-            AVLNode<key_type, mapped_type>* right) :
-        key_{ key }, value_{ value },
+    AVLNode(const key_type& key, const typename NodeValue<Value>::argument_type& value,
+            AVLNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* parent,
+            AVLNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* left,
+            AVLNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* right) :
+        NodeValue<Value>{ value }, key_{ key },
         parent_{ parent }, left_{ left }, right_{ right },
         balance_{ 0 }
     {}
 
-    AVLNode(const key_type& key, const mapped_type& value,
-            AVLNode<key_type, mapped_type>* parent,
-            AVLNode<key_type, mapped_type>* left,
-            AVLNode<key_type, mapped_type>* right,
+    AVLNode(const key_type& key, const typename NodeValue<Value>::argument_type& value,
+            AVLNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* parent,
+            AVLNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* left,
+            AVLNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* right,
             int balance) :
-        key_{ key }, value_{ value },
+        NodeValue<Value>{ value }, key_{ key },
         parent_{ parent }, left_{ left }, right_{ right },
         balance_{ balance }
     {}
@@ -65,23 +66,39 @@ struct AVLNode
     }
 };
 
-template<typename Node>
-class AVLTree : public BinarySearchTree<Node>
+template<typename Node, typename Compare = std::less<typename Node::key_type>, bool Multi = false>
+class AVLTree : public BinarySearchTree<Node, Compare, Multi>
 {
 public:
     using key_type = typename Node::key_type;
     using mapped_type = typename Node::mapped_type;
-    using value_type = std::pair<const key_type, mapped_type>;
-    using size_type = typename BinarySearchTree<Node>::size_type;
+    using value_type = typename BinarySearchTree<Node, Compare, Multi>::value_type;
+    using size_type = typename BinarySearchTree<Node, Compare, Multi>::size_type;
     using node_type = Node;
 
     AVLTree();
+    explicit AVLTree(const Compare& compare);
     virtual ~AVLTree();
 
-    virtual bool insert(const value_type& value);
-    virtual size_type erase(const key_type& key);
+    // Moves the entries with keys not less than key to other, whose keys all have to
+    // be greater. The moved nodes are split off and joined to other in O(log² n)
+    // time and then relinked to other in one pass, so they are not reallocated.
+    void splitGreater(const key_type& key, AVLTree& other);
+    // Moves the entries with keys less than key to other, whose keys all have to be less
+    void splitLess(const key_type& key, AVLTree& other);
+    // Moves all the entries of other to this tree. The keys of other have to be all
+    // less or all greater than the keys of this tree.
+    void join(AVLTree& other);
+
+protected:
+    virtual bool insertNode(Node* node);
+    virtual bool insertNodeNear(Node* node, Node* hint);
+    virtual void removeNode(Node* node);
+    virtual Node* joinNodes(Node* left, Node* middle, Node* right);
 
 private:
+    // The height of the subtree of node, found by following the higher child down
+    int spineHeight(Node* node) const;
     void insertBalance(Node* node, int balance);
     void deleteBalance(Node* node, int balance);
     Node* rotateLeft(Node* x);
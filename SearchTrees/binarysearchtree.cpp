@@ -41,40 +41,51 @@ inline std::ostream& print_blue(std::ostream &s)
 
 } // namespace
 
-template<typename Node>
-BinarySearchTree<Node>::BinarySearchTree() :
+template<typename Node, typename Compare, bool Multi>
+BinarySearchTree<Node, Compare, Multi>::BinarySearchTree() :
+    BinarySearchTree{ Compare{} }
+{
+}
+
+template<typename Node, typename Compare, bool Multi>
+BinarySearchTree<Node, Compare, Multi>::BinarySearchTree(const Compare& compare) :
+    CompareStorage<Compare>{ compare },
     nil_{ new Node{} },
     root_{ nil_ },
-    nodes_{ 0 }
+    nodes_{ 0 },
+    rotations_{ 0 },
+    leftmost_{ nil_ },
+    rightmost_{ nil_ }
 {
 }
 
-template<typename Node>
-BinarySearchTree<Node>::~BinarySearchTree()
+template<typename Node, typename Compare, bool Multi>
+BinarySearchTree<Node, Compare, Multi>::~BinarySearchTree()
 {
-    auto node{ minimum() };
-    while (node != nil_)
-    {
-        erase(node->key_);
-        node = minimum();
-    }
+    destroyNodes();
     delete nil_;
 }
 
-template<typename Node>
-typename BinarySearchTree<Node>::size_type BinarySearchTree<Node>::size() const
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::size() const
 {
     return nodes_;
 }
 
-template<typename Node>
-int BinarySearchTree<Node>::height() const
+template<typename Node, typename Compare, bool Multi>
+unsigned long long BinarySearchTree<Node, Compare, Multi>::rotations() const
+{
+    return rotations_;
+}
+
+template<typename Node, typename Compare, bool Multi>
+int BinarySearchTree<Node, Compare, Multi>::height() const
 {
     return height(root_);
 }
 
-template<typename Node>
-int BinarySearchTree<Node>::height(Node* node) const
+template<typename Node, typename Compare, bool Multi>
+int BinarySearchTree<Node, Compare, Multi>::height(Node* node) const
 {
     if (node == nil_)
     {
@@ -100,7 +111,7 @@ int BinarySearchTree<Node>::height(Node* node) const
         }
         else
         {
-            auto y{ x->parent_ };
+            Node* y{ x->parent_ };
             while (y != nil_ and x == y->right_)
             {
                 x = y;
@@ -124,28 +135,224 @@ int BinarySearchTree<Node>::height(Node* node) const
     return hMax - hMin;
 }
 
-template<typename Node>
-void BinarySearchTree<Node>::clear()
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::clear()
 {
-    auto node{ minimum() };
-    while (node != nil_)
+    destroyNodes();
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::destroyNodes()
+{
+    // Right rotations flatten the tree into a list while it is being freed,
+    // so no stack is needed even when the tree is badly unbalanced.
+    Node* x{ root_ };
+    while (x != nil_)
     {
-        erase(node->key_);
-        node = minimum();
+        if (x->left_ != nil_)
+        {
+            Node* left{ x->left_ };
+            x->left_ = left->right_;
+            left->right_ = x;
+            x = left;
+        }
+        else
+        {
+            Node* right{ x->right_ };
+            delete x;
+            x = right;
+        }
     }
 
     root_ = nil_;
+    leftmost_ = nil_;
+    rightmost_ = nil_;
     nodes_ = 0;
 }
 
-template<typename Node>
-Node* BinarySearchTree<Node>::maximum() const
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::linkInOrder(Node* node)
 {
-    return maximum(root_);
+    linkThreads(node, Threading{});
+
+    if (node->parent_ == nil_)
+    {
+        leftmost_ = node;
+        rightmost_ = node;
+    }
+    else if (node == leftmost_->left_)
+    {
+        leftmost_ = node;
+    }
+    else if (node == rightmost_->right_)
+    {
+        rightmost_ = node;
+    }
 }
 
-template<typename Node>
-Node* BinarySearchTree<Node>::maximum(Node* node) const
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::unlinkInOrder(Node* node)
+{
+    if (node == leftmost_)
+    {
+        leftmost_ = successor(node, Threading{});
+    }
+    if (node == rightmost_)
+    {
+        rightmost_ = predecessor(node, Threading{});
+    }
+
+    unlinkThreads(node, Threading{});
+}
+
+// A new leaf is next to its parent in the in-order sequence
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::linkThreads(Node* node, std::true_type)
+{
+    Node* parent{ node->parent_ };
+    if (parent == nil_)
+    {
+        node->prev_ = nil_;
+        node->next_ = nil_;
+        return;
+    }
+
+    if (node == parent->left_)
+    {
+        node->prev_ = parent->prev_;
+        node->next_ = parent;
+    }
+    else
+    {
+        node->prev_ = parent;
+        node->next_ = parent->next_;
+    }
+
+    if (node->prev_ != nil_)
+    {
+        node->prev_->next_ = node;
+    }
+    if (node->next_ != nil_)
+    {
+        node->next_->prev_ = node;
+    }
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::linkThreads(Node*, std::false_type)
+{
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::unlinkThreads(Node* node, std::true_type)
+{
+    if (node->prev_ != nil_)
+    {
+        node->prev_->next_ = node->next_;
+    }
+    if (node->next_ != nil_)
+    {
+        node->next_->prev_ = node->prev_;
+    }
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::unlinkThreads(Node*, std::false_type)
+{
+}
+
+// Makes after the next node of before, either of which may be nil_
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::linkNeighbours(Node* before, Node* after, std::true_type)
+{
+    if (before != nil_)
+    {
+        before->next_ = after;
+    }
+    if (after != nil_)
+    {
+        after->prev_ = before;
+    }
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::linkNeighbours(Node*, Node*, std::false_type)
+{
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::adoptThreads(Node* node, Node* nil, std::true_type)
+{
+    if (node->prev_ == nil)
+    {
+        node->prev_ = nil_;
+    }
+    if (node->next_ == nil)
+    {
+        node->next_ = nil_;
+    }
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::adoptThreads(Node*, Node*, std::false_type)
+{
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::updateSummary(Node* node)
+{
+    updateSummary(node, Summarizing{});
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::updatePath(Node* node)
+{
+    updatePath(node, Summarizing{});
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::refreshSummaries(Node* node)
+{
+    updatePath(node, Summarizing{});
+}
+
+// The summary of nil_ is the identity and it is never changed,
+// so the missing children need no special handling
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::updateSummary(Node* node, std::true_type)
+{
+    using Monoid = typename Node::monoid_type;
+    node->summary_ = Monoid::combine(Monoid::combine(node->left_->summary_, Monoid::lift(node->value_)),
+                                     node->right_->summary_);
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::updateSummary(Node*, std::false_type)
+{
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::updatePath(Node* node, std::true_type)
+{
+    for (; node != nil_; node = node->parent_)
+    {
+        updateSummary(node, std::true_type{});
+    }
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::updatePath(Node*, std::false_type)
+{
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::maximum() const
+{
+    return rightmost_;
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::maximum(Node* node) const
 {
     if (node == nil_)
     {
@@ -160,14 +367,14 @@ Node* BinarySearchTree<Node>::maximum(Node* node) const
     return x;
 }
 
-template<typename Node>
-Node* BinarySearchTree<Node>::minimum() const
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::minimum() const
 {
-    return minimum(root_);
+    return leftmost_;
 }
 
-template<typename Node>
-Node* BinarySearchTree<Node>::minimum(Node* node) const
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::minimum(Node* node) const
 {
     if (node == nil_)
     {
@@ -182,21 +389,33 @@ Node* BinarySearchTree<Node>::minimum(Node* node) const
     return x;
 }
 
-template<typename Node>
-Node* BinarySearchTree<Node>::successor(Node* node) const
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::successor(Node* node) const
 {
     if (node == nil_)
     {
         return nil_;
     }
 
+    return successor(node, Threading{});
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::successor(Node* node, std::true_type) const
+{
+    return node->next_;
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::successor(Node* node, std::false_type) const
+{
     if (node->right_ != nil_)
     {
         return minimum(node->right_);
     }
 
     auto x{ node };
-    auto y{ x->parent_ };
+    Node* y{ x->parent_ };
     while (y != nil_ and x == y->right_)
     {
         x = y;
@@ -205,21 +424,33 @@ Node* BinarySearchTree<Node>::successor(Node* node) const
     return y;
 }
 
-template<typename Node>
-Node* BinarySearchTree<Node>::predecessor(Node* node) const
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::predecessor(Node* node) const
 {
     if (node == nil_)
     {
         return nil_;
     }
 
+    return predecessor(node, Threading{});
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::predecessor(Node* node, std::true_type) const
+{
+    return node->prev_;
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::predecessor(Node* node, std::false_type) const
+{
     if (node->left_ != nil_)
     {
         return maximum(node->left_);
     }
 
     auto x{ node };
-    auto y{ x->parent_ };
+    Node* y{ x->parent_ };
     while (y != nil_ and x == y->left_)
     {
         x = y;
@@ -228,8 +459,8 @@ Node* BinarySearchTree<Node>::predecessor(Node* node) const
     return y;
 }
 
-template<typename Node>
-bool BinarySearchTree<Node>::isInTree(Node* node) const
+template<typename Node, typename Compare, bool Multi>
+bool BinarySearchTree<Node, Compare, Multi>::isInTree(Node* node) const
 {
     if (node == nil_ or root_ == nil_)
     {
@@ -249,67 +480,239 @@ bool BinarySearchTree<Node>::isInTree(Node* node) const
     return false;
 }
 
-template<typename Node>
-Node* BinarySearchTree<Node>::find(const key_type& key) const
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::nil() const
+{
+    return nil_;
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::root() const
+{
+    return root_;
+}
+
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::key_compare BinarySearchTree<Node, Compare, Multi>::keyCompare() const
 {
-    auto x{ root_ };
+    return this->comparator();
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::find(const key_type& key) const
+{
+    return findNode(key);
+}
+
+template<typename Node, typename Compare, bool Multi>
+template<typename K, typename C, typename>
+Node* BinarySearchTree<Node, Compare, Multi>::find(const K& key) const
+{
+    return findNode(key);
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::lowerBound(const key_type& key) const
+{
+    Node* x{ root_ };
+    auto bound{ nil_ };
     while (x != nil_)
     {
-        if (key < x->key_)
+        if (less(x->key_, key))
+        {
+            x = x->right_;
+        }
+        else
         {
+            bound = x;
             x = x->left_;
         }
-        else if (x->key_ < key)
+    }
+    return bound;
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::upperBound(const key_type& key) const
+{
+    Node* x{ root_ };
+    auto bound{ nil_ };
+    while (x != nil_)
+    {
+        if (less(key, x->key_))
         {
-            x = x->right_;
+            bound = x;
+            x = x->left_;
         }
         else
         {
-            return x;
+            x = x->right_;
         }
     }
-    return x;
+    return bound;
 }
 
-template<typename Node>
-bool BinarySearchTree<Node>::insert(const value_type& value)
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::count(const key_type& key) const
 {
-    Node* x{ root_ };
-    Node* parent{ nil_ };
+    size_type entries{ 0 };
+    for (auto x = lowerBound(key); x != nil_ and not less(key, x->key_); x = successor(x))
+    {
+        ++entries;
+    }
+    return entries;
+}
+
+template<typename Node, typename Compare, bool Multi>
+std::pair<Node*, Node*> BinarySearchTree<Node, Compare, Multi>::equalRange(const key_type& key) const
+{
+    auto first{ lowerBound(key) };
+    auto last{ first };
+    while (last != nil_ and not less(key, last->key_))
+    {
+        last = successor(last);
+    }
+    return std::pair<Node*, Node*>{ first, last };
+}
 
+// Splits the search at the topmost node x in [lo, hi]. In the left subtree of x,
+// every node that is not less than lo contributes itself and its right subtree,
+// and in the right subtree of x, every node that is not greater than hi
+// contributes its left subtree and itself. The summaries are combined in the
+// in-order sequence, so the monoid does not need to be commutative.
+template<typename Node, typename Compare, bool Multi>
+template<typename N, typename Monoid>
+typename Monoid::summary_type BinarySearchTree<Node, Compare, Multi>::aggregate(const key_type& lo, const key_type& hi) const
+{
+    Node* x{ root_ };
     while (x != nil_)
     {
-        parent = x;
-        if (value.first < x->key_)
+        if (less(hi, x->key_))
         {
             x = x->left_;
         }
-        else if (x->key_ < value.first)
+        else if (less(x->key_, lo))
         {
             x = x->right_;
         }
         else
         {
-            // Key alreydy exists in the tree
-            return false;
+            break;
+        }
+    }
+    if (x == nil_)
+    {
+        return Monoid::identity();
+    }
+
+    auto left{ Monoid::identity() };
+    for (Node* y = x->left_; y != nil_; )
+    {
+        if (less(y->key_, lo))
+        {
+            y = y->right_;
+        }
+        else
+        {
+            left = Monoid::combine(Monoid::lift(y->value_), Monoid::combine(y->right_->summary_, left));
+            y = y->left_;
+        }
+    }
+
+    auto right{ Monoid::identity() };
+    for (Node* y = x->right_; y != nil_; )
+    {
+        if (less(hi, y->key_))
+        {
+            y = y->left_;
+        }
+        else
+        {
+            right = Monoid::combine(right, Monoid::combine(y->left_->summary_, Monoid::lift(y->value_)));
+            y = y->right_;
+        }
+    }
+
+    return Monoid::combine(left, Monoid::combine(Monoid::lift(x->value_), right));
+}
+
+template<typename Node, typename Compare, bool Multi>
+bool BinarySearchTree<Node, Compare, Multi>::insert(const value_type& value)
+{
+    Node* node{ createNode(value, std::is_void<mapped_type>{}) };
+
+    if (not insertNode(node))
+    {
+        delete node;
+        return false;
+    }
+    return true;
+}
+
+template<typename Node, typename Compare, bool Multi>
+bool BinarySearchTree<Node, Compare, Multi>::insert(node_handle&& handle)
+{
+    if (handle.empty() or not insertNode(handle.get()))
+    {
+        return false;
+    }
+
+    handle.release();
+    return true;
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::insert(Node* hint, const value_type& value)
+{
+    Node* node{ createNode(value, std::is_void<mapped_type>{}) };
+
+    if (not insertNodeNear(node, hint))
+    {
+        delete node;
+        return nil_;
+    }
+    return node;
+}
+
+// The trees move nodes instead of copying keys between them, so the previous
+// new node stays valid as the hint while the tree is rebalanced
+template<typename Node, typename Compare, bool Multi>
+template<typename InputIt>
+typename BinarySearchTree<Node, Compare, Multi>::size_type
+BinarySearchTree<Node, Compare, Multi>::insertSorted(InputIt first, InputIt last)
+{
+    size_type inserted{ 0 };
+    Node* hint{ nil_ };
+    for (; first != last; ++first)
+    {
+        Node* node{ insert(hint, *first) };
+        if (node != nil_)
+        {
+            hint = node;
+            ++inserted;
         }
     }
+    return inserted;
+}
 
-    Node* node{
-        new Node{ value.first, value.second,
-                  parent, nil_, nil_ } };
-//    Node* node{ new Node{} };
-//    node->key_ = value.first;
-//    node->value_ = value.second;
-//    node->parent_ = parent;
-//    node->left_ = nil_;
-//    node->right_ = nil_;
+template<typename Node, typename Compare, bool Multi>
+bool BinarySearchTree<Node, Compare, Multi>::insertNode(Node* node)
+{
+    Node* parent{ nil_ };
+    int order{ 0 };
+    if (not findParent(node, nil_, parent, order))
+    {
+        return false;
+    }
+
+    node->parent_ = parent;
+    node->left_ = nil_;
+    node->right_ = nil_;
 
     if (parent == nil_)
     {
         root_ = node;
     }
-    else if (node->key_ < parent->key_)
+    else if (order < 0)
     {
         parent->left_ = node;
     }
@@ -318,19 +721,218 @@ bool BinarySearchTree<Node>::insert(const value_type& value)
         parent->right_ = node;
     }
     ++nodes_;
+    linkInOrder(node);
+    updatePath(node);
 
     return true;
 }
 
-template<typename Node>
-typename BinarySearchTree<Node>::size_type BinarySearchTree<Node>::erase(const key_type& key)
+template<typename Node, typename Compare, bool Multi>
+bool BinarySearchTree<Node, Compare, Multi>::insertNodeNear(Node* node, Node*)
+{
+    return insertNode(node);
+}
+
+// If node goes between hint and its successor, its place is either the empty right
+// child of hint or the empty left child of the successor, which is then the
+// leftmost node in the right subtree of hint
+template<typename Node, typename Compare, bool Multi>
+bool BinarySearchTree<Node, Compare, Multi>::findParent(const Node* node, Node* hint,
+                                                        Node*& parent, int& order) const
+{
+    if (hint != nil_ and (Multi ? not less(node->key_, hint->key_) : less(hint->key_, node->key_)))
+    {
+        Node* next{ successor(hint) };
+        if (next == nil_ or less(node->key_, next->key_))
+        {
+            if (hint->right_ == nil_)
+            {
+                parent = hint;
+                order = 1;
+            }
+            else
+            {
+                parent = next;
+                order = -1;
+            }
+            return true;
+        }
+    }
+
+    Node* x{ root_ };
+    parent = nil_;
+    order = 0;
+
+    while (x != nil_)
+    {
+        parent = x;
+        order = compareKeys(node->key_, x->key_);
+        if (order < 0)
+        {
+            x = x->left_;
+        }
+        else if (order > 0 or Multi)
+        {
+            // Equal keys of a multimap go after the existing ones
+            x = x->right_;
+        }
+        else
+        {
+            // Key alreydy exists in the tree
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::erase(const key_type& key)
+{
+    return eraseKey(key);
+}
+
+template<typename Node, typename Compare, bool Multi>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::erase(const K& key)
+{
+    return eraseKey(key);
+}
+
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::erase(Node* node)
+{
+    return eraseNode(node);
+}
+
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::node_handle BinarySearchTree<Node, Compare, Multi>::extract(const key_type& key)
+{
+    auto node{ findNode(key) };
+    if (node == nil_)
+    {
+        return node_handle{};
+    }
+
+    unlinkInOrder(node);
+    removeNode(node);
+    --nodes_;
+    return node_handle{ node };
+}
+
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::popMin()
+{
+    return eraseNode(leftmost_);
+}
+
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::popMax()
+{
+    return eraseNode(rightmost_);
+}
+
+// Creates a set node from the key
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::createNode(const value_type& value, std::true_type) const
+{
+    return new Node{ value, NoValue{}, nil_, nil_, nil_ };
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::createNode(const value_type& value, std::false_type) const
+{
+    return new Node{ value.first, value.second, nil_, nil_, nil_ };
+}
+
+template<typename Node, typename Compare, bool Multi>
+template<typename A, typename B>
+bool BinarySearchTree<Node, Compare, Multi>::less(const A& a, const B& b) const
+{
+    return this->comparator()(a, b);
+}
+
+template<typename Node, typename Compare, bool Multi>
+template<typename A, typename B>
+int BinarySearchTree<Node, Compare, Multi>::compareKeys(const A& a, const B& b) const
+{
+    return compareKeys(a, b, HasThreeWayCompare<Compare, A, B>{});
+}
+
+template<typename Node, typename Compare, bool Multi>
+template<typename A, typename B>
+int BinarySearchTree<Node, Compare, Multi>::compareKeys(const A& a, const B& b, std::true_type) const
+{
+    return this->comparator().compare(a, b);
+}
+
+template<typename Node, typename Compare, bool Multi>
+template<typename A, typename B>
+int BinarySearchTree<Node, Compare, Multi>::compareKeys(const A& a, const B& b, std::false_type) const
+{
+    if (less(a, b))
+    {
+        return -1;
+    }
+    return less(b, a) ? 1 : 0;
+}
+
+template<typename Node, typename Compare, bool Multi>
+template<typename K>
+Node* BinarySearchTree<Node, Compare, Multi>::findNode(const K& key) const
+{
+    Node* x{ root_ };
+    while (x != nil_)
+    {
+        int order{ compareKeys(key, x->key_) };
+        if (order < 0)
+        {
+            x = x->left_;
+        }
+        else if (order > 0)
+        {
+            x = x->right_;
+        }
+        else
+        {
+            return x;
+        }
+    }
+    return x;
+}
+
+template<typename Node, typename Compare, bool Multi>
+template<typename K>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::eraseKey(const K& key)
+{
+    size_type erased{ 0 };
+    for (auto node = findNode(key); node != nil_; node = Multi ? findNode(key) : nil_)
+    {
+        erased += eraseNode(node);
+    }
+    return erased;
+}
+
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::eraseNode(Node* node)
 {
-    auto node{ find(key) };
     if (node == nil_)
     {
         return 0;
     }
 
+    unlinkInOrder(node);
+    removeNode(node);
+    delete node;
+    --nodes_;
+    return 1;
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::removeNode(Node* node)
+{
+    // The lowest node whose subtree changes
+    Node* changed{ node->parent_ };
+
     if (node->left_ == nil_)
     {
         transplant(node, node->right_);
@@ -342,8 +944,10 @@ typename BinarySearchTree<Node>::size_type BinarySearchTree<Node>::erase(const k
     else
     {
         Node* y{ minimum(node->right_) };
+        changed = y;
         if (y->parent_ != node)
         {
+            changed = y->parent_;
             transplant(y, y->right_);
             y->right_ = node->right_;
             y->right_->parent_ = y;
@@ -353,13 +957,11 @@ typename BinarySearchTree<Node>::size_type BinarySearchTree<Node>::erase(const k
         y->left_->parent_ = y;
     }
 
-    delete node;
-    --nodes_;
-    return 1;
+    updatePath(changed);
 }
 
-template<typename Node>
-void BinarySearchTree<Node>::transplant(Node* u, Node* v)
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::transplant(Node* u, Node* v)
 {
     if (u == nil_)
     {
@@ -385,8 +987,229 @@ void BinarySearchTree<Node>::transplant(Node* u, Node* v)
     }
 }
 
-template<typename Node>
-void BinarySearchTree<Node>::print() const
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::joinNodes(Node* left, Node* middle, Node* right)
+{
+    middle->parent_ = nil_;
+    middle->left_ = left;
+    middle->right_ = right;
+    if (left != nil_)
+    {
+        left->parent_ = middle;
+    }
+    if (right != nil_)
+    {
+        right->parent_ = middle;
+    }
+
+    updateSummary(middle);
+    return middle;
+}
+
+// The split follows the path of key down from the root and joins the subtrees on
+// each side of the path back together on the way up, as in G.E. Blelloch, D. Ferizovic,
+// Y. Sun, Just join for parallel ordered sets, Proceedings of the 28th ACM Symposium
+// on Parallelism in Algorithms and Architectures, 2016, pp. 253-264
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::splitInto(const key_type& key, BinarySearchTree& other, bool greater)
+{
+    Node* first{ lowerBound(key) };
+    Node* last{ (first == nil_) ? rightmost_ : predecessor(first, Threading{}) };
+    Node* movedFirst{ greater ? first : leftmost_ };
+    Node* movedLast{ greater ? rightmost_ : last };
+    if (movedFirst == nil_ or movedLast == nil_)
+    {
+        return;
+    }
+
+    Node* lower{ nil_ };
+    Node* upper{ nil_ };
+    splitNodes(root_, key, lower, upper);
+    linkNeighbours(last, nil_, Threading{});
+    linkNeighbours(nil_, first, Threading{});
+
+    Node* moved{ nil_ };
+    if (greater)
+    {
+        moved = upper;
+        root_ = lower;
+        leftmost_ = (last == nil_) ? nil_ : leftmost_;
+        rightmost_ = last;
+    }
+    else
+    {
+        moved = lower;
+        root_ = upper;
+        leftmost_ = first;
+        rightmost_ = (first == nil_) ? nil_ : rightmost_;
+    }
+
+    size_type count{ other.adoptNodes(moved, nil_) };
+    nodes_ -= count;
+    other.attachNodes(moved, movedFirst, movedLast, count, not greater);
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::joinFrom(BinarySearchTree& other)
+{
+    if (other.nodes_ == 0)
+    {
+        return;
+    }
+
+    bool after{ nodes_ == 0 or not less(other.leftmost_->key_, rightmost_->key_) };
+    Node* node{ other.root_ };
+    Node* first{ other.leftmost_ };
+    Node* last{ other.rightmost_ };
+    size_type count{ other.nodes_ };
+    other.root_ = other.nil_;
+    other.leftmost_ = other.nil_;
+    other.rightmost_ = other.nil_;
+    other.nodes_ = 0;
+
+    adoptNodes(node, other.nil_);
+    attachNodes(node, first, last, count, after);
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::splitNodes(Node* node, const key_type& key, Node*& lower, Node*& upper)
+{
+    if (node == nil_)
+    {
+        lower = nil_;
+        upper = nil_;
+        return;
+    }
+
+    Node* left{ node->left_ };
+    Node* right{ node->right_ };
+    if (left != nil_)
+    {
+        left->parent_ = nil_;
+    }
+    if (right != nil_)
+    {
+        right->parent_ = nil_;
+    }
+
+    if (less(node->key_, key))
+    {
+        Node* rest{ nil_ };
+        splitNodes(right, key, rest, upper);
+        lower = joinNodes(left, node, rest);
+    }
+    else
+    {
+        Node* rest{ nil_ };
+        splitNodes(left, key, lower, rest);
+        upper = joinNodes(rest, node, right);
+    }
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::splitLast(Node* node, Node*& rest, Node*& last)
+{
+    Node* left{ node->left_ };
+    Node* right{ node->right_ };
+    if (left != nil_)
+    {
+        left->parent_ = nil_;
+    }
+
+    if (right == nil_)
+    {
+        last = node;
+        rest = left;
+        return;
+    }
+
+    right->parent_ = nil_;
+    Node* remaining{ nil_ };
+    splitLast(right, remaining, last);
+    rest = joinNodes(left, node, remaining);
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* BinarySearchTree<Node, Compare, Multi>::joinTrees(Node* lower, Node* upper)
+{
+    if (lower == nil_)
+    {
+        return upper;
+    }
+
+    Node* rest{ nil_ };
+    Node* last{ nil_ };
+    splitLast(lower, rest, last);
+    return joinNodes(rest, last, upper);
+}
+
+// The subtree is walked in preorder with the parent links, so the walk needs no
+// stack. The links of a node are adopted before the walk follows them.
+template<typename Node, typename Compare, bool Multi>
+typename BinarySearchTree<Node, Compare, Multi>::size_type BinarySearchTree<Node, Compare, Multi>::adoptNodes(Node* node, Node* nil)
+{
+    size_type count{ 0 };
+    node->parent_ = nil_;
+    Node* x{ node };
+    while (x != nil_)
+    {
+        ++count;
+        if (x->left_ == nil)
+        {
+            x->left_ = nil_;
+        }
+        if (x->right_ == nil)
+        {
+            x->right_ = nil_;
+        }
+        adoptThreads(x, nil, Threading{});
+
+        if (x->left_ != nil_)
+        {
+            x = x->left_;
+        }
+        else if (x->right_ != nil_)
+        {
+            x = x->right_;
+        }
+        else
+        {
+            while (x != node and (x == x->parent_->right_ or x->parent_->right_ == nil_))
+            {
+                x = x->parent_;
+            }
+            x = (x == node) ? nil_ : x->parent_->right_;
+        }
+    }
+    return count;
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::attachNodes(Node* node, Node* first, Node* last, size_type count, bool after)
+{
+    if (nodes_ == 0)
+    {
+        root_ = node;
+        leftmost_ = first;
+        rightmost_ = last;
+    }
+    else if (after)
+    {
+        linkNeighbours(rightmost_, first, Threading{});
+        root_ = joinTrees(root_, node);
+        rightmost_ = last;
+    }
+    else
+    {
+        linkNeighbours(last, leftmost_, Threading{});
+        root_ = joinTrees(node, root_);
+        leftmost_ = first;
+    }
+    nodes_ += count;
+}
+
+template<typename Node, typename Compare, bool Multi>
+void BinarySearchTree<Node, Compare, Multi>::print() const
 {
     const int NODE_WIDTH{ 3 };
     const int NODE_SPACE{ 1 };
@@ -546,8 +1369,8 @@ struct ColorStruct<Node, false>
     ColorStruct<Node, false>(...) : color_{ PrintColor::White } {}
 };
 
-template<typename Node>
-PrintColor BinarySearchTree<Node>::getPrintColor(Node* node) const
+template<typename Node, typename Compare, bool Multi>
+PrintColor BinarySearchTree<Node, Compare, Multi>::getPrintColor(Node* node) const
 {
     ColorStruct<Node, Has_color<Node>()> colorStruct{ node };
     return colorStruct.color_;
@@ -8,6 +8,10 @@
 #ifndef BINARYSEARCHTREE_HH
 #define BINARYSEARCHTREE_HH
 
+#include "nodehandle.hh"
+#include <atomic>
+#include <functional>
+#include <type_traits>
 #include <utility>
 
 enum class PrintColor
@@ -17,50 +21,277 @@ enum class PrintColor
     Blue
 };
 
-template<typename Key, typename Value>
-struct TreeNode
+// The explicit in-order links of a threaded node. When a node type is threaded,
+// the tree keeps prev_ and next_ pointing to the in-order neighbours (nil at the
+// ends), and successor and predecessor just follow them. Rotations and moving
+// nodes around do not change the in-order sequence, so the links only need
+// updating when a node is linked to or unlinked from the tree.
+template<typename Node, bool Threaded>
+struct InOrderLinks
+{};
+
+template<typename Node>
+struct InOrderLinks<Node, true>
+{
+    Node* prev_;
+    Node* next_;
+
+    InOrderLinks() :
+        prev_{}, next_{}
+    {}
+};
+
+// A link that readers may load without locking the tree while a writer changes it,
+// as in the optimistic mode of ConcurrentTree. The stores release and the loads
+// acquire, so a reader that reaches a new node also sees its key. On x86 both are
+// plain moves, but the compiler cannot merge or reorder them like plain pointers.
+template<typename Node>
+class AtomicLink
+{
+public:
+    AtomicLink(Node* node = nullptr) :
+        link_{ node }
+    {}
+
+    AtomicLink(const AtomicLink& other) :
+        link_{ other.get() }
+    {}
+
+    AtomicLink& operator=(const AtomicLink& other)
+    {
+        link_.store(other.get(), std::memory_order_release);
+        return *this;
+    }
+
+    AtomicLink& operator=(Node* node)
+    {
+        link_.store(node, std::memory_order_release);
+        return *this;
+    }
+
+    Node* get() const
+    {
+        return link_.load(std::memory_order_acquire);
+    }
+
+    operator Node*() const
+    {
+        return get();
+    }
+
+    Node* operator->() const
+    {
+        return get();
+    }
+
+private:
+    std::atomic<Node*> link_;
+};
+
+// The type of the parent and child links of a node
+template<typename Node, bool Atomic>
+struct NodeLink
+{
+    using type = Node*;
+};
+
+template<typename Node>
+struct NodeLink<Node, true>
+{
+    using type = AtomicLink<Node>;
+};
+
+// The type of the root link of a tree, which is atomic if the links of the nodes are
+template<typename Node, typename = void>
+struct RootLink
+{
+    using type = Node*;
+};
+
+template<typename Node>
+struct RootLink<Node, std::void_t<typename Node::link_type>>
+{
+    using type = typename Node::link_type;
+};
+
+// Stands for the missing value in the constructors of the set nodes
+struct NoValue
+{};
+
+// The mapped value of a node. The nodes of sets, where the mapped type is void,
+// store no value, so they contain only the key, the links and the balance
+// information.
+template<typename Value>
+struct NodeValue
+{
+    using argument_type = Value;
+
+    Value value_;
+
+    NodeValue() :
+        value_{}
+    {}
+
+    explicit NodeValue(const Value& value) :
+        value_{ value }
+    {}
+};
+
+template<>
+struct NodeValue<void>
+{
+    using argument_type = NoValue;
+
+    NodeValue()
+    {}
+
+    explicit NodeValue(const NoValue&)
+    {}
+};
+
+// The summary of the values in the subtree of a node. Monoid provides
+//  summary_type: the type of the summaries
+//  identity(): the summary of an empty subtree
+//  lift(value): the summary of a single value
+//  combine(a, b): the summary of the values of a followed by the values of b,
+//                 which has to be associative
+// The tree keeps the summaries up to date through the insertions, the removals
+// and the rotations. Nodes without a monoid store no summary.
+template<typename Monoid>
+struct SubtreeSummary
+{
+    using monoid_type = Monoid;
+
+    typename Monoid::summary_type summary_;
+
+    SubtreeSummary() :
+        summary_{ Monoid::identity() }
+    {}
+};
+
+template<>
+struct SubtreeSummary<void>
+{};
+
+// Whether the node stores the summary of its subtree
+template<typename Node, typename = void>
+struct HasSubtreeSummary : std::false_type
+{};
+
+template<typename Node>
+struct HasSubtreeSummary<Node, std::void_t<typename Node::monoid_type>> : std::true_type
+{};
+
+template<typename Key, typename Value, bool Threaded = false, typename Monoid = void>
+struct TreeNode : InOrderLinks<TreeNode<Key, Value, Threaded, Monoid>, Threaded>, NodeValue<Value>,
+                 SubtreeSummary<Monoid>
 {
     using key_type = Key;
     using mapped_type = Value;
 
     key_type key_;
-    mapped_type value_;
-    TreeNode<key_type, mapped_type>* parent_;
-    TreeNode<key_type, mapped_type>* left_;
-    TreeNode<key_type, mapped_type>* right_;
+    TreeNode<key_type, mapped_type, Threaded, Monoid>* parent_;
+    TreeNode<key_type, mapped_type, Threaded, Monoid>* left_;
+    TreeNode<key_type, mapped_type, Threaded, Monoid>* right_;
 
     TreeNode() :
-        key_{}, value_{},
+        key_{},
         parent_{}, left_{}, right_{}
     {}
 
-    TreeNode(const key_type& key, const mapped_type& value,
-             TreeNode<key_type, mapped_type>* parent,
-             TreeNode<key_type, mapped_type>* left,
-             TreeNode<key_type, mapped_type>* right) :
-        key_{ key }, value_{ value },
+    TreeNode(const key_type& key, const typename NodeValue<Value>::argument_type& value,
+             TreeNode<key_type, mapped_type, Threaded, Monoid>* parent,
+             TreeNode<key_type, mapped_type, Threaded, Monoid>* left,
+             TreeNode<key_type, mapped_type, Threaded, Monoid>* right) :
+        NodeValue<Value>{ value }, key_{ key },
         parent_{ parent }, left_{ left }, right_{ right }
     {}
 };
 
-template<typename Node>
-class BinarySearchTree
+// Holds the comparison object of a tree. An empty comparison class is inherited
+// instead of stored as a member, so that it takes no space in the tree.
+template<typename Compare,
+         bool Empty = std::is_empty<Compare>::value and not std::is_final<Compare>::value>
+class CompareStorage : private Compare
+{
+public:
+    explicit CompareStorage(const Compare& compare) :
+        Compare{ compare }
+    {}
+
+    const Compare& comparator() const
+    {
+        return *this;
+    }
+};
+
+template<typename Compare>
+class CompareStorage<Compare, false>
+{
+public:
+    explicit CompareStorage(const Compare& compare) :
+        compare_{ compare }
+    {}
+
+    const Compare& comparator() const
+    {
+        return compare_;
+    }
+
+private:
+    Compare compare_;
+};
+
+// Whether the comparator has a three-way compare(a, b) member function that returns
+// a negative value, zero or a positive value when a is ordered before, equivalent
+// to or after b
+template<typename Compare, typename A, typename B, typename = void>
+struct HasThreeWayCompare : std::false_type
+{};
+
+template<typename Compare, typename A, typename B>
+struct HasThreeWayCompare<Compare, A, B,
+        std::void_t<decltype(std::declval<const Compare&>().compare(std::declval<const A&>(),
+                                                                    std::declval<const B&>()))>> :
+    std::true_type
+{};
+
+// The keys are ordered with Compare. If Compare is transparent (it defines
+// is_transparent, like std::less<>), find and erase also accept any key type
+// that Compare can compare with key_type, so for example a tree with
+// std::string keys can be searched with a std::string_view without
+// constructing a temporary string. If Compare also has a three-way compare
+// member function, the searches compare the key with each node only once.
+//
+// If Multi is true, the tree is a multimap (or a multiset) that keeps all the
+// inserted entries. Equal keys are ordered by their insertion order, find
+// returns any one of them and erase removes all of them.
+template<typename Node, typename Compare = std::less<typename Node::key_type>, bool Multi = false>
+class BinarySearchTree : private CompareStorage<Compare>
 {
 public:
     using key_type = typename Node::key_type;
     using mapped_type = typename Node::mapped_type;
-    using value_type = std::pair<const key_type, mapped_type>;
+    // A tree of nodes with a void mapped type is a set of keys
+    using value_type = typename std::conditional<std::is_void<mapped_type>::value, key_type,
+                                                 std::pair<const key_type, mapped_type>>::type;
     using size_type = unsigned int;
     using node_type = Node;
+    using node_handle = NodeHandle<Node>;
+    using key_compare = Compare;
 
     BinarySearchTree();
+    explicit BinarySearchTree(const Compare& compare);
     virtual ~BinarySearchTree();
 
     virtual size_type size() const;
     virtual int height() const;
+    // Returns the number of rotations done since the tree was created
+    virtual unsigned long long rotations() const;
 
     virtual void clear();
 
+    // The extremes are cached, so these take constant time
     virtual Node* maximum() const;
     virtual Node* minimum() const;
 
@@ -69,16 +300,78 @@ public:
 
     virtual bool isInTree(Node* node) const;
 
+    // Returns the sentinel node that ends the in-order sequence
+    Node* nil() const;
+    // Returns the root node, or nil if the tree is empty
+    Node* root() const;
+
+    // Returns a copy of the comparison object
+    key_compare keyCompare() const;
+
     virtual Node* find(const key_type& key) const;
+    // Returns the node with the smallest key that is not less than key, or nil
+    virtual Node* lowerBound(const key_type& key) const;
+    // Returns the node with the smallest key that is greater than key, or nil
+    virtual Node* upperBound(const key_type& key) const;
+    // Returns the number of entries with the given key in O(log n + count) time
+    size_type count(const key_type& key) const;
+    // Returns the nodes [first, last) that have the given key. Both are nil if
+    // all the keys are less than key.
+    std::pair<Node*, Node*> equalRange(const key_type& key) const;
     virtual bool insert(const value_type& value);
     virtual size_type erase(const key_type& key);
+    // Removes the node, which must be in the tree, without searching for its key.
+    // Returns the number of removed nodes, which is zero if node is nil.
+    virtual size_type erase(Node* node);
+
+    // Heterogeneous lookup, only available when Compare is transparent
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    Node* find(const K& key) const;
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    size_type erase(const K& key);
+
+    // Unlinks the node with the given key and hands it over to the caller.
+    // Returns an empty handle if the key is not in the tree.
+    virtual node_handle extract(const key_type& key);
+    // Links the node of the handle to the tree without reallocating it.
+    // If the key already exists in a tree that is not a multimap,
+    // returns false and the handle keeps the node.
+    bool insert(node_handle&& handle);
+    // Inserts the value searching for its place from hint, which should be the node
+    // with the largest key before the new key. When the keys are inserted in order,
+    // the previous new node is the hint and no search starts from the root. A wrong
+    // hint only costs the search from the root. Returns the new node, or nil if the
+    // key already exists in a tree that is not a multimap.
+    Node* insert(Node* hint, const value_type& value);
+    // Inserts the values with the previous new node as the hint, which is fastest
+    // when the values are sorted by key. Returns the number of inserted values.
+    template<typename InputIt>
+    size_type insertSorted(InputIt first, InputIt last);
+
+    // Returns the combined summary of the values with keys in [lo, hi] in O(log n)
+    // time. Only available when the nodes store subtree summaries.
+    template<typename N = Node, typename Monoid = typename N::monoid_type>
+    typename Monoid::summary_type aggregate(const key_type& lo, const key_type& hi) const;
+    // Recomputes the summaries on the path from node to the root. This has to be
+    // called after the value of node has been changed in place.
+    void refreshSummaries(Node* node);
+
+    // Remove the node with the smallest or the largest key without searching for it,
+    // so that the tree can be used as an ordered priority queue.
+    // Return the number of removed nodes.
+    virtual size_type popMin();
+    virtual size_type popMax();
 
     virtual void print() const;
 
 protected:
     Node* nil_;
-    Node* root_;
+    typename RootLink<Node>::type root_;
     size_type nodes_;
+    unsigned long long rotations_;
+    // The nodes with the smallest and the largest key, nil_ when the tree is empty
+    Node* leftmost_;
+    Node* rightmost_;
 
     virtual int height(Node* node) const;
     virtual Node* maximum(Node* node) const;
@@ -86,8 +379,121 @@ protected:
 
     PrintColor getPrintColor(Node* node) const;
 
+    // Returns true if a is ordered before b
+    template<typename A, typename B>
+    bool less(const A& a, const B& b) const;
+    // Returns a negative value, zero or a positive value when a is ordered before,
+    // equivalent to or after b. This is a single comparison if the comparator has
+    // a compare member function, otherwise two calls to the comparator at most.
+    template<typename A, typename B>
+    int compareKeys(const A& a, const B& b) const;
+
+    // Returns the node with the given key or nil_
+    template<typename K>
+    Node* findNode(const K& key) const;
+    // Removes the node with the given key, or all of them from a multimap,
+    // and returns the number of removed nodes
+    template<typename K>
+    size_type eraseKey(const K& key);
+    // Unlinks node from the tree and frees it. Returns the number of removed nodes,
+    // which is zero if node is nil_.
+    size_type eraseNode(Node* node);
+
+    // Frees all the nodes without rebalancing and leaves the tree empty
+    void destroyNodes();
+
+    // Updates the cached extremes and the in-order links after node has been
+    // linked to the tree as a leaf. Rotations do not change the in-order
+    // sequence, so they need no updates.
+    void linkInOrder(Node* node);
+    // Updates the cached extremes and the in-order links before node is
+    // unlinked from the tree
+    void unlinkInOrder(Node* node);
+
+    // Recomputes the subtree summary of node from its children. Rotations call
+    // this for the lower and then for the upper one of the rotated nodes.
+    void updateSummary(Node* node);
+    // Recomputes the subtree summaries from node up to the root. The balancing
+    // algorithms call this for the lowest changed node after a node has been linked
+    // or unlinked and before the tree is rebalanced, so that the rotations can
+    // rely on the summaries of the children.
+    void updatePath(Node* node);
+
+    // Links a detached node to the tree and rebalances the tree. The links and the
+    // balance information of the node are reset, so the node may come from another
+    // tree. Returns false if the key already exists, and then the node is not used.
+    // The node count is updated.
+    virtual bool insertNode(Node* node);
+    // Links node like insertNode, but searches for its place starting from hint.
+    // The trees that do not override this ignore the hint.
+    virtual bool insertNodeNear(Node* node, Node* hint);
+    // Finds the parent of the leaf position of node, and the order of node relative
+    // to the parent. The search starts from hint if node goes right after hint in
+    // the order, and otherwise from the root. Returns false if the key already
+    // exists in a tree that is not a multimap.
+    bool findParent(const Node* node, Node* hint, Node*& parent, int& order) const;
+    // Unlinks node from the tree and rebalances the tree.
+    // The node is not freed and the node count is not changed.
+    virtual void removeNode(Node* node);
+
+    // Links left and right, two subtrees whose roots have no parent, as the children
+    // of middle, which goes between them in the order, and returns the root of the
+    // joined subtree. The balanced trees override this to rebalance the joined
+    // subtree, which may use root_ while it rotates. The base tree does not rebalance.
+    virtual Node* joinNodes(Node* left, Node* middle, Node* right);
+    // Splits the tree at key with joinNodes and moves the nodes with keys not less
+    // than key, if greater is true, or the nodes with smaller keys to other, whose
+    // keys all have to be after or before them. The moved nodes are joined to other
+    // with joinNodes, and one pass over them points their links to the nil of other.
+    void splitInto(const key_type& key, BinarySearchTree& other, bool greater);
+    // Moves all the nodes of other to this tree. The keys of other have to be all
+    // before or all after the keys of this tree.
+    void joinFrom(BinarySearchTree& other);
+
 private:
+    using Threading = std::is_base_of<InOrderLinks<Node, true>, Node>;
+    using Summarizing = HasSubtreeSummary<Node>;
+
     void transplant(Node* u, Node* v);
+
+    // Splits the subtree of node, whose root has no parent, into the nodes with keys
+    // less than key and the rest
+    void splitNodes(Node* node, const key_type& key, Node*& lower, Node*& upper);
+    // Splits the node with the largest key off the subtree of node
+    void splitLast(Node* node, Node*& rest, Node*& last);
+    // Joins two subtrees when all the keys of lower are before the keys of upper
+    Node* joinTrees(Node* lower, Node* upper);
+    // Points the links of the subtree of node that point to nil, the sentinel of
+    // another tree, to nil_. Returns the number of nodes in the subtree.
+    size_type adoptNodes(Node* node, Node* nil);
+    // Joins the adopted subtree of node, whose smallest and largest nodes are first
+    // and last, after or before the nodes of the tree
+    void attachNodes(Node* node, Node* first, Node* last, size_type count, bool after);
+
+    Node* createNode(const value_type& value, std::true_type) const;
+    Node* createNode(const value_type& value, std::false_type) const;
+
+    template<typename A, typename B>
+    int compareKeys(const A& a, const B& b, std::true_type) const;
+    template<typename A, typename B>
+    int compareKeys(const A& a, const B& b, std::false_type) const;
+
+    Node* successor(Node* node, std::true_type) const;
+    Node* successor(Node* node, std::false_type) const;
+    Node* predecessor(Node* node, std::true_type) const;
+    Node* predecessor(Node* node, std::false_type) const;
+    void linkThreads(Node* node, std::true_type);
+    void linkThreads(Node* node, std::false_type);
+    void unlinkThreads(Node* node, std::true_type);
+    void unlinkThreads(Node* node, std::false_type);
+    void linkNeighbours(Node* before, Node* after, std::true_type);
+    void linkNeighbours(Node* before, Node* after, std::false_type);
+    void adoptThreads(Node* node, Node* nil, std::true_type);
+    void adoptThreads(Node* node, Node* nil, std::false_type);
+    void updateSummary(Node* node, std::true_type);
+    void updateSummary(Node* node, std::false_type);
+    void updatePath(Node* node, std::true_type);
+    void updatePath(Node* node, std::false_type);
 };
 
 #include "binarysearchtree.cpp"
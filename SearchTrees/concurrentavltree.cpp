@@ -0,0 +1,897 @@
+// Concurrent AVL tree implementation
+//
+// Implementation is based on N.G. Bronson, J. Casper, H. Chafi, K. Olukotun, A practical
+// concurrent binary search tree, Proceedings of the 15th ACM SIGPLAN Symposium on
+// Principles and Practice of Parallel Programming, 2010, pp. 257-268
+
+#ifndef CONCURRENTAVLTREE_CPP
+#define CONCURRENTAVLTREE_CPP
+
+#include "concurrentavltree.hh"
+#include <algorithm>
+#include <new>
+#include <thread>
+#include <vector>
+
+template<typename Node, typename Compare>
+ConcurrentAVLTree<Node, Compare>::ConcurrentAVLTree() :
+    ConcurrentAVLTree{ Compare{} }
+{
+}
+
+template<typename Node, typename Compare>
+ConcurrentAVLTree<Node, Compare>::ConcurrentAVLTree(const Compare& compare) :
+    CompareStorage<Compare>{ compare },
+    nodePool_{ NodePool::shared(sizeof(Node)) },
+    valuePool_{ NodePool::shared(sizeof(mapped_type)) },
+    holder_{ createNode(key_type{}, nullptr, nullptr) },
+    nodes_{ 0 }
+{
+}
+
+template<typename Node, typename Compare>
+ConcurrentAVLTree<Node, Compare>::~ConcurrentAVLTree()
+{
+    destroy(holder_);
+}
+
+template<typename Node, typename Compare>
+typename ConcurrentAVLTree<Node, Compare>::size_type ConcurrentAVLTree<Node, Compare>::size() const
+{
+    return nodes_.load(std::memory_order_relaxed);
+}
+
+template<typename Node, typename Compare>
+int ConcurrentAVLTree<Node, Compare>::height() const
+{
+    return depth(holder_->right_.load());
+}
+
+template<typename Node, typename Compare>
+void ConcurrentAVLTree<Node, Compare>::clear()
+{
+    destroy(holder_->right_.load());
+    holder_->right_.store(nullptr);
+    holder_->height_.store(1);
+    nodes_.store(0);
+}
+
+template<typename Node, typename Compare>
+bool ConcurrentAVLTree<Node, Compare>::contains(const key_type& key) const
+{
+    EpochReclamation::Guard guard;
+    return attemptFind(key, holder_, 1, 0, nullptr) == Result::Present;
+}
+
+template<typename Node, typename Compare>
+bool ConcurrentAVLTree<Node, Compare>::find(const key_type& key, mapped_type& value) const
+{
+    EpochReclamation::Guard guard;
+    return attemptFind(key, holder_, 1, 0, &value) == Result::Present;
+}
+
+template<typename Node, typename Compare>
+bool ConcurrentAVLTree<Node, Compare>::insert(const value_type& value)
+{
+    EpochReclamation::Guard guard;
+    if (attemptInsert(value, holder_, 1, 0) == Result::Absent)
+    {
+        nodes_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+template<typename Node, typename Compare>
+typename ConcurrentAVLTree<Node, Compare>::size_type ConcurrentAVLTree<Node, Compare>::erase(const key_type& key)
+{
+    EpochReclamation::Guard guard;
+    if (attemptErase(key, holder_, 1, 0) == Result::Present)
+    {
+        nodes_.fetch_sub(1, std::memory_order_relaxed);
+        return 1;
+    }
+    return 0;
+}
+
+template<typename Node, typename Compare>
+template<typename Visit>
+void ConcurrentAVLTree<Node, Compare>::forEach(Visit visit) const
+{
+    EpochReclamation::Guard guard;
+    forEach(holder_->right_.load(), visit);
+}
+
+template<typename Node, typename Compare>
+std::atomic<Node*>& ConcurrentAVLTree<Node, Compare>::child(Node* node, int direction)
+{
+    return (direction < 0) ? node->left_ : node->right_;
+}
+
+template<typename Node, typename Compare>
+int ConcurrentAVLTree<Node, Compare>::height(Node* node)
+{
+    return (node == nullptr) ? 0 : node->height_.load();
+}
+
+template<typename Node, typename Compare>
+bool ConcurrentAVLTree<Node, Compare>::isUnlinked(unsigned long long version)
+{
+    return (version & UNLINKED) != 0;
+}
+
+template<typename Node, typename Compare>
+bool ConcurrentAVLTree<Node, Compare>::isShrinking(unsigned long long version)
+{
+    return (version & SHRINKING) != 0;
+}
+
+template<typename Node, typename Compare>
+void ConcurrentAVLTree<Node, Compare>::waitUntilNotChanging(Node* node)
+{
+    while (isShrinking(node->version_.load()))
+    {
+        std::this_thread::yield();
+    }
+}
+
+template<typename Node, typename Compare>
+int ConcurrentAVLTree<Node, Compare>::direction(const key_type& key, const Node* node) const
+{
+    if (this->comparator()(key, node->key_))
+    {
+        return -1;
+    }
+    return this->comparator()(node->key_, key) ? 1 : 0;
+}
+
+// The child is read between two checks of the version of node, so it was the child
+// of node while the subtree of node still covered the key. The version of the
+// child is read before the search moves on, so that the next level can check it.
+template<typename Node, typename Compare>
+typename ConcurrentAVLTree<Node, Compare>::Result
+ConcurrentAVLTree<Node, Compare>::attemptFind(const key_type& key, Node* node, int direction,
+                                              unsigned long long nodeVersion, mapped_type* value) const
+{
+    while (true)
+    {
+        Node* next{ child(node, direction).load() };
+        if (node->version_.load() != nodeVersion)
+        {
+            return Result::Retry;
+        }
+        if (next == nullptr)
+        {
+            return Result::Absent;
+        }
+
+        int nextDirection{ this->direction(key, next) };
+        if (nextDirection == 0)
+        {
+            mapped_type* found{ next->value_.load() };
+            if (found == nullptr)
+            {
+                return Result::Absent;
+            }
+            if (value != nullptr)
+            {
+                *value = *found;
+            }
+            return Result::Present;
+        }
+
+        unsigned long long nextVersion{ next->version_.load() };
+        if (isShrinking(nextVersion))
+        {
+            waitUntilNotChanging(next);
+        }
+        else if (not isUnlinked(nextVersion) and next == child(node, direction).load())
+        {
+            if (node->version_.load() != nodeVersion)
+            {
+                return Result::Retry;
+            }
+            Result result{ attemptFind(key, next, nextDirection, nextVersion, value) };
+            if (result != Result::Retry)
+            {
+                return result;
+            }
+        }
+    }
+}
+
+// Returns Absent if the key was inserted and Present if it was already in the tree
+template<typename Node, typename Compare>
+typename ConcurrentAVLTree<Node, Compare>::Result
+ConcurrentAVLTree<Node, Compare>::attemptInsert(const value_type& value, Node* node, int direction,
+                                                unsigned long long nodeVersion)
+{
+    Result result{ Result::Retry };
+    do
+    {
+        Node* next{ child(node, direction).load() };
+        if (node->version_.load() != nodeVersion)
+        {
+            return Result::Retry;
+        }
+
+        if (next == nullptr)
+        {
+            result = attemptLink(value, node, direction, nodeVersion);
+            continue;
+        }
+
+        int nextDirection{ this->direction(value.first, next) };
+        if (nextDirection == 0)
+        {
+            result = attemptRevive(next, value.second);
+            continue;
+        }
+
+        unsigned long long nextVersion{ next->version_.load() };
+        if (isShrinking(nextVersion))
+        {
+            waitUntilNotChanging(next);
+        }
+        else if (not isUnlinked(nextVersion) and next == child(node, direction).load())
+        {
+            if (node->version_.load() != nodeVersion)
+            {
+                return Result::Retry;
+            }
+            result = attemptInsert(value, next, nextDirection, nextVersion);
+        }
+    }
+    while (result == Result::Retry);
+    return result;
+}
+
+// Returns Present if the key was erased and Absent if it was not in the tree
+template<typename Node, typename Compare>
+typename ConcurrentAVLTree<Node, Compare>::Result
+ConcurrentAVLTree<Node, Compare>::attemptErase(const key_type& key, Node* node, int direction,
+                                               unsigned long long nodeVersion)
+{
+    Result result{ Result::Retry };
+    do
+    {
+        Node* next{ child(node, direction).load() };
+        if (node->version_.load() != nodeVersion)
+        {
+            return Result::Retry;
+        }
+        if (next == nullptr)
+        {
+            return Result::Absent;
+        }
+
+        int nextDirection{ this->direction(key, next) };
+        if (nextDirection == 0)
+        {
+            result = attemptRemove(node, next);
+            continue;
+        }
+
+        unsigned long long nextVersion{ next->version_.load() };
+        if (isShrinking(nextVersion))
+        {
+            waitUntilNotChanging(next);
+        }
+        else if (not isUnlinked(nextVersion) and next == child(node, direction).load())
+        {
+            if (node->version_.load() != nodeVersion)
+            {
+                return Result::Retry;
+            }
+            result = attemptErase(key, next, nextDirection, nextVersion);
+        }
+    }
+    while (result == Result::Retry);
+    return result;
+}
+
+template<typename Node, typename Compare>
+typename ConcurrentAVLTree<Node, Compare>::Result
+ConcurrentAVLTree<Node, Compare>::attemptLink(const value_type& value, Node* node, int direction,
+                                              unsigned long long nodeVersion)
+{
+    {
+        std::lock_guard<std::mutex> lock{ node->mutex_ };
+        if (node->version_.load() != nodeVersion or child(node, direction).load() != nullptr)
+        {
+            return Result::Retry;
+        }
+        child(node, direction).store(createNode(value.first, createValue(value.second), node));
+    }
+
+    fixHeightAndRebalance(node);
+    return Result::Absent;
+}
+
+template<typename Node, typename Compare>
+typename ConcurrentAVLTree<Node, Compare>::Result
+ConcurrentAVLTree<Node, Compare>::attemptRevive(Node* node, const mapped_type& value)
+{
+    std::lock_guard<std::mutex> lock{ node->mutex_ };
+    if (isUnlinked(node->version_.load()))
+    {
+        return Result::Retry;
+    }
+    if (node->value_.load() != nullptr)
+    {
+        return Result::Present;
+    }
+    node->value_.store(createValue(value));
+    return Result::Absent;
+}
+
+// A node with two children becomes a routing node. Otherwise the node is unlinked,
+// which needs the lock of the parent too.
+template<typename Node, typename Compare>
+typename ConcurrentAVLTree<Node, Compare>::Result
+ConcurrentAVLTree<Node, Compare>::attemptRemove(Node* parent, Node* node)
+{
+    if (node->value_.load() == nullptr)
+    {
+        return Result::Absent;
+    }
+
+    mapped_type* removed{ nullptr };
+    if (node->left_.load() != nullptr and node->right_.load() != nullptr)
+    {
+        std::lock_guard<std::mutex> lock{ node->mutex_ };
+        if (isUnlinked(node->version_.load())
+                or node->left_.load() == nullptr or node->right_.load() == nullptr)
+        {
+            return Result::Retry;
+        }
+        removed = node->value_.exchange(nullptr);
+        if (removed == nullptr)
+        {
+            return Result::Absent;
+        }
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> parentLock{ parent->mutex_ };
+            if (isUnlinked(parent->version_.load()) or node->parent_.load() != parent)
+            {
+                return Result::Retry;
+            }
+
+            std::lock_guard<std::mutex> lock{ node->mutex_ };
+            if (isUnlinked(node->version_.load()))
+            {
+                return Result::Retry;
+            }
+            removed = node->value_.exchange(nullptr);
+            if (removed == nullptr)
+            {
+                return Result::Absent;
+            }
+
+            // The node may have got a second child before it was locked, and
+            // then it stays as a routing node
+            Node* left{ node->left_.load() };
+            Node* right{ node->right_.load() };
+            if (left == nullptr or right == nullptr)
+            {
+                Node* splice{ (left != nullptr) ? left : right };
+                child(parent, (parent->left_.load() == node) ? -1 : 1).store(splice);
+                if (splice != nullptr)
+                {
+                    splice->parent_.store(parent);
+                }
+                node->version_.store(node->version_.load() | UNLINKED);
+                EpochReclamation::retire(node, nodePool_);
+            }
+        }
+        fixHeightAndRebalance(parent);
+    }
+
+    EpochReclamation::retire(removed, valuePool_);
+    return Result::Present;
+}
+
+// Reads the children and the heights without locking, so the result may be out of
+// date. A later fix of the same node handles the changes made in the meantime.
+template<typename Node, typename Compare>
+int ConcurrentAVLTree<Node, Compare>::nodeCondition(Node* node) const
+{
+    Node* left{ node->left_.load() };
+    Node* right{ node->right_.load() };
+    if ((left == nullptr or right == nullptr) and node->value_.load() == nullptr)
+    {
+        return UNLINK_REQUIRED;
+    }
+
+    int nodeHeight{ node->height_.load() };
+    int leftHeight{ height(left) };
+    int rightHeight{ height(right) };
+    int newHeight{ 1 + std::max(leftHeight, rightHeight) };
+    int balance{ leftHeight - rightHeight };
+    if (balance < -1 or balance > 1)
+    {
+        return REBALANCE_REQUIRED;
+    }
+    return (nodeHeight != newHeight) ? newHeight : NOTHING_REQUIRED;
+}
+
+// Walks up from node fixing the heights, rotating and unlinking the routing nodes
+// until a node needs no changes. Only a height fix needs just the node locked.
+template<typename Node, typename Compare>
+void ConcurrentAVLTree<Node, Compare>::fixHeightAndRebalance(Node* node)
+{
+    while (node != nullptr and node->parent_.load() != nullptr)
+    {
+        int condition{ nodeCondition(node) };
+        if (condition == NOTHING_REQUIRED or isUnlinked(node->version_.load()))
+        {
+            return;
+        }
+
+        if (condition != UNLINK_REQUIRED and condition != REBALANCE_REQUIRED)
+        {
+            std::lock_guard<std::mutex> lock{ node->mutex_ };
+            node = fixHeightLocked(node);
+        }
+        else
+        {
+            Node* parent{ node->parent_.load() };
+            std::lock_guard<std::mutex> parentLock{ parent->mutex_ };
+            if (not isUnlinked(parent->version_.load()) and node->parent_.load() == parent)
+            {
+                std::lock_guard<std::mutex> lock{ node->mutex_ };
+                node = rebalanceLocked(parent, node);
+            }
+        }
+    }
+}
+
+template<typename Node, typename Compare>
+Node* ConcurrentAVLTree<Node, Compare>::fixHeightLocked(Node* node)
+{
+    int condition{ nodeCondition(node) };
+    switch (condition)
+    {
+    case REBALANCE_REQUIRED:
+    case UNLINK_REQUIRED:
+        return node;
+    case NOTHING_REQUIRED:
+        return nullptr;
+    default:
+        node->height_.store(condition);
+        return node->parent_.load();
+    }
+}
+
+template<typename Node, typename Compare>
+Node* ConcurrentAVLTree<Node, Compare>::rebalanceLocked(Node* parent, Node* node)
+{
+    Node* left{ node->left_.load() };
+    Node* right{ node->right_.load() };
+    if ((left == nullptr or right == nullptr) and node->value_.load() == nullptr)
+    {
+        return attemptUnlinkLocked(parent, node) ? fixHeightLocked(parent) : node;
+    }
+
+    int nodeHeight{ node->height_.load() };
+    int leftHeight{ height(left) };
+    int rightHeight{ height(right) };
+    int newHeight{ 1 + std::max(leftHeight, rightHeight) };
+    int balance{ leftHeight - rightHeight };
+    if (balance > 1)
+    {
+        return rebalanceToRightLocked(parent, node, left, rightHeight);
+    }
+    else if (balance < -1)
+    {
+        return rebalanceToLeftLocked(parent, node, right, leftHeight);
+    }
+    else if (newHeight != nodeHeight)
+    {
+        node->height_.store(newHeight);
+        return fixHeightLocked(parent);
+    }
+    return nullptr;
+}
+
+// If the left child leans right, it is first rotated left, unless a double
+// rotation leaves the nodes balanced
+template<typename Node, typename Compare>
+Node* ConcurrentAVLTree<Node, Compare>::rebalanceToRightLocked(Node* parent, Node* node, Node* left,
+                                                               int rightHeight)
+{
+    std::lock_guard<std::mutex> leftLock{ left->mutex_ };
+    int leftHeight{ left->height_.load() };
+    if (leftHeight - rightHeight <= 1)
+    {
+        return node;
+    }
+
+    Node* leftRight{ left->right_.load() };
+    int leftLeftHeight{ height(left->left_.load()) };
+    int leftRightHeight{ height(leftRight) };
+    if (leftLeftHeight >= leftRightHeight)
+    {
+        return rotateRightLocked(parent, node, left, rightHeight, leftLeftHeight, leftRight, leftRightHeight);
+    }
+
+    {
+        std::lock_guard<std::mutex> leftRightLock{ leftRight->mutex_ };
+        leftRightHeight = leftRight->height_.load();
+        if (leftLeftHeight >= leftRightHeight)
+        {
+            return rotateRightLocked(parent, node, left, rightHeight, leftLeftHeight, leftRight, leftRightHeight);
+        }
+
+        int leftRightLeftHeight{ height(leftRight->left_.load()) };
+        int balance{ leftLeftHeight - leftRightLeftHeight };
+        if (balance >= -1 and balance <= 1
+                and not ((leftLeftHeight == 0 or leftRightLeftHeight == 0) and left->value_.load() == nullptr))
+        {
+            return rotateRightOverLeftLocked(parent, node, left, rightHeight, leftLeftHeight, leftRight,
+                                             leftRightLeftHeight);
+        }
+    }
+    return rebalanceToLeftLocked(node, left, leftRight, leftLeftHeight);
+}
+
+template<typename Node, typename Compare>
+Node* ConcurrentAVLTree<Node, Compare>::rebalanceToLeftLocked(Node* parent, Node* node, Node* right,
+                                                              int leftHeight)
+{
+    std::lock_guard<std::mutex> rightLock{ right->mutex_ };
+    int rightHeight{ right->height_.load() };
+    if (leftHeight - rightHeight >= -1)
+    {
+        return node;
+    }
+
+    Node* rightLeft{ right->left_.load() };
+    int rightRightHeight{ height(right->right_.load()) };
+    int rightLeftHeight{ height(rightLeft) };
+    if (rightRightHeight >= rightLeftHeight)
+    {
+        return rotateLeftLocked(parent, node, right, leftHeight, rightRightHeight, rightLeft, rightLeftHeight);
+    }
+
+    {
+        std::lock_guard<std::mutex> rightLeftLock{ rightLeft->mutex_ };
+        rightLeftHeight = rightLeft->height_.load();
+        if (rightRightHeight >= rightLeftHeight)
+        {
+            return rotateLeftLocked(parent, node, right, leftHeight, rightRightHeight, rightLeft, rightLeftHeight);
+        }
+
+        int rightLeftRightHeight{ height(rightLeft->right_.load()) };
+        int balance{ rightRightHeight - rightLeftRightHeight };
+        if (balance >= -1 and balance <= 1
+                and not ((rightRightHeight == 0 or rightLeftRightHeight == 0) and right->value_.load() == nullptr))
+        {
+            return rotateLeftOverRightLocked(parent, node, right, leftHeight, rightRightHeight, rightLeft,
+                                             rightLeftRightHeight);
+        }
+    }
+    return rebalanceToRightLocked(node, right, rightLeft, rightRightHeight);
+}
+
+// Node moves down, so its version changes while the links change. Returns the node
+// that may need a fix next: one of the rotated nodes or the parent.
+template<typename Node, typename Compare>
+Node* ConcurrentAVLTree<Node, Compare>::rotateRightLocked(Node* parent, Node* node, Node* left, int rightHeight,
+                                                          int leftLeftHeight, Node* leftRight, int leftRightHeight)
+{
+    Node* parentLeft{ parent->left_.load() };
+    beginShrink(node);
+
+    node->left_.store(leftRight);
+    if (leftRight != nullptr)
+    {
+        leftRight->parent_.store(node);
+    }
+    left->right_.store(node);
+    node->parent_.store(left);
+    child(parent, (parentLeft == node) ? -1 : 1).store(left);
+    left->parent_.store(parent);
+
+    int nodeHeight{ 1 + std::max(leftRightHeight, rightHeight) };
+    node->height_.store(nodeHeight);
+    left->height_.store(1 + std::max(leftLeftHeight, nodeHeight));
+
+    endShrink(node);
+
+    int nodeBalance{ leftRightHeight - rightHeight };
+    if (nodeBalance < -1 or nodeBalance > 1)
+    {
+        return node;
+    }
+    if ((leftRight == nullptr or rightHeight == 0) and node->value_.load() == nullptr)
+    {
+        return node;
+    }
+    int leftBalance{ leftLeftHeight - nodeHeight };
+    if (leftBalance < -1 or leftBalance > 1)
+    {
+        return left;
+    }
+    if (leftLeftHeight == 0 and left->value_.load() == nullptr)
+    {
+        return left;
+    }
+    return fixHeightLocked(parent);
+}
+
+template<typename Node, typename Compare>
+Node* ConcurrentAVLTree<Node, Compare>::rotateLeftLocked(Node* parent, Node* node, Node* right, int leftHeight,
+                                                         int rightRightHeight, Node* rightLeft, int rightLeftHeight)
+{
+    Node* parentLeft{ parent->left_.load() };
+    beginShrink(node);
+
+    node->right_.store(rightLeft);
+    if (rightLeft != nullptr)
+    {
+        rightLeft->parent_.store(node);
+    }
+    right->left_.store(node);
+    node->parent_.store(right);
+    child(parent, (parentLeft == node) ? -1 : 1).store(right);
+    right->parent_.store(parent);
+
+    int nodeHeight{ 1 + std::max(leftHeight, rightLeftHeight) };
+    node->height_.store(nodeHeight);
+    right->height_.store(1 + std::max(nodeHeight, rightRightHeight));
+
+    endShrink(node);
+
+    int nodeBalance{ rightLeftHeight - leftHeight };
+    if (nodeBalance < -1 or nodeBalance > 1)
+    {
+        return node;
+    }
+    if ((rightLeft == nullptr or leftHeight == 0) and node->value_.load() == nullptr)
+    {
+        return node;
+    }
+    int rightBalance{ rightRightHeight - nodeHeight };
+    if (rightBalance < -1 or rightBalance > 1)
+    {
+        return right;
+    }
+    if (rightRightHeight == 0 and right->value_.load() == nullptr)
+    {
+        return right;
+    }
+    return fixHeightLocked(parent);
+}
+
+template<typename Node, typename Compare>
+Node* ConcurrentAVLTree<Node, Compare>::rotateRightOverLeftLocked(Node* parent, Node* node, Node* left,
+                                                                  int rightHeight, int leftLeftHeight,
+                                                                  Node* leftRight, int leftRightLeftHeight)
+{
+    Node* parentLeft{ parent->left_.load() };
+    Node* leftRightLeft{ leftRight->left_.load() };
+    Node* leftRightRight{ leftRight->right_.load() };
+    int leftRightRightHeight{ height(leftRightRight) };
+    beginShrink(node);
+    beginShrink(left);
+
+    node->left_.store(leftRightRight);
+    if (leftRightRight != nullptr)
+    {
+        leftRightRight->parent_.store(node);
+    }
+    left->right_.store(leftRightLeft);
+    if (leftRightLeft != nullptr)
+    {
+        leftRightLeft->parent_.store(left);
+    }
+    leftRight->left_.store(left);
+    left->parent_.store(leftRight);
+    leftRight->right_.store(node);
+    node->parent_.store(leftRight);
+    child(parent, (parentLeft == node) ? -1 : 1).store(leftRight);
+    leftRight->parent_.store(parent);
+
+    int nodeHeight{ 1 + std::max(leftRightRightHeight, rightHeight) };
+    node->height_.store(nodeHeight);
+    int newLeftHeight{ 1 + std::max(leftLeftHeight, leftRightLeftHeight) };
+    left->height_.store(newLeftHeight);
+    leftRight->height_.store(1 + std::max(newLeftHeight, nodeHeight));
+
+    endShrink(left);
+    endShrink(node);
+
+    int nodeBalance{ leftRightRightHeight - rightHeight };
+    if (nodeBalance < -1 or nodeBalance > 1)
+    {
+        return node;
+    }
+    if ((leftRightRight == nullptr or rightHeight == 0) and node->value_.load() == nullptr)
+    {
+        return node;
+    }
+    int leftRightBalance{ newLeftHeight - nodeHeight };
+    if (leftRightBalance < -1 or leftRightBalance > 1)
+    {
+        return leftRight;
+    }
+    return fixHeightLocked(parent);
+}
+
+template<typename Node, typename Compare>
+Node* ConcurrentAVLTree<Node, Compare>::rotateLeftOverRightLocked(Node* parent, Node* node, Node* right,
+                                                                  int leftHeight, int rightRightHeight,
+                                                                  Node* rightLeft, int rightLeftRightHeight)
+{
+    Node* parentLeft{ parent->left_.load() };
+    Node* rightLeftLeft{ rightLeft->left_.load() };
+    Node* rightLeftRight{ rightLeft->right_.load() };
+    int rightLeftLeftHeight{ height(rightLeftLeft) };
+    beginShrink(node);
+    beginShrink(right);
+
+    node->right_.store(rightLeftLeft);
+    if (rightLeftLeft != nullptr)
+    {
+        rightLeftLeft->parent_.store(node);
+    }
+    right->left_.store(rightLeftRight);
+    if (rightLeftRight != nullptr)
+    {
+        rightLeftRight->parent_.store(right);
+    }
+    rightLeft->right_.store(right);
+    right->parent_.store(rightLeft);
+    rightLeft->left_.store(node);
+    node->parent_.store(rightLeft);
+    child(parent, (parentLeft == node) ? -1 : 1).store(rightLeft);
+    rightLeft->parent_.store(parent);
+
+    int nodeHeight{ 1 + std::max(leftHeight, rightLeftLeftHeight) };
+    node->height_.store(nodeHeight);
+    int newRightHeight{ 1 + std::max(rightLeftRightHeight, rightRightHeight) };
+    right->height_.store(newRightHeight);
+    rightLeft->height_.store(1 + std::max(nodeHeight, newRightHeight));
+
+    endShrink(right);
+    endShrink(node);
+
+    int nodeBalance{ rightLeftLeftHeight - leftHeight };
+    if (nodeBalance < -1 or nodeBalance > 1)
+    {
+        return node;
+    }
+    if ((rightLeftLeft == nullptr or leftHeight == 0) and node->value_.load() == nullptr)
+    {
+        return node;
+    }
+    int rightLeftBalance{ newRightHeight - nodeHeight };
+    if (rightLeftBalance < -1 or rightLeftBalance > 1)
+    {
+        return rightLeft;
+    }
+    return fixHeightLocked(parent);
+}
+
+template<typename Node, typename Compare>
+bool ConcurrentAVLTree<Node, Compare>::attemptUnlinkLocked(Node* parent, Node* node)
+{
+    Node* parentLeft{ parent->left_.load() };
+    if (parentLeft != node and parent->right_.load() != node)
+    {
+        return false;
+    }
+
+    Node* left{ node->left_.load() };
+    Node* right{ node->right_.load() };
+    if (left != nullptr and right != nullptr)
+    {
+        return false;
+    }
+
+    Node* splice{ (left != nullptr) ? left : right };
+    child(parent, (parentLeft == node) ? -1 : 1).store(splice);
+    if (splice != nullptr)
+    {
+        splice->parent_.store(parent);
+    }
+    node->version_.store(node->version_.load() | UNLINKED);
+    EpochReclamation::retire(node, nodePool_);
+    return true;
+}
+
+template<typename Node, typename Compare>
+void ConcurrentAVLTree<Node, Compare>::beginShrink(Node* node)
+{
+    node->version_.store(node->version_.load() | SHRINKING);
+}
+
+template<typename Node, typename Compare>
+void ConcurrentAVLTree<Node, Compare>::endShrink(Node* node)
+{
+    node->version_.store((node->version_.load() & ~SHRINKING) + SHRINK_COUNT);
+}
+
+template<typename Node, typename Compare>
+Node* ConcurrentAVLTree<Node, Compare>::createNode(const key_type& key, mapped_type* value, Node* parent)
+{
+    return new (nodePool_.allocate()) Node{ key, value, parent };
+}
+
+template<typename Node, typename Compare>
+typename ConcurrentAVLTree<Node, Compare>::mapped_type*
+ConcurrentAVLTree<Node, Compare>::createValue(const mapped_type& value)
+{
+    return new (valuePool_.allocate()) mapped_type{ value };
+}
+
+template<typename Node, typename Compare>
+void ConcurrentAVLTree<Node, Compare>::freeNode(Node* node)
+{
+    node->~Node();
+    nodePool_.deallocate(node);
+}
+
+// The routing nodes have no value
+template<typename Node, typename Compare>
+void ConcurrentAVLTree<Node, Compare>::freeValue(mapped_type* value)
+{
+    if (value != nullptr)
+    {
+        value->~mapped_type();
+        valuePool_.deallocate(value);
+    }
+}
+
+template<typename Node, typename Compare>
+void ConcurrentAVLTree<Node, Compare>::destroy(Node* node)
+{
+    std::vector<Node*> nodes{ node };
+    while (not nodes.empty())
+    {
+        Node* x{ nodes.back() };
+        nodes.pop_back();
+        if (x != nullptr)
+        {
+            nodes.push_back(x->left_.load());
+            nodes.push_back(x->right_.load());
+            freeValue(x->value_.load());
+            freeNode(x);
+        }
+    }
+}
+
+template<typename Node, typename Compare>
+int ConcurrentAVLTree<Node, Compare>::depth(Node* node) const
+{
+    if (node == nullptr)
+    {
+        return 0;
+    }
+
+    return std::max(depth(node->left_.load()), depth(node->right_.load())) + 1;
+}
+
+template<typename Node, typename Compare>
+template<typename Visit>
+void ConcurrentAVLTree<Node, Compare>::forEach(Node* node, Visit& visit) const
+{
+    if (node == nullptr)
+    {
+        return;
+    }
+
+    forEach(node->left_.load(), visit);
+    mapped_type* value{ node->value_.load() };
+    if (value != nullptr)
+    {
+        visit(node->key_, *value);
+    }
+    forEach(node->right_.load(), visit);
+}
+
+#endif // CONCURRENTAVLTREE_CPP
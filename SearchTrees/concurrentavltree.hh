@@ -0,0 +1,183 @@
+// Concurrent AVL tree implementation
+//
+// Implementation is based on N.G. Bronson, J. Casper, H. Chafi, K. Olukotun, A practical
+// concurrent binary search tree, Proceedings of the 15th ACM SIGPLAN Symposium on
+// Principles and Practice of Parallel Programming, 2010, pp. 257-268
+//
+// The searches do not lock. Every node has a version number that changes when the
+// node is rotated down, which is when keys can leave its subtree. A search reads the
+// version of a node before it moves to a child, and goes back to the parent if the
+// version has changed in the meantime. The writers lock only the nodes that they
+// change, from the top down.
+//
+// Erasing a node with two children only removes its value, and the node stays in the
+// tree as a routing node until it has at most one child and can be unlinked. Insert
+// can give a routing node a value again. The balance is relaxed: the heights are
+// fixed and the rotations done after the change, one node at a time, so the tree may
+// be briefly out of balance while other threads use it. The nodes and the values
+// come from NodePools, and EpochReclamation returns the unlinked nodes and the
+// removed values to their pools.
+
+#ifndef CONCURRENTAVLTREE_HH
+#define CONCURRENTAVLTREE_HH
+
+#include "binarysearchtree.hh"
+#include "epochreclamation.hh"
+#include "nodepool.hh"
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+template<typename Key, typename Value>
+struct ConcurrentAVLNode
+{
+    using key_type = Key;
+    using mapped_type = Value;
+
+    const key_type key_;
+    // Nullptr in the routing nodes
+    std::atomic<mapped_type*> value_;
+    std::atomic<int> height_;
+    // Changes when the node is rotated down or unlinked
+    std::atomic<unsigned long long> version_;
+    std::atomic<ConcurrentAVLNode<key_type, mapped_type>*> parent_;
+    std::atomic<ConcurrentAVLNode<key_type, mapped_type>*> left_;
+    std::atomic<ConcurrentAVLNode<key_type, mapped_type>*> right_;
+    std::mutex mutex_;
+
+    ConcurrentAVLNode(const key_type& key, mapped_type* value,
+                      ConcurrentAVLNode<key_type, mapped_type>* parent) :
+        key_{ key }, value_{ value },
+        height_{ 1 },
+        version_{ 0 },
+        parent_{ parent }, left_{ nullptr }, right_{ nullptr },
+        mutex_{}
+    {}
+};
+
+// The member functions can be called from several threads at the same time,
+// except for clear and the destructor
+template<typename Node, typename Compare = std::less<typename Node::key_type>>
+class ConcurrentAVLTree : private CompareStorage<Compare>
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+    using value_type = std::pair<const key_type, mapped_type>;
+    using size_type = unsigned int;
+    using node_type = Node;
+    using key_compare = Compare;
+
+    ConcurrentAVLTree();
+    explicit ConcurrentAVLTree(const Compare& compare);
+    ConcurrentAVLTree(const ConcurrentAVLTree&) = delete;
+    ConcurrentAVLTree& operator=(const ConcurrentAVLTree&) = delete;
+    ~ConcurrentAVLTree();
+
+    // The number of keys once the operations in progress have finished
+    size_type size() const;
+    int height() const;
+
+    // Not thread-safe
+    void clear();
+
+    bool contains(const key_type& key) const;
+    // Copies the value of the key to value. Returns false if the key is not in the tree.
+    bool find(const key_type& key, mapped_type& value) const;
+    bool insert(const value_type& value);
+    size_type erase(const key_type& key);
+
+    // Calls visit for every key and value in the order of the keys. The keys that
+    // are inserted or erased during the scan may or may not be visited.
+    template<typename Visit>
+    void forEach(Visit visit) const;
+
+private:
+    // The results of one try of an operation
+    enum class Result
+    {
+        Retry,
+        Absent,
+        Present
+    };
+
+    // The conditions of a node after a change below it. A non-negative
+    // condition is the height that the node should have.
+    const static int UNLINK_REQUIRED = -1;
+    const static int REBALANCE_REQUIRED = -2;
+    const static int NOTHING_REQUIRED = -3;
+
+    // The bits of the version. The count of the finished shrinks is above them.
+    const static unsigned long long UNLINKED = 1;
+    const static unsigned long long SHRINKING = 2;
+    const static unsigned long long SHRINK_COUNT = 4;
+
+    // Shared by the trees with the same node and value sizes, because the retired
+    // nodes and values may go back to the pools after the tree is gone
+    NodePool& nodePool_;
+    NodePool& valuePool_;
+    // The tree is the right subtree of the holder, which is never rotated
+    Node* holder_;
+    std::atomic<size_type> nodes_;
+
+    static std::atomic<Node*>& child(Node* node, int direction);
+    static int height(Node* node);
+    static bool isUnlinked(unsigned long long version);
+    static bool isShrinking(unsigned long long version);
+    static void waitUntilNotChanging(Node* node);
+
+    // Returns a negative value, zero or a positive value when key is ordered
+    // before, equal to or after the key of node
+    int direction(const key_type& key, const Node* node) const;
+
+    // The searches continue from node towards direction. They return Retry if the
+    // version of node is no longer nodeVersion, and the caller has to search again
+    // from the parent.
+    Result attemptFind(const key_type& key, Node* node, int direction, unsigned long long nodeVersion,
+                       mapped_type* value) const;
+    Result attemptInsert(const value_type& value, Node* node, int direction,
+                         unsigned long long nodeVersion);
+    Result attemptErase(const key_type& key, Node* node, int direction, unsigned long long nodeVersion);
+
+    // Links a new leaf as the child of node
+    Result attemptLink(const value_type& value, Node* node, int direction, unsigned long long nodeVersion);
+    // Gives a routing node a value
+    Result attemptRevive(Node* node, const mapped_type& value);
+    // Removes the value of node, and unlinks node from parent if it has at most one child
+    Result attemptRemove(Node* parent, Node* node);
+
+    // The functions ending in Locked are called with parent and node locked
+    int nodeCondition(Node* node) const;
+    void fixHeightAndRebalance(Node* node);
+    // Returns the node that has to be fixed next, or nullptr
+    Node* fixHeightLocked(Node* node);
+    Node* rebalanceLocked(Node* parent, Node* node);
+    Node* rebalanceToRightLocked(Node* parent, Node* node, Node* left, int rightHeight);
+    Node* rebalanceToLeftLocked(Node* parent, Node* node, Node* right, int leftHeight);
+    Node* rotateRightLocked(Node* parent, Node* node, Node* left, int rightHeight,
+                            int leftLeftHeight, Node* leftRight, int leftRightHeight);
+    Node* rotateLeftLocked(Node* parent, Node* node, Node* right, int leftHeight,
+                           int rightRightHeight, Node* rightLeft, int rightLeftHeight);
+    Node* rotateRightOverLeftLocked(Node* parent, Node* node, Node* left, int rightHeight,
+                                    int leftLeftHeight, Node* leftRight, int leftRightLeftHeight);
+    Node* rotateLeftOverRightLocked(Node* parent, Node* node, Node* right, int leftHeight,
+                                    int rightRightHeight, Node* rightLeft, int rightLeftRightHeight);
+    bool attemptUnlinkLocked(Node* parent, Node* node);
+    void beginShrink(Node* node);
+    void endShrink(Node* node);
+
+    Node* createNode(const key_type& key, mapped_type* value, Node* parent);
+    mapped_type* createValue(const mapped_type& value);
+    // Frees a node or a value that no other thread can be reading
+    void freeNode(Node* node);
+    void freeValue(mapped_type* value);
+    void destroy(Node* node);
+    // Returns the height of the subtree of node by walking through it
+    int depth(Node* node) const;
+    template<typename Visit>
+    void forEach(Node* node, Visit& visit) const;
+};
+
+#include "concurrentavltree.cpp"
+
+#endif // CONCURRENTAVLTREE_HH
@@ -0,0 +1,356 @@
+// Thread-safe wrapper for the search trees
+//
+// Implementation is based on P.J. Courtois, F. Heymans, D.L. Parnas, Concurrent control
+// with "readers" and "writers", Communications of the ACM 14(10), 1971, pp. 667-668,
+// and H.-J. Boehm, Can seqlocks get along with programming language memory models?,
+// Proceedings of the 2012 ACM SIGPLAN Workshop on Memory Systems Performance and
+// Correctness, 2012, pp. 12-20
+
+#ifndef CONCURRENTTREE_CPP
+#define CONCURRENTTREE_CPP
+
+#include "concurrenttree.hh"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+template<typename Tree, ConcurrencyMode Mode>
+ConcurrentTree<Tree, Mode>::ConcurrentTree(size_type stripes) :
+    stripes_{}
+{
+    size_type count{ (Mode == ConcurrencyMode::Striped and stripes > 0) ? stripes : 1 };
+    for (size_type i{ 0 }; i < count; ++i)
+    {
+        stripes_.push_back(std::make_unique<Stripe>());
+    }
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+ConcurrentTree<Tree, Mode>::~ConcurrentTree()
+{
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+typename ConcurrentTree<Tree, Mode>::size_type ConcurrentTree<Tree, Mode>::size() const
+{
+    size_type nodes{ 0 };
+    for (auto& stripe : stripes_)
+    {
+        std::shared_lock<std::shared_mutex> lock{ stripe->mutex_ };
+        nodes += stripe->tree_.size();
+    }
+    return nodes;
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+void ConcurrentTree<Tree, Mode>::clear()
+{
+    for (auto& stripe : stripes_)
+    {
+        std::unique_lock<std::shared_mutex> lock{ stripe->mutex_ };
+        beginWrite(*stripe, Optimistic{});
+        waitForReaders(*stripe);
+        stripe->tree_.clear();
+        stripe->retired_.clear();
+        endWrite(*stripe, Optimistic{});
+    }
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+bool ConcurrentTree<Tree, Mode>::contains(const key_type& key) const
+{
+    return lookup(key, nullptr, Optimistic{});
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+bool ConcurrentTree<Tree, Mode>::find(const key_type& key, mapped_type& value) const
+{
+    return lookup(key, &value, Optimistic{});
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+bool ConcurrentTree<Tree, Mode>::insert(const value_type& value)
+{
+    Stripe& target{ stripe(value.first) };
+    std::unique_lock<std::shared_mutex> lock{ target.mutex_ };
+    beginWrite(target, Optimistic{});
+    bool inserted{ target.tree_.insert(value) };
+    endWrite(target, Optimistic{});
+    return inserted;
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+typename ConcurrentTree<Tree, Mode>::size_type ConcurrentTree<Tree, Mode>::erase(const key_type& key)
+{
+    Stripe& target{ stripe(key) };
+    std::unique_lock<std::shared_mutex> lock{ target.mutex_ };
+    return erase(target, key, Optimistic{});
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+template<typename Visit>
+void ConcurrentTree<Tree, Mode>::forEach(Visit visit) const
+{
+    visitRange(nullptr, std::numeric_limits<size_type>::max(), visit);
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+template<typename Visit>
+typename ConcurrentTree<Tree, Mode>::size_type
+ConcurrentTree<Tree, Mode>::scan(const key_type& first, size_type length, Visit visit) const
+{
+    return visitRange(&first, length, visit);
+}
+
+// The stripes are locked in their order, and a writer only locks one stripe, so the
+// scans cannot deadlock with the writers or with each other. Every stripe has a cursor
+// at its next key, and the cursors are kept in a heap on their keys, so the next key
+// of the merge is found in O(log stripes) comparisons.
+template<typename Tree, ConcurrencyMode Mode>
+template<typename Visit>
+typename ConcurrentTree<Tree, Mode>::size_type
+ConcurrentTree<Tree, Mode>::visitRange(const key_type* first, size_type length, Visit& visit) const
+{
+    std::vector<ReadLock> locks;
+    std::vector<std::pair<Node*, const Tree*>> cursors;
+    for (auto& stripe : stripes_)
+    {
+        locks.emplace_back(stripe->mutex_);
+        const Tree& tree{ stripe->tree_ };
+        Node* node{ (first == nullptr) ? tree.minimum() : tree.lowerBound(*first) };
+        if (node != tree.nil())
+        {
+            cursors.emplace_back(node, &tree);
+        }
+    }
+
+    auto compare{ stripes_.front()->tree_.keyCompare() };
+    auto later = [&compare](const std::pair<Node*, const Tree*>& a, const std::pair<Node*, const Tree*>& b)
+    {
+        return compare(b.first->key_, a.first->key_);
+    };
+    std::make_heap(cursors.begin(), cursors.end(), later);
+
+    size_type visited{ 0 };
+    while (not cursors.empty() and visited < length)
+    {
+        std::pop_heap(cursors.begin(), cursors.end(), later);
+        auto& cursor{ cursors.back() };
+        visit(cursor.first->key_, cursor.first->value_);
+        ++visited;
+
+        cursor.first = cursor.second->successor(cursor.first);
+        if (cursor.first == cursor.second->nil())
+        {
+            cursors.pop_back();
+        }
+        else
+        {
+            std::push_heap(cursors.begin(), cursors.end(), later);
+        }
+    }
+    return visited;
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+typename ConcurrentTree<Tree, Mode>::Stripe& ConcurrentTree<Tree, Mode>::stripe(const key_type& key) const
+{
+    if (stripes_.size() == 1)
+    {
+        return *stripes_.front();
+    }
+    return *stripes_[std::hash<key_type>{}(key) % stripes_.size()];
+}
+
+// Every thread gets the next slot when it reads optimistically for the first time
+template<typename Tree, ConcurrencyMode Mode>
+int ConcurrentTree<Tree, Mode>::readerSlot()
+{
+    static std::atomic<int> nextSlot{ 0 };
+    thread_local int slot{ nextSlot.fetch_add(1, std::memory_order_relaxed) % READER_SLOTS };
+    return slot;
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+bool ConcurrentTree<Tree, Mode>::lookup(const key_type& key, mapped_type* value, std::true_type) const
+{
+    const Stripe& target{ stripe(key) };
+    ReaderSlot& slot{ target.slots_[readerSlot()] };
+
+    for (int i{ 0 }; i < OPTIMISTIC_RETRIES; ++i)
+    {
+        // The reader is counted before it reads the sequence number, so a writer
+        // that waits for the readers either sees the reader or the reader sees
+        // the odd sequence number of the writer
+        slot.readers_.fetch_add(1, std::memory_order_seq_cst);
+        Node* node{ nullptr };
+        unsigned long long sequence{ 0 };
+        bool valid{ false };
+        bool found{ optimisticLookup(target, key, node, sequence, valid) };
+        slot.readers_.fetch_sub(1, std::memory_order_release);
+
+        if (valid)
+        {
+            if (found and value != nullptr)
+            {
+                // The value may be any type, so it is only copied under the lock. The node
+                // is still the node of the key if no writer has been active since the search.
+                ReadLock lock{ target.mutex_ };
+                if (target.sequence_.load(std::memory_order_relaxed) != sequence)
+                {
+                    node = target.tree_.find(key);
+                }
+                found = node != target.tree_.nil();
+                if (found)
+                {
+                    *value = node->value_;
+                }
+            }
+            return found;
+        }
+        std::this_thread::yield();
+    }
+
+    std::shared_lock<std::shared_mutex> lock{ target.mutex_ };
+    Node* node{ target.tree_.find(key) };
+    if (node == target.tree_.nil())
+    {
+        return false;
+    }
+    if (value != nullptr)
+    {
+        *value = node->value_;
+    }
+    return true;
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+bool ConcurrentTree<Tree, Mode>::lookup(const key_type& key, mapped_type* value, std::false_type) const
+{
+    const Stripe& target{ stripe(key) };
+    ReadLock lock{ target.mutex_ };
+    Node* node{ target.tree_.find(key) };
+    if (node == target.tree_.nil())
+    {
+        return false;
+    }
+    if (value != nullptr)
+    {
+        *value = node->value_;
+    }
+    return true;
+}
+
+// The search races with the writer, so the links it follows may be inconsistent,
+// but every node it reaches is either in the tree or retired and not yet freed.
+// The links are atomic, and the keys are not changed while a node exists. The acquire fence keeps the reads of the search before the second read
+// of the sequence number, which tells whether a writer was active during the search.
+template<typename Tree, ConcurrencyMode Mode>
+bool ConcurrentTree<Tree, Mode>::optimisticLookup(const Stripe& stripe, const key_type& key, Node*& node,
+                                                  unsigned long long& sequence, bool& valid) const
+{
+    // Sequentially consistent, so that it cannot be ordered before the reader count
+    sequence = stripe.sequence_.load(std::memory_order_seq_cst);
+    if (sequence % 2 == 1)
+    {
+        valid = false;
+        return false;
+    }
+
+    const Tree& tree{ stripe.tree_ };
+    auto compare{ tree.keyCompare() };
+    Node* nil{ tree.nil() };
+    Node* x{ tree.root() };
+    for (int depth{ 0 }; x != nil and depth < OPTIMISTIC_DEPTH; ++depth)
+    {
+        if (compare(key, x->key_))
+        {
+            x = x->left_;
+        }
+        else if (compare(x->key_, key))
+        {
+            x = x->right_;
+        }
+        else
+        {
+            break;
+        }
+    }
+    node = x;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = stripe.sequence_.load(std::memory_order_relaxed) == sequence;
+    return x != nil;
+}
+
+// The erased nodes are extracted instead of freed, because optimistic readers may
+// still be reading them. The batch is freed once no optimistic reader is active.
+template<typename Tree, ConcurrencyMode Mode>
+typename ConcurrentTree<Tree, Mode>::size_type ConcurrentTree<Tree, Mode>::erase(Stripe& stripe, const key_type& key,
+                                                                                 std::true_type)
+{
+    beginWrite(stripe, std::true_type{});
+    size_type erased{ 0 };
+    for (auto handle = stripe.tree_.extract(key); not handle.empty(); handle = stripe.tree_.extract(key))
+    {
+        stripe.retired_.push_back(std::move(handle));
+        ++erased;
+    }
+
+    if (stripe.retired_.size() >= RETIRE_BATCH)
+    {
+        waitForReaders(stripe);
+        stripe.retired_.clear();
+    }
+    endWrite(stripe, std::true_type{});
+    return erased;
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+typename ConcurrentTree<Tree, Mode>::size_type ConcurrentTree<Tree, Mode>::erase(Stripe& stripe, const key_type& key,
+                                                                                 std::false_type)
+{
+    return stripe.tree_.erase(key);
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+void ConcurrentTree<Tree, Mode>::beginWrite(Stripe& stripe, std::true_type)
+{
+    // The sequence number only changes under the lock, so a plain increment is
+    // enough, and the fence keeps the changes to the tree after it
+    stripe.sequence_.store(stripe.sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+void ConcurrentTree<Tree, Mode>::beginWrite(Stripe&, std::false_type)
+{
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+void ConcurrentTree<Tree, Mode>::endWrite(Stripe& stripe, std::true_type)
+{
+    stripe.sequence_.store(stripe.sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+void ConcurrentTree<Tree, Mode>::endWrite(Stripe&, std::false_type)
+{
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+void ConcurrentTree<Tree, Mode>::waitForReaders(const Stripe& stripe) const
+{
+    for (auto& slot : stripe.slots_)
+    {
+        while (slot.readers_.load(std::memory_order_seq_cst) != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+#endif // CONCURRENTTREE_CPP
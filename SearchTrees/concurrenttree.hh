@@ -0,0 +1,158 @@
+// Thread-safe wrapper for the search trees
+//
+// Implementation is based on P.J. Courtois, F. Heymans, D.L. Parnas, Concurrent control
+// with "readers" and "writers", Communications of the ACM 14(10), 1971, pp. 667-668,
+// and H.-J. Boehm, Can seqlocks get along with programming language memory models?,
+// Proceedings of the 2012 ACM SIGPLAN Workshop on Memory Systems Performance and
+// Correctness, 2012, pp. 12-20
+//
+// The wrapper owns a tree such as RedBlackTree or AVLTree and guards it in one of
+// four modes:
+//  Exclusive: every operation holds the lock alone, like behind a plain mutex.
+//  ReaderWriter: the readers share a reader-writer lock and the writers hold it alone.
+//  Optimistic: the writers hold the lock and make a sequence number odd while they
+//              change the tree. The readers search without locking and retry if the
+//              sequence number was odd or changed during the search. After a few
+//              failed tries a reader takes the lock. The nodes of the tree must have
+//              atomic links (RedBlackNode and AVLNode with AtomicLinks) so that the
+//              search does not race with the writers. The search never copies a
+//              value, so find copies it under the reader lock once the search has
+//              been validated.
+//  Striped: the keys are hashed to independent trees that have their own locks, so
+//           operations on different stripes do not wait for each other. The scans
+//           lock every stripe and merge the keys of the stripes in order.
+//
+// The trees move nodes instead of copying keys and values between them, so the key
+// and the value of a node never change while the node is in the tree. An optimistic
+// reader may still reach a node that a writer has just erased, so in the optimistic
+// mode the erased nodes are kept and only freed when no optimistic reader is active.
+
+#ifndef CONCURRENTTREE_HH
+#define CONCURRENTTREE_HH
+
+#include "binarysearchtree.hh"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <vector>
+
+enum class ConcurrencyMode
+{
+    Exclusive,
+    ReaderWriter,
+    Optimistic,
+    Striped
+};
+
+template<typename Tree, ConcurrencyMode Mode = ConcurrencyMode::ReaderWriter>
+class ConcurrentTree
+{
+public:
+    using key_type = typename Tree::key_type;
+    using mapped_type = typename Tree::mapped_type;
+    using value_type = typename Tree::value_type;
+    using size_type = typename Tree::size_type;
+    using node_type = typename Tree::node_type;
+
+    static_assert(Mode != ConcurrencyMode::Optimistic or
+                  std::is_same<typename RootLink<node_type>::type, AtomicLink<node_type>>::value,
+                  "The optimistic mode needs a tree whose nodes have atomic links");
+
+    // The number of stripes in the striped mode
+    const static size_type DEFAULT_STRIPES = 16;
+    // How many times an optimistic read is tried before the reader takes the lock
+    const static int OPTIMISTIC_RETRIES = 4;
+    // An optimistic search that goes deeper than this has seen an inconsistent tree
+    const static int OPTIMISTIC_DEPTH = 128;
+    // How many erased nodes are collected before they are freed
+    const static size_type RETIRE_BATCH = 256;
+
+    // The number of stripes is only used in the striped mode
+    explicit ConcurrentTree(size_type stripes = DEFAULT_STRIPES);
+    ConcurrentTree(const ConcurrentTree&) = delete;
+    ConcurrentTree& operator=(const ConcurrentTree&) = delete;
+    ~ConcurrentTree();
+
+    size_type size() const;
+    void clear();
+
+    bool contains(const key_type& key) const;
+    // Copies the value of the key to value. Returns false if the key is not in the tree.
+    bool find(const key_type& key, mapped_type& value) const;
+    bool insert(const value_type& value);
+    size_type erase(const key_type& key);
+
+    // Calls visit for every key and value in the order of the keys. Every stripe is
+    // locked for reading during the visit, so the writers wait until it has ended,
+    // and visit must not use the tree.
+    template<typename Visit>
+    void forEach(Visit visit) const;
+    // Calls visit for at most length keys starting from the first key that is not
+    // less than first. Returns the number of visited keys.
+    template<typename Visit>
+    size_type scan(const key_type& first, size_type length, Visit visit) const;
+
+private:
+    using Node = node_type;
+    using Optimistic = std::integral_constant<bool, Mode == ConcurrencyMode::Optimistic>;
+    // The lock of the readers that do not read optimistically
+    using ReadLock = typename std::conditional<Mode == ConcurrencyMode::Exclusive,
+                                               std::unique_lock<std::shared_mutex>,
+                                               std::shared_lock<std::shared_mutex>>::type;
+
+    // The optimistic readers count themselves in one of the slots, which are on
+    // their own cache lines so that the readers do not share a counter
+    const static int READER_SLOTS = 64;
+
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<unsigned int> readers_{ 0 };
+    };
+
+    struct Stripe
+    {
+        mutable std::shared_mutex mutex_;
+        Tree tree_;
+        // Odd while a writer changes the tree in the optimistic mode
+        std::atomic<unsigned long long> sequence_{ 0 };
+        mutable std::array<ReaderSlot, READER_SLOTS> slots_;
+        // The erased nodes that optimistic readers may still be reading
+        std::vector<typename Tree::node_handle> retired_;
+    };
+
+    std::vector<std::unique_ptr<Stripe>> stripes_;
+
+    Stripe& stripe(const key_type& key) const;
+    static int readerSlot();
+
+    // Visits the keys from first, or from the smallest key if first is null
+    template<typename Visit>
+    size_type visitRange(const key_type* first, size_type length, Visit& visit) const;
+
+    bool lookup(const key_type& key, mapped_type* value, std::true_type) const;
+    bool lookup(const key_type& key, mapped_type* value, std::false_type) const;
+    // Searches without locking and sets node to the node of the key, or nil. Returns
+    // false in valid if the search has to be retried, and the sequence number that
+    // the search was validated against in sequence.
+    bool optimisticLookup(const Stripe& stripe, const key_type& key, Node*& node,
+                          unsigned long long& sequence, bool& valid) const;
+
+    size_type erase(Stripe& stripe, const key_type& key, std::true_type);
+    size_type erase(Stripe& stripe, const key_type& key, std::false_type);
+
+    // Make the sequence number odd and even again in the optimistic mode
+    void beginWrite(Stripe& stripe, std::true_type);
+    void beginWrite(Stripe& stripe, std::false_type);
+    void endWrite(Stripe& stripe, std::true_type);
+    void endWrite(Stripe& stripe, std::false_type);
+    // Waits until no optimistic reader is active. Called while the sequence
+    // number is odd, so no new optimistic reader gets past the start.
+    void waitForReaders(const Stripe& stripe) const;
+};
+
+#include "concurrenttree.cpp"
+
+#endif // CONCURRENTTREE_HH
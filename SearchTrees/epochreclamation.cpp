@@ -0,0 +1,177 @@
+// Epoch-based memory reclamation
+//
+// Implementation is based on K. Fraser, Practical lock-freedom, PhD thesis,
+// University of Cambridge, Technical Report UCAM-CL-TR-579, 2004, Section 5.2.3
+
+#include "epochreclamation.hh"
+#include <algorithm>
+#include <functional>
+
+std::atomic<unsigned long long> EpochReclamation::epoch_{ 0 };
+std::atomic<EpochReclamation::ThreadRecord*> EpochReclamation::records_{ nullptr };
+
+// The epoch is read again after it has been published, so that a thread that
+// was preempted between the two does not hold the epoch back for long. Reading
+// a stale epoch is still safe, because the thread only reads the container after
+// the published epoch is visible to the threads that try to advance the epoch.
+EpochReclamation::Guard::Guard()
+{
+    ThreadRecord& current{ record() };
+    if (current.depth_++ == 0)
+    {
+        unsigned long long epoch{ epoch_.load() };
+        current.epoch_.store(epoch);
+        while (epoch_.load() != epoch)
+        {
+            epoch = epoch_.load();
+            current.epoch_.store(epoch);
+        }
+    }
+}
+
+EpochReclamation::Guard::~Guard()
+{
+    ThreadRecord& current{ record() };
+    if (--current.depth_ == 0)
+    {
+        current.epoch_.store(IDLE, std::memory_order_release);
+        if (current.sinceCollect_ >= COLLECT_INTERVAL)
+        {
+            collect();
+        }
+    }
+}
+
+// The epoch is read after the object has been unlinked, so every thread that
+// may still hold a pointer to it has pinned this epoch or an earlier one
+void EpochReclamation::retire(void* object, void (*deleter)(void*))
+{
+    retire(object, deleter, nullptr);
+}
+
+void EpochReclamation::retire(void* object, void (*deleter)(void*), NodePool* pool)
+{
+    ThreadRecord& current{ record() };
+    current.retired_.push_back(Retired{ object, deleter, pool, epoch_.load() });
+    if (++current.sinceCollect_ >= COLLECT_INTERVAL and current.depth_ == 0)
+    {
+        collect();
+    }
+}
+
+std::size_t EpochReclamation::collect()
+{
+    ThreadRecord& current{ record() };
+    current.sinceCollect_ = 0;
+    tryAdvance();
+
+    unsigned long long epoch{ epoch_.load() };
+    auto first{ std::partition(current.retired_.begin(), current.retired_.end(),
+                               [epoch](const Retired& retired)
+    {
+        return retired.epoch_ + 2 > epoch;
+    }) };
+
+    // The deleters run after the list is final, in case they retire more objects
+    std::vector<Retired> freed(first, current.retired_.end());
+    current.retired_.erase(first, current.retired_.end());
+    release(freed);
+    return freed.size();
+}
+
+std::size_t EpochReclamation::pending()
+{
+    return record().retired_.size();
+}
+
+unsigned long long EpochReclamation::epoch()
+{
+    return epoch_.load();
+}
+
+EpochReclamation::Owner::Owner() :
+    record_{ acquireRecord() }
+{
+}
+
+// The unfreed objects stay in the record for the next thread that takes it over
+EpochReclamation::Owner::~Owner()
+{
+    if (record_->depth_ == 0)
+    {
+        collect();
+    }
+    record_->epoch_.store(IDLE);
+    record_->depth_ = 0;
+    record_->used_.store(false, std::memory_order_release);
+}
+
+EpochReclamation::ThreadRecord& EpochReclamation::record()
+{
+    thread_local Owner owner;
+    return *owner.record_;
+}
+
+EpochReclamation::ThreadRecord* EpochReclamation::acquireRecord()
+{
+    for (ThreadRecord* current{ records_.load() }; current != nullptr; current = current->next_)
+    {
+        bool used{ false };
+        if (not current->used_.load(std::memory_order_relaxed)
+                and current->used_.compare_exchange_strong(used, true, std::memory_order_acquire))
+        {
+            return current;
+        }
+    }
+
+    ThreadRecord* added{ new ThreadRecord };
+    added->used_.store(true, std::memory_order_relaxed);
+    ThreadRecord* head{ records_.load() };
+    do
+    {
+        added->next_ = head;
+    }
+    while (not records_.compare_exchange_weak(head, added));
+    return added;
+}
+
+// The freed objects are sorted by pool, so that every pool is locked once
+// for all of its blocks
+void EpochReclamation::release(std::vector<Retired>& freed)
+{
+    std::sort(freed.begin(), freed.end(), [](const Retired& a, const Retired& b)
+    {
+        return std::less<NodePool*>{}(a.pool_, b.pool_);
+    });
+
+    std::vector<void*> blocks;
+    for (std::size_t i{ 0 }; i < freed.size(); ++i)
+    {
+        freed[i].deleter_(freed[i].object_);
+        if (freed[i].pool_ == nullptr)
+        {
+            continue;
+        }
+
+        blocks.push_back(freed[i].object_);
+        if (i + 1 == freed.size() or freed[i + 1].pool_ != freed[i].pool_)
+        {
+            freed[i].pool_->deallocate(blocks);
+            blocks.clear();
+        }
+    }
+}
+
+bool EpochReclamation::tryAdvance()
+{
+    unsigned long long epoch{ epoch_.load() };
+    for (ThreadRecord* current{ records_.load() }; current != nullptr; current = current->next_)
+    {
+        unsigned long long pinned{ current->epoch_.load() };
+        if (pinned != IDLE and pinned != epoch)
+        {
+            return false;
+        }
+    }
+    return epoch_.compare_exchange_strong(epoch, epoch + 1);
+}
@@ -0,0 +1,125 @@
+// Epoch-based memory reclamation
+//
+// Implementation is based on K. Fraser, Practical lock-freedom, PhD thesis,
+// University of Cambridge, Technical Report UCAM-CL-TR-579, 2004, Section 5.2.3
+//
+// Lock-free containers unlink nodes while other threads may still be reading them,
+// so the unlinked nodes cannot be freed right away. A thread pins the current epoch
+// with a Guard while it reads the container, and the unlinked nodes are retired with
+// the epoch at the time they were retired. The global epoch only advances when every
+// pinned thread has seen the current epoch, so once it has advanced twice past the
+// epoch of a retired node, no thread can still hold a pointer to the node.
+//
+// Every thread keeps its own list of retired nodes and frees them in batches. The
+// nodes that were allocated from a NodePool are destroyed and their blocks are
+// returned to the pool together, one batch for every pool. The thread records are
+// reused by new threads, and a thread that exits leaves its unfreed nodes to the
+// next thread that takes over its record.
+
+#ifndef EPOCHRECLAMATION_HH
+#define EPOCHRECLAMATION_HH
+
+#include "nodepool.hh"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+class EpochReclamation
+{
+public:
+    // Pins the calling thread to the current epoch while the guard exists.
+    // Guards can be nested, and only the outermost one pins and unpins.
+    class Guard
+    {
+    public:
+        Guard();
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard();
+    };
+
+    // Frees object with delete once no pinned thread can be reading it
+    template<typename T>
+    static void retire(T* object);
+    static void retire(void* object, void (*deleter)(void*));
+    // Destroys object and returns its block to pool once no pinned thread can be reading it
+    template<typename T>
+    static void retire(T* object, NodePool& pool);
+
+    // Tries to advance the epoch and frees the objects retired by the calling thread
+    // that no thread can be reading any more. Returns the number of freed objects.
+    static std::size_t collect();
+    // Returns the number of objects retired by the calling thread and not yet freed
+    static std::size_t pending();
+    // Returns the current global epoch
+    static unsigned long long epoch();
+
+private:
+    // How many objects a thread retires between its attempts to free them
+    const static std::size_t COLLECT_INTERVAL = 64;
+    // The epoch of a thread that is not pinned
+    const static unsigned long long IDLE = ~0ULL;
+
+    // If pool_ is set, the deleter only destroys the object and the block goes back to the pool
+    struct Retired
+    {
+        void* object_;
+        void (*deleter_)(void*);
+        NodePool* pool_;
+        unsigned long long epoch_;
+    };
+
+    struct alignas(64) ThreadRecord
+    {
+        // The pinned epoch, or IDLE
+        std::atomic<unsigned long long> epoch_{ IDLE };
+        // Whether a thread owns the record
+        std::atomic<bool> used_{ false };
+        ThreadRecord* next_{ nullptr };
+        // The number of nested guards of the owner
+        unsigned int depth_{ 0 };
+        std::size_t sinceCollect_{ 0 };
+        std::vector<Retired> retired_;
+    };
+
+    // Releases the record of a thread when the thread exits
+    struct Owner
+    {
+        ThreadRecord* record_;
+
+        Owner();
+        ~Owner();
+    };
+
+    static std::atomic<unsigned long long> epoch_;
+    // The records are never freed, so the list can be read without locking
+    static std::atomic<ThreadRecord*> records_;
+
+    static ThreadRecord& record();
+    static ThreadRecord* acquireRecord();
+    static void retire(void* object, void (*deleter)(void*), NodePool* pool);
+    // Advances the epoch if every pinned thread has seen the current one
+    static bool tryAdvance();
+    // Frees the objects and returns the blocks of the pooled ones to their pools
+    static void release(std::vector<Retired>& freed);
+};
+
+template<typename T>
+void EpochReclamation::retire(T* object)
+{
+    retire(static_cast<void*>(object), [](void* pointer)
+    {
+        delete static_cast<T*>(pointer);
+    });
+}
+
+template<typename T>
+void EpochReclamation::retire(T* object, NodePool& pool)
+{
+    retire(static_cast<void*>(object), [](void* pointer)
+    {
+        static_cast<T*>(pointer)->~T();
+    }, &pool);
+}
+
+#endif // EPOCHRECLAMATION_HH
@@ -0,0 +1,210 @@
+// Flat combining wrapper for the search trees
+//
+// Implementation is based on D. Hendler, I. Incze, N. Shavit, M. Tzafrir, Flat combining
+// and the synchronization-parallelism tradeoff, Proceedings of the 22nd ACM Symposium on
+// Parallelism in Algorithms and Architectures, 2010, pp. 355-364
+
+#ifndef FLATCOMBININGTREE_CPP
+#define FLATCOMBININGTREE_CPP
+
+#include "flatcombiningtree.hh"
+#include <algorithm>
+#include <thread>
+
+template<typename Tree>
+FlatCombiningTree<Tree>::FlatCombiningTree() :
+    tree_{},
+    combiner_{},
+    slots_{},
+    batch_{},
+    batches_{ 0 },
+    combined_{ 0 }
+{
+    batch_.reserve(SLOTS);
+}
+
+template<typename Tree>
+FlatCombiningTree<Tree>::~FlatCombiningTree()
+{
+}
+
+template<typename Tree>
+typename FlatCombiningTree<Tree>::size_type FlatCombiningTree<Tree>::size() const
+{
+    std::lock_guard<std::mutex> lock{ combiner_ };
+    return tree_.size();
+}
+
+template<typename Tree>
+void FlatCombiningTree<Tree>::clear()
+{
+    std::lock_guard<std::mutex> lock{ combiner_ };
+    tree_.clear();
+}
+
+template<typename Tree>
+bool FlatCombiningTree<Tree>::contains(const key_type& key) const
+{
+    return publish(Operation::Find, key, nullptr, nullptr) != 0;
+}
+
+template<typename Tree>
+bool FlatCombiningTree<Tree>::find(const key_type& key, mapped_type& value) const
+{
+    return publish(Operation::Find, key, nullptr, &value) != 0;
+}
+
+template<typename Tree>
+bool FlatCombiningTree<Tree>::insert(const value_type& value)
+{
+    return publish(Operation::Insert, value.first, &value, nullptr) != 0;
+}
+
+template<typename Tree>
+typename FlatCombiningTree<Tree>::size_type FlatCombiningTree<Tree>::erase(const key_type& key)
+{
+    return publish(Operation::Erase, key, nullptr, nullptr);
+}
+
+template<typename Tree>
+unsigned long long FlatCombiningTree<Tree>::batches() const
+{
+    std::lock_guard<std::mutex> lock{ combiner_ };
+    return batches_;
+}
+
+template<typename Tree>
+unsigned long long FlatCombiningTree<Tree>::combined() const
+{
+    std::lock_guard<std::mutex> lock{ combiner_ };
+    return combined_;
+}
+
+// Every thread gets the next slot when it publishes for the first time
+template<typename Tree>
+int FlatCombiningTree<Tree>::preferredSlot()
+{
+    static std::atomic<int> nextSlot{ 0 };
+    thread_local int slot{ nextSlot.fetch_add(1, std::memory_order_relaxed) % SLOTS };
+    return slot;
+}
+
+// The slot is claimed before the operation is written to it, so the combiner
+// only sees complete operations. The owner frees the slot after reading the result.
+template<typename Tree>
+typename FlatCombiningTree<Tree>::size_type
+FlatCombiningTree<Tree>::publish(Operation operation, const key_type& key, const value_type* value,
+                                 mapped_type* found) const
+{
+    Slot* slot{ nullptr };
+    int first{ preferredSlot() };
+    while (slot == nullptr)
+    {
+        for (int i{ 0 }; i < SLOTS and slot == nullptr; ++i)
+        {
+            Slot& candidate{ slots_[(first + i) % SLOTS] };
+            int expected{ FREE };
+            if (candidate.state_.load(std::memory_order_relaxed) == FREE
+                and candidate.state_.compare_exchange_strong(expected, CLAIMED, std::memory_order_acquire))
+            {
+                slot = &candidate;
+            }
+        }
+        if (slot == nullptr)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    slot->operation_ = operation;
+    slot->key_ = &key;
+    slot->value_ = value;
+    slot->found_ = found;
+    slot->state_.store(PENDING, std::memory_order_release);
+
+    while (slot->state_.load(std::memory_order_acquire) != DONE)
+    {
+        if (combiner_.try_lock())
+        {
+            combine();
+            combiner_.unlock();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    size_type result{ slot->result_ };
+    slot->state_.store(FREE, std::memory_order_release);
+    return result;
+}
+
+template<typename Tree>
+void FlatCombiningTree<Tree>::combine() const
+{
+    batch_.clear();
+    for (auto& slot : slots_)
+    {
+        if (slot.state_.load(std::memory_order_acquire) == PENDING)
+        {
+            batch_.push_back(&slot);
+        }
+    }
+
+    auto compare{ tree_.keyCompare() };
+    std::sort(batch_.begin(), batch_.end(), [&compare](const Slot* a, const Slot* b)
+    {
+        return compare(*a->key_, *b->key_);
+    });
+
+    Node* hint{ tree_.nil() };
+    for (Slot* slot : batch_)
+    {
+        apply(*slot, hint);
+        slot->state_.store(DONE, std::memory_order_release);
+    }
+
+    if (not batch_.empty())
+    {
+        ++batches_;
+        combined_ += batch_.size();
+    }
+}
+
+// The trees move nodes instead of copying keys between them, so an erase only
+// invalidates the hint if it erases the hint itself
+template<typename Tree>
+void FlatCombiningTree<Tree>::apply(Slot& slot, Node*& hint) const
+{
+    const key_type& key{ *slot.key_ };
+    if (slot.operation_ == Operation::Find)
+    {
+        Node* node{ tree_.find(key) };
+        slot.result_ = (node != tree_.nil()) ? 1 : 0;
+        if (slot.result_ != 0 and slot.found_ != nullptr)
+        {
+            *slot.found_ = node->value_;
+        }
+    }
+    else if (slot.operation_ == Operation::Insert)
+    {
+        Node* node{ tree_.insert(hint, *slot.value_) };
+        slot.result_ = (node != tree_.nil()) ? 1 : 0;
+        if (slot.result_ != 0)
+        {
+            hint = node;
+        }
+    }
+    else
+    {
+        auto compare{ tree_.keyCompare() };
+        if (hint != tree_.nil() and not compare(hint->key_, key) and not compare(key, hint->key_))
+        {
+            hint = tree_.nil();
+        }
+        slot.result_ = tree_.erase(key);
+    }
+}
+
+#endif // FLATCOMBININGTREE_CPP
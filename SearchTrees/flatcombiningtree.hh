@@ -0,0 +1,108 @@
+// Flat combining wrapper for the search trees
+//
+// Implementation is based on D. Hendler, I. Incze, N. Shavit, M. Tzafrir, Flat combining
+// and the synchronization-parallelism tradeoff, Proceedings of the 22nd ACM Symposium on
+// Parallelism in Algorithms and Architectures, 2010, pp. 355-364
+//
+// A thread does not lock the tree. It publishes its operation in a slot and waits
+// until the operation is done. One of the waiting threads takes the combiner lock,
+// collects the published operations and applies them to the tree in one batch, so
+// the tree and the lock stay in the cache of one thread at a time.
+//
+// The batch is sorted by key before it is applied. The keys of a sorted batch are
+// inserted with the previous new node as the hint, so they are not searched from
+// the root of the tree. The operations in a batch are concurrent, so any order of
+// them is a valid order.
+
+#ifndef FLATCOMBININGTREE_HH
+#define FLATCOMBININGTREE_HH
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+template<typename Tree>
+class FlatCombiningTree
+{
+public:
+    using key_type = typename Tree::key_type;
+    using mapped_type = typename Tree::mapped_type;
+    using value_type = typename Tree::value_type;
+    using size_type = typename Tree::size_type;
+    using node_type = typename Tree::node_type;
+
+    FlatCombiningTree();
+    FlatCombiningTree(const FlatCombiningTree&) = delete;
+    FlatCombiningTree& operator=(const FlatCombiningTree&) = delete;
+    ~FlatCombiningTree();
+
+    size_type size() const;
+    void clear();
+
+    bool contains(const key_type& key) const;
+    // Copies the value of the key to value. Returns false if the key is not in the tree.
+    bool find(const key_type& key, mapped_type& value) const;
+    bool insert(const value_type& value);
+    size_type erase(const key_type& key);
+
+    // Returns the number of batches and the number of operations in them
+    unsigned long long batches() const;
+    unsigned long long combined() const;
+
+private:
+    using Node = node_type;
+
+    // The number of publication slots. When more threads publish at the same time,
+    // the extra threads wait for a free slot.
+    const static int SLOTS = 64;
+
+    enum class Operation
+    {
+        Find,
+        Insert,
+        Erase
+    };
+
+    // The states of a slot
+    const static int FREE = 0;
+    // The owner is writing the operation
+    const static int CLAIMED = 1;
+    const static int PENDING = 2;
+    const static int DONE = 3;
+
+    // The operation points to the arguments of the waiting owner
+    struct alignas(64) Slot
+    {
+        std::atomic<int> state_{ FREE };
+        Operation operation_{ Operation::Find };
+        const key_type* key_{ nullptr };
+        const value_type* value_{ nullptr };
+        mapped_type* found_{ nullptr };
+        size_type result_{ 0 };
+    };
+
+    // The lookups are applied by the combiner, which may also change the tree,
+    // so everything that the combiner uses is mutable
+    mutable Tree tree_;
+    mutable std::mutex combiner_;
+    mutable std::array<Slot, SLOTS> slots_;
+    // The operations of the current batch
+    mutable std::vector<Slot*> batch_;
+    mutable unsigned long long batches_;
+    mutable unsigned long long combined_;
+
+    // Returns the slot that the calling thread tries first
+    static int preferredSlot();
+
+    // Publishes the operation, and combines or waits until it is done
+    size_type publish(Operation operation, const key_type& key, const value_type* value,
+                      mapped_type* found) const;
+    // Applies the published operations. Called with the combiner lock held.
+    void combine() const;
+    void apply(Slot& slot, Node*& hint) const;
+};
+
+#include "flatcombiningtree.cpp"
+
+#endif // FLATCOMBININGTREE_HH
@@ -0,0 +1,125 @@
+// Interval tree implementation
+//
+// Implementation is based on T.H. Cormen, C.E. Leiserson, R.L. Rivest, C. Stein,
+// Introduction to algorithms, 3rd ed. MIT Press, Cambridge, MA, 2009, Section 14.3
+
+#ifndef INTERVALTREE_CPP
+#define INTERVALTREE_CPP
+
+#include "intervaltree.hh"
+
+template<typename Node>
+IntervalTree<Node>::IntervalTree() :
+    RedBlackTree<Node, std::less<key_type>, true>{}
+{
+}
+
+template<typename Node>
+IntervalTree<Node>::~IntervalTree()
+{
+}
+
+template<typename Node>
+bool IntervalTree<Node>::insert(const key_type& low, const key_type& high, const data_type& data)
+{
+    if (high < low)
+    {
+        return false;
+    }
+    return this->insert(value_type{ low, mapped_type{ high, data } });
+}
+
+template<typename Node>
+typename IntervalTree<Node>::size_type IntervalTree<Node>::erase(const key_type& low, const key_type& high)
+{
+    size_type erased{ 0 };
+    auto range{ this->equalRange(low) };
+    for (auto x = range.first; x != range.second; )
+    {
+        // Nodes are moved instead of copied when the tree is rebalanced,
+        // so the successor stays valid when x is erased
+        Node* next{ this->successor(x) };
+        if (not (x->value_.high_ < high) and not (high < x->value_.high_))
+        {
+            erased += this->eraseNode(x);
+        }
+        x = next;
+    }
+    return erased;
+}
+
+// If the left subtree reaches low, either it contains an overlapping interval or
+// no interval overlaps, because all the intervals on the right start later
+template<typename Node>
+Node* IntervalTree<Node>::anyOverlapping(const key_type& low, const key_type& high) const
+{
+    Node* x{ this->root_ };
+    while (x != this->nil_ and (high < x->key_ or x->value_.high_ < low))
+    {
+        if (x->left_ != this->nil_ and not (x->left_->summary_ < low))
+        {
+            x = x->left_;
+        }
+        else
+        {
+            x = x->right_;
+        }
+    }
+    return x;
+}
+
+template<typename Node>
+template<typename Visit>
+void IntervalTree<Node>::forEachOverlapping(const key_type& low, const key_type& high, Visit visit) const
+{
+    if (high < low)
+    {
+        return;
+    }
+    forEachOverlapping(this->root_, low, high, visit);
+}
+
+// A subtree is entered only if some interval in it reaches low, and the right
+// subtree only if the low endpoint of the node is not above high. The subtrees
+// that are entered hold an overlapping interval unless they are on the search
+// path of high, so the time is O(log n + k) when the overlapping intervals are
+// next to each other and O(min(n, k log n)) in the worst case.
+template<typename Node>
+template<typename Visit>
+void IntervalTree<Node>::forEachOverlapping(Node* node, const key_type& low, const key_type& high, Visit& visit) const
+{
+    if (node == this->nil_ or node->summary_ < low)
+    {
+        return;
+    }
+
+    forEachOverlapping(node->left_, low, high, visit);
+    if (high < node->key_)
+    {
+        return;
+    }
+    if (not (node->value_.high_ < low))
+    {
+        visit(node);
+    }
+    forEachOverlapping(node->right_, low, high, visit);
+}
+
+template<typename Node>
+std::vector<Node*> IntervalTree<Node>::overlapping(const key_type& low, const key_type& high) const
+{
+    std::vector<Node*> intervals;
+    forEachOverlapping(low, high, [&intervals](Node* node)
+    {
+        intervals.push_back(node);
+    });
+    return intervals;
+}
+
+template<typename Node>
+std::vector<Node*> IntervalTree<Node>::stabbing(const key_type& point) const
+{
+    return overlapping(point, point);
+}
+
+#endif // INTERVALTREE_CPP
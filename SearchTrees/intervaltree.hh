@@ -0,0 +1,96 @@
+// Interval tree implementation
+//
+// Implementation is based on T.H. Cormen, C.E. Leiserson, R.L. Rivest, C. Stein,
+// Introduction to algorithms, 3rd ed. MIT Press, Cambridge, MA, 2009, Section 14.3
+//
+// The intervals are closed and keyed by their low endpoint in a red black multimap.
+// Every node stores the largest high endpoint in its subtree as its subtree summary,
+// which the red black tree keeps up to date through the rotations. A subtree whose
+// largest high endpoint is below the query, or whose low endpoints are all above
+// it, cannot contain overlapping intervals and is skipped.
+
+#ifndef INTERVALTREE_HH
+#define INTERVALTREE_HH
+
+#include "redblacktree.hh"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+// The mapped value of an interval tree node: the high endpoint and the data
+template<typename Key, typename Value>
+struct Interval
+{
+    Key high_;
+    Value data_;
+};
+
+// The largest high endpoint of the intervals in a subtree
+template<typename Key, typename Value>
+struct HighMonoid
+{
+    using summary_type = Key;
+
+    static summary_type identity()
+    {
+        return std::numeric_limits<Key>::lowest();
+    }
+
+    static summary_type lift(const Interval<Key, Value>& interval)
+    {
+        return interval.high_;
+    }
+
+    static summary_type combine(const summary_type& a, const summary_type& b)
+    {
+        return std::max(a, b);
+    }
+};
+
+template<typename Key, typename Value, bool Threaded = false>
+using IntervalNode = RedBlackNode<Key, Interval<Key, Value>, Threaded, HighMonoid<Key, Value>>;
+
+// Node is an IntervalNode. The endpoints are ordered with operator<, which the
+// subtree summaries also use.
+template<typename Node>
+class IntervalTree : public RedBlackTree<Node, std::less<typename Node::key_type>, true>
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+    using data_type = decltype(mapped_type::data_);
+    using value_type = typename RedBlackTree<Node, std::less<key_type>, true>::value_type;
+    using size_type = typename RedBlackTree<Node, std::less<key_type>, true>::size_type;
+    using node_type = Node;
+
+    IntervalTree();
+    virtual ~IntervalTree();
+
+    using RedBlackTree<Node, std::less<key_type>, true>::insert;
+    using RedBlackTree<Node, std::less<key_type>, true>::erase;
+
+    // Inserts the interval [low, high]. Returns false if high is less than low.
+    bool insert(const key_type& low, const key_type& high, const data_type& data);
+    // Removes all the intervals [low, high] and returns the number of removed intervals
+    size_type erase(const key_type& low, const key_type& high);
+
+    // Returns any interval that overlaps [low, high] in O(log n) time, or nil
+    Node* anyOverlapping(const key_type& low, const key_type& high) const;
+    // Calls visit for every interval that overlaps [low, high] in the order of
+    // the low endpoints. Takes O(log n + k) time for k overlapping intervals that
+    // are next to each other in the tree, and O(min(n, k log n)) time at most.
+    template<typename Visit>
+    void forEachOverlapping(const key_type& low, const key_type& high, Visit visit) const;
+    // Returns the intervals that overlap [low, high]
+    std::vector<Node*> overlapping(const key_type& low, const key_type& high) const;
+    // Returns the intervals that contain point
+    std::vector<Node*> stabbing(const key_type& point) const;
+
+private:
+    template<typename Visit>
+    void forEachOverlapping(Node* node, const key_type& low, const key_type& high, Visit& visit) const;
+};
+
+#include "intervaltree.cpp"
+
+#endif // INTERVALTREE_HH
@@ -0,0 +1,401 @@
+// Lock-free external binary search tree implementation
+//
+// Implementation is based on A. Natarajan, N. Mittal, Fast concurrent lock-free binary
+// search trees, Proceedings of the 19th ACM SIGPLAN Symposium on Principles and
+// Practice of Parallel Programming, 2014, pp. 317-328
+
+#ifndef LOCKFREETREE_CPP
+#define LOCKFREETREE_CPP
+
+#include "lockfreetree.hh"
+#include <algorithm>
+#include <new>
+#include <vector>
+
+template<typename Node, typename Compare>
+LockFreeTree<Node, Compare>::LockFreeTree() :
+    LockFreeTree{ Compare{} }
+{
+}
+
+template<typename Node, typename Compare>
+LockFreeTree<Node, Compare>::LockFreeTree(const Compare& compare) :
+    CompareStorage<Compare>{ compare },
+    root_{ nullptr },
+    nodes_{ 0 },
+    pool_{ NodePool::shared(sizeof(Node)) }
+{
+    createSentinels();
+}
+
+template<typename Node, typename Compare>
+LockFreeTree<Node, Compare>::~LockFreeTree()
+{
+    destroy(root_);
+}
+
+template<typename Node, typename Compare>
+typename LockFreeTree<Node, Compare>::size_type LockFreeTree<Node, Compare>::size() const
+{
+    return nodes_.load(std::memory_order_relaxed);
+}
+
+template<typename Node, typename Compare>
+int LockFreeTree<Node, Compare>::height() const
+{
+    // The sentinels add two levels above the tree
+    Node* sentinel{ address(root_->left_.load()) };
+    return height(address(sentinel->left_.load())) - 1;
+}
+
+template<typename Node, typename Compare>
+void LockFreeTree<Node, Compare>::clear()
+{
+    destroy(root_);
+    createSentinels();
+    nodes_.store(0);
+}
+
+template<typename Node, typename Compare>
+bool LockFreeTree<Node, Compare>::contains(const key_type& key) const
+{
+    EpochReclamation::Guard guard;
+    SeekRecord record;
+    seek(key, record);
+    return equal(key, record.leaf_);
+}
+
+template<typename Node, typename Compare>
+bool LockFreeTree<Node, Compare>::find(const key_type& key, mapped_type& value) const
+{
+    EpochReclamation::Guard guard;
+    SeekRecord record;
+    seek(key, record);
+    if (not equal(key, record.leaf_))
+    {
+        return false;
+    }
+    value = record.leaf_->value_;
+    return true;
+}
+
+// The new leaf is created once, and a new internal node for every try,
+// because its key depends on the leaf that it replaces
+template<typename Node, typename Compare>
+bool LockFreeTree<Node, Compare>::insert(const value_type& value)
+{
+    EpochReclamation::Guard guard;
+    Node* added{ nullptr };
+    SeekRecord record;
+    while (true)
+    {
+        seek(value.first, record);
+        Node* leaf{ record.leaf_ };
+        if (equal(value.first, leaf))
+        {
+            if (added != nullptr)
+            {
+                free(added);
+            }
+            return false;
+        }
+
+        if (added == nullptr)
+        {
+            added = create(value.first, value.second, 0, nullptr, nullptr);
+        }
+        Node* internal{ nullptr };
+        if (less(value.first, leaf))
+        {
+            internal = create(leaf->key_, mapped_type{}, leaf->infinity_, added, leaf);
+        }
+        else
+        {
+            internal = create(value.first, mapped_type{}, 0, leaf, added);
+        }
+
+        std::atomic<std::uintptr_t>& link{ child(record.parent_, value.first) };
+        std::uintptr_t expected{ edge(leaf) };
+        if (link.compare_exchange_strong(expected, edge(internal)))
+        {
+            nodes_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // The internal node was never visible to the other threads
+        free(internal);
+        if (address(expected) == leaf and (flagged(expected) or tagged(expected)))
+        {
+            cleanup(value.first, record);
+        }
+    }
+}
+
+// In the injection phase the edge to the leaf is flagged. The thread that flagged
+// it keeps cleaning up until the leaf is gone, which another thread may also do.
+template<typename Node, typename Compare>
+typename LockFreeTree<Node, Compare>::size_type LockFreeTree<Node, Compare>::erase(const key_type& key)
+{
+    EpochReclamation::Guard guard;
+    Node* leaf{ nullptr };
+    SeekRecord record;
+    while (true)
+    {
+        seek(key, record);
+        if (leaf == nullptr)
+        {
+            if (not equal(key, record.leaf_))
+            {
+                return 0;
+            }
+
+            std::atomic<std::uintptr_t>& link{ child(record.parent_, key) };
+            std::uintptr_t expected{ edge(record.leaf_) };
+            if (link.compare_exchange_strong(expected, edge(record.leaf_) | FLAG))
+            {
+                leaf = record.leaf_;
+                nodes_.fetch_sub(1, std::memory_order_relaxed);
+                if (cleanup(key, record))
+                {
+                    return 1;
+                }
+            }
+            else if (address(expected) == record.leaf_ and (flagged(expected) or tagged(expected)))
+            {
+                cleanup(key, record);
+            }
+        }
+        else if (record.leaf_ != leaf or cleanup(key, record))
+        {
+            return 1;
+        }
+    }
+}
+
+template<typename Node, typename Compare>
+template<typename Visit>
+void LockFreeTree<Node, Compare>::forEach(Visit visit) const
+{
+    EpochReclamation::Guard guard;
+    forEach(root_, visit);
+}
+
+template<typename Node, typename Compare>
+Node* LockFreeTree<Node, Compare>::address(std::uintptr_t edge)
+{
+    return reinterpret_cast<Node*>(edge & ~(FLAG | TAG));
+}
+
+template<typename Node, typename Compare>
+bool LockFreeTree<Node, Compare>::flagged(std::uintptr_t edge)
+{
+    return (edge & FLAG) != 0;
+}
+
+template<typename Node, typename Compare>
+bool LockFreeTree<Node, Compare>::tagged(std::uintptr_t edge)
+{
+    return (edge & TAG) != 0;
+}
+
+template<typename Node, typename Compare>
+std::uintptr_t LockFreeTree<Node, Compare>::edge(Node* node)
+{
+    return reinterpret_cast<std::uintptr_t>(node);
+}
+
+template<typename Node, typename Compare>
+bool LockFreeTree<Node, Compare>::less(const key_type& key, const Node* node) const
+{
+    return node->infinity_ != 0 or this->comparator()(key, node->key_);
+}
+
+template<typename Node, typename Compare>
+bool LockFreeTree<Node, Compare>::equal(const key_type& key, const Node* node) const
+{
+    return node->infinity_ == 0 and not this->comparator()(key, node->key_)
+            and not this->comparator()(node->key_, key);
+}
+
+template<typename Node, typename Compare>
+std::atomic<std::uintptr_t>& LockFreeTree<Node, Compare>::child(Node* node, const key_type& key) const
+{
+    return less(key, node) ? node->left_ : node->right_;
+}
+
+template<typename Node, typename Compare>
+Node* LockFreeTree<Node, Compare>::create(const key_type& key, const mapped_type& value, int infinity,
+                                          Node* left, Node* right)
+{
+    return new (pool_.allocate()) Node{ key, value, infinity, left, right };
+}
+
+template<typename Node, typename Compare>
+void LockFreeTree<Node, Compare>::free(Node* node)
+{
+    node->~Node();
+    pool_.deallocate(node);
+}
+
+// The root has the largest sentinel key and its left child the middle one, so all
+// the keys go left twice. The leaf with the smallest sentinel key is the tree
+// before the first insertion.
+template<typename Node, typename Compare>
+void LockFreeTree<Node, Compare>::createSentinels()
+{
+    Node* left{ create(key_type{}, mapped_type{}, 1, nullptr, nullptr) };
+    Node* middle{ create(key_type{}, mapped_type{}, 2, nullptr, nullptr) };
+    Node* right{ create(key_type{}, mapped_type{}, 3, nullptr, nullptr) };
+    Node* sentinel{ create(key_type{}, mapped_type{}, 2, left, middle) };
+    root_ = create(key_type{}, mapped_type{}, 3, sentinel, right);
+}
+
+// The successor is the lowest node on the path whose incoming edge is not tagged.
+// The nodes between it and the leaf are already being removed by other threads.
+template<typename Node, typename Compare>
+void LockFreeTree<Node, Compare>::seek(const key_type& key, SeekRecord& record) const
+{
+    Node* sentinel{ address(root_->left_.load()) };
+    record.ancestor_ = root_;
+    record.successor_ = sentinel;
+    record.parent_ = sentinel;
+    record.leaf_ = address(sentinel->left_.load());
+
+    std::uintptr_t parentEdge{ sentinel->left_.load() };
+    std::uintptr_t currentEdge{ child(record.leaf_, key).load() };
+    Node* current{ address(currentEdge) };
+    while (current != nullptr)
+    {
+        if (not tagged(parentEdge))
+        {
+            record.ancestor_ = record.parent_;
+            record.successor_ = record.leaf_;
+        }
+        record.parent_ = record.leaf_;
+        record.leaf_ = current;
+
+        parentEdge = currentEdge;
+        currentEdge = child(current, key).load();
+        current = address(currentEdge);
+    }
+}
+
+// If the edge to the leaf on the path of key is not flagged, the leaf that is
+// being erased is its sibling, and the leaf on the path is the one that stays
+template<typename Node, typename Compare>
+bool LockFreeTree<Node, Compare>::cleanup(const key_type& key, const SeekRecord& record)
+{
+    Node* parent{ record.parent_ };
+    std::atomic<std::uintptr_t>& successorLink{ child(record.ancestor_, key) };
+    std::atomic<std::uintptr_t>* childLink{ &parent->left_ };
+    std::atomic<std::uintptr_t>* siblingLink{ &parent->right_ };
+    if (not less(key, parent))
+    {
+        std::swap(childLink, siblingLink);
+    }
+    if (not flagged(childLink->load()))
+    {
+        siblingLink = childLink;
+    }
+
+    // After tagging, the edge to the node that stays can not change
+    std::uintptr_t kept{ siblingLink->fetch_or(TAG) };
+    std::uintptr_t expected{ edge(record.successor_) };
+    if (successorLink.compare_exchange_strong(expected, kept & ~TAG))
+    {
+        retire(key, record.successor_, parent, address(kept));
+        return true;
+    }
+    return false;
+}
+
+// The edges between successor and parent are tagged, so the nodes on the path
+// are the same that the search saw, and the other child of every one of them is
+// a flagged leaf
+template<typename Node, typename Compare>
+void LockFreeTree<Node, Compare>::retire(const key_type& key, Node* successor, Node* parent, Node* kept)
+{
+    Node* x{ successor };
+    while (x != parent)
+    {
+        Node* left{ address(x->left_.load()) };
+        Node* right{ address(x->right_.load()) };
+        bool goLeft{ less(key, x) };
+        EpochReclamation::retire(goLeft ? right : left, pool_);
+        EpochReclamation::retire(x, pool_);
+        x = goLeft ? left : right;
+    }
+
+    Node* left{ address(parent->left_.load()) };
+    EpochReclamation::retire((left == kept) ? address(parent->right_.load()) : left, pool_);
+    EpochReclamation::retire(parent, pool_);
+}
+
+// The tree is not balanced, so the nodes are freed without recursion
+template<typename Node, typename Compare>
+void LockFreeTree<Node, Compare>::destroy(Node* node)
+{
+    std::vector<Node*> nodes{ node };
+    while (not nodes.empty())
+    {
+        Node* x{ nodes.back() };
+        nodes.pop_back();
+        if (x != nullptr)
+        {
+            nodes.push_back(address(x->left_.load()));
+            nodes.push_back(address(x->right_.load()));
+            free(x);
+        }
+    }
+}
+
+// Sorted keys make the tree a list, so the height and the leaves are found
+// without recursion like in destroy
+template<typename Node, typename Compare>
+int LockFreeTree<Node, Compare>::height(const Node* node) const
+{
+    int maxHeight{ 0 };
+    std::vector<std::pair<const Node*, int>> nodes{ { node, 1 } };
+    while (not nodes.empty())
+    {
+        const Node* x{ nodes.back().first };
+        int depth{ nodes.back().second };
+        nodes.pop_back();
+        if (x != nullptr)
+        {
+            maxHeight = std::max(maxHeight, depth);
+            nodes.push_back({ address(x->left_.load()), depth + 1 });
+            nodes.push_back({ address(x->right_.load()), depth + 1 });
+        }
+    }
+    return maxHeight;
+}
+
+// The right child is pushed before the left one, so the leaves are visited in order
+template<typename Node, typename Compare>
+template<typename Visit>
+void LockFreeTree<Node, Compare>::forEach(const Node* node, Visit& visit) const
+{
+    std::vector<const Node*> nodes{ node };
+    while (not nodes.empty())
+    {
+        const Node* x{ nodes.back() };
+        nodes.pop_back();
+        Node* left{ address(x->left_.load()) };
+        Node* right{ address(x->right_.load()) };
+        if (left == nullptr)
+        {
+            if (x->infinity_ == 0)
+            {
+                visit(x->key_, x->value_);
+            }
+        }
+        else
+        {
+            nodes.push_back(right);
+            nodes.push_back(left);
+        }
+    }
+}
+
+#endif // LOCKFREETREE_CPP
@@ -0,0 +1,149 @@
+// Lock-free external binary search tree implementation
+//
+// Implementation is based on A. Natarajan, N. Mittal, Fast concurrent lock-free binary
+// search trees, Proceedings of the 19th ACM SIGPLAN Symposium on Principles and
+// Practice of Parallel Programming, 2014, pp. 317-328
+//
+// The tree is external: the keys and the values are in the leaves, and the internal
+// nodes only route the searches. Every internal node has two children. Insert
+// replaces a leaf with a new internal node that has the old and the new leaf as its
+// children. Erase first flags the edge to the leaf, which is the moment the key
+// leaves the tree, then tags the edge to the sibling of the leaf so that it can not
+// change, and finally swings the edge above the parent to the sibling. A thread that
+// finds a flagged or tagged edge on its way helps to finish the erase.
+//
+// The tree is not balanced, so random keys give it logarithmic height but sorted
+// keys make it a list. The nodes come from a NodePool, and EpochReclamation returns
+// the unlinked nodes to the pool.
+
+#ifndef LOCKFREETREE_HH
+#define LOCKFREETREE_HH
+
+#include "binarysearchtree.hh"
+#include "epochreclamation.hh"
+#include "nodepool.hh"
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+template<typename Key, typename Value>
+struct LockFreeNode
+{
+    using key_type = Key;
+    using mapped_type = Value;
+
+    const key_type key_;
+    // Only the leaves have a value
+    const mapped_type value_;
+    // Zero for the nodes with a key. The three sentinel keys that are greater than
+    // all the keys are 1, 2 and 3.
+    const int infinity_;
+    // The children with the flag and the tag bits of the edges. Nullptr in the leaves.
+    std::atomic<std::uintptr_t> left_;
+    std::atomic<std::uintptr_t> right_;
+
+    LockFreeNode(const key_type& key, const mapped_type& value, int infinity,
+                 LockFreeNode<key_type, mapped_type>* left,
+                 LockFreeNode<key_type, mapped_type>* right) :
+        key_{ key }, value_{ value },
+        infinity_{ infinity },
+        left_{ reinterpret_cast<std::uintptr_t>(left) },
+        right_{ reinterpret_cast<std::uintptr_t>(right) }
+    {}
+};
+
+// The member functions can be called from several threads at the same time,
+// except for clear and the destructor
+template<typename Node, typename Compare = std::less<typename Node::key_type>>
+class LockFreeTree : private CompareStorage<Compare>
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+    using value_type = std::pair<const key_type, mapped_type>;
+    using size_type = unsigned int;
+    using node_type = Node;
+    using key_compare = Compare;
+
+    LockFreeTree();
+    explicit LockFreeTree(const Compare& compare);
+    LockFreeTree(const LockFreeTree&) = delete;
+    LockFreeTree& operator=(const LockFreeTree&) = delete;
+    ~LockFreeTree();
+
+    // The number of keys once the operations in progress have finished
+    size_type size() const;
+    int height() const;
+
+    // Not thread-safe
+    void clear();
+
+    bool contains(const key_type& key) const;
+    // Copies the value of the key to value. Returns false if the key is not in the tree.
+    bool find(const key_type& key, mapped_type& value) const;
+    bool insert(const value_type& value);
+    size_type erase(const key_type& key);
+
+    // Calls visit for every key and value in the order of the keys. The keys that
+    // are inserted or erased during the scan may or may not be visited.
+    template<typename Visit>
+    void forEach(Visit visit) const;
+
+private:
+    // The edge to a leaf that is being erased
+    const static std::uintptr_t FLAG = 1;
+    // The edge to the sibling of a leaf that is being erased
+    const static std::uintptr_t TAG = 2;
+
+    // The path of a search
+    //  ancestor_: the parent of successor_
+    //  successor_: the highest node that is removed if leaf_ is erased
+    //  parent_: the parent of leaf_
+    //  leaf_: the leaf where the search ended
+    struct SeekRecord
+    {
+        Node* ancestor_;
+        Node* successor_;
+        Node* parent_;
+        Node* leaf_;
+    };
+
+    // The internal sentinel with the largest key. The tree is the left subtree of
+    // its left child.
+    Node* root_;
+    std::atomic<size_type> nodes_;
+    // Shared by the trees with the same node size, because the retired nodes
+    // may go back to the pool after the tree is gone
+    NodePool& pool_;
+
+    static Node* address(std::uintptr_t edge);
+    static bool flagged(std::uintptr_t edge);
+    static bool tagged(std::uintptr_t edge);
+    static std::uintptr_t edge(Node* node);
+
+    // Returns true if key is ordered before the key of node
+    bool less(const key_type& key, const Node* node) const;
+    bool equal(const key_type& key, const Node* node) const;
+    // The edge from node that the search for key follows
+    std::atomic<std::uintptr_t>& child(Node* node, const key_type& key) const;
+
+    Node* create(const key_type& key, const mapped_type& value, int infinity, Node* left, Node* right);
+    // Frees a node that no other thread can be reading
+    void free(Node* node);
+    void createSentinels();
+    void seek(const key_type& key, SeekRecord& record) const;
+    // Removes the flagged leaf and its parent. Returns false if another thread
+    // changed the tree first and the search has to be done again.
+    bool cleanup(const key_type& key, const SeekRecord& record);
+    // Retires the nodes that were removed when the edge above successor was
+    // swung to kept
+    void retire(const key_type& key, Node* successor, Node* parent, Node* kept);
+    void destroy(Node* node);
+    int height(const Node* node) const;
+    template<typename Visit>
+    void forEach(const Node* node, Visit& visit) const;
+};
+
+#include "lockfreetree.cpp"
+
+#endif // LOCKFREETREE_HH
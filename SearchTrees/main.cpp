@@ -15,6 +15,13 @@
 #include <iostream>
 #include <stdlib.h>
 
+// Appends the results of one run to the results of the earlier runs
+template<typename Time>
+void append(std::vector<Time>& times, const std::vector<Time>& newTimes)
+{
+    times.insert(times.end(), newTimes.begin(), newTimes.end());
+}
+
 int main(int argc, char *argv[])
 {
     if (argc != 5)
@@ -38,16 +45,44 @@ int main(int argc, char *argv[])
 
     TreeTest trees;
     std::vector<TestTime> testTimes;
+    std::vector<LatencyTime> latencyTimes;
+    std::vector<QueueTime> queueTimes;
+    std::vector<ScanTime> scanTimes;
+    std::vector<RekeyTime> rekeyTimes;
+    std::vector<StringTime> stringTimes;
+    std::vector<StringTime> prefixTimes;
+    std::vector<MultiTime> multiTimes;
+    std::vector<AggregateTime> aggregateTimes;
+    std::vector<IntervalTime> intervalTimes;
+    std::vector<PersistentTime> persistentTimes;
+    std::vector<ConcurrentTime> concurrentTimes;
+    std::vector<ReclamationTime> reclamationTimes;
+    std::vector<SnapshotTime> snapshotTimes;
+    std::vector<ScalingTime> scalingTimes;
+    std::vector<ServiceTime> serviceTimes;
+    std::vector<CompareTime> compareTimes;
     for (int i{ 0 }; i < repeats; ++i)
     {
         for (auto n : testValues)
         {
             std::cout << "Running tests with " << n << std::endl;
-            auto newTests{ trees.test(n) };
-            for (auto test : newTests)
-            {
-                testTimes.push_back(test);
-            }
+            append(testTimes, trees.test(n));
+            append(latencyTimes, trees.testLatency(n));
+            append(queueTimes, trees.testQueue(n));
+            append(scanTimes, trees.testScan(n));
+            append(rekeyTimes, trees.testRekey(n));
+            append(stringTimes, trees.testString(n));
+            append(prefixTimes, trees.testPrefix(n));
+            append(multiTimes, trees.testMulti(n));
+            append(aggregateTimes, trees.testAggregate(n));
+            append(intervalTimes, trees.testInterval(n));
+            append(persistentTimes, trees.testPersistent(n));
+            append(concurrentTimes, trees.testConcurrent(n));
+            append(reclamationTimes, trees.testReclamation(n));
+            append(snapshotTimes, trees.testSnapshot(n));
+            append(scalingTimes, trees.testScaling(n));
+            append(serviceTimes, trees.testService(n));
+            append(compareTimes, trees.testCompare(n));
             std::cout << std::endl;
         }
     }
@@ -74,5 +109,149 @@ int main(int argc, char *argv[])
         }
     }
 
+    std::cout << std::endl
+              << "Printing the insert latency results (latencies in ns, rebalancing in us):"
+              << std::endl << std::endl;
+    printLatencyHeader();
+    for (auto time : latencyTimes)
+    {
+        printLatencyTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the priority queue results (times in ms):"
+              << std::endl << std::endl;
+    printQueueHeader();
+    for (auto time : queueTimes)
+    {
+        printQueueTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the scan results (times in ms):"
+              << std::endl << std::endl;
+    printScanHeader();
+    for (auto time : scanTimes)
+    {
+        printScanTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the re-keying results (times in ms):"
+              << std::endl << std::endl;
+    printRekeyHeader();
+    for (auto time : rekeyTimes)
+    {
+        printRekeyTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the string lookup results (times in ms):"
+              << std::endl << std::endl;
+    printStringHeader();
+    for (auto time : stringTimes)
+    {
+        printStringTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the prefix key results (times in ms):"
+              << std::endl << std::endl;
+    printStringHeader();
+    for (auto time : prefixTimes)
+    {
+        printStringTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the multimap results (times in ms):"
+              << std::endl << std::endl;
+    printMultiHeader();
+    for (auto time : multiTimes)
+    {
+        printMultiTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the aggregate results (times in ms):"
+              << std::endl << std::endl;
+    printAggregateHeader();
+    for (auto time : aggregateTimes)
+    {
+        printAggregateTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the interval results (times in ms):"
+              << std::endl << std::endl;
+    printIntervalHeader();
+    for (auto time : intervalTimes)
+    {
+        printIntervalTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the persistence results (times in ms):"
+              << std::endl << std::endl;
+    printPersistentHeader();
+    for (auto time : persistentTimes)
+    {
+        printPersistentTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the concurrent results (times in ms):"
+              << std::endl << std::endl;
+    printConcurrentHeader();
+    for (auto time : concurrentTimes)
+    {
+        printConcurrentTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the reclamation results (times in ms):"
+              << std::endl << std::endl;
+    printReclamationHeader();
+    for (auto time : reclamationTimes)
+    {
+        printReclamationTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the snapshot results (times in ms, scans in ns per key):"
+              << std::endl << std::endl;
+    printSnapshotHeader();
+    for (auto time : snapshotTimes)
+    {
+        printSnapshotTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the scaling results (times in ms):"
+              << std::endl << std::endl;
+    printScalingHeader();
+    for (auto time : scalingTimes)
+    {
+        printScalingTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the service results (times in ms):"
+              << std::endl << std::endl;
+    printServiceHeader();
+    for (auto time : serviceTimes)
+    {
+        printServiceTime(time);
+    }
+
+    std::cout << std::endl
+              << "Printing the comparison count results (comparisons per operation):"
+              << std::endl << std::endl;
+    printCompareHeader();
+    for (auto time : compareTimes)
+    {
+        printCompareTime(time);
+    }
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,82 @@
+// Monoids for the subtree summaries of the binary search trees
+//
+// Implementation is based on T.H. Cormen, C.E. Leiserson, R.L. Rivest, C. Stein,
+// Introduction to algorithms, 3rd ed. MIT Press, Cambridge, MA, 2009, Chapter 14
+//
+// A tree whose nodes have a monoid keeps the summary of the values of every
+// subtree, and aggregate(lo, hi) combines the summaries of O(log n) subtrees
+// instead of visiting every node in the range.
+
+#ifndef MONOID_HH
+#define MONOID_HH
+
+#include <algorithm>
+#include <limits>
+
+// The sum of the values
+template<typename Value>
+struct SumMonoid
+{
+    using summary_type = Value;
+
+    static summary_type identity()
+    {
+        return summary_type{};
+    }
+
+    static summary_type lift(const Value& value)
+    {
+        return value;
+    }
+
+    static summary_type combine(const summary_type& a, const summary_type& b)
+    {
+        return a + b;
+    }
+};
+
+// The smallest value, or the largest representable value for an empty range
+template<typename Value>
+struct MinMonoid
+{
+    using summary_type = Value;
+
+    static summary_type identity()
+    {
+        return std::numeric_limits<Value>::max();
+    }
+
+    static summary_type lift(const Value& value)
+    {
+        return value;
+    }
+
+    static summary_type combine(const summary_type& a, const summary_type& b)
+    {
+        return std::min(a, b);
+    }
+};
+
+// The largest value, or the smallest representable value for an empty range
+template<typename Value>
+struct MaxMonoid
+{
+    using summary_type = Value;
+
+    static summary_type identity()
+    {
+        return std::numeric_limits<Value>::lowest();
+    }
+
+    static summary_type lift(const Value& value)
+    {
+        return value;
+    }
+
+    static summary_type combine(const summary_type& a, const summary_type& b)
+    {
+        return std::max(a, b);
+    }
+};
+
+#endif // MONOID_HH
@@ -0,0 +1,75 @@
+// Lock-free multi-producer single-consumer queue
+//
+// Implementation is based on D. Vyukov, Intrusive MPSC node-based queue,
+// http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue,
+// 2010
+
+#ifndef MPSCQUEUE_CPP
+#define MPSCQUEUE_CPP
+
+#include "mpscqueue.hh"
+
+template<typename T>
+MpscQueue<T>::MpscQueue() :
+    head_{ &stub_ },
+    tail_{ &stub_ },
+    stub_{}
+{
+}
+
+template<typename T>
+void MpscQueue<T>::push(T* element)
+{
+    link(element);
+}
+
+// The stub is skipped when it is at the tail. When the tail is the last linked
+// element, the stub is pushed behind it, so that the tail can be taken without
+// leaving the queue without a head.
+template<typename T>
+T* MpscQueue<T>::pop()
+{
+    MpscLink* tail{ tail_ };
+    MpscLink* next{ tail->next_.load(std::memory_order_acquire) };
+    if (tail == &stub_)
+    {
+        if (next == nullptr)
+        {
+            return nullptr;
+        }
+        tail_ = next;
+        tail = next;
+        next = next->next_.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr)
+    {
+        tail_ = next;
+        return static_cast<T*>(tail);
+    }
+
+    // A producer has swapped in a newer head but not linked it yet
+    if (tail != head_.load(std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+
+    link(&stub_);
+    next = tail->next_.load(std::memory_order_acquire);
+    if (next != nullptr)
+    {
+        tail_ = next;
+        return static_cast<T*>(tail);
+    }
+    return nullptr;
+}
+
+template<typename T>
+void MpscQueue<T>::link(MpscLink* element)
+{
+    element->next_.store(nullptr, std::memory_order_relaxed);
+    MpscLink* previous{ head_.exchange(element, std::memory_order_acq_rel) };
+    previous->next_.store(element, std::memory_order_release);
+}
+
+#endif // MPSCQUEUE_CPP
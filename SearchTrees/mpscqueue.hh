@@ -0,0 +1,49 @@
+// Lock-free multi-producer single-consumer queue
+//
+// Implementation is based on D. Vyukov, Intrusive MPSC node-based queue,
+// http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue,
+// 2010
+//
+// The elements link themselves through the MpscLink they derive from, so pushing
+// allocates nothing. A producer swaps itself in as the head with one atomic exchange
+// and then links the previous head to itself. The consumer takes the elements from
+// the tail. Between the exchange and the link the newer elements cannot be reached,
+// so the consumer may find the queue empty for a moment although a push has started.
+// A stub link keeps the queue from ever being truly empty, so the head and the tail
+// are never null.
+
+#ifndef MPSCQUEUE_HH
+#define MPSCQUEUE_HH
+
+#include <atomic>
+
+struct MpscLink
+{
+    std::atomic<MpscLink*> next_{ nullptr };
+};
+
+template<typename T>
+class MpscQueue
+{
+public:
+    MpscQueue();
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Called by any number of producers. The element must not be in the queue.
+    void push(T* element);
+    // Only called by the consumer. Returns null if the queue is empty or the
+    // newest push has not been linked yet.
+    T* pop();
+
+private:
+    alignas(64) std::atomic<MpscLink*> head_;
+    alignas(64) MpscLink* tail_;
+    MpscLink stub_;
+
+    void link(MpscLink* element);
+};
+
+#include "mpscqueue.cpp"
+
+#endif // MPSCQUEUE_HH
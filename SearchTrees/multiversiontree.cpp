@@ -0,0 +1,520 @@
+// Multi-version red black tree with snapshot reads
+//
+// Implementation is based on P.A. Bernstein, N. Goodman, Multiversion concurrency
+// control - theory and algorithms, ACM Transactions on Database Systems 8(4), 1983,
+// pp. 465-483, and J. Böttcher, V. Leis, T. Neumann, A. Kemper, Scalable garbage
+// collection for in-memory MVCC systems, Proceedings of the VLDB Endowment 13(2),
+// 2019, pp. 128-141
+
+#ifndef MULTIVERSIONTREE_CPP
+#define MULTIVERSIONTREE_CPP
+
+#include "multiversiontree.hh"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+template<typename Key, typename Value, typename Compare>
+MultiVersionTree<Key, Value, Compare>::Snapshot::Snapshot(const MultiVersionTree* tree,
+                                                          typename std::multiset<version_type>::iterator pin) :
+    tree_{ tree },
+    pin_{ pin },
+    version_{ *pin }
+{
+}
+
+template<typename Key, typename Value, typename Compare>
+MultiVersionTree<Key, Value, Compare>::Snapshot::Snapshot(Snapshot&& other) :
+    tree_{ other.tree_ },
+    pin_{ other.pin_ },
+    version_{ other.version_ }
+{
+    other.tree_ = nullptr;
+}
+
+template<typename Key, typename Value, typename Compare>
+MultiVersionTree<Key, Value, Compare>::Snapshot::~Snapshot()
+{
+    if (tree_ != nullptr)
+    {
+        tree_->release(pin_);
+    }
+}
+
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::version_type
+MultiVersionTree<Key, Value, Compare>::Snapshot::version() const
+{
+    return version_;
+}
+
+template<typename Key, typename Value, typename Compare>
+MultiVersionTree<Key, Value, Compare>::MultiVersionTree() :
+    MultiVersionTree{ Compare{} }
+{
+}
+
+template<typename Key, typename Value, typename Compare>
+MultiVersionTree<Key, Value, Compare>::MultiVersionTree(const Compare& compare) :
+    tree_{ compare },
+    turnstile_{},
+    latch_{},
+    clock_{ 0 },
+    size_{ 0 },
+    versions_{ 0 },
+    garbage_{},
+    snapshotMutex_{},
+    snapshots_{},
+    collectMutex_{},
+    sleepMutex_{},
+    wakeup_{},
+    requested_{ false },
+    stop_{ false },
+    collector_{}
+{
+    collector_ = std::thread{ [this]() { run(); } };
+}
+
+template<typename Key, typename Value, typename Compare>
+MultiVersionTree<Key, Value, Compare>::~MultiVersionTree()
+{
+    {
+        std::lock_guard<std::mutex> lock{ sleepMutex_ };
+        stop_ = true;
+        wakeup_.notify_one();
+    }
+    collector_.join();
+    destroyAll();
+}
+
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::size_type MultiVersionTree<Key, Value, Compare>::size() const
+{
+    return size_.load(std::memory_order_relaxed);
+}
+
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::size_type MultiVersionTree<Key, Value, Compare>::versions() const
+{
+    return versions_.load(std::memory_order_relaxed);
+}
+
+template<typename Key, typename Value, typename Compare>
+int MultiVersionTree<Key, Value, Compare>::height() const
+{
+    auto latch{ readLatch() };
+    return tree_.height();
+}
+
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::version_type MultiVersionTree<Key, Value, Compare>::version() const
+{
+    return clock_.load(std::memory_order_acquire);
+}
+
+// The clock is not reset, so the versions keep growing over the clears
+template<typename Key, typename Value, typename Compare>
+void MultiVersionTree<Key, Value, Compare>::clear()
+{
+    std::lock_guard<std::mutex> collecting{ collectMutex_ };
+    auto latch{ writeLatch() };
+    destroyAll();
+    tree_.clear();
+    garbage_.clear();
+    size_.store(0, std::memory_order_relaxed);
+    versions_.store(0, std::memory_order_relaxed);
+}
+
+// The collector reads the oldest snapshot under the same lock, so it either sees
+// the new snapshot or a version that is not newer than it
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::Snapshot MultiVersionTree<Key, Value, Compare>::snapshot() const
+{
+    std::lock_guard<std::mutex> lock{ snapshotMutex_ };
+    return Snapshot{ this, snapshots_.insert(clock_.load(std::memory_order_acquire)) };
+}
+
+template<typename Key, typename Value, typename Compare>
+bool MultiVersionTree<Key, Value, Compare>::contains(const key_type& key) const
+{
+    auto latch{ readLatch() };
+    return lookup(key, clock_.load(std::memory_order_relaxed)) != nullptr;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool MultiVersionTree<Key, Value, Compare>::find(const key_type& key, mapped_type& value) const
+{
+    auto latch{ readLatch() };
+    Version* found{ lookup(key, clock_.load(std::memory_order_relaxed)) };
+    if (found == nullptr)
+    {
+        return false;
+    }
+    value = found->value_;
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool MultiVersionTree<Key, Value, Compare>::contains(const Snapshot& snapshot, const key_type& key) const
+{
+    auto latch{ readLatch() };
+    return lookup(key, snapshot.version()) != nullptr;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool MultiVersionTree<Key, Value, Compare>::find(const Snapshot& snapshot, const key_type& key, mapped_type& value) const
+{
+    auto latch{ readLatch() };
+    Version* found{ lookup(key, snapshot.version()) };
+    if (found == nullptr)
+    {
+        return false;
+    }
+    value = found->value_;
+    return true;
+}
+
+// A key that was erased but whose node is still in the tree gets a new version
+// at the head of its chain
+template<typename Key, typename Value, typename Compare>
+bool MultiVersionTree<Key, Value, Compare>::insert(const value_type& value)
+{
+    auto latch{ writeLatch() };
+    version_type version{ clock_.load(std::memory_order_relaxed) + 1 };
+    Node* node{ tree_.find(value.first) };
+    if (node == tree_.nil())
+    {
+        tree_.insert(typename Tree::value_type{ value.first, new Version{ value.second, version, INFINITE, nullptr } });
+    }
+    else if (node->value_->end_ == INFINITE)
+    {
+        return false;
+    }
+    else
+    {
+        node->value_ = new Version{ value.second, version, INFINITE, node->value_ };
+    }
+
+    size_.fetch_add(1, std::memory_order_relaxed);
+    versions_.fetch_add(1, std::memory_order_relaxed);
+    clock_.store(version, std::memory_order_release);
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::size_type MultiVersionTree<Key, Value, Compare>::erase(const key_type& key)
+{
+    bool wake{ false };
+    {
+        auto latch{ writeLatch() };
+        version_type version{ clock_.load(std::memory_order_relaxed) + 1 };
+        Node* node{ tree_.find(key) };
+        if (node == tree_.nil() or node->value_->end_ != INFINITE)
+        {
+            return 0;
+        }
+
+        node->value_->end_ = version;
+        garbage_.push_back(key);
+        wake = (garbage_.size() == COLLECT_THRESHOLD);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        clock_.store(version, std::memory_order_release);
+    }
+
+    if (wake)
+    {
+        std::lock_guard<std::mutex> lock{ sleepMutex_ };
+        requested_ = true;
+        wakeup_.notify_one();
+    }
+    return 1;
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename Visit>
+void MultiVersionTree<Key, Value, Compare>::forEach(const Snapshot& snapshot, Visit visit) const
+{
+    visitRange(snapshot.version(), nullptr, std::numeric_limits<size_type>::max(), visit);
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename Visit>
+typename MultiVersionTree<Key, Value, Compare>::size_type
+MultiVersionTree<Key, Value, Compare>::scan(const Snapshot& snapshot, const key_type& first,
+                                            size_type length, Visit visit) const
+{
+    return visitRange(snapshot.version(), &first, length, visit);
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename Visit>
+void MultiVersionTree<Key, Value, Compare>::forEach(Visit visit) const
+{
+    Snapshot pinned{ snapshot() };
+    forEach(pinned, visit);
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename Visit>
+typename MultiVersionTree<Key, Value, Compare>::size_type
+MultiVersionTree<Key, Value, Compare>::scan(const key_type& first, size_type length, Visit visit) const
+{
+    Snapshot pinned{ snapshot() };
+    return scan(pinned, first, length, visit);
+}
+
+// The keys are sorted and deduplicated so that the same key is pruned once and
+// the tree is walked in order. The keys that still have versions visible to some
+// snapshot are kept for the next round.
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::size_type MultiVersionTree<Key, Value, Compare>::collect()
+{
+    std::lock_guard<std::mutex> collecting{ collectMutex_ };
+    version_type oldest{ oldestVisible() };
+    std::vector<key_type> keys;
+    {
+        auto latch{ writeLatch() };
+        keys.swap(garbage_);
+    }
+    if (keys.empty())
+    {
+        return 0;
+    }
+
+    Compare compare{ tree_.keyCompare() };
+    std::sort(keys.begin(), keys.end(), compare);
+    keys.erase(std::unique(keys.begin(), keys.end(), [&compare](const key_type& a, const key_type& b)
+    {
+        return not compare(a, b) and not compare(b, a);
+    }), keys.end());
+
+    size_type freed{ 0 };
+    std::vector<key_type> kept;
+    for (std::size_t first{ 0 }; first < keys.size(); first += COLLECT_BATCH)
+    {
+        std::size_t last{ first + COLLECT_BATCH };
+        if (last > keys.size())
+        {
+            last = keys.size();
+        }
+
+        auto latch{ writeLatch() };
+        for (std::size_t i{ first }; i < last; ++i)
+        {
+            if (prune(keys[i], oldest, freed))
+            {
+                kept.push_back(keys[i]);
+            }
+        }
+        if (last == keys.size())
+        {
+            garbage_.insert(garbage_.end(), kept.begin(), kept.end());
+        }
+    }
+
+    versions_.fetch_sub(freed, std::memory_order_relaxed);
+    return freed;
+}
+
+template<typename Key, typename Value, typename Compare>
+std::shared_lock<std::shared_mutex> MultiVersionTree<Key, Value, Compare>::readLatch() const
+{
+    std::lock_guard<std::mutex> turn{ turnstile_ };
+    return std::shared_lock<std::shared_mutex>{ latch_ };
+}
+
+template<typename Key, typename Value, typename Compare>
+std::unique_lock<std::shared_mutex> MultiVersionTree<Key, Value, Compare>::writeLatch() const
+{
+    std::lock_guard<std::mutex> turn{ turnstile_ };
+    return std::unique_lock<std::shared_mutex>{ latch_ };
+}
+
+template<typename Key, typename Value, typename Compare>
+void MultiVersionTree<Key, Value, Compare>::release(typename std::multiset<version_type>::iterator pin) const
+{
+    std::lock_guard<std::mutex> lock{ snapshotMutex_ };
+    snapshots_.erase(pin);
+}
+
+// A snapshot taken later gets at least the current version
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::version_type MultiVersionTree<Key, Value, Compare>::oldestVisible() const
+{
+    std::lock_guard<std::mutex> lock{ snapshotMutex_ };
+    if (snapshots_.empty())
+    {
+        return clock_.load(std::memory_order_acquire);
+    }
+    return *snapshots_.begin();
+}
+
+// The chain is ordered from the newest version to the oldest, and the versions
+// of a key do not overlap
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::Version*
+MultiVersionTree<Key, Value, Compare>::visible(Node* node, version_type version) const
+{
+    Version* current{ node->value_ };
+    while (current != nullptr and current->begin_ > version)
+    {
+        current = current->older_;
+    }
+    if (current == nullptr or current->end_ <= version)
+    {
+        return nullptr;
+    }
+    return current;
+}
+
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::Version*
+MultiVersionTree<Key, Value, Compare>::lookup(const key_type& key, version_type version) const
+{
+    Node* node{ tree_.find(key) };
+    if (node == tree_.nil())
+    {
+        return nullptr;
+    }
+    return visible(node, version);
+}
+
+// No snapshot from oldest on can see a version that ended at or before oldest,
+// and the versions older than it ended even earlier
+template<typename Key, typename Value, typename Compare>
+bool MultiVersionTree<Key, Value, Compare>::prune(const key_type& key, version_type oldest, size_type& freed)
+{
+    Node* node{ tree_.find(key) };
+    if (node == tree_.nil())
+    {
+        return false;
+    }
+
+    Version* newer{ nullptr };
+    Version* current{ node->value_ };
+    while (current != nullptr and current->end_ > oldest)
+    {
+        newer = current;
+        current = current->older_;
+    }
+    if (current != nullptr)
+    {
+        if (newer == nullptr)
+        {
+            node->value_ = nullptr;
+        }
+        else
+        {
+            newer->older_ = nullptr;
+        }
+        freed += destroy(current);
+    }
+
+    Version* head{ node->value_ };
+    if (head == nullptr)
+    {
+        tree_.erase(key);
+        return false;
+    }
+    return head->end_ != INFINITE or head->older_ != nullptr;
+}
+
+template<typename Key, typename Value, typename Compare>
+typename MultiVersionTree<Key, Value, Compare>::size_type MultiVersionTree<Key, Value, Compare>::destroy(Version* version)
+{
+    size_type destroyed{ 0 };
+    while (version != nullptr)
+    {
+        Version* older{ version->older_ };
+        delete version;
+        version = older;
+        ++destroyed;
+    }
+    return destroyed;
+}
+
+template<typename Key, typename Value, typename Compare>
+void MultiVersionTree<Key, Value, Compare>::destroyAll()
+{
+    for (Node* node{ tree_.minimum() }; node != tree_.nil(); node = tree_.successor(node))
+    {
+        destroy(node->value_);
+        node->value_ = nullptr;
+    }
+}
+
+template<typename Key, typename Value, typename Compare>
+void MultiVersionTree<Key, Value, Compare>::run()
+{
+    const std::chrono::milliseconds interval{ static_cast<long long>(COLLECT_INTERVAL) };
+    std::unique_lock<std::mutex> lock{ sleepMutex_ };
+    while (not stop_)
+    {
+        wakeup_.wait_for(lock, interval, [this]()
+        {
+            return requested_ or stop_;
+        });
+        if (stop_)
+        {
+            return;
+        }
+        requested_ = false;
+
+        lock.unlock();
+        collect();
+        lock.lock();
+    }
+}
+
+// The scan copies a batch of the visible keys and values under the latch, and
+// visits them after it has released the latch, so a slow visit does not hold up
+// the writers and visit may write to the tree. The scan remembers the next key
+// and continues from it. The keys that were inserted in the meantime are not
+// visible in the version of the scan, and the keys that are visible cannot be
+// collected, so the scan sees the same keys as if it had held the latch all the time.
+template<typename Key, typename Value, typename Compare>
+template<typename Visit>
+typename MultiVersionTree<Key, Value, Compare>::size_type
+MultiVersionTree<Key, Value, Compare>::visitRange(version_type version, const key_type* first,
+                                                  size_type length, Visit& visit) const
+{
+    size_type visited{ 0 };
+    bool resume{ first != nullptr };
+    key_type next{ resume ? *first : key_type{} };
+    std::vector<std::pair<key_type, mapped_type>> batch;
+    batch.reserve(SCAN_BATCH);
+    bool more{ true };
+    while (more and visited < length)
+    {
+        batch.clear();
+        {
+            auto latch{ readLatch() };
+            Node* node{ resume ? tree_.lowerBound(next) : tree_.minimum() };
+            for (size_type i{ 0 }; i < SCAN_BATCH and node != tree_.nil() and visited + batch.size() < length; ++i)
+            {
+                Version* found{ visible(node, version) };
+                if (found != nullptr)
+                {
+                    batch.emplace_back(node->key_, found->value_);
+                }
+                node = tree_.successor(node);
+            }
+
+            more = node != tree_.nil();
+            if (more)
+            {
+                next = node->key_;
+                resume = true;
+            }
+        }
+
+        for (const auto& entry : batch)
+        {
+            visit(entry.first, entry.second);
+        }
+        visited += batch.size();
+    }
+    return visited;
+}
+
+#endif // MULTIVERSIONTREE_CPP
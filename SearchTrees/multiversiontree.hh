@@ -0,0 +1,188 @@
+// Multi-version red black tree with snapshot reads
+//
+// Implementation is based on P.A. Bernstein, N. Goodman, Multiversion concurrency
+// control - theory and algorithms, ACM Transactions on Database Systems 8(4), 1983,
+// pp. 465-483, and J. Böttcher, V. Leis, T. Neumann, A. Kemper, Scalable garbage
+// collection for in-memory MVCC systems, Proceedings of the VLDB Endowment 13(2),
+// 2019, pp. 128-141
+//
+// Every node of the underlying RedBlackTree holds a chain of the versions of its key,
+// newest first. A version carries the value and the versions of the tree in which it
+// was created and ended, and it is visible in the versions [begin, end). The writers
+// are serialized, and each of them makes one new version of the tree. An erase only
+// ends the current version of the key, so the node stays in the tree for the readers
+// of the older versions.
+//
+// A reader pins a snapshot of the latest version and sees exactly the keys and values
+// of that version however long it keeps the snapshot. The readers latch the tree only
+// for one search or while a scan copies a short batch of keys and values, which the
+// scan visits after it has released the latch. The scan continues from the next key
+// after the writers have had their turn, so a long scan does not keep the writers
+// waiting. A collector thread frees the versions that ended before the oldest pinned
+// snapshot and removes the nodes that have no versions left.
+
+#ifndef MULTIVERSIONTREE_HH
+#define MULTIVERSIONTREE_HH
+
+#include "redblacktree.hh"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template<typename Key, typename Value, typename Compare = std::less<Key>>
+class MultiVersionTree
+{
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<const key_type, mapped_type>;
+    using size_type = unsigned int;
+    using version_type = unsigned long long;
+
+    // The end of a version that has not ended
+    const static version_type INFINITE = ~0ULL;
+    // How many nodes a scan visits before it lets the writers in
+    const static size_type SCAN_BATCH = 64;
+    // How many keys the collector prunes before it lets the others in
+    const static size_type COLLECT_BATCH = 256;
+    // The number of ended versions that wakes up the collector before its interval
+    const static size_type COLLECT_THRESHOLD = 4096;
+    // How often the collector runs in milliseconds
+    const static int COLLECT_INTERVAL = 10;
+
+    // A pinned version of the tree. The versions visible in it are not collected
+    // while it exists, so it should not be kept longer than it is needed. A
+    // snapshot must not outlive its tree.
+    class Snapshot
+    {
+    public:
+        Snapshot(Snapshot&& other);
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+        ~Snapshot();
+
+        version_type version() const;
+
+    private:
+        friend class MultiVersionTree;
+
+        Snapshot(const MultiVersionTree* tree, typename std::multiset<version_type>::iterator pin);
+
+        const MultiVersionTree* tree_;
+        typename std::multiset<version_type>::iterator pin_;
+        version_type version_;
+    };
+
+    MultiVersionTree();
+    explicit MultiVersionTree(const Compare& compare);
+    MultiVersionTree(const MultiVersionTree&) = delete;
+    MultiVersionTree& operator=(const MultiVersionTree&) = delete;
+    ~MultiVersionTree();
+
+    // The number of keys in the latest version
+    size_type size() const;
+    // The number of stored versions, including the ones not yet collected
+    size_type versions() const;
+    int height() const;
+    // The latest version of the tree
+    version_type version() const;
+    // Drops every version. No snapshot of the tree may be in use.
+    void clear();
+
+    // Pins the latest version
+    Snapshot snapshot() const;
+
+    // The reads without a snapshot see the latest version
+    bool contains(const key_type& key) const;
+    // Copies the value of the key to value. Returns false if the key is not in the tree.
+    bool find(const key_type& key, mapped_type& value) const;
+    bool contains(const Snapshot& snapshot, const key_type& key) const;
+    bool find(const Snapshot& snapshot, const key_type& key, mapped_type& value) const;
+
+    // Each write makes a new version of the tree
+    bool insert(const value_type& value);
+    size_type erase(const key_type& key);
+
+    // Calls visit for every key and value of the snapshot in the order of the keys.
+    // The keys and values are copied in batches under the latch and visited after
+    // it has been released, so visit may take its time and may change the tree.
+    template<typename Visit>
+    void forEach(const Snapshot& snapshot, Visit visit) const;
+    // Calls visit for at most length keys of the snapshot starting from the first
+    // key that is not less than first. Returns the number of visited keys.
+    template<typename Visit>
+    size_type scan(const Snapshot& snapshot, const key_type& first, size_type length, Visit visit) const;
+    // The same in a snapshot of the latest version
+    template<typename Visit>
+    void forEach(Visit visit) const;
+    template<typename Visit>
+    size_type scan(const key_type& first, size_type length, Visit visit) const;
+
+    // Frees the versions that no snapshot can see. The collector thread calls
+    // this regularly. Returns the number of freed versions.
+    size_type collect();
+
+private:
+    struct Version
+    {
+        mapped_type value_;
+        version_type begin_;
+        version_type end_;
+        Version* older_;
+    };
+
+    using Node = RedBlackNode<key_type, Version*>;
+    using Tree = RedBlackTree<Node, Compare>;
+
+    Tree tree_;
+    // The readers pass the turnstile before they latch the tree, and a writer holds
+    // the turnstile while it waits for the latch, so the batches of the scans
+    // cannot keep a writer waiting for long
+    mutable std::mutex turnstile_;
+    mutable std::shared_mutex latch_;
+    std::atomic<version_type> clock_;
+    std::atomic<size_type> size_;
+    std::atomic<size_type> versions_;
+    // The keys that have ended versions, appended by the writers
+    std::vector<key_type> garbage_;
+
+    mutable std::mutex snapshotMutex_;
+    mutable std::multiset<version_type> snapshots_;
+
+    std::mutex collectMutex_;
+    std::mutex sleepMutex_;
+    std::condition_variable wakeup_;
+    bool requested_;
+    bool stop_;
+    std::thread collector_;
+
+    std::shared_lock<std::shared_mutex> readLatch() const;
+    std::unique_lock<std::shared_mutex> writeLatch() const;
+
+    void release(typename std::multiset<version_type>::iterator pin) const;
+    // The oldest version that a snapshot can see now or later
+    version_type oldestVisible() const;
+    // Returns the version of the node visible in the given version of the tree
+    Version* visible(Node* node, version_type version) const;
+    Version* lookup(const key_type& key, version_type version) const;
+    // Frees the versions of the key that ended at or before oldest. Returns true
+    // if the key still has ended versions. Called with the tree latched for writing.
+    bool prune(const key_type& key, version_type oldest, size_type& freed);
+    // Frees the version and the older ones. Returns the number of freed versions.
+    static size_type destroy(Version* version);
+    void destroyAll();
+    void run();
+
+    template<typename Visit>
+    size_type visitRange(version_type version, const key_type* first, size_type length, Visit& visit) const;
+};
+
+#include "multiversiontree.cpp"
+
+#endif // MULTIVERSIONTREE_HH
@@ -0,0 +1,86 @@
+// Node handle for moving nodes out of and into the search trees
+//
+// Implementation is based on the node handles of the C++17 associative containers,
+// ISO/IEC 14882:2017, Section 26.2.4
+
+#ifndef NODEHANDLE_CPP
+#define NODEHANDLE_CPP
+
+#include "nodehandle.hh"
+
+template<typename Node>
+NodeHandle<Node>::NodeHandle() :
+    node_{ nullptr }
+{
+}
+
+template<typename Node>
+NodeHandle<Node>::NodeHandle(Node* node) :
+    node_{ node }
+{
+}
+
+template<typename Node>
+NodeHandle<Node>::NodeHandle(NodeHandle<Node>&& other) :
+    node_{ other.node_ }
+{
+    other.node_ = nullptr;
+}
+
+template<typename Node>
+NodeHandle<Node>::~NodeHandle()
+{
+    delete node_;
+}
+
+template<typename Node>
+NodeHandle<Node>& NodeHandle<Node>::operator=(NodeHandle<Node>&& other)
+{
+    if (this != &other)
+    {
+        delete node_;
+        node_ = other.node_;
+        other.node_ = nullptr;
+    }
+    return *this;
+}
+
+template<typename Node>
+bool NodeHandle<Node>::empty() const
+{
+    return node_ == nullptr;
+}
+
+template<typename Node>
+NodeHandle<Node>::operator bool() const
+{
+    return node_ != nullptr;
+}
+
+template<typename Node>
+typename NodeHandle<Node>::key_type& NodeHandle<Node>::key() const
+{
+    return node_->key_;
+}
+
+template<typename Node>
+std::add_lvalue_reference_t<typename NodeHandle<Node>::mapped_type> NodeHandle<Node>::mapped() const
+{
+    return node_->value_;
+}
+
+template<typename Node>
+Node* NodeHandle<Node>::get() const
+{
+    return node_;
+}
+
+template<typename Node>
+Node* NodeHandle<Node>::release()
+{
+    Node* node{ node_ };
+    node_ = nullptr;
+    return node;
+}
+
+#endif // NODEHANDLE_CPP
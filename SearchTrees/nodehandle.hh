@@ -0,0 +1,50 @@
+// Node handle for moving nodes out of and into the search trees
+//
+// Implementation is based on the node handles of the C++17 associative containers,
+// ISO/IEC 14882:2017, Section 26.2.4
+
+#ifndef NODEHANDLE_HH
+#define NODEHANDLE_HH
+
+#include <type_traits>
+
+// A move-only owner of a node that has been extracted from a tree. The key and
+// the value can be changed while the node is outside of a tree, and the node
+// can be inserted back to any tree of the same type without reallocation.
+// An empty handle owns no node.
+template<typename Node>
+class NodeHandle
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+
+    NodeHandle();
+    explicit NodeHandle(Node* node);
+    NodeHandle(NodeHandle<Node>&& other);
+    NodeHandle(const NodeHandle<Node>&) = delete;
+    ~NodeHandle();
+
+    NodeHandle<Node>& operator=(NodeHandle<Node>&& other);
+    NodeHandle<Node>& operator=(const NodeHandle<Node>&) = delete;
+
+    bool empty() const;
+    explicit operator bool() const;
+
+    // The handle must not be empty
+    key_type& key() const;
+    // Not available for set nodes, which have no mapped value
+    std::add_lvalue_reference_t<mapped_type> mapped() const;
+
+    // Returns the owned node, or nullptr if the handle is empty
+    Node* get() const;
+    // Gives up the ownership of the node and returns it
+    Node* release();
+
+private:
+    Node* node_;
+};
+
+#include "nodehandle.cpp"
+
+#endif // NODEHANDLE_HH
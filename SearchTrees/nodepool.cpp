@@ -0,0 +1,144 @@
+// Memory pool for fixed-size nodes
+//
+// Implementation is based on J. Bonwick, The slab allocator: an object-caching kernel
+// memory allocator, Proceedings of the USENIX Summer 1994 Technical Conference,
+// 1994, pp. 87-98
+
+#include "nodepool.hh"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <new>
+
+NodePool::NodePool(std::size_t blockSize) :
+    blockSize_{ (blockSize + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)
+                * alignof(std::max_align_t) },
+    shards_{},
+    slabMutex_{},
+    slabs_{}
+{
+}
+
+NodePool::~NodePool()
+{
+    for (void* slab : slabs_)
+    {
+        ::operator delete(slab);
+    }
+}
+
+std::size_t NodePool::blockSize() const
+{
+    return blockSize_;
+}
+
+std::size_t NodePool::capacity() const
+{
+    std::lock_guard<std::mutex> lock{ slabMutex_ };
+    return slabs_.size() * SLAB_BLOCKS;
+}
+
+void* NodePool::allocate()
+{
+    std::size_t own{ shardIndex() };
+    {
+        std::lock_guard<std::mutex> lock{ shards_[own].mutex_ };
+        if (not shards_[own].free_.empty())
+        {
+            void* block{ shards_[own].free_.back() };
+            shards_[own].free_.pop_back();
+            return block;
+        }
+    }
+
+    void* block{ steal(own) };
+    if (block != nullptr)
+    {
+        return block;
+    }
+
+    std::lock_guard<std::mutex> lock{ shards_[own].mutex_ };
+    return grow(shards_[own]);
+}
+
+void NodePool::deallocate(void* block)
+{
+    Shard& shard{ shards_[shardIndex()] };
+    std::lock_guard<std::mutex> lock{ shard.mutex_ };
+    shard.free_.push_back(block);
+}
+
+void NodePool::deallocate(const std::vector<void*>& blocks)
+{
+    Shard& shard{ shards_[shardIndex()] };
+    std::lock_guard<std::mutex> lock{ shard.mutex_ };
+    shard.free_.insert(shard.free_.end(), blocks.begin(), blocks.end());
+}
+
+NodePool& NodePool::shared(std::size_t blockSize)
+{
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<NodePool>> pools;
+
+    std::lock_guard<std::mutex> lock{ mutex };
+    auto& pool{ pools[blockSize] };
+    if (not pool)
+    {
+        pool = std::make_unique<NodePool>(blockSize);
+    }
+    return *pool;
+}
+
+// Every thread gets the next shard when it uses a pool for the first time
+std::size_t NodePool::shardIndex()
+{
+    static std::atomic<std::size_t> nextShard{ 0 };
+    thread_local std::size_t shard{ nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS };
+    return shard;
+}
+
+// Half of the free blocks of the first shard that has any are moved to the
+// calling thread, so that a thread that only allocates does not steal every time
+void* NodePool::steal(std::size_t own)
+{
+    for (std::size_t i{ 1 }; i < SHARDS; ++i)
+    {
+        Shard& other{ shards_[(own + i) % SHARDS] };
+        std::unique_lock<std::mutex> lock{ other.mutex_, std::try_to_lock };
+        if (not lock.owns_lock() or other.free_.empty())
+        {
+            continue;
+        }
+
+        std::size_t keep{ other.free_.size() / 2 };
+        std::vector<void*> stolen(other.free_.begin() + keep, other.free_.end());
+        other.free_.resize(keep);
+        lock.unlock();
+
+        void* block{ stolen.back() };
+        stolen.pop_back();
+        if (not stolen.empty())
+        {
+            Shard& shard{ shards_[own] };
+            std::lock_guard<std::mutex> ownLock{ shard.mutex_ };
+            shard.free_.insert(shard.free_.end(), stolen.begin(), stolen.end());
+        }
+        return block;
+    }
+    return nullptr;
+}
+
+void* NodePool::grow(Shard& shard)
+{
+    char* slab{ static_cast<char*>(::operator new(blockSize_ * SLAB_BLOCKS)) };
+    {
+        std::lock_guard<std::mutex> lock{ slabMutex_ };
+        slabs_.push_back(slab);
+    }
+
+    for (std::size_t i{ 1 }; i < SLAB_BLOCKS; ++i)
+    {
+        shard.free_.push_back(slab + i * blockSize_);
+    }
+    return slab;
+}
@@ -0,0 +1,69 @@
+// Memory pool for fixed-size nodes
+//
+// Implementation is based on J. Bonwick, The slab allocator: an object-caching kernel
+// memory allocator, Proceedings of the USENIX Summer 1994 Technical Conference,
+// 1994, pp. 87-98
+//
+// The pool hands out blocks of one size. The blocks are carved from slabs that are
+// only returned to the system when the pool is destroyed. The free blocks are kept
+// in shards, and every thread uses its own shard first, so the threads that allocate
+// and free nodes at the same time rarely wait for each other.
+
+#ifndef NODEPOOL_HH
+#define NODEPOOL_HH
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+class NodePool
+{
+public:
+    // The block size is rounded up to the alignment of the fundamental types
+    explicit NodePool(std::size_t blockSize);
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    ~NodePool();
+
+    std::size_t blockSize() const;
+    // Returns the number of blocks carved from the slabs so far
+    std::size_t capacity() const;
+
+    void* allocate();
+    // The block must have been allocated from this pool
+    void deallocate(void* block);
+    // Returns all the blocks with one lock of the shard
+    void deallocate(const std::vector<void*>& blocks);
+
+    // Returns a pool of the given block size that lives until the program ends.
+    // The containers that free their nodes after a delay use these, so that the
+    // pool outlives the container.
+    static NodePool& shared(std::size_t blockSize);
+
+private:
+    // The number of blocks in a slab
+    const static std::size_t SLAB_BLOCKS = 256;
+    const static std::size_t SHARDS = 16;
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex_;
+        std::vector<void*> free_;
+    };
+
+    std::size_t blockSize_;
+    std::array<Shard, SHARDS> shards_;
+    mutable std::mutex slabMutex_;
+    std::vector<void*> slabs_;
+
+    // Returns the shard of the calling thread
+    static std::size_t shardIndex();
+    // Takes a block from another shard, or nullptr if they are all empty
+    void* steal(std::size_t own);
+    // Carves a new slab into the shard and returns one of its blocks.
+    // The shard is locked by the caller.
+    void* grow(Shard& shard);
+};
+
+#endif // NODEPOOL_HH
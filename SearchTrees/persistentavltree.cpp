@@ -0,0 +1,347 @@
+// Persistent AVL tree implementation
+//
+// Implementation is based on J.R. Driscoll, N. Sarnak, D.D. Sleator, R.E. Tarjan,
+// Making data structures persistent, Journal of Computer and System Sciences 38(1),
+// 1989, pp. 86-124
+
+#ifndef PERSISTENTAVLTREE_CPP
+#define PERSISTENTAVLTREE_CPP
+
+#include "persistentavltree.hh"
+#include <algorithm>
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare>::PersistentAVLTree() :
+    PersistentAVLTree{ Compare{} }
+{
+}
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare>::PersistentAVLTree(const Compare& compare) :
+    CompareStorage<Compare>{ compare },
+    root_{ nullptr },
+    nodes_{ 0 }
+{
+}
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare>::PersistentAVLTree(const PersistentAVLTree& other) :
+    CompareStorage<Compare>{ other.comparator() },
+    root_{ retain(other.root_) },
+    nodes_{ other.nodes_ }
+{
+}
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare>::PersistentAVLTree(PersistentAVLTree&& other) noexcept :
+    CompareStorage<Compare>{ other.comparator() },
+    root_{ other.root_ },
+    nodes_{ other.nodes_ }
+{
+    other.root_ = nullptr;
+    other.nodes_ = 0;
+}
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare>::PersistentAVLTree(const Compare& compare, const Node* root, size_type nodes) :
+    CompareStorage<Compare>{ compare },
+    root_{ root },
+    nodes_{ nodes }
+{
+}
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare>& PersistentAVLTree<Node, Compare>::operator=(const PersistentAVLTree& other)
+{
+    // Retain first, so that assigning a version to itself keeps the nodes alive
+    const Node* root{ retain(other.root_) };
+    release(root_);
+    root_ = root;
+    nodes_ = other.nodes_;
+    return *this;
+}
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare>& PersistentAVLTree<Node, Compare>::operator=(PersistentAVLTree&& other) noexcept
+{
+    if (this != &other)
+    {
+        release(root_);
+        root_ = other.root_;
+        nodes_ = other.nodes_;
+        other.root_ = nullptr;
+        other.nodes_ = 0;
+    }
+    return *this;
+}
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare>::~PersistentAVLTree()
+{
+    release(root_);
+}
+
+template<typename Node, typename Compare>
+typename PersistentAVLTree<Node, Compare>::size_type PersistentAVLTree<Node, Compare>::size() const
+{
+    return nodes_;
+}
+
+template<typename Node, typename Compare>
+bool PersistentAVLTree<Node, Compare>::empty() const
+{
+    return nodes_ == 0;
+}
+
+template<typename Node, typename Compare>
+int PersistentAVLTree<Node, Compare>::height() const
+{
+    return height(root_);
+}
+
+template<typename Node, typename Compare>
+void PersistentAVLTree<Node, Compare>::clear()
+{
+    release(root_);
+    root_ = nullptr;
+    nodes_ = 0;
+}
+
+template<typename Node, typename Compare>
+const Node* PersistentAVLTree<Node, Compare>::find(const key_type& key) const
+{
+    const Node* x{ root_ };
+    while (x != nullptr)
+    {
+        if (this->comparator()(key, x->key_))
+        {
+            x = x->left_;
+        }
+        else if (this->comparator()(x->key_, key))
+        {
+            x = x->right_;
+        }
+        else
+        {
+            return x;
+        }
+    }
+    return x;
+}
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare> PersistentAVLTree<Node, Compare>::insert(const value_type& value) const
+{
+    bool inserted{ false };
+    const Node* root{ insertNode(root_, value, inserted) };
+    return PersistentAVLTree{ this->comparator(), root, inserted ? nodes_ + 1 : nodes_ };
+}
+
+template<typename Node, typename Compare>
+PersistentAVLTree<Node, Compare> PersistentAVLTree<Node, Compare>::erase(const key_type& key) const
+{
+    bool erased{ false };
+    const Node* root{ eraseNode(root_, key, erased) };
+    return PersistentAVLTree{ this->comparator(), root, erased ? nodes_ - 1 : nodes_ };
+}
+
+template<typename Node, typename Compare>
+template<typename Visit>
+void PersistentAVLTree<Node, Compare>::forEach(Visit visit) const
+{
+    forEach(root_, visit);
+}
+
+template<typename Node, typename Compare>
+template<typename Visit>
+void PersistentAVLTree<Node, Compare>::forEach(const Node* node, Visit& visit) const
+{
+    if (node == nullptr)
+    {
+        return;
+    }
+
+    forEach(node->left_, visit);
+    visit(node);
+    forEach(node->right_, visit);
+}
+
+template<typename Node, typename Compare>
+const Node* PersistentAVLTree<Node, Compare>::retain(const Node* node)
+{
+    if (node != nullptr)
+    {
+        node->references_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return node;
+}
+
+// The last reference frees the node and drops the references of the node to
+// its children. The recursion is at most as deep as the tree is high.
+template<typename Node, typename Compare>
+void PersistentAVLTree<Node, Compare>::release(const Node* node)
+{
+    if (node != nullptr and node->references_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        const Node* left{ node->left_ };
+        const Node* right{ node->right_ };
+        delete node;
+        release(left);
+        release(right);
+    }
+}
+
+template<typename Node, typename Compare>
+int PersistentAVLTree<Node, Compare>::height(const Node* node)
+{
+    return (node == nullptr) ? 0 : node->height_;
+}
+
+template<typename Node, typename Compare>
+const Node* PersistentAVLTree<Node, Compare>::createNode(const key_type& key, const mapped_type& value,
+                                                         const Node* left, const Node* right)
+{
+    return new Node{ key, value, left, right, std::max(height(left), height(right)) + 1 };
+}
+
+// Creates the node and rotates it if the heights of the subtrees differ by two.
+// The rotated nodes are copies, because the old ones may be shared.
+template<typename Node, typename Compare>
+const Node* PersistentAVLTree<Node, Compare>::balance(const key_type& key, const mapped_type& value,
+                                                      const Node* left, const Node* right)
+{
+    if (height(left) > height(right) + 1)
+    {
+        const Node* result{ nullptr };
+        if (height(left->left_) >= height(left->right_))
+        {
+            result = createNode(left->key_, left->value_, retain(left->left_),
+                                createNode(key, value, retain(left->right_), right));
+        }
+        else
+        {
+            const Node* leftright{ left->right_ };
+            result = createNode(leftright->key_, leftright->value_,
+                                createNode(left->key_, left->value_, retain(left->left_), retain(leftright->left_)),
+                                createNode(key, value, retain(leftright->right_), right));
+        }
+        release(left);
+        return result;
+    }
+    else if (height(right) > height(left) + 1)
+    {
+        const Node* result{ nullptr };
+        if (height(right->right_) >= height(right->left_))
+        {
+            result = createNode(right->key_, right->value_,
+                                createNode(key, value, left, retain(right->left_)), retain(right->right_));
+        }
+        else
+        {
+            const Node* rightleft{ right->left_ };
+            result = createNode(rightleft->key_, rightleft->value_,
+                                createNode(key, value, left, retain(rightleft->left_)),
+                                createNode(right->key_, right->value_, retain(rightleft->right_), retain(right->right_)));
+        }
+        release(right);
+        return result;
+    }
+
+    return createNode(key, value, left, right);
+}
+
+template<typename Node, typename Compare>
+const Node* PersistentAVLTree<Node, Compare>::insertNode(const Node* node, const value_type& value,
+                                                         bool& inserted) const
+{
+    if (node == nullptr)
+    {
+        inserted = true;
+        return createNode(value.first, value.second, nullptr, nullptr);
+    }
+
+    if (this->comparator()(value.first, node->key_))
+    {
+        const Node* left{ insertNode(node->left_, value, inserted) };
+        if (not inserted)
+        {
+            release(left);
+            return retain(node);
+        }
+        return balance(node->key_, node->value_, left, retain(node->right_));
+    }
+    else if (this->comparator()(node->key_, value.first))
+    {
+        const Node* right{ insertNode(node->right_, value, inserted) };
+        if (not inserted)
+        {
+            release(right);
+            return retain(node);
+        }
+        return balance(node->key_, node->value_, retain(node->left_), right);
+    }
+
+    // Key already exists in the tree
+    return retain(node);
+}
+
+template<typename Node, typename Compare>
+const Node* PersistentAVLTree<Node, Compare>::eraseNode(const Node* node, const key_type& key, bool& erased) const
+{
+    if (node == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (this->comparator()(key, node->key_))
+    {
+        const Node* left{ eraseNode(node->left_, key, erased) };
+        if (not erased)
+        {
+            release(left);
+            return retain(node);
+        }
+        return balance(node->key_, node->value_, left, retain(node->right_));
+    }
+    else if (this->comparator()(node->key_, key))
+    {
+        const Node* right{ eraseNode(node->right_, key, erased) };
+        if (not erased)
+        {
+            release(right);
+            return retain(node);
+        }
+        return balance(node->key_, node->value_, retain(node->left_), right);
+    }
+
+    erased = true;
+    if (node->left_ == nullptr)
+    {
+        return retain(node->right_);
+    }
+    else if (node->right_ == nullptr)
+    {
+        return retain(node->left_);
+    }
+
+    // The successor takes the place of the node. The old version still refers
+    // to the successor, so it stays valid while its copy is created.
+    const Node* successor{ nullptr };
+    const Node* right{ eraseMinimum(node->right_, successor) };
+    return balance(successor->key_, successor->value_, retain(node->left_), right);
+}
+
+template<typename Node, typename Compare>
+const Node* PersistentAVLTree<Node, Compare>::eraseMinimum(const Node* node, const Node*& minimum)
+{
+    if (node->left_ == nullptr)
+    {
+        minimum = node;
+        return retain(node->right_);
+    }
+
+    const Node* left{ eraseMinimum(node->left_, minimum) };
+    return balance(node->key_, node->value_, left, retain(node->right_));
+}
+
+#endif // PERSISTENTAVLTREE_CPP
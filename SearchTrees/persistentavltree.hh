@@ -0,0 +1,116 @@
+// Persistent AVL tree implementation
+//
+// Implementation is based on J.R. Driscoll, N. Sarnak, D.D. Sleator, R.E. Tarjan,
+// Making data structures persistent, Journal of Computer and System Sciences 38(1),
+// 1989, pp. 86-124
+//
+// The nodes are never changed after they have been created. Insert and erase copy
+// the nodes on the path from the root to the changed node and return a new version
+// of the tree that shares all the other subtrees with the old version. Copying a
+// version is a constant time snapshot. Every node counts the versions and the
+// parent nodes that refer to it, and it is freed when the last of them goes away.
+//
+// The versions can be read from several threads at the same time, because the
+// nodes are immutable and the reference counts are atomic. A version object
+// itself must not be assigned while another thread reads or copies it.
+
+#ifndef PERSISTENTAVLTREE_HH
+#define PERSISTENTAVLTREE_HH
+
+#include "binarysearchtree.hh"
+#include <atomic>
+#include <utility>
+
+template<typename Key, typename Value>
+struct PersistentAVLNode
+{
+    using key_type = Key;
+    using mapped_type = Value;
+
+    const key_type key_;
+    const mapped_type value_;
+    const PersistentAVLNode<key_type, mapped_type>* const left_;
+    const PersistentAVLNode<key_type, mapped_type>* const right_;
+    const int height_;
+    // The number of versions and parent nodes that refer to the node
+    mutable std::atomic<unsigned int> references_;
+
+    PersistentAVLNode(const key_type& key, const mapped_type& value,
+                      const PersistentAVLNode<key_type, mapped_type>* left,
+                      const PersistentAVLNode<key_type, mapped_type>* right,
+                      int height) :
+        key_{ key }, value_{ value },
+        left_{ left }, right_{ right },
+        height_{ height },
+        references_{ 1 }
+    {}
+};
+
+template<typename Node, typename Compare = std::less<typename Node::key_type>>
+class PersistentAVLTree : private CompareStorage<Compare>
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+    using value_type = std::pair<const key_type, mapped_type>;
+    using size_type = unsigned int;
+    using node_type = Node;
+    using key_compare = Compare;
+
+    PersistentAVLTree();
+    explicit PersistentAVLTree(const Compare& compare);
+    // Copying takes a snapshot of the version in constant time
+    PersistentAVLTree(const PersistentAVLTree& other);
+    PersistentAVLTree(PersistentAVLTree&& other) noexcept;
+    PersistentAVLTree& operator=(const PersistentAVLTree& other);
+    PersistentAVLTree& operator=(PersistentAVLTree&& other) noexcept;
+    ~PersistentAVLTree();
+
+    size_type size() const;
+    bool empty() const;
+    int height() const;
+
+    // Drops the reference of this version to its nodes and leaves it empty
+    void clear();
+
+    // Returns the node with the given key, or nullptr. The node stays valid as
+    // long as some version that contains it exists.
+    const Node* find(const key_type& key) const;
+    // Returns a new version with the value inserted. If the key already exists,
+    // the returned version shares all the nodes with this one.
+    PersistentAVLTree insert(const value_type& value) const;
+    // Returns a new version without the key. If the key does not exist,
+    // the returned version shares all the nodes with this one.
+    PersistentAVLTree erase(const key_type& key) const;
+
+    // Calls visit for every node in the order of the keys
+    template<typename Visit>
+    void forEach(Visit visit) const;
+
+private:
+    const Node* root_;
+    size_type nodes_;
+
+    // Takes over the reference to root
+    PersistentAVLTree(const Compare& compare, const Node* root, size_type nodes);
+
+    // The functions below take over the references to the left and the right
+    // subtrees that they are given, and return a node with a reference for the caller
+    static const Node* retain(const Node* node);
+    static void release(const Node* node);
+    static int height(const Node* node);
+    static const Node* createNode(const key_type& key, const mapped_type& value,
+                                  const Node* left, const Node* right);
+    static const Node* balance(const key_type& key, const mapped_type& value,
+                               const Node* left, const Node* right);
+    static const Node* eraseMinimum(const Node* node, const Node*& minimum);
+
+    const Node* insertNode(const Node* node, const value_type& value, bool& inserted) const;
+    const Node* eraseNode(const Node* node, const key_type& key, bool& erased) const;
+    template<typename Visit>
+    void forEach(const Node* node, Visit& visit) const;
+};
+
+#include "persistentavltree.cpp"
+
+#endif // PERSISTENTAVLTREE_HH
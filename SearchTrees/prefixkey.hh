@@ -0,0 +1,98 @@
+// String key with an inline order-preserving prefix
+//
+// Implementation is based on G. Graefe, P.-A. Larson, B-tree indexes and CPU caches,
+// Proceedings of the 17th International Conference on Data Engineering, 2001, pp. 349-358
+//
+// The first eight bytes of the string are packed big-endian into an integer, so
+// comparing the prefixes orders the keys like comparing their first eight bytes.
+// The prefix is stored in the node next to the pointer to the string buffer, and
+// the buffer is only read when the prefixes are equal.
+
+#ifndef PREFIXKEY_HH
+#define PREFIXKEY_HH
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Returns the first eight bytes of the string packed big-endian into an integer.
+// Strings shorter than eight bytes are padded with zero bytes.
+inline std::uint64_t stringPrefix(std::string_view string)
+{
+    std::uint64_t prefix{ 0 };
+    for (std::size_t i{ 0 }; i < sizeof(prefix); ++i)
+    {
+        prefix <<= 8;
+        if (i < string.size())
+        {
+            prefix |= static_cast<unsigned char>(string[i]);
+        }
+    }
+    return prefix;
+}
+
+struct PrefixKey
+{
+    std::uint64_t prefix_;
+    std::string string_;
+
+    PrefixKey() :
+        prefix_{ 0 }, string_{}
+    {}
+
+    explicit PrefixKey(std::string string) :
+        prefix_{ stringPrefix(string) }, string_{ std::move(string) }
+    {}
+};
+
+// A non-owning key for searching with a string_view. The prefix is computed once
+// when the view is created, not at every node.
+struct PrefixView
+{
+    std::uint64_t prefix_;
+    std::string_view string_;
+
+    explicit PrefixView(std::string_view string) :
+        prefix_{ stringPrefix(string) }, string_{ string }
+    {}
+
+    PrefixView(const PrefixKey& key) :
+        prefix_{ key.prefix_ }, string_{ key.string_ }
+    {}
+};
+
+inline std::ostream& operator<<(std::ostream& stream, const PrefixKey& key)
+{
+    return stream << key.string_;
+}
+
+// Transparent three-way comparator for PrefixKey and PrefixView
+struct PrefixCompare
+{
+    using is_transparent = void;
+
+    bool operator()(const PrefixView& a, const PrefixView& b) const
+    {
+        return compare(a, b) < 0;
+    }
+
+    int compare(const PrefixView& a, const PrefixView& b) const
+    {
+        if (a.prefix_ != b.prefix_)
+        {
+            return a.prefix_ < b.prefix_ ? -1 : 1;
+        }
+
+        // Equal prefixes mean equal first eight bytes, unless one of the strings is
+        // shorter than that and the other one has zero bytes in the padded places
+        if (a.string_.size() >= sizeof(a.prefix_) and b.string_.size() >= sizeof(b.prefix_))
+        {
+            return a.string_.substr(sizeof(a.prefix_)).compare(b.string_.substr(sizeof(b.prefix_)));
+        }
+        return a.string_.compare(b.string_);
+    }
+};
+
+#endif // PREFIXKEY_HH
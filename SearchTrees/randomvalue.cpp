@@ -55,9 +55,9 @@ std::vector<int> RandomValue::getValues(int n, RandomType type, bool distinct) c
     }
     else
     {
+        // The values are drawn with replacement, so any number of them can be drawn
         std::uniform_int_distribution<int> distribution(min_, max_);
-        unsigned int nMax{ static_cast<unsigned int>(std::min(n, count())) };
-        while (values.size() < nMax)
+        while (static_cast<int>(values.size()) < n)
         {
             values.push_back(distribution(generator));
         }
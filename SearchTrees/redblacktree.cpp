@@ -10,50 +10,67 @@
 
 #include "redblacktree.hh"
 
-template<typename Node>
-RedBlackTree<Node>::RedBlackTree() :
-    BinarySearchTree<Node>{}
+template<typename Node, typename Compare, bool Multi>
+RedBlackTree<Node, Compare, Multi>::RedBlackTree() :
+    BinarySearchTree<Node, Compare, Multi>{}
 {
 }
 
-template<typename Node>
-RedBlackTree<Node>::~RedBlackTree()
+template<typename Node, typename Compare, bool Multi>
+RedBlackTree<Node, Compare, Multi>::RedBlackTree(const Compare& compare) :
+    BinarySearchTree<Node, Compare, Multi>{ compare }
 {
 }
 
-template<typename Node>
-bool RedBlackTree<Node>::insert(const value_type& value)
+template<typename Node, typename Compare, bool Multi>
+RedBlackTree<Node, Compare, Multi>::~RedBlackTree()
 {
-    Node* x{ this->root_ };
-    Node* parent{ this->nil_ };
+}
+
+template<typename Node, typename Compare, bool Multi>
+void RedBlackTree<Node, Compare, Multi>::splitGreater(const key_type& key, RedBlackTree& other)
+{
+    this->splitInto(key, other, true);
+}
+
+template<typename Node, typename Compare, bool Multi>
+void RedBlackTree<Node, Compare, Multi>::splitLess(const key_type& key, RedBlackTree& other)
+{
+    this->splitInto(key, other, false);
+}
 
-    while (x != this->nil_)
+template<typename Node, typename Compare, bool Multi>
+void RedBlackTree<Node, Compare, Multi>::join(RedBlackTree& other)
+{
+    this->joinFrom(other);
+}
+
+template<typename Node, typename Compare, bool Multi>
+bool RedBlackTree<Node, Compare, Multi>::insertNode(Node* node)
+{
+    return insertNodeNear(node, this->nil_);
+}
+
+template<typename Node, typename Compare, bool Multi>
+bool RedBlackTree<Node, Compare, Multi>::insertNodeNear(Node* node, Node* hint)
+{
+    Node* parent{ this->nil_ };
+    int order{ 0 };
+    if (not this->findParent(node, hint, parent, order))
     {
-        parent = x;
-        if (value.first < x->key_)
-        {
-            x = x->left_;
-        }
-        else if (x->key_ < value.first)
-        {
-            x = x->right_;
-        }
-        else
-        {
-            // Key alreydy exists in the tree
-            return false;
-        }
+        return false;
     }
 
-    Node* node{
-        new Node{ value.first, value.second,
-                  parent, this->nil_, this->nil_, Color::Red } };
+    node->parent_ = parent;
+    node->left_ = this->nil_;
+    node->right_ = this->nil_;
+    node->color_ = Color::Red;
 
     if (parent == this->nil_)
     {
         this->root_ = node;
     }
-    else if (node->key_ < parent->key_)
+    else if (order < 0)
     {
         parent->left_ = node;
     }
@@ -62,21 +79,17 @@ bool RedBlackTree<Node>::insert(const value_type& value)
         parent->right_ = node;
     }
     ++this->nodes_;
+    this->linkInOrder(node);
+    this->updatePath(node);
 
     insertFix(node);
 
     return true;
 }
 
-template<typename Node>
-typename RedBlackTree<Node>::size_type RedBlackTree<Node>::erase(const key_type& key)
+template<typename Node, typename Compare, bool Multi>
+void RedBlackTree<Node, Compare, Multi>::removeNode(Node* node)
 {
-    auto node{ this->find(key) };
-    if (node == this->nil_)
-    {
-        return 0;
-    }
-
     Node* x{ this->nil_ };
     Node* y{ node };
     Color yOriginalColor{ y->color_ };
@@ -113,19 +126,17 @@ typename RedBlackTree<Node>::size_type RedBlackTree<Node>::erase(const key_type&
         y->color_ = node->color_;
     }
 
-    delete node;
-    --this->nodes_;
+    // The parent of x is the lowest node whose subtree changed, even if x is nil_
+    this->updatePath(x->parent_);
 
     if (yOriginalColor == Color::Black)
     {
         deleteFix(x);
     }
-
-    return 1;
 }
 
-template<typename Node>
-void RedBlackTree<Node>::rotateLeft(Node* x)
+template<typename Node, typename Compare, bool Multi>
+void RedBlackTree<Node, Compare, Multi>::rotateLeft(Node* x)
 {
     Node* y{ x->right_ };
 
@@ -151,10 +162,13 @@ void RedBlackTree<Node>::rotateLeft(Node* x)
 
     y->left_ = x;
     x->parent_ = y;
+    this->updateSummary(x);
+    this->updateSummary(y);
+    ++this->rotations_;
 }
 
-template<typename Node>
-void RedBlackTree<Node>::rotateRight(Node* x)
+template<typename Node, typename Compare, bool Multi>
+void RedBlackTree<Node, Compare, Multi>::rotateRight(Node* x)
 {
     Node* y{ x->left_ };
 
@@ -180,10 +194,13 @@ void RedBlackTree<Node>::rotateRight(Node* x)
 
     y->right_ = x;
     x->parent_ = y;
+    this->updateSummary(x);
+    this->updateSummary(y);
+    ++this->rotations_;
 }
 
-template<typename Node>
-void RedBlackTree<Node>::insertFix(Node* x)
+template<typename Node, typename Compare, bool Multi>
+void RedBlackTree<Node, Compare, Multi>::insertFix(Node* x)
 {
     while (x->parent_->color_ == Color::Red)
     {
@@ -238,8 +255,8 @@ void RedBlackTree<Node>::insertFix(Node* x)
     this->root_->color_ = Color::Black;
 }
 
-template<typename Node>
-void RedBlackTree<Node>::deleteFix(Node* x)
+template<typename Node, typename Compare, bool Multi>
+void RedBlackTree<Node, Compare, Multi>::deleteFix(Node* x)
 {
     while (x != this->root_ and x->color_ == Color::Black)
     {
@@ -312,8 +329,85 @@ void RedBlackTree<Node>::deleteFix(Node* x)
     x->color_ = Color::Black;
 }
 
-template<typename Node>
-void RedBlackTree<Node>::transplant(Node* u, Node* v)
+// The join is based on R.E. Tarjan, Data structures and network algorithms, SIAM, 1983,
+// Chapter 4. The roots are made black. If the black heights differ, middle is linked
+// as a red node in place of the black node on the inner spine of the higher subtree
+// that has the black height of the lower subtree, and insertFix fixes the possible
+// red-red violation above it.
+template<typename Node, typename Compare, bool Multi>
+Node* RedBlackTree<Node, Compare, Multi>::joinNodes(Node* left, Node* middle, Node* right)
+{
+    left->color_ = Color::Black;
+    right->color_ = Color::Black;
+    int leftHeight{ blackHeight(left) };
+    int rightHeight{ blackHeight(right) };
+
+    if (leftHeight == rightHeight)
+    {
+        middle->color_ = Color::Black;
+        return BinarySearchTree<Node, Compare, Multi>::joinNodes(left, middle, right);
+    }
+
+    Node* parent{ this->nil_ };
+    if (leftHeight > rightHeight)
+    {
+        Node* x{ left };
+        while (x->color_ == Color::Red or leftHeight > rightHeight)
+        {
+            if (x->color_ == Color::Black)
+            {
+                --leftHeight;
+            }
+            parent = x;
+            x = x->right_;
+        }
+
+        BinarySearchTree<Node, Compare, Multi>::joinNodes(x, middle, right);
+        parent->right_ = middle;
+        this->root_ = left;
+    }
+    else
+    {
+        Node* x{ right };
+        while (x->color_ == Color::Red or rightHeight > leftHeight)
+        {
+            if (x->color_ == Color::Black)
+            {
+                --rightHeight;
+            }
+            parent = x;
+            x = x->left_;
+        }
+
+        BinarySearchTree<Node, Compare, Multi>::joinNodes(left, middle, x);
+        parent->left_ = middle;
+        this->root_ = right;
+    }
+
+    middle->parent_ = parent;
+    middle->color_ = Color::Red;
+    this->updatePath(middle);
+    insertFix(middle);
+    return this->root_;
+}
+
+template<typename Node, typename Compare, bool Multi>
+int RedBlackTree<Node, Compare, Multi>::blackHeight(Node* node) const
+{
+    int height{ 0 };
+    while (node != this->nil_)
+    {
+        if (node->color_ == Color::Black)
+        {
+            ++height;
+        }
+        node = node->left_;
+    }
+    return height;
+}
+
+template<typename Node, typename Compare, bool Multi>
+void RedBlackTree<Node, Compare, Multi>::transplant(Node* u, Node* v)
 {
     if (u == this->nil_)
     {
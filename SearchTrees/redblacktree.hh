@@ -17,40 +17,41 @@ enum class Color
     Black
 };
 
-template<typename Key, typename Value>
-struct RedBlackNode
+template<typename Key, typename Value, bool Threaded = false, typename Monoid = void, bool AtomicLinks = false>
+struct RedBlackNode : InOrderLinks<RedBlackNode<Key, Value, Threaded, Monoid, AtomicLinks>, Threaded>, NodeValue<Value>,
+                     SubtreeSummary<Monoid>
 {
     using key_type = Key;
     using mapped_type = Value;
+    using link_type = typename NodeLink<RedBlackNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>, AtomicLinks>::type;
 
     key_type key_;
-    mapped_type value_;
-    RedBlackNode<key_type, mapped_type>* parent_;
-    RedBlackNode<key_type, mapped_type>* left_;
-    RedBlackNode<key_type, mapped_type>* right_;
+    link_type parent_;
+    link_type left_;
+    link_type right_;
     Color color_;
 
     RedBlackNode() :
-        key_{}, value_{},
+        key_{},
         parent_{}, left_{}, right_{},
         color_{ Color::Black }
     {}
 
-    RedBlackNode(const key_type& key, const mapped_type& value,
-                 RedBlackNode<key_type, mapped_type>* parent,
-                 RedBlackNode<key_type, mapped_type>* left,
-                 RedBlackNode<key_type, mapped_type>* right) :
-        key_{ key }, value_{ value },
+    RedBlackNode(const key_type& key, const typename NodeValue<Value>::argument_type& value,
+                 RedBlackNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* parent,
+                 RedBlackNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* left,
+                 RedBlackNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* right) :
+        NodeValue<Value>{ value }, key_{ key },
         parent_{ parent }, left_{ left }, right_{ right },
         color_{ Color::Black }
     {}
 
-    RedBlackNode(const key_type& key, const mapped_type& value,
-                 RedBlackNode<key_type, mapped_type>* parent,
-                 RedBlackNode<key_type, mapped_type>* left,
-                 RedBlackNode<key_type, mapped_type>* right,
+    RedBlackNode(const key_type& key, const typename NodeValue<Value>::argument_type& value,
+                 RedBlackNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* parent,
+                 RedBlackNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* left,
+                 RedBlackNode<key_type, mapped_type, Threaded, Monoid, AtomicLinks>* right,
                  Color color) :
-        key_{ key }, value_{ value },
+        NodeValue<Value>{ value }, key_{ key },
         parent_{ parent }, left_{ left }, right_{ right },
         color_{ color }
     {}
@@ -61,28 +62,49 @@ struct RedBlackNode
     }
 };
 
-template<typename Node>
-class RedBlackTree : public BinarySearchTree<Node>
+template<typename Node, typename Compare = std::less<typename Node::key_type>, bool Multi = false>
+class RedBlackTree : public BinarySearchTree<Node, Compare, Multi>
 {
 public:
     using key_type = typename Node::key_type;
     using mapped_type = typename Node::mapped_type;
-    using value_type = std::pair<const key_type, mapped_type>;
-    using size_type = typename BinarySearchTree<Node>::size_type;
+    using value_type = typename BinarySearchTree<Node, Compare, Multi>::value_type;
+    using size_type = typename BinarySearchTree<Node, Compare, Multi>::size_type;
     using node_type = Node;
 
     RedBlackTree();
+    explicit RedBlackTree(const Compare& compare);
     virtual ~RedBlackTree();
 
-    virtual bool insert(const value_type& value);
-    virtual size_type erase(const key_type& key);
+    // Moves the entries with keys not less than key to other, whose keys all have to
+    // be greater. The moved nodes are split off and joined to other in O(log² n)
+    // time and then relinked to other in one pass, so they are not reallocated.
+    void splitGreater(const key_type& key, RedBlackTree& other);
+    // Moves the entries with keys less than key to other, whose keys all have to be less
+    void splitLess(const key_type& key, RedBlackTree& other);
+    // Moves all the entries of other to this tree. The keys of other have to be all
+    // less or all greater than the keys of this tree.
+    void join(RedBlackTree& other);
+
+protected:
+    virtual bool insertNode(Node* node);
+    virtual bool insertNodeNear(Node* node, Node* hint);
+
+    // Unlinks node from the tree and restores the red black properties.
+    // The node is not freed and the node count is not changed.
+    virtual void removeNode(Node* node);
 
-private:
     void rotateLeft(Node* x);
     void rotateRight(Node* x);
     void insertFix(Node* x);
     void deleteFix(Node* x);
+
+    virtual Node* joinNodes(Node* left, Node* middle, Node* right);
+
+private:
     void transplant(Node* u, Node* v);
+    // The number of black nodes on the path from node down to nil
+    int blackHeight(Node* node) const;
 };
 
 #include "redblacktree.cpp"
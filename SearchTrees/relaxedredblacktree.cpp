@@ -0,0 +1,590 @@
+// Relaxed balance red black tree implementation
+//
+// Implementation is based on S. Hanke, T. Ottmann, E. Soisalon-Soininen,
+// Relaxed balanced red-black trees, Proceedings of the 3rd Italian Conference on
+// Algorithms and Complexity, LNCS 1203, 1997, pp. 193-204
+
+#ifndef RELAXEDREDBLACKTREE_CPP
+#define RELAXEDREDBLACKTREE_CPP
+
+#include "relaxedredblacktree.hh"
+#include <chrono>
+
+template<typename Node, typename Compare>
+RelaxedRedBlackTree<Node, Compare>::RelaxedRedBlackTree() :
+    RelaxedRedBlackTree{ Compare{} }
+{
+}
+
+template<typename Node, typename Compare>
+RelaxedRedBlackTree<Node, Compare>::RelaxedRedBlackTree(const Compare& compare) :
+    RedBlackTree<Node, Compare>{ compare },
+    violations_{},
+    removedNodes_{},
+    mutex_{},
+    rebalancer_{},
+    stopRebalancer_{ false },
+    background_{ false }
+{
+}
+
+template<typename Node, typename Compare>
+RelaxedRedBlackTree<Node, Compare>::~RelaxedRedBlackTree()
+{
+    stopBackgroundRebalancing();
+    this->destroyNodes();
+}
+
+template<typename Node, typename Compare>
+void RelaxedRedBlackTree<Node, Compare>::clear()
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    violations_.clear();
+    removedNodes_.clear();
+    this->destroyNodes();
+}
+
+template<typename Node, typename Compare>
+Node* RelaxedRedBlackTree<Node, Compare>::maximum() const
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    return firstLive(this->rightmost_, false);
+}
+
+template<typename Node, typename Compare>
+Node* RelaxedRedBlackTree<Node, Compare>::minimum() const
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    return firstLive(this->leftmost_, true);
+}
+
+template<typename Node, typename Compare>
+Node* RelaxedRedBlackTree<Node, Compare>::successor(Node* node) const
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    return firstLive(BinarySearchTree<Node, Compare>::successor(node), true);
+}
+
+template<typename Node, typename Compare>
+Node* RelaxedRedBlackTree<Node, Compare>::predecessor(Node* node) const
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    return firstLive(BinarySearchTree<Node, Compare>::predecessor(node), false);
+}
+
+template<typename Node, typename Compare>
+Node* RelaxedRedBlackTree<Node, Compare>::find(const key_type& key) const
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    Node* node{ this->findNode(key) };
+    return node->removed_ ? this->nil_ : node;
+}
+
+template<typename Node, typename Compare>
+template<typename K, typename C, typename>
+Node* RelaxedRedBlackTree<Node, Compare>::find(const K& key) const
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    Node* node{ this->findNode(key) };
+    return node->removed_ ? this->nil_ : node;
+}
+
+template<typename Node, typename Compare>
+Node* RelaxedRedBlackTree<Node, Compare>::lowerBound(const key_type& key) const
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    return firstLive(BinarySearchTree<Node, Compare>::lowerBound(key), true);
+}
+
+template<typename Node, typename Compare>
+Node* RelaxedRedBlackTree<Node, Compare>::upperBound(const key_type& key) const
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    return firstLive(BinarySearchTree<Node, Compare>::upperBound(key), true);
+}
+
+template<typename Node, typename Compare>
+bool RelaxedRedBlackTree<Node, Compare>::insertNode(Node* node)
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    Node* x{ this->root_ };
+    Node* parent{ this->nil_ };
+    int order{ 0 };
+
+    while (x != this->nil_)
+    {
+        parent = x;
+        order = this->compareKeys(node->key_, x->key_);
+        if (order < 0)
+        {
+            x = x->left_;
+        }
+        else if (order > 0)
+        {
+            x = x->right_;
+        }
+        else if (x->removed_)
+        {
+            // The key is still in the tree as a removed node, so it is simply
+            // revived and the new node is not needed
+            x->value_ = std::move(node->value_);
+            x->removed_ = false;
+            ++this->nodes_;
+            delete node;
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    node->parent_ = parent;
+    node->left_ = this->nil_;
+    node->right_ = this->nil_;
+    node->color_ = Color::Red;
+    node->removed_ = false;
+    node->queued_ = false;
+
+    if (parent == this->nil_)
+    {
+        this->root_ = node;
+        node->color_ = Color::Black;
+    }
+    else
+    {
+        if (order < 0)
+        {
+            parent->left_ = node;
+        }
+        else
+        {
+            parent->right_ = node;
+        }
+
+        if (parent->color_ == Color::Red)
+        {
+            violations_.push_back(node);
+        }
+    }
+    ++this->nodes_;
+    this->linkInOrder(node);
+
+    return true;
+}
+
+template<typename Node, typename Compare>
+bool RelaxedRedBlackTree<Node, Compare>::insertNodeNear(Node* node, Node*)
+{
+    return insertNode(node);
+}
+
+template<typename Node, typename Compare>
+typename RelaxedRedBlackTree<Node, Compare>::size_type RelaxedRedBlackTree<Node, Compare>::erase(const key_type& key)
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    Node* node{ this->findNode(key) };
+    if (node == this->nil_ or node->removed_)
+    {
+        return 0;
+    }
+
+    markRemoved(node);
+    return 1;
+}
+
+template<typename Node, typename Compare>
+template<typename K, typename C, typename>
+typename RelaxedRedBlackTree<Node, Compare>::size_type RelaxedRedBlackTree<Node, Compare>::erase(const K& key)
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    Node* node{ this->findNode(key) };
+    if (node == this->nil_ or node->removed_)
+    {
+        return 0;
+    }
+
+    markRemoved(node);
+    return 1;
+}
+
+template<typename Node, typename Compare>
+typename RelaxedRedBlackTree<Node, Compare>::size_type RelaxedRedBlackTree<Node, Compare>::erase(Node* node)
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    if (node == this->nil_ or node->removed_)
+    {
+        return 0;
+    }
+
+    markRemoved(node);
+    return 1;
+}
+
+// The node can only be unlinked from a valid red black tree,
+// so the queued violations are fixed first
+template<typename Node, typename Compare>
+typename RelaxedRedBlackTree<Node, Compare>::node_handle RelaxedRedBlackTree<Node, Compare>::extract(const key_type& key)
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    Node* node{ this->findNode(key) };
+    if (node == this->nil_ or node->removed_)
+    {
+        return node_handle{};
+    }
+
+    while (not violations_.empty())
+    {
+        step(DEFAULT_BUDGET);
+    }
+
+    if (node->queued_)
+    {
+        dequeue(node);
+    }
+
+    this->unlinkInOrder(node);
+    this->removeNode(node);
+    --this->nodes_;
+    return node_handle{ node };
+}
+
+template<typename Node, typename Compare>
+typename RelaxedRedBlackTree<Node, Compare>::size_type RelaxedRedBlackTree<Node, Compare>::popMin()
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    Node* node{ firstLive(this->leftmost_, true) };
+    if (node == this->nil_)
+    {
+        return 0;
+    }
+
+    markRemoved(node);
+    return 1;
+}
+
+template<typename Node, typename Compare>
+typename RelaxedRedBlackTree<Node, Compare>::size_type RelaxedRedBlackTree<Node, Compare>::popMax()
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    Node* node{ firstLive(this->rightmost_, false) };
+    if (node == this->nil_)
+    {
+        return 0;
+    }
+
+    markRemoved(node);
+    return 1;
+}
+
+template<typename Node, typename Compare>
+typename RelaxedRedBlackTree<Node, Compare>::size_type RelaxedRedBlackTree<Node, Compare>::rebalanceStep(size_type budget)
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    return step(budget);
+}
+
+template<typename Node, typename Compare>
+void RelaxedRedBlackTree<Node, Compare>::rebalance()
+{
+    while (rebalanceStep(DEFAULT_BUDGET) > 0)
+    {
+    }
+}
+
+template<typename Node, typename Compare>
+typename RelaxedRedBlackTree<Node, Compare>::size_type RelaxedRedBlackTree<Node, Compare>::pending() const
+{
+    std::unique_lock<std::mutex> lock{ mutex_, std::defer_lock };
+    if (background_)
+    {
+        lock.lock();
+    }
+
+    return static_cast<size_type>(violations_.size() + removedNodes_.size());
+}
+
+template<typename Node, typename Compare>
+void RelaxedRedBlackTree<Node, Compare>::startBackgroundRebalancing(size_type budget)
+{
+    if (background_)
+    {
+        return;
+    }
+
+    background_ = true;
+    stopRebalancer_ = false;
+    rebalancer_ = std::thread{ &RelaxedRedBlackTree<Node, Compare>::runRebalancer, this, budget };
+}
+
+template<typename Node, typename Compare>
+void RelaxedRedBlackTree<Node, Compare>::stopBackgroundRebalancing()
+{
+    if (not background_)
+    {
+        return;
+    }
+
+    stopRebalancer_ = true;
+    rebalancer_.join();
+    background_ = false;
+}
+
+// Returns the first node starting from node that has not been removed,
+// moving forward or backward in the key order
+template<typename Node, typename Compare>
+Node* RelaxedRedBlackTree<Node, Compare>::firstLive(Node* node, bool forward) const
+{
+    while (node != this->nil_ and node->removed_)
+    {
+        node = forward ? BinarySearchTree<Node, Compare>::successor(node)
+                       : BinarySearchTree<Node, Compare>::predecessor(node);
+    }
+    return node;
+}
+
+template<typename Node, typename Compare>
+void RelaxedRedBlackTree<Node, Compare>::markRemoved(Node* node)
+{
+    node->removed_ = true;
+    if (not node->queued_)
+    {
+        node->queued_ = true;
+        node->slot_ = removedNodes_.size();
+        removedNodes_.push_back(node);
+    }
+    --this->nodes_;
+}
+
+// Takes the node out of the queue of removed nodes by moving the last queued
+// node to its slot, because the queue order does not matter
+template<typename Node, typename Compare>
+void RelaxedRedBlackTree<Node, Compare>::dequeue(Node* node)
+{
+    Node* last{ removedNodes_.back() };
+    removedNodes_[node->slot_] = last;
+    last->slot_ = node->slot_;
+    removedNodes_.pop_back();
+    node->queued_ = false;
+}
+
+// Handles at most budget queued items without locking.
+// The removed nodes are unlinked only when there are no violations left,
+// because the red black deletion requires a valid red black tree.
+template<typename Node, typename Compare>
+typename RelaxedRedBlackTree<Node, Compare>::size_type RelaxedRedBlackTree<Node, Compare>::step(size_type budget)
+{
+    while (budget > 0 and not violations_.empty())
+    {
+        Node* x{ violations_.back() };
+        violations_.pop_back();
+        fixViolation(x);
+        --budget;
+    }
+
+    while (budget > 0 and violations_.empty() and not removedNodes_.empty())
+    {
+        Node* node{ removedNodes_.back() };
+        removedNodes_.pop_back();
+        node->queued_ = false;
+        if (node->removed_)
+        {
+            this->unlinkInOrder(node);
+            this->removeNode(node);
+            delete node;
+        }
+        --budget;
+    }
+
+    return static_cast<size_type>(violations_.size() + removedNodes_.size());
+}
+
+template<typename Node, typename Compare>
+void RelaxedRedBlackTree<Node, Compare>::fixViolation(Node* x)
+{
+    while (x->color_ == Color::Red and x->parent_->color_ == Color::Red)
+    {
+        // The root is always black, so x has a grandparent. The violations
+        // above x on the same path must be fixed first.
+        Node* y{ x };
+        while (y->parent_->parent_->color_ == Color::Red)
+        {
+            y = y->parent_;
+        }
+        fixTopmost(y);
+    }
+}
+
+// Does one insertFix step for the red node x that has a red parent and a black grandparent
+template<typename Node, typename Compare>
+void RelaxedRedBlackTree<Node, Compare>::fixTopmost(Node* x)
+{
+    Node* parent{ x->parent_ };
+    Node* grandparent{ parent->parent_ };
+
+    if (parent == grandparent->left_)
+    {
+        Node* y{ grandparent->right_ };
+        if (y->color_ == Color::Red)
+        {
+            parent->color_ = Color::Black;
+            y->color_ = Color::Black;
+            grandparent->color_ = Color::Red;
+        }
+        else
+        {
+            if (x == parent->right_)
+            {
+                x = parent;
+                this->rotateLeft(x);
+            }
+
+            x->parent_->color_ = Color::Black;
+            x->parent_->parent_->color_ = Color::Red;
+            this->rotateRight(x->parent_->parent_);
+            return;
+        }
+    }
+    else
+    {
+        Node* y{ grandparent->left_ };
+        if (y->color_ == Color::Red)
+        {
+            parent->color_ = Color::Black;
+            y->color_ = Color::Black;
+            grandparent->color_ = Color::Red;
+        }
+        else
+        {
+            if (x == parent->left_)
+            {
+                x = parent;
+                this->rotateRight(x);
+            }
+
+            x->parent_->color_ = Color::Black;
+            x->parent_->parent_->color_ = Color::Red;
+            this->rotateLeft(x->parent_->parent_);
+            return;
+        }
+    }
+
+    // The recoloring moved the red node up to the grandparent
+    if (grandparent == this->root_)
+    {
+        grandparent->color_ = Color::Black;
+    }
+    else if (grandparent->parent_->color_ == Color::Red)
+    {
+        violations_.push_back(grandparent);
+    }
+}
+
+template<typename Node, typename Compare>
+void RelaxedRedBlackTree<Node, Compare>::runRebalancer(size_type budget)
+{
+    while (not stopRebalancer_)
+    {
+        size_type left{ 0 };
+        {
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            left = step(budget);
+        }
+
+        if (left == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+#endif // RELAXEDREDBLACKTREE_CPP
@@ -0,0 +1,169 @@
+// Relaxed balance red black tree implementation
+//
+// Implementation is based on S. Hanke, T. Ottmann, E. Soisalon-Soininen,
+// Relaxed balanced red-black trees, Proceedings of the 3rd Italian Conference on
+// Algorithms and Complexity, LNCS 1203, 1997, pp. 193-204
+//
+// Insertion only links a red leaf into the tree and erase only marks the node as
+// removed. The resulting red-red violations and removed nodes are queued, and the
+// tree is rebalanced later in small steps with rebalanceStep or by a background
+// thread. A red-red violation is always fixed starting from the topmost violation
+// on its path, so the standard red black fixing cases apply. Removed nodes are
+// unlinked with the standard red black deletion once no violations are left.
+
+#ifndef RELAXEDREDBLACKTREE_HH
+#define RELAXEDREDBLACKTREE_HH
+
+#include "redblacktree.hh"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template<typename Key, typename Value>
+struct RelaxedRedBlackNode
+{
+    using key_type = Key;
+    using mapped_type = Value;
+
+    key_type key_;
+    mapped_type value_;
+    RelaxedRedBlackNode<key_type, mapped_type>* parent_;
+    RelaxedRedBlackNode<key_type, mapped_type>* left_;
+    RelaxedRedBlackNode<key_type, mapped_type>* right_;
+    Color color_;
+    // The node has been erased but not yet unlinked from the tree
+    bool removed_;
+    // The node is in the queue of removed nodes
+    bool queued_;
+    // The position of the node in the queue of removed nodes while it is queued
+    std::size_t slot_;
+
+    RelaxedRedBlackNode() :
+        key_{}, value_{},
+        parent_{}, left_{}, right_{},
+        color_{ Color::Black },
+        removed_{ false }, queued_{ false }, slot_{}
+    {}
+
+    RelaxedRedBlackNode(const key_type& key, const mapped_type& value,
+                        RelaxedRedBlackNode<key_type, mapped_type>* parent,
+                        RelaxedRedBlackNode<key_type, mapped_type>* left,
+                        RelaxedRedBlackNode<key_type, mapped_type>* right) :
+        key_{ key }, value_{ value },
+        parent_{ parent }, left_{ left }, right_{ right },
+        color_{ Color::Black },
+        removed_{ false }, queued_{ false }, slot_{}
+    {}
+
+    RelaxedRedBlackNode(const key_type& key, const mapped_type& value,
+                        RelaxedRedBlackNode<key_type, mapped_type>* parent,
+                        RelaxedRedBlackNode<key_type, mapped_type>* left,
+                        RelaxedRedBlackNode<key_type, mapped_type>* right,
+                        Color color) :
+        key_{ key }, value_{ value },
+        parent_{ parent }, left_{ left }, right_{ right },
+        color_{ color },
+        removed_{ false }, queued_{ false }, slot_{}
+    {}
+
+    PrintColor getPrintColor()
+    {
+        if (removed_)
+        {
+            return PrintColor::Blue;
+        }
+        return (color_ == Color::Red) ? PrintColor::Red : PrintColor::White;
+    }
+};
+
+// While the background rebalancing is running, only insert, erase, find, the
+// bounds, the extremes, successor, predecessor, rebalanceStep and pending may be used.
+template<typename Node, typename Compare = std::less<typename Node::key_type>>
+class RelaxedRedBlackTree : public RedBlackTree<Node, Compare>
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+    using value_type = typename RedBlackTree<Node, Compare>::value_type;
+    using size_type = typename RedBlackTree<Node, Compare>::size_type;
+    using node_type = Node;
+    using node_handle = typename RedBlackTree<Node, Compare>::node_handle;
+
+    // How many queued items the background thread handles at a time
+    const static size_type DEFAULT_BUDGET = 64;
+
+    RelaxedRedBlackTree();
+    explicit RelaxedRedBlackTree(const Compare& compare);
+    virtual ~RelaxedRedBlackTree();
+
+    virtual void clear();
+
+    // The cached extremes and the neighbours may be removed nodes that are not
+    // yet unlinked, so these skip over the removed nodes
+    virtual Node* maximum() const;
+    virtual Node* minimum() const;
+    virtual Node* successor(Node* node) const;
+    virtual Node* predecessor(Node* node) const;
+
+    virtual Node* find(const key_type& key) const;
+    virtual Node* lowerBound(const key_type& key) const;
+    virtual Node* upperBound(const key_type& key) const;
+    virtual size_type erase(const key_type& key);
+    // Only marks the node as removed, like erasing its key
+    virtual size_type erase(Node* node);
+    virtual node_handle extract(const key_type& key);
+
+    // These hide the heterogeneous lookup of the base class, which would
+    // neither lock nor skip the removed nodes
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    Node* find(const K& key) const;
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    size_type erase(const K& key);
+
+    virtual size_type popMin();
+    virtual size_type popMax();
+
+    // The removed nodes and the queued violations can not be split or joined
+    void splitGreater(const key_type& key, RedBlackTree<Node, Compare>& other) = delete;
+    void splitLess(const key_type& key, RedBlackTree<Node, Compare>& other) = delete;
+    void join(RedBlackTree<Node, Compare>& other) = delete;
+
+    // Handles at most budget queued violations or removed nodes.
+    // Returns the number of queued items left.
+    size_type rebalanceStep(size_type budget);
+    // Handles all the queued items
+    void rebalance();
+    // Returns the number of queued violations and removed nodes
+    size_type pending() const;
+
+    void startBackgroundRebalancing(size_type budget = DEFAULT_BUDGET);
+    void stopBackgroundRebalancing();
+
+protected:
+    virtual bool insertNode(Node* node);
+    // Ignores the hint, because the place of a removed node is searched from the root
+    virtual bool insertNodeNear(Node* node, Node* hint);
+
+private:
+    std::vector<Node*> violations_;
+    std::vector<Node*> removedNodes_;
+
+    mutable std::mutex mutex_;
+    std::thread rebalancer_;
+    std::atomic<bool> stopRebalancer_;
+    bool background_;
+
+    Node* firstLive(Node* node, bool forward) const;
+    void markRemoved(Node* node);
+    void dequeue(Node* node);
+    size_type step(size_type budget);
+    void fixViolation(Node* x);
+    void fixTopmost(Node* x);
+    void runRebalancer(size_type budget);
+};
+
+#include "relaxedredblacktree.cpp"
+
+#endif // RELAXEDREDBLACKTREE_HH
@@ -0,0 +1,217 @@
+// Scapegoat tree implementation
+//
+// Implementation is based on I. Galperin, R.L. Rivest, Scapegoat trees,
+// Proceedings of the 4th Annual ACM-SIAM Symposium on Discrete Algorithms, 1993, pp. 165-174
+
+#ifndef SCAPEGOATTREE_CPP
+#define SCAPEGOATTREE_CPP
+
+#include "scapegoattree.hh"
+#include <cmath>
+
+template<typename Node, typename Compare>
+const double ScapegoatTree<Node, Compare>::DEFAULT_ALPHA{ 0.7 };
+
+template<typename Node, typename Compare>
+ScapegoatTree<Node, Compare>::ScapegoatTree() :
+    ScapegoatTree{ DEFAULT_ALPHA }
+{
+}
+
+template<typename Node, typename Compare>
+ScapegoatTree<Node, Compare>::ScapegoatTree(double alpha, const Compare& compare) :
+    BinarySearchTree<Node, Compare>{ compare },
+    alpha_{ alpha },
+    logInverseAlpha_{ 0.0 },
+    maxNodes_{ 0 },
+    rebuildBuffer_{}
+{
+    if (alpha_ < 0.5 or alpha_ >= 1.0)
+    {
+        alpha_ = DEFAULT_ALPHA;
+    }
+    logInverseAlpha_ = -std::log(alpha_);
+}
+
+template<typename Node, typename Compare>
+ScapegoatTree<Node, Compare>::~ScapegoatTree()
+{
+}
+
+template<typename Node, typename Compare>
+void ScapegoatTree<Node, Compare>::clear()
+{
+    BinarySearchTree<Node, Compare>::clear();
+    maxNodes_ = 0;
+}
+
+template<typename Node, typename Compare>
+bool ScapegoatTree<Node, Compare>::insertNode(Node* node)
+{
+    Node* x{ this->root_ };
+    Node* parent{ this->nil_ };
+    int depth{ 0 };
+
+    int order{ 0 };
+
+    while (x != this->nil_)
+    {
+        parent = x;
+        order = this->compareKeys(node->key_, x->key_);
+        if (order < 0)
+        {
+            x = x->left_;
+        }
+        else if (order > 0)
+        {
+            x = x->right_;
+        }
+        else
+        {
+            return false;
+        }
+        ++depth;
+    }
+
+    node->parent_ = parent;
+    node->left_ = this->nil_;
+    node->right_ = this->nil_;
+
+    if (parent == this->nil_)
+    {
+        this->root_ = node;
+    }
+    else if (order < 0)
+    {
+        parent->left_ = node;
+    }
+    else
+    {
+        parent->right_ = node;
+    }
+    ++this->nodes_;
+    this->linkInOrder(node);
+
+    if (this->nodes_ > maxNodes_)
+    {
+        maxNodes_ = this->nodes_;
+    }
+
+    if (depth > depthLimit())
+    {
+        // Find the scapegoat: the lowest ancestor that is not alpha-weight-balanced.
+        // Such an ancestor always exists when the depth limit is exceeded.
+        Node* child{ node };
+        size_type size{ 1 };
+        while (child->parent_ != this->nil_)
+        {
+            Node* sibling{ (child == child->parent_->left_) ?
+                           child->parent_->right_ : child->parent_->left_ };
+            size_type parentSize{ size + subtreeSize(sibling) + 1 };
+            if (size > alpha_ * parentSize)
+            {
+                rebuild(child->parent_);
+                break;
+            }
+
+            child = child->parent_;
+            size = parentSize;
+        }
+    }
+
+    return true;
+}
+
+template<typename Node, typename Compare>
+void ScapegoatTree<Node, Compare>::removeNode(Node* node)
+{
+    BinarySearchTree<Node, Compare>::removeNode(node);
+
+    // The caller decrements the node count after the node has been unlinked
+    size_type nodesLeft{ this->nodes_ - 1 };
+    if (nodesLeft < alpha_ * maxNodes_)
+    {
+        rebuild(this->root_);
+        maxNodes_ = nodesLeft;
+    }
+}
+
+template<typename Node, typename Compare>
+int ScapegoatTree<Node, Compare>::depthLimit() const
+{
+    return static_cast<int>(std::log(static_cast<double>(this->nodes_)) / logInverseAlpha_);
+}
+
+template<typename Node, typename Compare>
+typename ScapegoatTree<Node, Compare>::size_type ScapegoatTree<Node, Compare>::subtreeSize(Node* node) const
+{
+    if (node == this->nil_)
+    {
+        return 0;
+    }
+
+    return subtreeSize(node->left_) + subtreeSize(node->right_) + 1;
+}
+
+template<typename Node, typename Compare>
+void ScapegoatTree<Node, Compare>::rebuild(Node* node)
+{
+    if (node == this->nil_)
+    {
+        return;
+    }
+
+    Node* parent{ node->parent_ };
+    bool isLeft{ parent != this->nil_ and node == parent->left_ };
+
+    rebuildBuffer_.clear();
+    flatten(node);
+    Node* subtree{ buildBalanced(0, rebuildBuffer_.size(), parent) };
+
+    if (parent == this->nil_)
+    {
+        this->root_ = subtree;
+    }
+    else if (isLeft)
+    {
+        parent->left_ = subtree;
+    }
+    else
+    {
+        parent->right_ = subtree;
+    }
+}
+
+template<typename Node, typename Compare>
+void ScapegoatTree<Node, Compare>::flatten(Node* node)
+{
+    if (node == this->nil_)
+    {
+        return;
+    }
+
+    flatten(node->left_);
+    rebuildBuffer_.push_back(node);
+    flatten(node->right_);
+}
+
+// Links the nodes rebuildBuffer_[first, last) into a perfectly balanced subtree
+// and returns the root of the subtree.
+template<typename Node, typename Compare>
+Node* ScapegoatTree<Node, Compare>::buildBalanced(size_type first, size_type last, Node* parent)
+{
+    if (first >= last)
+    {
+        return this->nil_;
+    }
+
+    size_type middle{ first + (last - first) / 2 };
+    Node* node{ rebuildBuffer_[middle] };
+    node->parent_ = parent;
+    node->left_ = buildBalanced(first, middle, node);
+    node->right_ = buildBalanced(middle + 1, last, node);
+
+    return node;
+}
+
+#endif // SCAPEGOATTREE_CPP
@@ -0,0 +1,56 @@
+// Scapegoat tree implementation
+//
+// Implementation is based on I. Galperin, R.L. Rivest, Scapegoat trees,
+// Proceedings of the 4th Annual ACM-SIAM Symposium on Discrete Algorithms, 1993, pp. 165-174
+//
+// The tree uses the plain TreeNode: no balance information is stored in the nodes.
+// The depth of each inserted node is tracked instead, and when it exceeds
+// log_{1/alpha}(n) the subtree rooted at the first alpha-weight-unbalanced ancestor
+// (the scapegoat) is rebuilt into a perfectly balanced subtree.
+
+#ifndef SCAPEGOATTREE_HH
+#define SCAPEGOATTREE_HH
+
+#include "binarysearchtree.hh"
+#include <utility>
+#include <vector>
+
+template<typename Node, typename Compare = std::less<typename Node::key_type>>
+class ScapegoatTree : public BinarySearchTree<Node, Compare>
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+    using value_type = typename BinarySearchTree<Node, Compare>::value_type;
+    using size_type = typename BinarySearchTree<Node, Compare>::size_type;
+    using node_type = Node;
+
+    // The weight balance parameter, alpha must be in range [0.5, 1.0)
+    const static double DEFAULT_ALPHA;
+
+    ScapegoatTree();
+    ScapegoatTree(double alpha, const Compare& compare = Compare{});
+    virtual ~ScapegoatTree();
+
+    virtual void clear();
+
+protected:
+    virtual bool insertNode(Node* node);
+    virtual void removeNode(Node* node);
+
+private:
+    double alpha_;
+    double logInverseAlpha_;
+    size_type maxNodes_;
+    std::vector<Node*> rebuildBuffer_;
+
+    int depthLimit() const;
+    size_type subtreeSize(Node* node) const;
+    void rebuild(Node* node);
+    void flatten(Node* node);
+    Node* buildBalanced(size_type first, size_type last, Node* parent);
+};
+
+#include "scapegoattree.cpp"
+
+#endif // SCAPEGOATTREE_HH
@@ -0,0 +1,626 @@
+// Key-range sharded map over the search trees
+//
+// Implementation is based on R. Dementiev, L. Kettner, P. Sanders, STXXL: standard
+// template library for XXL data sets, Software: Practice and Experience 38(6), 2008,
+// pp. 589-637 (sample sort splitters), and J. Roy, Ffwd: delegation is (much) faster
+// than you think, Proceedings of the 26th Symposium on Operating Systems Principles,
+// 2017, pp. 342-358
+
+#ifndef SHARDEDTREE_CPP
+#define SHARDEDTREE_CPP
+
+#include "shardedtree.hh"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+template<typename Tree, ShardingMode Mode>
+ShardedTree<Tree, Mode>::ShardedTree(size_type shards) :
+    shards_{},
+    layout_{ new Layout{} },
+    rebalancer_{},
+    stop_{ false }
+{
+    if (shards == 0)
+    {
+        shards = 1;
+    }
+    for (size_type i{ 0 }; i < shards; ++i)
+    {
+        shards_.push_back(std::make_unique<Shard>());
+        shards_.back()->sample_.reserve(SAMPLE_SIZE);
+    }
+
+    if (Delegated::value)
+    {
+        // The worker of shard i stays on core i modulo the cores, so that its
+        // tree stays in the caches of one core
+        for (size_type i{ 0 }; i < shards; ++i)
+        {
+            Shard* owned{ shards_[i].get() };
+            int core{ static_cast<int>(i) };
+            owned->worker_ = std::thread{ [this, owned, core]()
+            {
+                pinThread(core);
+                work(*owned);
+            } };
+        }
+    }
+}
+
+template<typename Tree, ShardingMode Mode>
+ShardedTree<Tree, Mode>::~ShardedTree()
+{
+    stop_.store(true, std::memory_order_seq_cst);
+    for (auto& shard : shards_)
+    {
+        if (shard->worker_.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock{ shard->sleepMutex_ };
+                shard->wakeup_.notify_one();
+            }
+            shard->worker_.join();
+        }
+    }
+
+    // No thread can be reading the current layout anymore
+    delete layout_.load(std::memory_order_relaxed);
+}
+
+template<typename Tree, ShardingMode Mode>
+typename ShardedTree<Tree, Mode>::size_type ShardedTree<Tree, Mode>::defaultShards()
+{
+    size_type threads{ std::thread::hardware_concurrency() };
+    return (threads < 2) ? 2 : threads;
+}
+
+template<typename Tree, ShardingMode Mode>
+typename ShardedTree<Tree, Mode>::size_type ShardedTree<Tree, Mode>::size() const
+{
+    size_type total{ 0 };
+    for (auto& shard : shards_)
+    {
+        total += shard->size_.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+template<typename Tree, ShardingMode Mode>
+int ShardedTree<Tree, Mode>::height() const
+{
+    int highest{ 0 };
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock{ shard->mutex_ };
+        int height{ shard->tree_.height() };
+        if (height > highest)
+        {
+            highest = height;
+        }
+    }
+    return highest;
+}
+
+template<typename Tree, ShardingMode Mode>
+typename ShardedTree<Tree, Mode>::size_type ShardedTree<Tree, Mode>::shards() const
+{
+    return static_cast<size_type>(shards_.size());
+}
+
+template<typename Tree, ShardingMode Mode>
+std::vector<typename ShardedTree<Tree, Mode>::size_type> ShardedTree<Tree, Mode>::shardSizes() const
+{
+    std::vector<size_type> sizes;
+    for (auto& shard : shards_)
+    {
+        sizes.push_back(shard->size_.load(std::memory_order_relaxed));
+    }
+    return sizes;
+}
+
+// Clearing the tree also forgets the boundaries, because the next keys may
+// have a different distribution
+template<typename Tree, ShardingMode Mode>
+void ShardedTree<Tree, Mode>::clear()
+{
+    std::lock_guard<std::mutex> rebalancing{ rebalancer_ };
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (auto& shard : shards_)
+    {
+        locks.emplace_back(shard->mutex_);
+        shard->tree_.clear();
+        shard->size_.store(0, std::memory_order_relaxed);
+        shard->sample_.clear();
+        shard->seen_ = 0;
+        shard->inserts_ = 0;
+    }
+
+    const Layout* old{ layout_.exchange(new Layout{}, std::memory_order_acq_rel) };
+    locks.clear();
+    EpochReclamation::retire(const_cast<Layout*>(old));
+}
+
+template<typename Tree, ShardingMode Mode>
+bool ShardedTree<Tree, Mode>::contains(const key_type& key) const
+{
+    Request request{ Operation::Find, nullptr, &key, nullptr, nullptr, 0, false, false, { false } };
+    return run(request) != 0;
+}
+
+template<typename Tree, ShardingMode Mode>
+bool ShardedTree<Tree, Mode>::find(const key_type& key, mapped_type& value) const
+{
+    Request request{ Operation::Find, nullptr, &key, nullptr, &value, 0, false, false, { false } };
+    return run(request) != 0;
+}
+
+template<typename Tree, ShardingMode Mode>
+bool ShardedTree<Tree, Mode>::insert(const value_type& value)
+{
+    Request request{ Operation::Insert, nullptr, &value.first, &value, nullptr, 0, false, false, { false } };
+    bool inserted{ run(request) != 0 };
+    if (request.check_ and unbalanced())
+    {
+        rebalance();
+    }
+    return inserted;
+}
+
+template<typename Tree, ShardingMode Mode>
+typename ShardedTree<Tree, Mode>::size_type ShardedTree<Tree, Mode>::erase(const key_type& key)
+{
+    Request request{ Operation::Erase, nullptr, &key, nullptr, nullptr, 0, false, false, { false } };
+    return run(request);
+}
+
+template<typename Tree, ShardingMode Mode>
+template<typename Visit>
+void ShardedTree<Tree, Mode>::forEach(Visit visit) const
+{
+    visitRange(nullptr, std::numeric_limits<size_type>::max(), visit);
+}
+
+template<typename Tree, ShardingMode Mode>
+template<typename Visit>
+typename ShardedTree<Tree, Mode>::size_type
+ShardedTree<Tree, Mode>::scan(const key_type& first, size_type length, Visit visit) const
+{
+    return visitRange(&first, length, visit);
+}
+
+// The samples are weighted by the number of keys that they stand for, so a
+// shard with few samples but many keys gets its share of the new ranges.
+// A missing boundary is above all the keys. The first pass moves the boundaries
+// that go down, or appear, in increasing order, and the second pass moves the
+// boundaries that go up, or disappear, in decreasing order. A key only crosses
+// boundaries that move the same way, so it reaches its shard in either pass.
+template<typename Tree, ShardingMode Mode>
+bool ShardedTree<Tree, Mode>::rebalance()
+{
+    std::unique_lock<std::mutex> rebalancing{ rebalancer_, std::try_to_lock };
+    if (not rebalancing.owns_lock())
+    {
+        return false;
+    }
+
+    std::vector<std::pair<key_type, double>> samples;
+    double total{ 0 };
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock{ shard->mutex_ };
+        Tree& tree{ shard->tree_ };
+        if (tree.size() == 0)
+        {
+            continue;
+        }
+
+        std::vector<key_type> valid;
+        for (const auto& key : shard->sample_)
+        {
+            if (tree.find(key) != tree.nil())
+            {
+                valid.push_back(key);
+            }
+        }
+        if (valid.empty())
+        {
+            valid.push_back(tree.minimum()->key_);
+        }
+
+        double weight{ static_cast<double>(tree.size()) / valid.size() };
+        for (const auto& key : valid)
+        {
+            samples.emplace_back(key, weight);
+        }
+        total += tree.size();
+    }
+
+    std::sort(samples.begin(), samples.end(), [this](const auto& a, const auto& b)
+    {
+        return less(a.first, b.first);
+    });
+
+    std::vector<key_type> bounds;
+    double step{ total / shards_.size() };
+    double weight{ 0 };
+    for (const auto& sample : samples)
+    {
+        if (bounds.size() + 1 == shards_.size())
+        {
+            break;
+        }
+        if (weight >= step * (bounds.size() + 1) and (bounds.empty() or less(bounds.back(), sample.first)))
+        {
+            bounds.push_back(sample.first);
+        }
+        weight += sample.second;
+    }
+
+    // Only the rebalancer and clear change the layout, and both hold rebalancer_
+    std::vector<key_type> current{ layout_.load(std::memory_order_acquire)->bounds_ };
+    for (size_type i{ 0 }; i < bounds.size(); ++i)
+    {
+        if (i >= current.size() or less(bounds[i], current[i]))
+        {
+            moveBoundary(current, i, &bounds[i]);
+        }
+    }
+    for (size_type i{ static_cast<size_type>(current.size()) }; i > 0; --i)
+    {
+        if (i > bounds.size())
+        {
+            moveBoundary(current, i - 1, nullptr);
+        }
+        else if (less(current[i - 1], bounds[i - 1]))
+        {
+            moveBoundary(current, i - 1, &bounds[i - 1]);
+        }
+    }
+
+    // The samples are taken again at even steps over the keys of every shard.
+    // A shard has seen as many keys as it has, so the next keys replace the
+    // samples at the rate of a reservoir over the whole shard.
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock{ shard->mutex_ };
+        const Tree& tree{ shard->tree_ };
+        size_type stride{ tree.size() / SAMPLE_SIZE + 1 };
+        size_type position{ 0 };
+        shard->sample_.clear();
+        for (auto node = tree.minimum(); node != tree.nil(); node = tree.successor(node))
+        {
+            if (position++ % stride == 0)
+            {
+                shard->sample_.push_back(node->key_);
+            }
+        }
+        shard->seen_ = tree.size();
+        shard->inserts_ = 0;
+        shard->size_.store(tree.size(), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// The shards are locked in the order of their indices, like clear locks them
+template<typename Tree, ShardingMode Mode>
+void ShardedTree<Tree, Mode>::moveBoundary(std::vector<key_type>& bounds, size_type i, const key_type* bound)
+{
+    Shard& lower{ *shards_[i] };
+    Shard& upper{ *shards_[i + 1] };
+    std::lock_guard<std::mutex> lowerLock{ lower.mutex_ };
+    std::lock_guard<std::mutex> upperLock{ upper.mutex_ };
+
+    if (bound == nullptr)
+    {
+        lower.tree_.join(upper.tree_);
+        bounds.pop_back();
+    }
+    else if (i == bounds.size())
+    {
+        lower.tree_.splitGreater(*bound, upper.tree_);
+        bounds.push_back(*bound);
+    }
+    else if (less(*bound, bounds[i]))
+    {
+        lower.tree_.splitGreater(*bound, upper.tree_);
+        bounds[i] = *bound;
+    }
+    else
+    {
+        upper.tree_.splitLess(*bound, lower.tree_);
+        bounds[i] = *bound;
+    }
+    lower.size_.store(lower.tree_.size(), std::memory_order_relaxed);
+    upper.size_.store(upper.tree_.size(), std::memory_order_relaxed);
+
+    const Layout* old{ layout_.exchange(new Layout{ bounds }, std::memory_order_acq_rel) };
+    EpochReclamation::retire(const_cast<Layout*>(old));
+}
+
+template<typename Tree, ShardingMode Mode>
+std::array<std::atomic<bool>, ShardedTree<Tree, Mode>::MAX_CLIENTS>& ShardedTree<Tree, Mode>::clients()
+{
+    static std::array<std::atomic<bool>, MAX_CLIENTS> used{};
+    return used;
+}
+
+template<typename Tree, ShardingMode Mode>
+std::atomic<int>& ShardedTree<Tree, Mode>::clientLimit()
+{
+    static std::atomic<int> limit{ 0 };
+    return limit;
+}
+
+template<typename Tree, ShardingMode Mode>
+int ShardedTree<Tree, Mode>::clientIndex()
+{
+    thread_local Client client;
+    return client.index_;
+}
+
+// A thread waits for a free index if MAX_CLIENTS threads already have one
+template<typename Tree, ShardingMode Mode>
+ShardedTree<Tree, Mode>::Client::Client() :
+    index_{ -1 }
+{
+    auto& used{ clients() };
+    while (index_ < 0)
+    {
+        for (int i{ 0 }; i < MAX_CLIENTS and index_ < 0; ++i)
+        {
+            bool expected{ false };
+            if (not used[i].load(std::memory_order_relaxed)
+                and used[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                index_ = i;
+            }
+        }
+        if (index_ < 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    int limit{ clientLimit().load(std::memory_order_relaxed) };
+    while (limit <= index_ and not clientLimit().compare_exchange_weak(limit, index_ + 1, std::memory_order_release))
+    {
+    }
+}
+
+template<typename Tree, ShardingMode Mode>
+ShardedTree<Tree, Mode>::Client::~Client()
+{
+    clients()[index_].store(false, std::memory_order_release);
+}
+
+template<typename Tree, ShardingMode Mode>
+bool ShardedTree<Tree, Mode>::less(const key_type& a, const key_type& b) const
+{
+    return shards_.front()->tree_.keyCompare()(a, b);
+}
+
+template<typename Tree, ShardingMode Mode>
+typename ShardedTree<Tree, Mode>::size_type ShardedTree<Tree, Mode>::route(const Layout& layout, const key_type& key) const
+{
+    auto bound = std::upper_bound(layout.bounds_.begin(), layout.bounds_.end(), key,
+                                  [this](const key_type& a, const key_type& b) { return less(a, b); });
+    return static_cast<size_type>(bound - layout.bounds_.begin());
+}
+
+// The guard keeps the layout alive while the request points to it, so a new
+// layout can not get the address of the layout that the request was routed with
+template<typename Tree, ShardingMode Mode>
+typename ShardedTree<Tree, Mode>::size_type ShardedTree<Tree, Mode>::run(Request& request) const
+{
+    EpochReclamation::Guard guard;
+    do
+    {
+        request.layout_ = layout_.load(std::memory_order_acquire);
+        request.stale_ = false;
+        dispatch(*shards_[route(*request.layout_, *request.key_)], request, Delegated{});
+    }
+    while (request.stale_);
+    return request.result_;
+}
+
+// The worker is woken up if it may be sleeping. The counter is raised before
+// the sleeping flag is read and the worker raises the flag before it reads the
+// counter, so one of them sees the other.
+template<typename Tree, ShardingMode Mode>
+void ShardedTree<Tree, Mode>::dispatch(Shard& shard, Request& request, std::true_type) const
+{
+    request.done_.store(false, std::memory_order_relaxed);
+    shard.pending_.fetch_add(1, std::memory_order_seq_cst);
+    shard.queues_[clientIndex()].push(&request);
+    if (shard.sleeping_.load(std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> lock{ shard.sleepMutex_ };
+        shard.wakeup_.notify_one();
+    }
+
+    while (not request.done_.load(std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+}
+
+template<typename Tree, ShardingMode Mode>
+void ShardedTree<Tree, Mode>::dispatch(Shard& shard, Request& request, std::false_type) const
+{
+    std::lock_guard<std::mutex> lock{ shard.mutex_ };
+    execute(shard, request);
+}
+
+template<typename Tree, ShardingMode Mode>
+void ShardedTree<Tree, Mode>::execute(Shard& shard, Request& request) const
+{
+    if (layout_.load(std::memory_order_acquire) != request.layout_)
+    {
+        request.stale_ = true;
+        return;
+    }
+
+    Tree& tree{ shard.tree_ };
+    const key_type& key{ *request.key_ };
+    if (request.operation_ == Operation::Find)
+    {
+        auto node = tree.find(key);
+        request.result_ = (node != tree.nil()) ? 1 : 0;
+        if (request.result_ != 0 and request.found_ != nullptr)
+        {
+            *request.found_ = node->value_;
+        }
+    }
+    else if (request.operation_ == Operation::Insert)
+    {
+        request.result_ = tree.insert(*request.value_) ? 1 : 0;
+        if (request.result_ != 0)
+        {
+            shard.size_.store(tree.size(), std::memory_order_relaxed);
+            sample(shard, key);
+            request.check_ = (++shard.inserts_ % CHECK_INTERVAL == 0);
+        }
+    }
+    else
+    {
+        request.result_ = tree.erase(key);
+        shard.size_.store(tree.size(), std::memory_order_relaxed);
+    }
+}
+
+template<typename Tree, ShardingMode Mode>
+void ShardedTree<Tree, Mode>::sample(Shard& shard, const key_type& key) const
+{
+    ++shard.seen_;
+    if (shard.sample_.size() < SAMPLE_SIZE)
+    {
+        shard.sample_.push_back(key);
+    }
+    else
+    {
+        unsigned long long slot{ shard.random_() % shard.seen_ };
+        if (slot < SAMPLE_SIZE)
+        {
+            shard.sample_[slot] = key;
+        }
+    }
+}
+
+// The worker serves the queues of the clients in turns while it holds the shard
+// lock, which it only shares with the scans and the rebalancer
+template<typename Tree, ShardingMode Mode>
+void ShardedTree<Tree, Mode>::work(Shard& shard)
+{
+    int idle{ 0 };
+    while (true)
+    {
+        unsigned int served{ 0 };
+        {
+            std::lock_guard<std::mutex> lock{ shard.mutex_ };
+            int clients{ clientLimit().load(std::memory_order_acquire) };
+            for (int i{ 0 }; i < clients; ++i)
+            {
+                Request* request{ nullptr };
+                while (shard.queues_[i].pop(request))
+                {
+                    execute(shard, *request);
+                    request->done_.store(true, std::memory_order_release);
+                    ++served;
+                }
+            }
+        }
+
+        if (served > 0)
+        {
+            shard.pending_.fetch_sub(served, std::memory_order_relaxed);
+            idle = 0;
+        }
+        else if (stop_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        else if (++idle < IDLE_SPINS)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock{ shard.sleepMutex_ };
+            shard.sleeping_.store(true, std::memory_order_seq_cst);
+            shard.wakeup_.wait(lock, [this, &shard]()
+            {
+                return shard.pending_.load(std::memory_order_seq_cst) != 0 or stop_.load(std::memory_order_acquire);
+            });
+            shard.sleeping_.store(false, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+}
+
+template<typename Tree, ShardingMode Mode>
+bool ShardedTree<Tree, Mode>::unbalanced() const
+{
+    size_type total{ 0 };
+    size_type largest{ 0 };
+    for (auto& shard : shards_)
+    {
+        size_type size{ shard->size_.load(std::memory_order_relaxed) };
+        total += size;
+        if (size > largest)
+        {
+            largest = size;
+        }
+    }
+    return total >= SAMPLE_SIZE * shards_.size() and largest * shards_.size() > IMBALANCE * total;
+}
+
+// A scan that finds a new layout when it locks the next shard starts again from
+// the shard of the last visited key, because the rebalancer may have moved the
+// following keys to that shard or further
+template<typename Tree, ShardingMode Mode>
+template<typename Visit>
+typename ShardedTree<Tree, Mode>::size_type
+ShardedTree<Tree, Mode>::visitRange(const key_type* first, size_type length, Visit& visit) const
+{
+    EpochReclamation::Guard guard;
+    size_type visited{ 0 };
+    const key_type* last{ first };
+    key_type previous{};
+    const Layout* layout{ layout_.load(std::memory_order_acquire) };
+    size_type index{ (last == nullptr) ? 0 : route(*layout, *last) };
+    while (index < shards_.size() and visited < length)
+    {
+        Shard& shard{ *shards_[index] };
+        std::lock_guard<std::mutex> lock{ shard.mutex_ };
+        const Layout* current{ layout_.load(std::memory_order_acquire) };
+        if (current != layout)
+        {
+            layout = current;
+            index = (last == nullptr) ? 0 : route(*layout, *last);
+            continue;
+        }
+
+        const Tree& tree{ shard.tree_ };
+        auto node = tree.minimum();
+        if (visited > 0)
+        {
+            node = tree.upperBound(previous);
+        }
+        else if (first != nullptr)
+        {
+            node = tree.lowerBound(*first);
+        }
+        for (; node != tree.nil() and visited < length; node = tree.successor(node))
+        {
+            visit(node->key_, node->value_);
+            previous = node->key_;
+            last = &previous;
+            ++visited;
+        }
+        ++index;
+    }
+    return visited;
+}
+
+#endif // SHARDEDTREE_CPP
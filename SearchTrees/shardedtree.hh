@@ -0,0 +1,210 @@
+// Key-range sharded map over the search trees
+//
+// Implementation is based on R. Dementiev, L. Kettner, P. Sanders, STXXL: standard
+// template library for XXL data sets, Software: Practice and Experience 38(6), 2008,
+// pp. 589-637 (sample sort splitters), and J. Roy, Ffwd: delegation is (much) faster
+// than you think, Proceedings of the 26th Symposium on Operating Systems Principles,
+// 2017, pp. 342-358
+//
+// The key space is split into ranges, and every range is a shard with its own tree,
+// which has to support splitGreater, splitLess and join like RedBlackTree and AVLTree. The boundaries of the ranges are in an immutable
+// layout, which the operations read without locking. In the locked mode a thread
+// locks the shard of the key and applies the operation itself. In the delegated mode
+// every shard has a worker thread that owns the tree and is pinned to a core of its
+// own, as long as there are enough cores. The threads send their operations to the
+// worker over single-producer single-consumer queues, one queue for every thread,
+// and wait for the result.
+//
+// Every shard keeps a reservoir sample of its keys. The rebalancer weights the
+// samples by the sizes of the shards and takes their quantiles as the new boundaries.
+// It moves one boundary at a time: it locks the two shards next to the boundary,
+// splits the keys that are now on the wrong side off one tree, joins them to the
+// other tree and publishes a layout with the new boundary before it unlocks the
+// shards, so the other shards keep serving. The boundaries that move down are moved
+// from the first to the last and the boundaries that move up from the last to the
+// first, so the boundaries stay sorted in every layout between. An operation that
+// was routed with an old layout finds out under the shard lock and is routed again.
+// The old layouts are freed through EpochReclamation.
+//
+// The scans are not delegated. They lock one shard at a time and visit the keys of
+// the shards in order, which merges the ranges into one sorted sequence.
+
+#ifndef SHARDEDTREE_HH
+#define SHARDEDTREE_HH
+
+#include "epochreclamation.hh"
+#include "spscqueue.hh"
+#include "threadaffinity.hh"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum class ShardingMode
+{
+    Locked,
+    Delegated
+};
+
+template<typename Tree, ShardingMode Mode = ShardingMode::Locked>
+class ShardedTree
+{
+public:
+    using key_type = typename Tree::key_type;
+    using mapped_type = typename Tree::mapped_type;
+    using value_type = typename Tree::value_type;
+    using size_type = typename Tree::size_type;
+    using node_type = typename Tree::node_type;
+
+    // The number of keys sampled from every shard
+    const static size_type SAMPLE_SIZE = 128;
+    // How many keys are inserted to a shard between the checks of the balance
+    const static size_type CHECK_INTERVAL = 1024;
+    // The shards are rebalanced when the largest one is this many times the average
+    const static size_type IMBALANCE = 2;
+    // The number of threads that can use a delegated tree at the same time
+    const static int MAX_CLIENTS = 64;
+
+    // One shard for every hardware thread by default
+    explicit ShardedTree(size_type shards = defaultShards());
+    ShardedTree(const ShardedTree&) = delete;
+    ShardedTree& operator=(const ShardedTree&) = delete;
+    ~ShardedTree();
+
+    static size_type defaultShards();
+
+    // The number of keys once the operations in progress have finished
+    size_type size() const;
+    // The height of the highest shard
+    int height() const;
+    size_type shards() const;
+    // The number of keys in every shard
+    std::vector<size_type> shardSizes() const;
+
+    void clear();
+
+    bool contains(const key_type& key) const;
+    // Copies the value of the key to value. Returns false if the key is not in the tree.
+    bool find(const key_type& key, mapped_type& value) const;
+    bool insert(const value_type& value);
+    size_type erase(const key_type& key);
+
+    // Calls visit for every key and value in the order of the keys. Each shard is
+    // locked while it is visited, so visit must not use the tree.
+    template<typename Visit>
+    void forEach(Visit visit) const;
+    // Calls visit for at most length keys starting from the first key that is not
+    // less than first. Returns the number of visited keys.
+    template<typename Visit>
+    size_type scan(const key_type& first, size_type length, Visit visit) const;
+
+    // Moves the boundaries to the sampled quantiles of the keys and moves the keys
+    // between the shards. Returns false if another thread is already rebalancing.
+    bool rebalance();
+
+private:
+    using Delegated = std::integral_constant<bool, Mode == ShardingMode::Delegated>;
+
+    const static std::size_t QUEUE_CAPACITY = 4;
+    // How many times an idle worker checks for requests before it sleeps
+    const static int IDLE_SPINS = 64;
+
+    enum class Operation
+    {
+        Find,
+        Insert,
+        Erase
+    };
+
+    // Shard i has the keys in [bounds_[i - 1], bounds_[i]). The shards after the
+    // last boundary are empty. An empty layout puts every key to the first shard.
+    struct Layout
+    {
+        std::vector<key_type> bounds_;
+    };
+
+    // An operation points to the arguments of the waiting thread
+    struct Request
+    {
+        Operation operation_;
+        const Layout* layout_;
+        const key_type* key_;
+        const value_type* value_;
+        mapped_type* found_;
+        size_type result_;
+        // Set if the layout changed after the request was routed
+        bool stale_;
+        // Set if the balance should be checked after the request
+        bool check_;
+        std::atomic<bool> done_;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex_;
+        Tree tree_;
+        std::atomic<size_type> size_{ 0 };
+        // A reservoir sample of the keys, taken again at every rebalance
+        std::vector<key_type> sample_;
+        unsigned long long seen_{ 0 };
+        std::minstd_rand random_{};
+        size_type inserts_{ 0 };
+
+        // The delegated mode only
+        std::array<SpscQueue<Request*, QUEUE_CAPACITY>, MAX_CLIENTS> queues_;
+        std::atomic<unsigned int> pending_{ 0 };
+        std::atomic<bool> sleeping_{ false };
+        std::mutex sleepMutex_;
+        std::condition_variable wakeup_;
+        std::thread worker_;
+    };
+
+    // Holds the index of a client thread until the thread exits
+    struct Client
+    {
+        int index_;
+
+        Client();
+        ~Client();
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<const Layout*> layout_;
+    std::mutex rebalancer_;
+    std::atomic<bool> stop_;
+
+    static std::array<std::atomic<bool>, MAX_CLIENTS>& clients();
+    // The number of client indices that have been in use
+    static std::atomic<int>& clientLimit();
+    static int clientIndex();
+
+    bool less(const key_type& a, const key_type& b) const;
+    size_type route(const Layout& layout, const key_type& key) const;
+
+    // Routes the request to its shard until it is not stale
+    size_type run(Request& request) const;
+    void dispatch(Shard& shard, Request& request, std::true_type) const;
+    void dispatch(Shard& shard, Request& request, std::false_type) const;
+    // Applies the request to the shard. Called with the shard locked.
+    void execute(Shard& shard, Request& request) const;
+    void sample(Shard& shard, const key_type& key) const;
+    void work(Shard& shard);
+
+    // Returns true if the largest shard is too large
+    bool unbalanced() const;
+    // Moves boundary i of bounds to bound, or removes it if bound is null, moves the
+    // keys between the two shards next to it and publishes the new layout
+    void moveBoundary(std::vector<key_type>& bounds, size_type i, const key_type* bound);
+    // Visits the keys from first, or from the smallest key if first is null
+    template<typename Visit>
+    size_type visitRange(const key_type* first, size_type length, Visit& visit) const;
+};
+
+#include "shardedtree.cpp"
+
+#endif // SHARDEDTREE_HH
@@ -0,0 +1,425 @@
+// Lock-free skip list implementation
+//
+// Implementation is based on M. Herlihy, N. Shavit, The Art of Multiprocessor
+// Programming, Morgan Kaufmann, 2008, Section 14.4 and K. Fraser, Practical
+// lock-freedom, PhD thesis, University of Cambridge, Technical Report
+// UCAM-CL-TR-579, 2004, Section 4.3
+
+#ifndef SKIPLIST_CPP
+#define SKIPLIST_CPP
+
+#include "skiplist.hh"
+#include <algorithm>
+#include <new>
+#include <random>
+
+template<typename Node, typename Compare>
+SkipList<Node, Compare>::SkipList() :
+    SkipList{ 0.5 }
+{
+}
+
+template<typename Node, typename Compare>
+SkipList<Node, Compare>::SkipList(double probability, int maxLevel, const Compare& compare) :
+    CompareStorage<Compare>{ compare },
+    probability_{ probability },
+    maxLevel_{ (maxLevel < 1) ? 1 : (maxLevel > MAX_LEVEL_LIMIT) ? MAX_LEVEL_LIMIT : maxLevel },
+    head_{ nullptr },
+    nodes_{ 0 },
+    levels_{ 0 },
+    pools_{}
+{
+    for (int height{ 1 }; height <= maxLevel_; ++height)
+    {
+        pools_.push_back(&NodePool::shared(sizeof(Node) + height * sizeof(std::atomic<std::uintptr_t>)));
+    }
+    head_ = create(key_type{}, mapped_type{}, maxLevel_);
+}
+
+template<typename Node, typename Compare>
+SkipList<Node, Compare>::~SkipList()
+{
+    clear();
+    destroy(head_);
+}
+
+template<typename Node, typename Compare>
+typename SkipList<Node, Compare>::size_type SkipList<Node, Compare>::size() const
+{
+    return nodes_.load(std::memory_order_relaxed);
+}
+
+template<typename Node, typename Compare>
+int SkipList<Node, Compare>::height() const
+{
+    return levels_.load();
+}
+
+template<typename Node, typename Compare>
+double SkipList<Node, Compare>::probability() const
+{
+    return probability_;
+}
+
+template<typename Node, typename Compare>
+int SkipList<Node, Compare>::maxLevel() const
+{
+    return maxLevel_;
+}
+
+template<typename Node, typename Compare>
+void SkipList<Node, Compare>::clear()
+{
+    Node* node{ address(head_->next()[0].load()) };
+    while (node != nullptr)
+    {
+        Node* next{ address(node->next()[0].load()) };
+        destroy(node);
+        node = next;
+    }
+
+    for (int level{ 0 }; level < maxLevel_; ++level)
+    {
+        head_->next()[level].store(0);
+    }
+    nodes_.store(0);
+    levels_.store(0);
+}
+
+template<typename Node, typename Compare>
+bool SkipList<Node, Compare>::contains(const key_type& key) const
+{
+    EpochReclamation::Guard guard;
+    Node* node{ skipMarked(lowerBound(key)) };
+    return node != nullptr and equal(node, key);
+}
+
+template<typename Node, typename Compare>
+bool SkipList<Node, Compare>::find(const key_type& key, mapped_type& value) const
+{
+    EpochReclamation::Guard guard;
+    Node* node{ skipMarked(lowerBound(key)) };
+    if (node == nullptr or not equal(node, key))
+    {
+        return false;
+    }
+    value = node->value_;
+    return true;
+}
+
+template<typename Node, typename Compare>
+Node* SkipList<Node, Compare>::find(const key_type& key) const
+{
+    EpochReclamation::Guard guard;
+    Node* node{ skipMarked(lowerBound(key)) };
+    return (node != nullptr and equal(node, key)) ? node : nullptr;
+}
+
+// The key is in the list once the node is linked on the bottom level. The upper
+// levels are linked after that, and linking stops if the node is erased meanwhile.
+template<typename Node, typename Compare>
+bool SkipList<Node, Compare>::insert(const value_type& value)
+{
+    EpochReclamation::Guard guard;
+    Node* preds[MAX_LEVEL_LIMIT];
+    Node* succs[MAX_LEVEL_LIMIT];
+    int height{ randomHeight() };
+    Node* node{ nullptr };
+    while (true)
+    {
+        if (search(value.first, preds, succs))
+        {
+            // The node was never visible to the other threads
+            if (node != nullptr)
+            {
+                destroy(node);
+            }
+            return false;
+        }
+
+        if (node == nullptr)
+        {
+            node = create(value.first, value.second, height);
+        }
+        for (int level{ 0 }; level < height; ++level)
+        {
+            node->next()[level].store(link(succs[level]), std::memory_order_relaxed);
+        }
+
+        std::uintptr_t expected{ link(succs[0]) };
+        if (preds[0]->next()[0].compare_exchange_strong(expected, link(node)))
+        {
+            break;
+        }
+    }
+
+    nodes_.fetch_add(1, std::memory_order_relaxed);
+    int levels{ levels_.load() };
+    while (levels < height and not levels_.compare_exchange_weak(levels, height))
+    {
+    }
+
+    bool linked{ true };
+    for (int level{ 1 }; level < height and linked; ++level)
+    {
+        while (true)
+        {
+            std::uintptr_t next{ node->next()[level].load() };
+            if (marked(next))
+            {
+                linked = false;
+                break;
+            }
+            if (address(next) != succs[level]
+                and not node->next()[level].compare_exchange_strong(next, link(succs[level])))
+            {
+                continue;
+            }
+
+            std::uintptr_t expected{ link(succs[level]) };
+            if (preds[level]->next()[level].compare_exchange_strong(expected, link(node)))
+            {
+                break;
+            }
+            search(value.first, preds, succs);
+            if (succs[0] != node)
+            {
+                linked = false;
+                break;
+            }
+        }
+    }
+
+    // An erase that finished before the upper levels were linked may have
+    // missed them, so they are unlinked here
+    if (marked(node->next()[0].load()))
+    {
+        search(value.first, preds, succs);
+    }
+    release(node);
+    return true;
+}
+
+// The thread that marks the bottom level erases the key
+template<typename Node, typename Compare>
+typename SkipList<Node, Compare>::size_type SkipList<Node, Compare>::erase(const key_type& key)
+{
+    EpochReclamation::Guard guard;
+    Node* preds[MAX_LEVEL_LIMIT];
+    Node* succs[MAX_LEVEL_LIMIT];
+    if (not search(key, preds, succs))
+    {
+        return 0;
+    }
+
+    Node* node{ succs[0] };
+    for (int level{ node->height_ - 1 }; level > 0; --level)
+    {
+        std::uintptr_t next{ node->next()[level].load() };
+        while (not marked(next) and not node->next()[level].compare_exchange_weak(next, next | MARK))
+        {
+        }
+    }
+
+    std::uintptr_t next{ node->next()[0].load() };
+    while (true)
+    {
+        if (marked(next))
+        {
+            return 0;
+        }
+        if (node->next()[0].compare_exchange_weak(next, next | MARK))
+        {
+            break;
+        }
+    }
+
+    nodes_.fetch_sub(1, std::memory_order_relaxed);
+    search(key, preds, succs);
+    release(node);
+    return 1;
+}
+
+template<typename Node, typename Compare>
+template<typename Visit>
+void SkipList<Node, Compare>::forEach(Visit visit) const
+{
+    EpochReclamation::Guard guard;
+    Node* node{ skipMarked(address(head_->next()[0].load())) };
+    while (node != nullptr)
+    {
+        visit(node->key_, node->value_);
+        node = skipMarked(address(node->next()[0].load()));
+    }
+}
+
+template<typename Node, typename Compare>
+template<typename Visit>
+typename SkipList<Node, Compare>::size_type
+SkipList<Node, Compare>::scan(const key_type& first, size_type length, Visit visit) const
+{
+    EpochReclamation::Guard guard;
+    size_type visited{ 0 };
+    Node* node{ skipMarked(lowerBound(first)) };
+    while (node != nullptr and visited < length)
+    {
+        visit(node->key_, node->value_);
+        ++visited;
+        node = skipMarked(address(node->next()[0].load()));
+    }
+    return visited;
+}
+
+template<typename Node, typename Compare>
+Node* SkipList<Node, Compare>::address(std::uintptr_t link)
+{
+    return reinterpret_cast<Node*>(link & ~MARK);
+}
+
+template<typename Node, typename Compare>
+bool SkipList<Node, Compare>::marked(std::uintptr_t link)
+{
+    return (link & MARK) != 0;
+}
+
+template<typename Node, typename Compare>
+std::uintptr_t SkipList<Node, Compare>::link(Node* node)
+{
+    return reinterpret_cast<std::uintptr_t>(node);
+}
+
+template<typename Node, typename Compare>
+void SkipList<Node, Compare>::free(void* node)
+{
+    Node* x{ static_cast<Node*>(node) };
+    NodePool* pool{ x->pool_ };
+    x->~Node();
+    pool->deallocate(x);
+}
+
+template<typename Node, typename Compare>
+bool SkipList<Node, Compare>::less(const Node* node, const key_type& key) const
+{
+    return this->comparator()(node->key_, key);
+}
+
+template<typename Node, typename Compare>
+bool SkipList<Node, Compare>::equal(const Node* node, const key_type& key) const
+{
+    return not this->comparator()(node->key_, key) and not this->comparator()(key, node->key_);
+}
+
+template<typename Node, typename Compare>
+int SkipList<Node, Compare>::randomHeight() const
+{
+    thread_local std::mt19937 generator{ std::random_device{}() };
+    std::uniform_real_distribution<double> distribution{ 0.0, 1.0 };
+    int height{ 1 };
+    while (height < maxLevel_ and distribution(generator) < probability_)
+    {
+        ++height;
+    }
+    return height;
+}
+
+template<typename Node, typename Compare>
+Node* SkipList<Node, Compare>::create(const key_type& key, const mapped_type& value, int height)
+{
+    NodePool* pool{ pools_[height - 1] };
+    Node* node{ new (pool->allocate()) Node{ key, value, height, pool } };
+    for (int level{ 0 }; level < height; ++level)
+    {
+        new (&node->next()[level]) std::atomic<std::uintptr_t>{ 0 };
+    }
+    return node;
+}
+
+template<typename Node, typename Compare>
+void SkipList<Node, Compare>::destroy(Node* node)
+{
+    free(node);
+}
+
+template<typename Node, typename Compare>
+void SkipList<Node, Compare>::release(Node* node)
+{
+    if (node->owners_.fetch_sub(1) == 1)
+    {
+        EpochReclamation::retire(node, *node->pool_);
+    }
+}
+
+// The search starts from the top level, because the height that is in use is only
+// raised after the bottom level of the new node has been linked
+template<typename Node, typename Compare>
+bool SkipList<Node, Compare>::search(const key_type& key, Node** preds, Node** succs)
+{
+    while (true)
+    {
+        Node* pred{ head_ };
+        bool restart{ false };
+        for (int level{ maxLevel_ - 1 }; level >= 0 and not restart; --level)
+        {
+            Node* current{ address(pred->next()[level].load()) };
+            while (current != nullptr)
+            {
+                std::uintptr_t next{ current->next()[level].load() };
+                if (marked(next))
+                {
+                    std::uintptr_t expected{ link(current) };
+                    if (not pred->next()[level].compare_exchange_strong(expected, next & ~MARK))
+                    {
+                        restart = true;
+                        break;
+                    }
+                    current = address(next);
+                }
+                else if (less(current, key))
+                {
+                    pred = current;
+                    current = address(next);
+                }
+                else
+                {
+                    break;
+                }
+            }
+            preds[level] = pred;
+            succs[level] = current;
+        }
+
+        if (not restart)
+        {
+            return succs[0] != nullptr and equal(succs[0], key);
+        }
+    }
+}
+
+template<typename Node, typename Compare>
+Node* SkipList<Node, Compare>::lowerBound(const key_type& key) const
+{
+    Node* pred{ head_ };
+    Node* current{ nullptr };
+    for (int level{ std::max(levels_.load(), 1) - 1 }; level >= 0; --level)
+    {
+        current = address(pred->next()[level].load());
+        while (current != nullptr and less(current, key))
+        {
+            pred = current;
+            current = address(current->next()[level].load());
+        }
+    }
+    return current;
+}
+
+template<typename Node, typename Compare>
+Node* SkipList<Node, Compare>::skipMarked(Node* node)
+{
+    while (node != nullptr and marked(node->next()[0].load()))
+    {
+        node = address(node->next()[0].load());
+    }
+    return node;
+}
+
+#endif // SKIPLIST_CPP
@@ -0,0 +1,151 @@
+// Lock-free skip list implementation
+//
+// Implementation is based on M. Herlihy, N. Shavit, The Art of Multiprocessor
+// Programming, Morgan Kaufmann, 2008, Section 14.4 and K. Fraser, Practical
+// lock-freedom, PhD thesis, University of Cambridge, Technical Report
+// UCAM-CL-TR-579, 2004, Section 4.3
+//
+// Every node has a tower of links, one for every level it is on. The height of the
+// tower is chosen when the node is inserted: it is on level i + 1 with the
+// probability p if it is on level i, up to the maximum level. A key is in the list
+// when its node is linked on the bottom level and the link of the node on that level
+// is not marked. Erase marks the links of the tower from the top down, and the
+// searches unlink the marked nodes that they pass.
+//
+// The inserter may still be linking the upper levels of a node when another thread
+// erases it, so the node is retired only after both have finished with it. The nodes
+// come from a NodePool of their tower height, and EpochReclamation returns the
+// erased nodes to the pool.
+
+#ifndef SKIPLIST_HH
+#define SKIPLIST_HH
+
+#include "binarysearchtree.hh"
+#include "epochreclamation.hh"
+#include "nodepool.hh"
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+template<typename Key, typename Value>
+struct SkipListNode
+{
+    using key_type = Key;
+    using mapped_type = Value;
+
+    const key_type key_;
+    const mapped_type value_;
+    // The number of levels in the tower
+    const int height_;
+    NodePool* const pool_;
+    // The inserter and the list each hold the node until they have finished with it
+    std::atomic<int> owners_;
+
+    SkipListNode(const key_type& key, const mapped_type& value, int height, NodePool* pool) :
+        key_{ key }, value_{ value },
+        height_{ height },
+        pool_{ pool },
+        owners_{ 2 }
+    {}
+
+    // The tower is stored right after the node in the same block
+    std::atomic<std::uintptr_t>* next()
+    {
+        return reinterpret_cast<std::atomic<std::uintptr_t>*>(this + 1);
+    }
+};
+
+// The member functions can be called from several threads at the same time,
+// except for clear and the destructor
+template<typename Node, typename Compare = std::less<typename Node::key_type>>
+class SkipList : private CompareStorage<Compare>
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+    using value_type = std::pair<const key_type, mapped_type>;
+    using size_type = unsigned int;
+    using node_type = Node;
+    using key_compare = Compare;
+
+    const static int DEFAULT_MAX_LEVEL = 24;
+    const static int MAX_LEVEL_LIMIT = 32;
+
+    SkipList();
+    // The maximum level is limited to 1 ... MAX_LEVEL_LIMIT
+    explicit SkipList(double probability, int maxLevel = DEFAULT_MAX_LEVEL,
+                      const Compare& compare = Compare{});
+    SkipList(const SkipList&) = delete;
+    SkipList& operator=(const SkipList&) = delete;
+    ~SkipList();
+
+    // The number of keys once the operations in progress have finished
+    size_type size() const;
+    // The number of levels in use
+    int height() const;
+    double probability() const;
+    int maxLevel() const;
+
+    // Not thread-safe
+    void clear();
+
+    bool contains(const key_type& key) const;
+    // Copies the value of the key to value. Returns false if the key is not in the list.
+    bool find(const key_type& key, mapped_type& value) const;
+    // Returns the node of the key, or nullptr. The node may only be used by the
+    // threads that do not erase keys.
+    Node* find(const key_type& key) const;
+    bool insert(const value_type& value);
+    size_type erase(const key_type& key);
+
+    // Calls visit for every key and value in the order of the keys. The keys that
+    // are inserted or erased during the scan may or may not be visited.
+    template<typename Visit>
+    void forEach(Visit visit) const;
+    // Calls visit for at most length keys starting from the first key that is not
+    // less than first. Returns the number of visited keys.
+    template<typename Visit>
+    size_type scan(const key_type& first, size_type length, Visit visit) const;
+
+private:
+    // The bit of a link that marks its node erased on that level
+    const static std::uintptr_t MARK = 1;
+
+    double probability_;
+    int maxLevel_;
+    // The head has a tower of the maximum height and no key
+    Node* head_;
+    std::atomic<size_type> nodes_;
+    std::atomic<int> levels_;
+    // The pools of the towers of every height
+    std::vector<NodePool*> pools_;
+
+    static Node* address(std::uintptr_t link);
+    static bool marked(std::uintptr_t link);
+    static std::uintptr_t link(Node* node);
+    static void free(void* node);
+
+    bool less(const Node* node, const key_type& key) const;
+    bool equal(const Node* node, const key_type& key) const;
+
+    int randomHeight() const;
+    Node* create(const key_type& key, const mapped_type& value, int height);
+    void destroy(Node* node);
+    // Retires the node if the other owner has already finished with it
+    void release(Node* node);
+
+    // Finds the last node before key and the node after it on every level, and unlinks
+    // the marked nodes on the way. Returns true if the node after it on the bottom
+    // level has the key.
+    bool search(const key_type& key, Node** preds, Node** succs);
+    // Returns the first node on the bottom level whose key is not less than key
+    // without unlinking anything. The node may be marked.
+    Node* lowerBound(const key_type& key) const;
+    // Returns the first unmarked node on the bottom level starting from node
+    static Node* skipMarked(Node* node);
+};
+
+#include "skiplist.cpp"
+
+#endif // SKIPLIST_HH
@@ -0,0 +1,67 @@
+// Lock-free single-producer single-consumer queue
+//
+// Implementation is based on L. Lamport, Specifying concurrent program modules, ACM
+// Transactions on Programming Languages and Systems 5(2), 1983, pp. 190-222, and
+// J. Giacomoni, T. Moseley, M. Vachharajani, FastForward for efficient pipeline
+// parallelism, Proceedings of the 17th International Conference on Parallel
+// Architectures and Compilation Techniques, 2008, pp. 43-52
+
+#ifndef SPSCQUEUE_CPP
+#define SPSCQUEUE_CPP
+
+#include "spscqueue.hh"
+
+template<typename T, std::size_t Capacity>
+SpscQueue<T, Capacity>::SpscQueue() :
+    head_{ 0 },
+    cachedTail_{ 0 },
+    tail_{ 0 },
+    cachedHead_{ 0 },
+    buffer_{}
+{
+}
+
+// The indices only grow, and the slot of an index is the index modulo the capacity
+template<typename T, std::size_t Capacity>
+bool SpscQueue<T, Capacity>::push(const T& value)
+{
+    std::size_t tail{ tail_.load(std::memory_order_relaxed) };
+    if (tail - cachedHead_ == Capacity)
+    {
+        cachedHead_ = head_.load(std::memory_order_acquire);
+        if (tail - cachedHead_ == Capacity)
+        {
+            return false;
+        }
+    }
+
+    buffer_[tail & (Capacity - 1)] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T, std::size_t Capacity>
+bool SpscQueue<T, Capacity>::pop(T& value)
+{
+    std::size_t head{ head_.load(std::memory_order_relaxed) };
+    if (head == cachedTail_)
+    {
+        cachedTail_ = tail_.load(std::memory_order_acquire);
+        if (head == cachedTail_)
+        {
+            return false;
+        }
+    }
+
+    value = buffer_[head & (Capacity - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T, std::size_t Capacity>
+bool SpscQueue<T, Capacity>::empty() const
+{
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
+
+#endif // SPSCQUEUE_CPP
@@ -0,0 +1,50 @@
+// Lock-free single-producer single-consumer queue
+//
+// Implementation is based on L. Lamport, Specifying concurrent program modules, ACM
+// Transactions on Programming Languages and Systems 5(2), 1983, pp. 190-222, and
+// J. Giacomoni, T. Moseley, M. Vachharajani, FastForward for efficient pipeline
+// parallelism, Proceedings of the 17th International Conference on Parallel
+// Architectures and Compilation Techniques, 2008, pp. 43-52
+//
+// A ring buffer whose head is only written by the consumer and whose tail is only
+// written by the producer. The indices are on their own cache lines, and both sides
+// keep a copy of the index of the other side, so they only read the shared index
+// when the queue looks full or empty.
+
+#ifndef SPSCQUEUE_HH
+#define SPSCQUEUE_HH
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+template<typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 and (Capacity & (Capacity - 1)) == 0, "The capacity must be a power of two");
+
+public:
+    SpscQueue();
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Only called by the producer. Returns false if the queue is full.
+    bool push(const T& value);
+    // Only called by the consumer. Returns false if the queue is empty.
+    bool pop(T& value);
+    // The queue may change right after the call
+    bool empty() const;
+
+private:
+    alignas(64) std::atomic<std::size_t> head_;
+    // The tail that the consumer saw last
+    std::size_t cachedTail_;
+    alignas(64) std::atomic<std::size_t> tail_;
+    // The head that the producer saw last
+    std::size_t cachedHead_;
+    alignas(64) std::array<T, Capacity> buffer_;
+};
+
+#include "spscqueue.cpp"
+
+#endif // SPSCQUEUE_HH
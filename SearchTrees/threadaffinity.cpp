@@ -0,0 +1,44 @@
+// Pinning threads to processors
+
+#include "threadaffinity.hh"
+#include <algorithm>
+#include <thread>
+#ifdef _WIN32
+// Keeps windows.h from defining min and max as macros
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// On Linux the CPU is picked from the affinity mask of the process, which may
+// leave out some of the hardware threads
+void pinThread(int cpu)
+{
+#ifdef _WIN32
+    int hardware{ std::max(1, static_cast<int>(std::thread::hardware_concurrency())) };
+    int bits{ static_cast<int>(sizeof(DWORD_PTR) * 8) };
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << (cpu % std::min(hardware, bits)));
+#else
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 or CPU_COUNT(&allowed) == 0)
+    {
+        return;
+    }
+
+    int skip{ cpu % CPU_COUNT(&allowed) };
+    for (int i{ 0 }; i < CPU_SETSIZE; ++i)
+    {
+        if (CPU_ISSET(i, &allowed) and skip-- == 0)
+        {
+            cpu_set_t pinned;
+            CPU_ZERO(&pinned);
+            CPU_SET(i, &pinned);
+            pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+            return;
+        }
+    }
+#endif
+}
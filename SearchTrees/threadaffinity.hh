@@ -0,0 +1,14 @@
+// Pinning threads to processors
+//
+// A thread that owns data, like the worker of a delegated shard, keeps its caches
+// warm only if it stays on one processor, and the benchmarks pin their threads so
+// that the runs are repeatable.
+
+#ifndef THREADAFFINITY_HH
+#define THREADAFFINITY_HH
+
+// Pins the calling thread to the given CPU, counted modulo the CPUs that the
+// process may use. Does nothing if the thread cannot be pinned.
+void pinThread(int cpu);
+
+#endif // THREADAFFINITY_HH
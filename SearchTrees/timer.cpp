@@ -19,3 +19,9 @@ double Timer::elapsed() const
     return std::chrono::duration_cast<std::chrono::milliseconds>
             (clock_::now() - start_).count();
 }
+
+long long Timer::elapsedNanoseconds() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>
+            (clock_::now() - start_).count();
+}
@@ -16,6 +16,8 @@ public:
     void reset();
     // Returns the elapsed time in milliseconds
     double elapsed() const;
+    // Returns the elapsed time in nanoseconds
+    long long elapsedNanoseconds() const;
 
 private:
     using clock_ = std::chrono::high_resolution_clock;
@@ -0,0 +1,275 @@
+// Asynchronous service that executes the requests to a search tree in batches
+//
+// Implementation is based on D. Hendler, I. Incze, N. Shavit, M. Tzafrir, Flat
+// combining and the synchronization-parallelism tradeoff, Proceedings of the 22nd
+// ACM Symposium on Parallelism in Algorithms and Architectures, 2010, pp. 355-364,
+// and D. Vyukov, Intrusive MPSC node-based queue, 2010
+
+#ifndef TREESERVICE_CPP
+#define TREESERVICE_CPP
+
+#include "treeservice.hh"
+#include <algorithm>
+
+template<typename Tree>
+TreeService<Tree>::TreeService() :
+    tree_{},
+    compare_{ tree_.keyCompare() },
+    queue_{},
+    started_{ Clock::now() },
+    pending_{ 0 },
+    sleeping_{ false },
+    stop_{ false },
+    sleepMutex_{},
+    wakeup_{},
+    size_{ 0 },
+    requests_{ 0 },
+    batches_{ 0 },
+    keys_{ 0 },
+    latency_{ 0 },
+    maxLatency_{ 0 },
+    worker_{}
+{
+    worker_ = std::thread{ [this]() { work(); } };
+}
+
+template<typename Tree>
+TreeService<Tree>::~TreeService()
+{
+    {
+        std::lock_guard<std::mutex> lock{ sleepMutex_ };
+        stop_.store(true, std::memory_order_seq_cst);
+        wakeup_.notify_one();
+    }
+    worker_.join();
+}
+
+template<typename Tree>
+typename TreeService<Tree>::size_type TreeService<Tree>::size() const
+{
+    return size_.load(std::memory_order_relaxed);
+}
+
+template<typename Tree>
+typename TreeService<Tree>::Counters TreeService<Tree>::counters() const
+{
+    auto uptime = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started_);
+    return Counters{ requests_.load(std::memory_order_relaxed),
+                     batches_.load(std::memory_order_relaxed),
+                     keys_.load(std::memory_order_relaxed),
+                     latency_.load(std::memory_order_relaxed),
+                     maxLatency_.load(std::memory_order_relaxed),
+                     static_cast<unsigned long long>(uptime.count()) };
+}
+
+template<typename Tree>
+std::future<bool> TreeService<Tree>::contains(const key_type& key)
+{
+    return submit<bool>(Operation::Contains, key, mapped_type{});
+}
+
+template<typename Tree>
+std::future<std::pair<bool, typename TreeService<Tree>::mapped_type>> TreeService<Tree>::find(const key_type& key)
+{
+    return submit<std::pair<bool, mapped_type>>(Operation::Find, key, mapped_type{});
+}
+
+template<typename Tree>
+std::future<bool> TreeService<Tree>::insert(const value_type& value)
+{
+    return submit<bool>(Operation::Insert, value.first, value.second);
+}
+
+template<typename Tree>
+std::future<typename TreeService<Tree>::size_type> TreeService<Tree>::erase(const key_type& key)
+{
+    return submit<size_type>(Operation::Erase, key, mapped_type{});
+}
+
+// The request is counted before it is queued, so a service that goes to sleep
+// either sees the count or the caller sees that the service is sleeping
+template<typename Tree>
+template<typename Result>
+std::future<Result> TreeService<Tree>::submit(Operation operation, const key_type& key, const mapped_type& value)
+{
+    Reply<Result>* request{ new Reply<Result>{} };
+    request->operation_ = operation;
+    request->key_ = key;
+    request->value_ = value;
+    std::future<Result> result{ request->promise_.get_future() };
+    request->submitted_ = Clock::now();
+
+    pending_.fetch_add(1, std::memory_order_seq_cst);
+    queue_.push(request);
+    if (sleeping_.load(std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> lock{ sleepMutex_ };
+        wakeup_.notify_one();
+    }
+    return result;
+}
+
+template<typename Tree>
+void TreeService<Tree>::work()
+{
+    std::vector<Request*> batch;
+    batch.reserve(MAX_BATCH);
+    int idle{ 0 };
+    while (true)
+    {
+        while (batch.size() < MAX_BATCH)
+        {
+            Request* request{ queue_.pop() };
+            if (request == nullptr)
+            {
+                break;
+            }
+            batch.push_back(request);
+        }
+
+        if (not batch.empty())
+        {
+            pending_.fetch_sub(static_cast<unsigned int>(batch.size()), std::memory_order_relaxed);
+            execute(batch);
+            batch.clear();
+            idle = 0;
+        }
+        else if (pending_.load(std::memory_order_seq_cst) != 0)
+        {
+            // A request has been counted but not yet linked to the queue
+            std::this_thread::yield();
+        }
+        else if (stop_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        else if (++idle < IDLE_SPINS)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock{ sleepMutex_ };
+            sleeping_.store(true, std::memory_order_seq_cst);
+            wakeup_.wait(lock, [this]()
+            {
+                return pending_.load(std::memory_order_seq_cst) != 0 or stop_.load(std::memory_order_acquire);
+            });
+            sleeping_.store(false, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+}
+
+// The previous node and the finger stay valid across the writes, because the
+// trees move nodes instead of copying the keys between them, and an erase moves
+// the finger off the node first. The finger is null until the first lookup of the
+// batch has searched from the root. The counters are updated before the futures
+// are fulfilled, so a caller that has its result sees the request counted.
+template<typename Tree>
+void TreeService<Tree>::execute(std::vector<Request*>& batch)
+{
+    std::stable_sort(batch.begin(), batch.end(), [this](const Request* a, const Request* b)
+    {
+        return compare_(a->key_, b->key_);
+    });
+
+    requests_.fetch_add(batch.size(), std::memory_order_relaxed);
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    Node* previous{ tree_.nil() };
+    Node* finger{ nullptr };
+    std::size_t first{ 0 };
+    while (first < batch.size())
+    {
+        // The key is copied, because the request that holds it is freed when it is applied
+        key_type key{ batch[first]->key_ };
+        std::size_t last{ first + 1 };
+        while (last < batch.size() and not compare_(key, batch[last]->key_))
+        {
+            ++last;
+        }
+
+        finger = (finger == nullptr) ? tree_.lowerBound(key) : locate(finger, key, previous);
+        Node* node{ (finger != tree_.nil() and not compare_(key, finger->key_)) ? finger : tree_.nil() };
+        keys_.fetch_add(1, std::memory_order_relaxed);
+        for (std::size_t i{ first }; i < last; ++i)
+        {
+            apply(batch[i], node, finger, previous);
+        }
+        if (node != tree_.nil())
+        {
+            previous = node;
+            finger = tree_.successor(node);
+        }
+        first = last;
+    }
+}
+
+template<typename Tree>
+typename TreeService<Tree>::Node* TreeService<Tree>::locate(Node* finger, const key_type& key, Node*& previous) const
+{
+    Node* node{ finger };
+    for (int i{ 0 }; i < FINGER_STEPS; ++i)
+    {
+        if (node == tree_.nil() or not compare_(node->key_, key))
+        {
+            return node;
+        }
+        previous = node;
+        node = tree_.successor(node);
+    }
+    return tree_.lowerBound(key);
+}
+
+template<typename Tree>
+void TreeService<Tree>::apply(Request* request, Node*& node, Node*& finger, Node* previous)
+{
+    bool found{ node != tree_.nil() };
+    if (request->operation_ == Operation::Contains)
+    {
+        reply<bool>(request, found);
+    }
+    else if (request->operation_ == Operation::Find)
+    {
+        reply<std::pair<bool, mapped_type>>(request, found ? std::pair<bool, mapped_type>{ true, node->value_ }
+                                                           : std::pair<bool, mapped_type>{ false, mapped_type{} });
+    }
+    else if (request->operation_ == Operation::Insert)
+    {
+        if (not found)
+        {
+            node = tree_.insert(previous, value_type{ request->key_, request->value_ });
+            size_.store(tree_.size(), std::memory_order_relaxed);
+        }
+        reply<bool>(request, not found);
+    }
+    else
+    {
+        if (found)
+        {
+            finger = tree_.successor(node);
+            tree_.erase(node);
+            node = tree_.nil();
+            size_.store(tree_.size(), std::memory_order_relaxed);
+        }
+        reply<size_type>(request, found ? 1 : 0);
+    }
+}
+
+template<typename Tree>
+template<typename Result>
+void TreeService<Tree>::reply(Request* request, const Result& result)
+{
+    Reply<Result>* typed{ static_cast<Reply<Result>*>(request) };
+    auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - typed->submitted_);
+    unsigned long long nanoseconds{ static_cast<unsigned long long>(latency.count()) };
+    latency_.fetch_add(nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds > maxLatency_.load(std::memory_order_relaxed))
+    {
+        maxLatency_.store(nanoseconds, std::memory_order_relaxed);
+    }
+    typed->promise_.set_value(result);
+    delete typed;
+}
+
+#endif // TREESERVICE_CPP
@@ -0,0 +1,151 @@
+// Asynchronous service that executes the requests to a search tree in batches
+//
+// Implementation is based on D. Hendler, I. Incze, N. Shavit, M. Tzafrir, Flat
+// combining and the synchronization-parallelism tradeoff, Proceedings of the 22nd
+// ACM Symposium on Parallelism in Algorithms and Architectures, 2010, pp. 355-364,
+// and D. Vyukov, Intrusive MPSC node-based queue, 2010
+//
+// The service owns a tree such as RedBlackTree or AVLTree, and only its own thread
+// uses the tree. The calls do not wait for the tree. They push a request to a lock-free
+// multi-producer single-consumer queue and return a future of the result.
+//
+// The service thread takes up to MAX_BATCH requests at a time and stable sorts them
+// by key, so the requests for the same key stay in the order they were queued and
+// the result is the same as if the requests had been executed one by one in the
+// order of the queue. Each distinct key is looked up once for all of its requests.
+// The keys come in order, so the lookup first walks a few nodes forward from a finger
+// that follows the previous key, the inserts use the node before the key as their
+// hint, and the erases remove the located node without searching for it again.
+//
+// The service counts the requests, batches and distinct keys, and the latencies from
+// the call that made a request to the moment its future is fulfilled.
+
+#ifndef TREESERVICE_HH
+#define TREESERVICE_HH
+
+#include "mpscqueue.hh"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template<typename Tree>
+class TreeService
+{
+public:
+    using key_type = typename Tree::key_type;
+    using mapped_type = typename Tree::mapped_type;
+    using value_type = typename Tree::value_type;
+    using size_type = typename Tree::size_type;
+
+    // The most requests that are executed in one batch
+    const static size_type MAX_BATCH = 256;
+    // How many nodes a lookup walks forward from the finger before it searches
+    // from the root
+    const static int FINGER_STEPS = 8;
+    // How many times an idle service checks for requests before it sleeps
+    const static int IDLE_SPINS = 64;
+
+    // The counters since the service was started. The throughput is requests_
+    // divided by uptime_, and the average latency is latency_ divided by requests_.
+    struct Counters
+    {
+        unsigned long long requests_;
+        unsigned long long batches_;
+        // The number of distinct keys in the batches
+        unsigned long long keys_;
+        // The sum of the latencies of the requests in nanoseconds
+        unsigned long long latency_;
+        unsigned long long maxLatency_;
+        unsigned long long uptime_;
+    };
+
+    TreeService();
+    TreeService(const TreeService&) = delete;
+    TreeService& operator=(const TreeService&) = delete;
+    // Executes the queued requests before it returns. No request may be made
+    // after the destruction has started.
+    ~TreeService();
+
+    // The number of keys after the last executed write
+    size_type size() const;
+    Counters counters() const;
+
+    std::future<bool> contains(const key_type& key);
+    // The future holds false and a default value if the key is not in the tree
+    std::future<std::pair<bool, mapped_type>> find(const key_type& key);
+    std::future<bool> insert(const value_type& value);
+    std::future<size_type> erase(const key_type& key);
+
+private:
+    using Node = typename Tree::node_type;
+    using Clock = std::chrono::steady_clock;
+
+    enum class Operation
+    {
+        Contains,
+        Find,
+        Insert,
+        Erase
+    };
+
+    struct Request : MpscLink
+    {
+        Operation operation_;
+        key_type key_;
+        mapped_type value_;
+        Clock::time_point submitted_;
+    };
+
+    // The operation of a request tells the type of its result
+    template<typename Result>
+    struct Reply : Request
+    {
+        std::promise<Result> promise_;
+    };
+
+    Tree tree_;
+    typename Tree::key_compare compare_;
+    MpscQueue<Request> queue_;
+    Clock::time_point started_;
+
+    alignas(64) std::atomic<unsigned int> pending_;
+    std::atomic<bool> sleeping_;
+    std::atomic<bool> stop_;
+    std::mutex sleepMutex_;
+    std::condition_variable wakeup_;
+
+    // Only written by the service thread
+    alignas(64) std::atomic<size_type> size_;
+    std::atomic<unsigned long long> requests_;
+    std::atomic<unsigned long long> batches_;
+    std::atomic<unsigned long long> keys_;
+    std::atomic<unsigned long long> latency_;
+    std::atomic<unsigned long long> maxLatency_;
+
+    std::thread worker_;
+
+    template<typename Result>
+    std::future<Result> submit(Operation operation, const key_type& key, const mapped_type& value);
+    void work();
+    void execute(std::vector<Request*>& batch);
+    // Returns the first node whose key is not less than key, walking forward from
+    // finger, whose key must not be greater than that. Moves previous to the last
+    // node passed on the way.
+    Node* locate(Node* finger, const key_type& key, Node*& previous) const;
+    // Applies the request to the node of its key, which is nil if the key is not in
+    // the tree, and fulfils and frees the request. An erase moves the finger to the
+    // successor of the node before it removes the node. The inserts use previous,
+    // whose key is less than the key of the request, as their hint.
+    void apply(Request* request, Node*& node, Node*& finger, Node* previous);
+    template<typename Result>
+    void reply(Request* request, const Result& result);
+};
+
+#include "treeservice.cpp"
+
+#endif // TREESERVICE_HH
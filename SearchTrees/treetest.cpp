@@ -6,12 +6,47 @@
 #include "randomvalue.hh"
 #include "timer.hh"
 #include <algorithm>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <string_view>
+
+namespace
+{
+
+// The keys of a test and the values stored with them
+struct KeyValues
+{
+    std::vector<key_type> keys_;
+    std::vector<data_type> values_;
+};
+
+// Returns the values stored with the keys: each value is its key as a string
+std::vector<data_type> makeValues(const std::vector<key_type>& keys)
+{
+    std::vector<data_type> values;
+    for (auto key : keys)
+    {
+        values.push_back(std::to_string(key));
+    }
+    return values;
+}
+
+// Generates n uniformly distributed keys and the values stored with them
+KeyValues makeKeyValues(const RandomValue& generator, int n, bool distinct = true)
+{
+    auto keys{ generator.getValues(n, RandomType::uniform, distinct) };
+    auto values{ makeValues(keys) };
+    return KeyValues{ keys, values };
+}
+
+} // namespace
 
 TreeTest::TreeTest() :
-    trees_{}
+    trees_{},
+    sets_{},
+    lists_{}
 {
 }
 
@@ -33,17 +68,415 @@ std::vector<TestTime> TreeTest::test(int n)
                                 testData.searchKeys1, testData.searchKeys2,
                                 testData.searchKeys3, testData.searchKeysAll,
                                 testData.deleteKeys1, testData.deleteKeys2);
-        for (auto value : testData.insertKeys1)
+        testData.insertData1 = makeValues(testData.insertKeys1);
+        testData.insertData2 = makeValues(testData.insertKeys2);
+
+        // Run the current test for each container in tuples trees_, sets_ and lists_.
+        runTest_for_each(trees_, tests, testData);
+        runTest_for_each(sets_, tests, testData);
+        runTest_for_each(lists_, tests, testData);
+    }
+    return tests;
+}
+
+std::vector<LatencyTime> TreeTest::testLatency(int n)
+{
+    RandomValue generator{ 10*n };
+    std::vector<LatencyTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Latency:" << "Generating data" << std::endl;
+    auto data{ makeKeyValues(generator, n) };
+
+    rbt_tree eager;
+    relaxed_tree relaxed;
+    for (auto burst : LATENCY_BURSTS)
+    {
+        std::cout << std::setw(9) << " " << getDescription<rbt_tree>().name_ << std::endl;
+        tests.push_back(insertLatency(eager, data.keys_, data.values_, burst));
+        std::cout << std::setw(9) << " " << getDescription<relaxed_tree>().name_ << std::endl;
+        tests.push_back(insertLatency(relaxed, data.keys_, data.values_, burst));
+    }
+    return tests;
+}
+
+std::vector<QueueTime> TreeTest::testQueue(int n)
+{
+    std::vector<QueueTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Queue:" << "Increasing keys" << std::endl;
+    forEachContainer(trees_, [&tests, n](auto& container)
+    {
+        auto newTest{ runQueueTest(container, n) };
+        if (newTest.n_ > 0)
+        {
+            tests.push_back(newTest);
+        }
+    });
+    return tests;
+}
+
+std::vector<ScanTime> TreeTest::testScan(int n)
+{
+    RandomValue generator{ 10*n };
+    std::vector<ScanTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Scan:" << "Generating data" << std::endl;
+    auto data{ makeKeyValues(generator, n) };
+    auto starts{ generator.getValues(n / (RANGE_SCAN_LENGTH / 10), RandomType::uniform) };
+
+    std::tuple<rbt_tree, threaded_rbt_tree, avl_tree, threaded_avl_tree,
+               aa_tree, threaded_aa_tree, map_tree, skiplist_tree, sharded_rbt_tree> trees;
+    forEachContainer(trees, [&](auto& container)
+    {
+        tests.push_back(runScanTest(container, data.keys_, data.values_, starts));
+    });
+    return tests;
+}
+
+std::vector<RekeyTime> TreeTest::testRekey(int n)
+{
+    RandomValue generator{ 10*n };
+    std::vector<RekeyTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Rekey:" << "Generating data" << std::endl;
+    auto data{ makeKeyValues(generator, n) };
+
+    // The generated keys are smaller than 10*n, so the new keys never collide with them
+    forEachContainer(trees_, [&](auto& container)
+    {
+        tests.push_back(runRekeyTest(container, data.keys_, data.values_, 10*n));
+    });
+    return tests;
+}
+
+std::vector<StringTime> TreeTest::testString(int n)
+{
+    RandomValue generator{ 10*n };
+    std::vector<StringTime> tests;
+
+    std::cout << std::setw(9) << std::left << "String:" << "Generating data" << std::endl;
+    auto numbers{ generator.getValues(n, RandomType::uniform) };
+    auto searchNumbers{ numbers };
+    generator.permutate(searchNumbers);
+
+    // The keys are longer than the small string buffer, so every
+    // temporary key allocates memory
+    auto makeKey = [](int value)
+    {
+        char key[32];
+        std::snprintf(key, sizeof(key), "customer/%010d/profile", value);
+        return string_key_type{ key };
+    };
+
+    std::vector<string_key_type> keys;
+    for (auto value : numbers)
+    {
+        keys.push_back(makeKey(value));
+    }
+    auto values{ makeValues(numbers) };
+
+    // The probes view the search keys, as if they were parsed from an input buffer
+    std::vector<string_key_type> searchKeys;
+    for (auto value : searchNumbers)
+    {
+        searchKeys.push_back(makeKey(value));
+    }
+    std::vector<std::string_view> probes{ searchKeys.begin(), searchKeys.end() };
+
+    std::tuple<string_rbt_tree, transparent_rbt_tree, string_avl_tree, transparent_avl_tree,
+               string_map_tree, transparent_map_tree> trees;
+    forEachContainer(trees, [&](auto& container)
+    {
+        tests.push_back(runStringTest(container, keys, values, probes));
+    });
+    return tests;
+}
+
+std::vector<StringTime> TreeTest::testPrefix(int n)
+{
+    RandomValue generator{ 10*n };
+    std::vector<StringTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Prefix:" << "Generating data" << std::endl;
+    auto numbers{ generator.getValues(n, RandomType::uniform) };
+    auto searchNumbers{ numbers };
+    generator.permutate(searchNumbers);
+
+    // The keys start with a hash of the number, so that most of them
+    // differ already in the first eight bytes
+    auto makeKey = [](int value)
+    {
+        char key[32];
+        std::snprintf(key, sizeof(key), "%016llx/profile",
+                      static_cast<unsigned long long>(value) * 0x9E3779B97F4A7C15ull);
+        return string_key_type{ key };
+    };
+
+    std::vector<string_key_type> keys;
+    std::vector<prefix_key_type> prefixKeys;
+    for (auto value : numbers)
+    {
+        keys.push_back(makeKey(value));
+        prefixKeys.push_back(prefix_key_type{ keys.back() });
+    }
+    auto values{ makeValues(numbers) };
+
+    std::vector<string_key_type> searchKeys;
+    for (auto value : searchNumbers)
+    {
+        searchKeys.push_back(makeKey(value));
+    }
+    std::vector<std::string_view> probes{ searchKeys.begin(), searchKeys.end() };
+    std::vector<PrefixView> prefixProbes;
+    for (auto probe : probes)
+    {
+        prefixProbes.push_back(PrefixView{ probe });
+    }
+
+    std::tuple<transparent_rbt_tree, transparent_avl_tree, transparent_map_tree> trees;
+    forEachContainer(trees, [&](auto& container)
+    {
+        tests.push_back(runStringTest(container, keys, values, probes));
+    });
+    std::tuple<prefix_rbt_tree, prefix_avl_tree, prefix_map_tree> prefixTrees;
+    forEachContainer(prefixTrees, [&](auto& container)
+    {
+        tests.push_back(runStringTest(container, prefixKeys, values, prefixProbes));
+    });
+    return tests;
+}
+
+std::vector<MultiTime> TreeTest::testMulti(int n)
+{
+    // The keys are drawn with replacement from a range that is smaller than n,
+    // so that each key has MULTI_DUPLICATES entries on average
+    RandomValue generator{ std::max(1, n / MULTI_DUPLICATES) };
+    std::vector<MultiTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Multi:" << "Generating data" << std::endl;
+    auto data{ makeKeyValues(generator, n, false) };
+    auto probes{ generator.getValues(generator.count(), RandomType::uniform) };
+
+    std::tuple<multi_rbt_tree, multi_avl_tree, multi_aa_tree, multi_bst_tree, multimap_tree> trees;
+    forEachContainer(trees, [&](auto& container)
+    {
+        tests.push_back(runMultiTest(container, data.keys_, data.values_, probes));
+    });
+    return tests;
+}
+
+std::vector<AggregateTime> TreeTest::testAggregate(int n)
+{
+    RandomValue generator{ 10*n };
+    std::vector<AggregateTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Sum:" << "Generating data" << std::endl;
+    auto keys{ generator.getValues(n, RandomType::uniform) };
+    auto starts{ generator.getValues(std::max(1, n / 100), RandomType::uniform) };
+
+    std::tuple<sum_rbt_tree, sum_avl_tree, sum_aa_tree, sum_map_tree> trees;
+    for (auto width : AGGREGATE_WIDTHS)
+    {
+        forEachContainer(trees, [&](auto& container)
+        {
+            tests.push_back(runAggregateTest(container, keys, starts, width));
+        });
+    }
+    return tests;
+}
+
+std::vector<IntervalTime> TreeTest::testInterval(int n)
+{
+    RandomValue generator{ 10*n };
+    RandomValue lengthGenerator{ 0, INTERVAL_LENGTH };
+    std::vector<IntervalTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Interval:" << "Generating data" << std::endl;
+    auto lows{ generator.getValues(n, RandomType::uniform, false) };
+    auto lengths{ lengthGenerator.getValues(n, RandomType::uniform, false) };
+    auto points{ generator.getValues(std::max(1, n / 100), RandomType::uniform) };
+
+    std::tuple<interval_tree, interval_map_tree> trees;
+    forEachContainer(trees, [&](auto& container)
+    {
+        tests.push_back(runIntervalTest(container, lows, lengths, points));
+    });
+    return tests;
+}
+
+std::vector<PersistentTime> TreeTest::testPersistent(int n)
+{
+    RandomValue generator{ 10*n };
+    std::vector<PersistentTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Persist:" << "Generating data" << std::endl;
+    auto data{ makeKeyValues(generator, n) };
+    auto eraseKeys{ data.keys_ };
+    generator.permutate(eraseKeys);
+
+    std::tuple<persistent_avl_tree, avl_tree, rbt_tree> trees;
+    forEachContainer(trees, [&](auto& container)
+    {
+        tests.push_back(runPersistentTest(container, data.keys_, data.values_, eraseKeys));
+    });
+    return tests;
+}
+
+std::vector<ConcurrentTime> TreeTest::testConcurrent(int n)
+{
+    // Half of the keys in the range are in the container at the start
+    RandomValue generator{ 2*n };
+    std::vector<ConcurrentTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Threads:" << "Generating data" << std::endl;
+    auto keys{ generator.getValues(n, RandomType::uniform) };
+
+    std::tuple<mutex_rbt_tree, rw_rbt_tree, optimistic_rbt_tree, striped_rbt_tree, fc_rbt_tree,
+               mutex_avl_tree, rw_avl_tree, optimistic_avl_tree, striped_avl_tree, fc_avl_tree,
+               mutex_aa_tree, fc_aa_tree,
+               sharded_rbt_tree, delegated_rbt_tree, sharded_avl_tree, delegated_avl_tree,
+               lockfree_tree, concurrent_avl_tree, skiplist_tree, LockedMap> trees;
+    for (auto reads : CONCURRENT_READS)
+    {
+        for (auto threads : threadCounts())
+        {
+            forEachContainer(trees, [&](auto& container)
+            {
+                tests.push_back(runConcurrentTest(container, keys, 2*n, n, threads, reads));
+            });
+        }
+    }
+    return tests;
+}
+
+std::vector<ReclamationTime> TreeTest::testReclamation(int n)
+{
+    std::vector<ReclamationTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Reclaim:" << "Retiring nodes" << std::endl;
+    std::tuple<DeleteReclaimer, EpochReclaimer, PooledReclaimer> reclaimers;
+    for (auto threads : RECLAMATION_THREADS)
+    {
+        forEachContainer(reclaimers, [&](auto& reclaimer)
+        {
+            tests.push_back(runReclamationTest(reclaimer, n, threads));
+        });
+    }
+    return tests;
+}
+
+// The locked tree uses the exclusive mode, because the reader-writer lock prefers
+// the readers, and the scanners could keep the writer out for good
+std::vector<SnapshotTime> TreeTest::testSnapshot(int n)
+{
+    // Half of the keys in the range are in the container at the start
+    RandomValue generator{ 2*n };
+    std::vector<SnapshotTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Snapshot:" << "Generating data" << std::endl;
+    auto keys{ generator.getValues(n, RandomType::uniform) };
+
+    std::tuple<mutex_rbt_tree, mvcc_rbt_tree> trees;
+    for (auto scanners : SNAPSHOT_SCANNERS)
+    {
+        forEachContainer(trees, [&](auto& container)
+        {
+            tests.push_back(runSnapshotTest(container, keys, 2*n, n, scanners));
+        });
+    }
+    return tests;
+}
+
+// The scaling efficiency compares each thread count with one thread on the same
+// container, mix and sharing, which is always run first
+std::vector<ScalingTime> TreeTest::testScaling(int n)
+{
+    // Half of the keys in the range are in the container at the start
+    RandomValue generator{ 2*n };
+    std::vector<ScalingTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Scaling:" << "Generating data" << std::endl;
+    auto keys{ generator.getValues(n, RandomType::uniform) };
+
+    auto scale = [&](auto& container, const OperationMix& mix, ContainerSharing sharing)
+    {
+        double single{ 0.0 };
+        for (auto threads : scalingThreads())
         {
-            testData.insertData1.push_back(std::to_string(value));
+            auto test{ runScalingTest(container, keys, 2*n, n, threads, mix, sharing) };
+            if (threads == 1)
+            {
+                single = test.mops_;
+            }
+            test.efficiency_ = (single > 0.0) ? test.mops_ / (threads * single) : 0.0;
+            tests.push_back(test);
         }
-        for (auto value : testData.insertKeys2)
+    };
+
+    std::tuple<rw_rbt_tree, sharded_rbt_tree, skiplist_tree, mvcc_rbt_tree> sharedTrees;
+    std::tuple<rbt_tree, rw_rbt_tree> ownTrees;
+    for (auto& mix : SCALING_MIXES)
+    {
+        forEachContainer(sharedTrees, [&](auto& container)
+        {
+            scale(container, mix, ContainerSharing::Shared);
+        });
+        forEachContainer(ownTrees, [&](auto& container)
         {
-            testData.insertData2.push_back(std::to_string(value));
+            scale(container, mix, ContainerSharing::PerThread);
+        });
+    }
+    return tests;
+}
+
+std::vector<ServiceTime> TreeTest::testService(int n)
+{
+    // Half of the keys in the range are in the tree at the start
+    RandomValue generator{ 2*n };
+    std::vector<ServiceTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Service:" << "Generating data" << std::endl;
+    auto keys{ generator.getValues(n, RandomType::uniform) };
+
+    for (auto producers : SERVICE_PRODUCERS)
+    {
+        for (auto window : SERVICE_WINDOWS)
+        {
+            tests.push_back(runServiceTest<service_rbt_tree>(keys, 2*n, n, producers, window));
+            tests.push_back(runServiceTest<service_avl_tree>(keys, 2*n, n, producers, window));
         }
+    }
+    return tests;
+}
 
-        // Run the current test for each container in tuple trees_.
-        runTest_for_each(trees_, tests, testData);
+std::vector<CompareTime> TreeTest::testCompare(int n)
+{
+    RandomValue generator{ 10*n };
+    std::vector<CompareTime> tests;
+
+    std::cout << std::setw(9) << std::left << "Compare:" << "Generating data" << std::endl;
+    auto numbers{ generator.getValues(n, RandomType::uniform) };
+    auto searchNumbers{ numbers };
+    generator.permutate(searchNumbers);
+
+    std::vector<CountedKey> keys;
+    for (auto value : numbers)
+    {
+        keys.push_back(CountedKey{ value });
+    }
+    auto values{ makeValues(numbers) };
+    std::vector<CountedKey> searchKeys;
+    for (auto value : searchNumbers)
+    {
+        searchKeys.push_back(CountedKey{ value });
     }
+
+    std::tuple<counted_bst_tree, threeway_bst_tree, counted_rbt_tree, threeway_rbt_tree,
+               counted_avl_tree, threeway_avl_tree, counted_aa_tree, threeway_aa_tree,
+               counted_map_tree> trees;
+    forEachContainer(trees, [&](auto& container)
+    {
+        tests.push_back(runCompareTest(container, keys, values, searchKeys));
+    });
     return tests;
 }
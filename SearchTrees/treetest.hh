@@ -8,6 +8,7 @@
 #include "randomvalue.hh"
 #include "treetesthelper.hh"
 #include <map>
+#include <set>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -37,6 +38,9 @@ const std::vector<Test> TEST_LIST
     { "F", true, RandomType::uniform, RandomType::uniform }
 };
 
+// The burst sizes used in the insert latency test
+const std::vector<int> LATENCY_BURSTS{ 100, 10000 };
+
 class TreeTest
 {
 public:
@@ -44,9 +48,50 @@ public:
 
     // Runs the tests with the given value of n
     std::vector<TestTime> test(int n);
+    // Runs the insert latency test for the eager and the relaxed red black tree
+    std::vector<LatencyTime> testLatency(int n);
+    // Runs the priority queue test for each balanced container
+    std::vector<QueueTime> testQueue(int n);
+    // Runs the scan test for the plain and the threaded trees and the skip list
+    std::vector<ScanTime> testScan(int n);
+    // Runs the re-keying test for each container
+    std::vector<RekeyTime> testRekey(int n);
+    // Runs the string lookup test for the plain and the transparent string containers
+    std::vector<StringTime> testString(int n);
+    // Runs the string lookup test for the plain and the prefix key string containers
+    std::vector<StringTime> testPrefix(int n);
+    // Runs the multimap test with duplicate keys for the multimap containers
+    std::vector<MultiTime> testMulti(int n);
+    // Runs the range aggregate test for the trees with subtree sums
+    std::vector<AggregateTime> testAggregate(int n);
+    // Runs the interval query test for the interval tree and a multimap of intervals
+    std::vector<IntervalTime> testInterval(int n);
+    // Runs the snapshot test for the persistent and the mutable AVL and red black trees
+    std::vector<PersistentTime> testPersistent(int n);
+    // Runs the concurrent test for the thread-safe trees with different thread
+    // counts and read percentages
+    std::vector<ConcurrentTime> testConcurrent(int n);
+    // Runs the reclamation test for immediate delete and the epoch-based reclamation
+    // with and without a node pool with different thread counts
+    std::vector<ReclamationTime> testReclamation(int n);
+    // Runs the snapshot test for the locked and the multi-version red black trees
+    // with different numbers of scanners alongside one writer
+    std::vector<SnapshotTime> testSnapshot(int n);
+    // Runs the scaling test for the shared thread-safe containers and the per-thread
+    // containers with every operation mix and every thread count
+    std::vector<ScalingTime> testScaling(int n);
+    // Runs the service test for the red black and the AVL tree services with
+    // different numbers of producers and request windows
+    std::vector<ServiceTime> testService(int n);
+    // Runs the comparison count test for the two-way and the three-way comparators
+    std::vector<CompareTime> testCompare(int n);
 
 private:
-    std::tuple<rbt_tree, avl_tree, aa_tree, bst_tree, map_tree> trees_;
+    std::tuple<rbt_tree, avl_tree, wavl_tree, aa_tree, wbt_tree, sgt_tree, bst_tree, map_tree> trees_;
+    // The set versions of the containers, which are only used in the main tests
+    std::tuple<set_rbt_tree, set_avl_tree, set_aa_tree, set_bst_tree, set_tree> sets_;
+    // The thread-safe containers that are not trees, which are only used in the main tests
+    std::tuple<skiplist_tree> lists_;
 };
 
 #endif // TREETEST_HH
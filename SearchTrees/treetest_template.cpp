@@ -3,7 +3,16 @@
 
 #include "timer.hh"
 #include "treetest.hh"
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
 #include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -60,145 +69,1920 @@ int getHeight(const Container& container)
     return heightStruct.height_;
 }
 
+template<typename T>
+struct get_rotations_result
+{
+private:
+    template<typename X>
+    static auto check(X const& x) -> decltype(x.rotations());
+    static substitution_failure check(...);
+public:
+    using type = decltype(check(std::declval<T>()));
+};
+
+template<typename T>
+struct has_rotations : substitution_succeeded<typename get_rotations_result<T>::type>
+{};
+
+template<typename T>
+constexpr bool Has_rotations()
+{
+    return has_rotations<T>::value;
+}
+
+template<typename Container, bool C = Has_rotations<Container>()>
+struct RotationsStruct
+{
+    long long rotations_;
+    RotationsStruct<Container, C>(const Container& container) :
+        rotations_{ static_cast<long long>(container.rotations()) } {}
+};
+
+template<typename Container>
+struct RotationsStruct<Container, false>
+{
+    long long rotations_;
+    RotationsStruct<Container, false>(const Container&) : rotations_{ -1 } {}
+};
+
+template<typename Container>
+long long getRotations(const Container& container)
+{
+    RotationsStruct<Container, Has_rotations<Container>()> rotationsStruct{ container };
+    return rotationsStruct.rotations_;
+}
+
+// Returns the average number of rotations per operation since rotationsBefore was taken,
+// or -1 if the container does not count its rotations
+template<typename Container>
+double getRotationRate(const Container& container, long long rotationsBefore, size_t operations)
+{
+    if (rotationsBefore < 0 or operations == 0)
+    {
+        return -1.0;
+    }
+    return static_cast<double>(getRotations(container) - rotationsBefore) / operations;
+}
+
+template<typename T>
+struct get_rebalance_result
+{
+private:
+    template<typename X>
+    static auto check(X& x) -> decltype(x.rebalance());
+    static substitution_failure check(...);
+public:
+    using type = decltype(check(std::declval<T&>()));
+};
+
+template<typename T>
+struct has_rebalance : substitution_succeeded<typename get_rebalance_result<T>::type>
+{};
+
+template<typename T>
+constexpr bool Has_rebalance()
+{
+    return has_rebalance<T>::value;
+}
+
+template<typename Container, bool C = Has_rebalance<Container>()>
+struct RebalanceStruct
+{
+    RebalanceStruct<Container, C>(Container& container) { container.rebalance(); }
+};
+
+template<typename Container>
+struct RebalanceStruct<Container, false>
+{
+    RebalanceStruct<Container, false>(Container&) {}
+};
+
+// Runs the deferred rebalancing of the container, if it has one
+template<typename Container>
+void rebalanceContainer(Container& container)
+{
+    RebalanceStruct<Container, Has_rebalance<Container>()> rebalanceStruct{ container };
+}
+
+template<typename T>
+struct get_popMin_result
+{
+private:
+    template<typename X>
+    static auto check(X& x) -> decltype(x.popMin());
+    static substitution_failure check(...);
+public:
+    using type = decltype(check(std::declval<T&>()));
+};
+
+template<typename T>
+struct has_popMin : substitution_succeeded<typename get_popMin_result<T>::type>
+{};
+
+template<typename T>
+constexpr bool Has_popMin()
+{
+    return has_popMin<T>::value;
+}
+
+template<typename Container, bool C = Has_popMin<Container>()>
+struct PopMinStruct
+{
+    PopMinStruct<Container, C>(Container& container) { container.popMin(); }
+};
+
+template<typename Container>
+struct PopMinStruct<Container, false>
+{
+    PopMinStruct<Container, false>(Container& container) { container.erase(container.begin()); }
+};
+
+// Removes the smallest key from the container, which must not be empty
+template<typename Container>
+void popMinimum(Container& container)
+{
+    PopMinStruct<Container, Has_popMin<Container>()> popMinStruct{ container };
+}
+
+template<typename T, typename Key>
+struct get_find_result
+{
+private:
+    template<typename X>
+    static auto check(X const& x, Key const& key) -> decltype(x.find(key));
+    static substitution_failure check(...);
+public:
+    using type = decltype(check(std::declval<T>(), std::declval<Key>()));
+};
+
+template<typename T, typename Key>
+struct has_find : substitution_succeeded<typename get_find_result<T, Key>::type>
+{};
+
+template<typename T, typename Key>
+constexpr bool Has_find()
+{
+    return has_find<T, Key>::value;
+}
+
+template<typename Container, typename Key, bool C = Has_find<Container, Key>()>
+struct FindStruct
+{
+    bool found_;
+    FindStruct<Container, Key, C>(const Container& container, const Key& key) :
+        found_{ container.find(key) != notFound(container) } {}
+};
+
+template<typename Container, typename Key>
+struct FindStruct<Container, Key, false>
+{
+    bool found_;
+    FindStruct<Container, Key, false>(const Container& container, const Key& key) :
+        found_{ container.find(typename Container::key_type{ key }) != notFound(container) } {}
+};
+
+// Searches the container for the key and returns whether it was found. If the
+// container cannot be searched with the key type directly, a temporary key_type
+// is constructed from the key.
+template<typename Container, typename Key>
+bool findKey(const Container& container, const Key& key)
+{
+    FindStruct<Container, Key, Has_find<Container, Key>()> findStruct{ container, key };
+    return findStruct.found_;
+}
+
+// Returns true if the container is a set, whose values are just the keys
+template<typename Container>
+constexpr bool Is_set()
+{
+    return std::is_same<typename Container::key_type, typename Container::value_type>::value;
+}
+
+template<typename Container, typename Key, typename Value, bool C = Is_set<Container>()>
+struct InsertStruct
+{
+    InsertStruct<Container, Key, Value, C>(Container& container, const Key& key, const Value&)
+    {
+        container.insert(key);
+    }
+};
+
+template<typename Container, typename Key, typename Value>
+struct InsertStruct<Container, Key, Value, false>
+{
+    InsertStruct<Container, Key, Value, false>(Container& container, const Key& key, const Value& value)
+    {
+        container.insert(std::pair<Key, Value>{ key, value });
+    }
+};
+
+// Inserts the key and the value to a map, or only the key to a set
+template<typename Container, typename Key, typename Value>
+void insertEntry(Container& container, const Key& key, const Value& value)
+{
+    InsertStruct<Container, Key, Value, Is_set<Container>()> insertStruct{ container, key, value };
+}
+
+template<typename Container>
+ContainerDescription getDescription()
+{
+    if (std::is_same<Container, rbt_tree>::value)
+    {
+        return ContainerDescription{ "Red Black Tree", "RBT", true };
+    }
+    else if (std::is_same<Container, relaxed_tree>::value)
+    {
+        return ContainerDescription{ "Relaxed Red Black Tree", "RRBT", true };
+    }
+    else if (std::is_same<Container, avl_tree>::value)
+    {
+        return ContainerDescription{ "AVL Tree", "AVL", true };
+    }
+    else if (std::is_same<Container, wavl_tree>::value)
+    {
+        return ContainerDescription{ "WAVL Tree", "WAVL", true };
+    }
+    else if (std::is_same<Container, aa_tree>::value)
+    {
+        return ContainerDescription{ "AA Tree", "AA", true };
+    }
+    else if (std::is_same<Container, wbt_tree>::value)
+    {
+        return ContainerDescription{ "Weight Balanced Tree", "WBT", true };
+    }
+    else if (std::is_same<Container, sgt_tree>::value)
+    {
+        return ContainerDescription{ "Scapegoat Tree", "SGT", true };
+    }
+    else if (std::is_same<Container, bst_tree>::value)
+    {
+        return ContainerDescription{ "Binary Search Tree", "BST", false };
+    }
+    else if (std::is_same<Container, map_tree>::value)
+    {
+        return ContainerDescription{ "std::map", "MAP", true };
+    }
+    else if (std::is_same<Container, threaded_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Threaded Red Black Tree", "TRBT", true };
+    }
+    else if (std::is_same<Container, threaded_avl_tree>::value)
+    {
+        return ContainerDescription{ "Threaded AVL Tree", "TAVL", true };
+    }
+    else if (std::is_same<Container, threaded_aa_tree>::value)
+    {
+        return ContainerDescription{ "Threaded AA Tree", "TAA", true };
+    }
+    else if (std::is_same<Container, set_bst_tree>::value)
+    {
+        return ContainerDescription{ "Binary Search Tree Set", "BSTS", false };
+    }
+    else if (std::is_same<Container, set_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Red Black Tree Set", "RBTS", true };
+    }
+    else if (std::is_same<Container, set_avl_tree>::value)
+    {
+        return ContainerDescription{ "AVL Tree Set", "AVLS", true };
+    }
+    else if (std::is_same<Container, set_aa_tree>::value)
+    {
+        return ContainerDescription{ "AA Tree Set", "AAS", true };
+    }
+    else if (std::is_same<Container, set_tree>::value)
+    {
+        return ContainerDescription{ "std::set", "SET", true };
+    }
+    else if (std::is_same<Container, multi_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Red Black Tree Multimap", "RBTM", true };
+    }
+    else if (std::is_same<Container, multi_avl_tree>::value)
+    {
+        return ContainerDescription{ "AVL Tree Multimap", "AVLM", true };
+    }
+    else if (std::is_same<Container, multi_aa_tree>::value)
+    {
+        return ContainerDescription{ "AA Tree Multimap", "AAM", true };
+    }
+    else if (std::is_same<Container, multi_bst_tree>::value)
+    {
+        return ContainerDescription{ "Binary Search Tree Multimap", "BSTM", false };
+    }
+    else if (std::is_same<Container, multimap_tree>::value)
+    {
+        return ContainerDescription{ "std::multimap", "MMAP", true };
+    }
+    else if (std::is_same<Container, sum_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Red Black Tree with Subtree Sums", "ARBT", true };
+    }
+    else if (std::is_same<Container, sum_avl_tree>::value)
+    {
+        return ContainerDescription{ "AVL Tree with Subtree Sums", "AAVL", true };
+    }
+    else if (std::is_same<Container, sum_aa_tree>::value)
+    {
+        return ContainerDescription{ "AA Tree with Subtree Sums", "AAA", true };
+    }
+    else if (std::is_same<Container, sum_map_tree>::value)
+    {
+        return ContainerDescription{ "std::map of Sums", "AMAP", true };
+    }
+    else if (std::is_same<Container, interval_tree>::value)
+    {
+        return ContainerDescription{ "Interval Tree", "ITV", true };
+    }
+    else if (std::is_same<Container, interval_map_tree>::value)
+    {
+        return ContainerDescription{ "std::multimap of Intervals", "IMAP", true };
+    }
+    else if (std::is_same<Container, persistent_avl_tree>::value)
+    {
+        return ContainerDescription{ "Persistent AVL Tree", "FAVL", true };
+    }
+    else if (std::is_same<Container, rw_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Reader-Writer Locked Red Black Tree", "RWRB", true };
+    }
+    else if (std::is_same<Container, optimistic_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Optimistic Read Red Black Tree", "OPRB", true };
+    }
+    else if (std::is_same<Container, striped_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Lock Striped Red Black Tree", "STRB", true };
+    }
+    else if (std::is_same<Container, rw_avl_tree>::value)
+    {
+        return ContainerDescription{ "Reader-Writer Locked AVL Tree", "RWAV", true };
+    }
+    else if (std::is_same<Container, optimistic_avl_tree>::value)
+    {
+        return ContainerDescription{ "Optimistic Read AVL Tree", "OPAV", true };
+    }
+    else if (std::is_same<Container, striped_avl_tree>::value)
+    {
+        return ContainerDescription{ "Lock Striped AVL Tree", "STAV", true };
+    }
+    else if (std::is_same<Container, mutex_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Mutex Locked Red Black Tree", "MXRB", true };
+    }
+    else if (std::is_same<Container, mutex_avl_tree>::value)
+    {
+        return ContainerDescription{ "Mutex Locked AVL Tree", "MXAV", true };
+    }
+    else if (std::is_same<Container, mutex_aa_tree>::value)
+    {
+        return ContainerDescription{ "Mutex Locked AA Tree", "MXAA", true };
+    }
+    else if (std::is_same<Container, fc_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Flat Combining Red Black Tree", "FCRB", true };
+    }
+    else if (std::is_same<Container, fc_avl_tree>::value)
+    {
+        return ContainerDescription{ "Flat Combining AVL Tree", "FCAV", true };
+    }
+    else if (std::is_same<Container, fc_aa_tree>::value)
+    {
+        return ContainerDescription{ "Flat Combining AA Tree", "FCAA", true };
+    }
+    else if (std::is_same<Container, lockfree_tree>::value)
+    {
+        return ContainerDescription{ "Lock-Free External Binary Search Tree", "LFBS", true };
+    }
+    else if (std::is_same<Container, concurrent_avl_tree>::value)
+    {
+        return ContainerDescription{ "Concurrent AVL Tree", "BAVL", true };
+    }
+    else if (std::is_same<Container, skiplist_tree>::value)
+    {
+        return ContainerDescription{ "Lock-Free Skip List", "SKIP", true };
+    }
+    else if (std::is_same<Container, sharded_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Sharded Red Black Tree", "SHRB", true };
+    }
+    else if (std::is_same<Container, sharded_avl_tree>::value)
+    {
+        return ContainerDescription{ "Sharded AVL Tree", "SHAV", true };
+    }
+    else if (std::is_same<Container, delegated_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Delegated Sharded Red Black Tree", "DLRB", true };
+    }
+    else if (std::is_same<Container, delegated_avl_tree>::value)
+    {
+        return ContainerDescription{ "Delegated Sharded AVL Tree", "DLAV", true };
+    }
+    else if (std::is_same<Container, mvcc_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Multi-Version Red Black Tree", "MVRB", true };
+    }
+    else if (std::is_same<Container, service_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Red Black Tree Service", "SVRB", true };
+    }
+    else if (std::is_same<Container, service_avl_tree>::value)
+    {
+        return ContainerDescription{ "AVL Tree Service", "SVAV", true };
+    }
+    else if (std::is_same<Container, DeleteReclaimer>::value)
+    {
+        return ContainerDescription{ "Immediate Delete", "DEL", false };
+    }
+    else if (std::is_same<Container, EpochReclaimer>::value)
+    {
+        return ContainerDescription{ "Epoch-Based Reclamation", "EBR", false };
+    }
+    else if (std::is_same<Container, PooledReclaimer>::value)
+    {
+        return ContainerDescription{ "Epoch-Based Reclamation to a Node Pool", "EBRP", false };
+    }
+    else if (std::is_same<Container, LockedMap>::value)
+    {
+        return ContainerDescription{ "Reader-Writer Locked std::map", "LMAP", false };
+    }
+    else if (std::is_same<Container, string_rbt_tree>::value)
+    {
+        return ContainerDescription{ "String Red Black Tree", "SRBT", true };
+    }
+    else if (std::is_same<Container, transparent_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Transparent String Red Black Tree", "HRBT", true };
+    }
+    else if (std::is_same<Container, string_avl_tree>::value)
+    {
+        return ContainerDescription{ "String AVL Tree", "SAVL", true };
+    }
+    else if (std::is_same<Container, transparent_avl_tree>::value)
+    {
+        return ContainerDescription{ "Transparent String AVL Tree", "HAVL", true };
+    }
+    else if (std::is_same<Container, string_map_tree>::value)
+    {
+        return ContainerDescription{ "String std::map", "SMAP", true };
+    }
+    else if (std::is_same<Container, transparent_map_tree>::value)
+    {
+        return ContainerDescription{ "Transparent String std::map", "HMAP", true };
+    }
+    else if (std::is_same<Container, counted_bst_tree>::value)
+    {
+        return ContainerDescription{ "Counted Binary Search Tree", "CBST", false };
+    }
+    else if (std::is_same<Container, threeway_bst_tree>::value)
+    {
+        return ContainerDescription{ "Three-way Binary Search Tree", "3BST", false };
+    }
+    else if (std::is_same<Container, counted_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Counted Red Black Tree", "CRBT", true };
+    }
+    else if (std::is_same<Container, threeway_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Three-way Red Black Tree", "3RBT", true };
+    }
+    else if (std::is_same<Container, counted_avl_tree>::value)
+    {
+        return ContainerDescription{ "Counted AVL Tree", "CAVL", true };
+    }
+    else if (std::is_same<Container, threeway_avl_tree>::value)
+    {
+        return ContainerDescription{ "Three-way AVL Tree", "3AVL", true };
+    }
+    else if (std::is_same<Container, counted_aa_tree>::value)
+    {
+        return ContainerDescription{ "Counted AA Tree", "CAA", true };
+    }
+    else if (std::is_same<Container, threeway_aa_tree>::value)
+    {
+        return ContainerDescription{ "Three-way AA Tree", "3AA", true };
+    }
+    else if (std::is_same<Container, counted_map_tree>::value)
+    {
+        return ContainerDescription{ "Counted std::map", "CMAP", true };
+    }
+    else if (std::is_same<Container, prefix_rbt_tree>::value)
+    {
+        return ContainerDescription{ "Prefix Key Red Black Tree", "PRBT", true };
+    }
+    else if (std::is_same<Container, prefix_avl_tree>::value)
+    {
+        return ContainerDescription{ "Prefix Key AVL Tree", "PAVL", true };
+    }
+    else if (std::is_same<Container, prefix_map_tree>::value)
+    {
+        return ContainerDescription{ "Prefix Key std::map", "PMAP", true };
+    }
+    else
+    {
+        return ContainerDescription{ "Unknown Container", "---", false };
+    }
+}
+
+template<typename Container, typename Key, typename Value>
+int insertValues(Container& container, const std::vector<Key>& keys,
+                 const std::vector<Value>& values)
+{
+    if (keys.size() != values.size())
+    {
+        return -1;
+    }
+    size_t length{ keys.size() };
+
+    Timer timer;
+    for (size_t i{ 0 }; i < length; ++i)
+    {
+        insertEntry(container, keys[i], values[i]);
+    }
+    double duration{ timer.elapsed() };
+
+    if (VERBOSE)
+    {
+        std::cout << "Inserted " << keys.size() << " to ";
+        std::cout << getDescription<Container>().name_ << std::endl;
+        std::cout << "Time duration: " << duration << " ms" << std::endl;
+        std::cout << getDescription<Container>().name_;
+        std::cout << " contains " << container.size() << " nodes. ";
+        std::cout << "Tree height is " << getHeight(container) << std::endl;
+        std::cout << std::endl;
+    }
+
+    return static_cast<int>(duration);
+}
+
+template<typename Container, typename Key>
+int searchValues(Container& container, const std::vector<Key>& keys)
+{
+    Timer timer;
+    size_t found{ 0 };
+    for (const auto& key : keys)
+    {
+        found += findKey(container, key) ? 1 : 0;
+    }
+    double duration{ timer.elapsed() };
+    // Storing the result keeps the compiler from optimizing the searches away
+    foundKeys = found;
+
+    if (VERBOSE)
+    {
+        std::cout << "Searched " << keys.size() << " values from ";
+        std::cout << getDescription<Container>().name_ << std::endl;
+        std::cout << "Time duration: " << duration << " ms" << std::endl;
+        std::cout << std::endl;
+    }
+
+    return static_cast<int>(duration);
+}
+
+template<typename Container, typename Key>
+int deleteValues(Container& container, const std::vector<Key>& keys)
+{
+    Timer timer;
+    for (auto key : keys)
+    {
+        container.erase(key);
+    }
+    double duration{ timer.elapsed() };
+
+    if (VERBOSE)
+    {
+        std::cout << "Deleted " << keys.size() << " from ";
+        std::cout << getDescription<Container>().name_ << std::endl;
+        std::cout << "Time duration: " << duration << " ms" << std::endl;
+        std::cout << getDescription<Container>().name_;
+        std::cout << " contains " << container.size() << " nodes. ";
+        std::cout << "Tree height is " << getHeight(container) << std::endl;
+        std::cout << std::endl;
+    }
+
+    return static_cast<int>(duration);
+}
+
+template<typename Container>
+TestTime runTest(Container& container, const TestData& testData)
+{
+    TestTime newTest;
+    newTest.n_ = 0;
+
+    if (testData.bst or getDescription<Container>().balanced_)
+    {
+        newTest.test_ = testData.testName;
+        newTest.n_ = testData.insertKeys1.size();
+
+        std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+        container.clear();
+        newTest.tree_ = getDescription<Container>().identifier_;
+        newTest.insert1_ = insertValues(container, testData.insertKeys1, testData.insertData1);
+        newTest.height1_ = getHeight(container);
+        newTest.search1a_ = searchValues(container, testData.searchKeys1);
+        newTest.search1b_ = searchValues(container, testData.searchKeysAll);
+        auto rotations{ getRotations(container) };
+        newTest.delete1_ = deleteValues(container, testData.deleteKeys1);
+        newTest.rotations1_ = getRotationRate(container, rotations, testData.deleteKeys1.size());
+        newTest.height2_ = getHeight(container);
+        newTest.search2a_ = searchValues(container, testData.searchKeys2);
+        newTest.search2b_ = searchValues(container, testData.searchKeysAll);
+        newTest.insert2_ = insertValues(container, testData.insertKeys2, testData.insertData2);
+        newTest.height3_ = getHeight(container);
+        newTest.search3a_ = searchValues(container, testData.searchKeys3);
+        newTest.search3b_ = searchValues(container, testData.searchKeysAll);
+        rotations = getRotations(container);
+        newTest.delete2_ = deleteValues(container, testData.deleteKeys2);
+        newTest.rotations2_ = getRotationRate(container, rotations, testData.deleteKeys2.size());
+        newTest.total_ = newTest.insert1_ + newTest.insert2_ +
+                         newTest.delete1_ + newTest.delete2_ +
+                         newTest.search1a_ + newTest.search2a_ + newTest.search3a_ +
+                         newTest.search1b_ + newTest.search2b_ + newTest.search3b_;
+    }
+
+    return newTest;
+}
+
+// Inserts the keys in bursts of the given size and measures the latency of each insert.
+// The container is rebalanced between the bursts, as if the bursts were separated by idle time.
+template<typename Container, typename Key, typename Value>
+LatencyTime insertLatency(Container& container, const std::vector<Key>& keys,
+                          const std::vector<Value>& values, int burst)
+{
+    LatencyTime result;
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = keys.size();
+    result.burst_ = burst;
+
+    container.clear();
+    std::vector<long long> latencies;
+    latencies.reserve(keys.size());
+    long long rebalanceTime{ 0 };
+
+    for (size_t i{ 0 }; i < keys.size() and i < values.size(); ++i)
+    {
+        Timer timer;
+        container.insert(std::pair<Key, Value>{ keys[i], values[i] });
+        latencies.push_back(timer.elapsedNanoseconds());
+
+        if ((i + 1) % burst == 0 and i + 1 < keys.size())
+        {
+            Timer rebalanceTimer;
+            rebalanceContainer(container);
+            rebalanceTime += rebalanceTimer.elapsedNanoseconds();
+        }
+    }
+
+    result.height1_ = getHeight(container);
+    Timer rebalanceTimer;
+    rebalanceContainer(container);
+    rebalanceTime += rebalanceTimer.elapsedNanoseconds();
+    result.height2_ = getHeight(container);
+    result.rebalance_ = static_cast<int>(rebalanceTime / 1000);
+
+    std::sort(latencies.begin(), latencies.end());
+    if (latencies.empty())
+    {
+        latencies.push_back(0);
+    }
+    result.p50_ = static_cast<int>(latencies[latencies.size() / 2]);
+    result.p99_ = static_cast<int>(latencies[latencies.size() * 99 / 100]);
+    result.max_ = static_cast<int>(latencies.back());
+
+    if (VERBOSE)
+    {
+        std::cout << "Inserted " << keys.size() << " to ";
+        std::cout << getDescription<Container>().name_;
+        std::cout << " in bursts of " << burst << std::endl;
+        std::cout << "99th percentile latency: " << result.p99_ << " ns" << std::endl;
+        std::cout << std::endl;
+    }
+
+    return result;
+}
+
+// Uses the container as an ordered priority queue with n keys. Each new key is larger
+// than all the keys in the container, and the keys are removed from the small end.
+// The unbalanced containers are skipped, because the keys arrive in increasing order.
+template<typename Container>
+QueueTime runQueueTest(Container& container, int n)
+{
+    QueueTime result;
+    result.n_ = 0;
+
+    if (not getDescription<Container>().balanced_)
+    {
+        return result;
+    }
+
+    using Key = typename Container::key_type;
+    using Value = typename Container::mapped_type;
+
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = n;
+
+    Timer fillTimer;
+    for (int i{ 0 }; i < n; ++i)
+    {
+        container.insert(std::pair<Key, Value>{ i, std::to_string(i) });
+    }
+    result.fill_ = static_cast<int>(fillTimer.elapsed());
+
+    Timer queueTimer;
+    for (int i{ n }; i < 2 * n; ++i)
+    {
+        container.insert(std::pair<Key, Value>{ i, std::to_string(i) });
+        popMinimum(container);
+    }
+    result.queue_ = static_cast<int>(queueTimer.elapsed());
+    result.height_ = getHeight(container);
+
+    Timer drainTimer;
+    while (container.size() > 0)
+    {
+        popMinimum(container);
+    }
+    result.drain_ = static_cast<int>(drainTimer.elapsed());
+
+    if (VERBOSE)
+    {
+        std::cout << "Used " << getDescription<Container>().name_;
+        std::cout << " as a priority queue of " << n << " keys" << std::endl;
+        std::cout << "Time duration: " << result.queue_ << " ms" << std::endl;
+        std::cout << std::endl;
+    }
+
+    return result;
+}
+
+// Visits all the nodes in order and returns the number of visited nodes
+template<typename Node, typename Compare, bool Multi>
+long long scanAll(const BinarySearchTree<Node, Compare, Multi>& tree)
+{
+    long long visited{ 0 };
+    for (auto x = tree.minimum(); x != tree.nil(); x = tree.successor(x))
+    {
+        ++visited;
+    }
+    return visited;
+}
+
+template<typename Key, typename Value, typename Compare>
+long long scanAll(const std::map<Key, Value, Compare>& container)
+{
+    long long visited{ 0 };
+    for (auto iter = container.begin(); iter != container.end(); ++iter)
+    {
+        ++visited;
+    }
+    return visited;
+}
+
+template<typename Container>
+typename std::enable_if<HasScan<Container>::value, long long>::type scanAll(const Container& container)
+{
+    long long visited{ 0 };
+    container.forEach([&visited](const auto&, const auto&)
+    {
+        ++visited;
+    });
+    return visited;
+}
+
+// Visits at most length nodes in order starting from the first key not less
+// than first and returns the number of visited nodes
+template<typename Node, typename Compare, bool Multi>
+long long scanRange(const BinarySearchTree<Node, Compare, Multi>& tree, const typename Node::key_type& first, int length)
+{
+    long long visited{ 0 };
+    for (auto x = tree.lowerBound(first); x != tree.nil() and visited < length; x = tree.successor(x))
+    {
+        ++visited;
+    }
+    return visited;
+}
+
+template<typename Key, typename Value, typename Compare>
+long long scanRange(const std::map<Key, Value, Compare>& container, const Key& first, int length)
+{
+    long long visited{ 0 };
+    for (auto iter = container.lower_bound(first); iter != container.end() and visited < length; ++iter)
+    {
+        ++visited;
+    }
+    return visited;
+}
+
+template<typename Container>
+typename std::enable_if<HasScan<Container>::value, long long>::type
+scanRange(const Container& container, const typename Container::key_type& first, int length)
+{
+    return container.scan(first, length, IgnoreVisit{});
+}
+
+template<typename Container>
+ScanTime runScanTest(Container& container, const std::vector<key_type>& keys,
+                     const std::vector<data_type>& values, const std::vector<key_type>& starts)
+{
+    ScanTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = keys.size();
+    result.visited_ = 0;
+
+    for (size_t i{ 0 }; i < keys.size() and i < values.size(); ++i)
+    {
+        container.insert(std::pair<key_type, data_type>{ keys[i], values[i] });
+    }
+
+    Timer fullTimer;
+    for (int i{ 0 }; i < FULL_SCANS; ++i)
+    {
+        result.visited_ += scanAll(container);
+    }
+    result.full_ = static_cast<int>(fullTimer.elapsed());
+
+    Timer rangeTimer;
+    for (auto first : starts)
+    {
+        result.visited_ += scanRange(container, first, RANGE_SCAN_LENGTH);
+    }
+    result.range_ = static_cast<int>(rangeTimer.elapsed());
+
+    if (VERBOSE)
+    {
+        std::cout << "Scanned " << getDescription<Container>().name_ << std::endl;
+        std::cout << "Full scans: " << result.full_ << " ms, range scans: "
+                  << result.range_ << " ms" << std::endl;
+        std::cout << std::endl;
+    }
+
+    return result;
+}
+
+template<typename Node, typename Compare, bool Multi>
+typename Node::mapped_type findValue(const BinarySearchTree<Node, Compare, Multi>& tree, const typename Node::key_type& key)
+{
+    return tree.find(key)->value_;
+}
+
+template<typename Key, typename Value, typename Compare>
+Value findValue(const std::map<Key, Value, Compare>& container, const Key& key)
+{
+    return container.find(key)->second;
+}
+
+template<typename Node, typename Compare, bool Multi>
+Node* notFound(const BinarySearchTree<Node, Compare, Multi>& tree)
+{
+    return tree.nil();
+}
+
+template<typename Key, typename Value, typename Compare>
+typename std::map<Key, Value, Compare>::const_iterator notFound(const std::map<Key, Value, Compare>& container)
+{
+    return container.end();
+}
+
+template<typename Key, typename Compare>
+typename std::set<Key, Compare>::const_iterator notFound(const std::set<Key, Compare>& container)
+{
+    return container.end();
+}
+
+template<typename Node, typename Compare>
+Node* notFound(const SkipList<Node, Compare>&)
+{
+    return nullptr;
+}
+
+// Visits the entries with the given key and returns the number of visited entries
+template<typename Node, typename Compare, bool Multi>
+long long scanEqual(const BinarySearchTree<Node, Compare, Multi>& tree, const typename Node::key_type& key)
+{
+    long long visited{ 0 };
+    auto range{ tree.equalRange(key) };
+    for (auto x = range.first; x != range.second; x = tree.successor(x))
+    {
+        ++visited;
+    }
+    return visited;
+}
+
+template<typename Key, typename Value, typename Compare>
+long long scanEqual(const std::multimap<Key, Value, Compare>& container, const Key& key)
+{
+    long long visited{ 0 };
+    auto range{ container.equal_range(key) };
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+        ++visited;
+    }
+    return visited;
+}
+
+// Inserts the entries with duplicate keys, then counts and visits the entries
+// of each probe key, and finally erases all the entries key by key
+template<typename Container>
+MultiTime runMultiTest(Container& container, const std::vector<key_type>& keys,
+                       const std::vector<data_type>& values, const std::vector<key_type>& probes)
+{
+    MultiTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = keys.size();
+    result.entries_ = 0;
+
+    result.insert_ = insertValues(container, keys, values);
+
+    Timer countTimer;
+    for (auto key : probes)
+    {
+        result.entries_ += container.count(key);
+    }
+    result.count_ = static_cast<int>(countTimer.elapsed());
+
+    long long visited{ 0 };
+    Timer rangeTimer;
+    for (auto key : probes)
+    {
+        visited += scanEqual(container, key);
+    }
+    result.range_ = static_cast<int>(rangeTimer.elapsed());
+
+    Timer eraseTimer;
+    for (auto key : probes)
+    {
+        container.erase(key);
+    }
+    result.erase_ = static_cast<int>(eraseTimer.elapsed());
+
+    if (VERBOSE or visited != result.entries_)
+    {
+        std::cout << "Counted " << result.entries_ << " and visited " << visited;
+        std::cout << " entries of " << getDescription<Container>().name_ << std::endl;
+        std::cout << std::endl;
+    }
+
+    return result;
+}
+
+// Sums the values with keys in [lo, hi] by visiting every entry in the range
+template<typename Node, typename Compare, bool Multi>
+sum_type sumRange(const BinarySearchTree<Node, Compare, Multi>& tree, key_type lo, key_type hi)
+{
+    sum_type sum{ 0 };
+    for (auto x = tree.lowerBound(lo); x != tree.nil() and not (hi < x->key_); x = tree.successor(x))
+    {
+        sum += x->value_;
+    }
+    return sum;
+}
+
+template<typename Key, typename Compare>
+sum_type sumRange(const std::map<Key, sum_type, Compare>& container, const Key& lo, const Key& hi)
+{
+    sum_type sum{ 0 };
+    for (auto iter = container.lower_bound(lo); iter != container.end() and not (hi < iter->first); ++iter)
+    {
+        sum += iter->second;
+    }
+    return sum;
+}
+
+// Sums the values with keys in [lo, hi] with the subtree summaries of the tree
+template<typename Node, typename Compare, bool Multi>
+sum_type aggregateRange(const BinarySearchTree<Node, Compare, Multi>& tree, key_type lo, key_type hi)
+{
+    return tree.aggregate(lo, hi);
+}
+
+// std::map has no subtree summaries, so it can only scan the range
+template<typename Key, typename Compare>
+sum_type aggregateRange(const std::map<Key, sum_type, Compare>& container, const Key& lo, const Key& hi)
+{
+    return sumRange(container, lo, hi);
+}
+
+// Sums the values over the ranges [start, start + width) with the subtree
+// summaries and by scanning the ranges, and checks that the sums agree
+template<typename Container>
+AggregateTime runAggregateTest(Container& container, const std::vector<key_type>& keys,
+                               const std::vector<key_type>& starts, int width)
+{
+    AggregateTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = keys.size();
+    result.width_ = width;
+
+    for (auto key : keys)
+    {
+        container.insert(std::pair<key_type, sum_type>{ key, key });
+    }
+
+    sum_type aggregated{ 0 };
+    Timer aggregateTimer;
+    for (auto start : starts)
+    {
+        aggregated += aggregateRange(container, start, start + width - 1);
+    }
+    result.aggregate_ = static_cast<int>(aggregateTimer.elapsed());
+
+    sum_type scanned{ 0 };
+    Timer scanTimer;
+    for (auto start : starts)
+    {
+        scanned += sumRange(container, start, start + width - 1);
+    }
+    result.scan_ = static_cast<int>(scanTimer.elapsed());
+    result.sum_ = scanned;
+
+    if (VERBOSE or aggregated != scanned)
+    {
+        std::cout << "Aggregated " << aggregated << " and scanned " << scanned;
+        std::cout << " in " << getDescription<Container>().name_ << std::endl;
+        std::cout << std::endl;
+    }
+
+    return result;
+}
+
+template<typename Node>
+long long countOverlapping(const IntervalTree<Node>& tree, key_type low, key_type high)
+{
+    long long found{ 0 };
+    tree.forEachOverlapping(low, high, [&found](Node*)
+    {
+        ++found;
+    });
+    return found;
+}
+
+// Scans all the intervals that start before the end of the query
+template<typename Key, typename Value, typename Compare>
+long long countOverlapping(const std::multimap<Key, Interval<Key, Value>, Compare>& container,
+                           const Key& low, const Key& high)
+{
+    long long found{ 0 };
+    for (auto iter = container.begin(); iter != container.end() and not (high < iter->first); ++iter)
+    {
+        if (not (iter->second.high_ < low))
+        {
+            ++found;
+        }
+    }
+    return found;
+}
+
+// Inserts the intervals [lows[i], lows[i] + lengths[i]] and then finds the
+// intervals that contain each point and that overlap the window starting at each point
+template<typename Container>
+IntervalTime runIntervalTest(Container& container, const std::vector<key_type>& lows,
+                             const std::vector<key_type>& lengths, const std::vector<key_type>& points)
+{
+    IntervalTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = lows.size();
+    result.found_ = 0;
+
+    Timer insertTimer;
+    for (size_t i{ 0 }; i < lows.size() and i < lengths.size(); ++i)
+    {
+        auto interval{ interval_type{ lows[i] + lengths[i], static_cast<key_type>(i) } };
+        container.insert(std::pair<key_type, interval_type>{ lows[i], interval });
+    }
+    result.insert_ = static_cast<int>(insertTimer.elapsed());
+
+    Timer stabTimer;
+    for (auto point : points)
+    {
+        result.found_ += countOverlapping(container, point, point);
+    }
+    result.stab_ = static_cast<int>(stabTimer.elapsed());
+
+    Timer windowTimer;
+    for (auto point : points)
+    {
+        result.found_ += countOverlapping(container, point, point + INTERVAL_WINDOW - 1);
+    }
+    result.window_ = static_cast<int>(windowTimer.elapsed());
+
+    if (VERBOSE)
+    {
+        std::cout << "Found " << result.found_ << " intervals in ";
+        std::cout << getDescription<Container>().name_ << std::endl;
+        std::cout << std::endl;
+    }
+
+    return result;
+}
+
+template<typename Node, typename Compare, bool Multi>
+void insertVersion(BinarySearchTree<Node, Compare, Multi>& tree, key_type key, const data_type& value)
+{
+    tree.insert(std::pair<key_type, data_type>{ key, value });
+}
+
+// The new version replaces the old one, which frees the nodes that only the old one used
+template<typename Node, typename Compare>
+void insertVersion(PersistentAVLTree<Node, Compare>& tree, key_type key, const data_type& value)
+{
+    tree = tree.insert(std::pair<key_type, data_type>{ key, value });
+}
+
+template<typename Node, typename Compare, bool Multi>
+void eraseVersion(BinarySearchTree<Node, Compare, Multi>& tree, key_type key)
+{
+    tree.erase(key);
+}
+
+template<typename Node, typename Compare>
+void eraseVersion(PersistentAVLTree<Node, Compare>& tree, key_type key)
+{
+    tree = tree.erase(key);
+}
+
+// A mutable tree can only be snapshotted by copying all the entries
 template<typename Container>
-ContainerDescription getDescription()
+std::unique_ptr<Container> takeSnapshot(const Container& container)
 {
-    if (std::is_same<Container, rbt_tree>::value)
+    auto snapshot{ std::make_unique<Container>() };
+    for (auto x = container.minimum(); x != container.nil(); x = container.successor(x))
     {
-        return ContainerDescription{ "Red Black Tree", "RBT", true };
+        snapshot->insert(std::pair<key_type, data_type>{ x->key_, x->value_ });
     }
-    else if (std::is_same<Container, avl_tree>::value)
+    return snapshot;
+}
+
+template<typename Node, typename Compare>
+std::unique_ptr<PersistentAVLTree<Node, Compare>> takeSnapshot(const PersistentAVLTree<Node, Compare>& tree)
+{
+    return std::make_unique<PersistentAVLTree<Node, Compare>>(tree);
+}
+
+// Inserts the keys and takes PERSISTENT_SNAPSHOTS snapshots at even intervals while
+// doing it, then drops the snapshots and erases the keys in another order
+template<typename Container>
+PersistentTime runPersistentTest(Container& container, const std::vector<key_type>& keys,
+                                 const std::vector<data_type>& values,
+                                 const std::vector<key_type>& eraseKeys)
+{
+    PersistentTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = keys.size();
+    result.snapshot_ = 0;
+
+    size_t interval{ std::max<size_t>(1, keys.size() / PERSISTENT_SNAPSHOTS) };
+    std::vector<std::unique_ptr<Container>> snapshots;
+    double snapshotTime{ 0.0 };
+    long long blocksBefore{ static_cast<long long>(allocations() - deallocations()) };
+
+    Timer insertTimer;
+    for (size_t i{ 0 }; i < keys.size() and i < values.size(); ++i)
     {
-        return ContainerDescription{ "AVL Tree", "AVL", true };
+        insertVersion(container, keys[i], values[i]);
+        if ((i + 1) % interval == 0)
+        {
+            Timer snapshotTimer;
+            snapshots.push_back(takeSnapshot(container));
+            snapshotTime += snapshotTimer.elapsed();
+        }
     }
-    else if (std::is_same<Container, aa_tree>::value)
+    result.insert_ = static_cast<int>(insertTimer.elapsed() - snapshotTime);
+    result.snapshot_ = static_cast<int>(snapshotTime);
+    result.retained_ = static_cast<long long>(allocations() - deallocations()) - blocksBefore;
+
+    snapshots.clear();
+
+    Timer eraseTimer;
+    for (auto key : eraseKeys)
     {
-        return ContainerDescription{ "AA Tree", "AA", true };
+        eraseVersion(container, key);
     }
-    else if (std::is_same<Container, bst_tree>::value)
+    result.erase_ = static_cast<int>(eraseTimer.elapsed());
+
+    if (VERBOSE or container.size() != 0)
     {
-        return ContainerDescription{ "Binary Search Tree", "BST", false };
+        std::cout << getDescription<Container>().name_ << " contains " << container.size();
+        std::cout << " keys after erasing all of them" << std::endl;
+        std::cout << std::endl;
     }
-    else if (std::is_same<Container, map_tree>::value)
+
+    return result;
+}
+
+// Fills the container with keys and then lets each of the threads do operations
+// on random keys in [1, keyRange]. Of the operations, reads percent are finds and
+// the rest are inserts and erases in equal parts, so the size stays about the same.
+// The threads generate their operations before they wait for the common start.
+template<typename Container>
+ConcurrentTime runConcurrentTest(Container& container, const std::vector<key_type>& keys,
+                                 int keyRange, int operations, int threads, int reads)
+{
+    ConcurrentTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << ", "
+              << threads << " threads, " << reads << "% reads" << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.threads_ = threads;
+    result.reads_ = reads;
+    result.operations_ = static_cast<long long>(operations) * threads;
+
+    for (auto key : keys)
     {
-        return ContainerDescription{ "std::map", "MAP", true };
+        container.insert(std::pair<key_type, data_type>{ key, std::to_string(key) });
     }
-    else
+
+    std::atomic<int> ready{ 0 };
+    std::atomic<bool> start{ false };
+    std::atomic<long long> found{ 0 };
+    std::vector<std::thread> workers;
+    for (int t{ 0 }; t < threads; ++t)
     {
-        return ContainerDescription{ "Unknown Container", "---", false };
+        workers.emplace_back([&, t]()
+        {
+            std::mt19937 generator{ static_cast<unsigned int>(t + 1) };
+            std::uniform_int_distribution<int> keyDistribution(1, keyRange);
+            std::uniform_int_distribution<int> operationDistribution(0, 199);
+            std::vector<std::pair<int, key_type>> work;
+            for (int i{ 0 }; i < operations; ++i)
+            {
+                work.push_back({ operationDistribution(generator), keyDistribution(generator) });
+            }
+            const data_type value{ "value" };
+            long long hits{ 0 };
+
+            ++ready;
+            while (not start.load())
+            {
+                std::this_thread::yield();
+            }
+
+            for (auto& operation : work)
+            {
+                if (operation.first < 2 * reads)
+                {
+                    hits += container.contains(operation.second);
+                }
+                else if (operation.first % 2 == 0)
+                {
+                    container.insert(std::pair<key_type, data_type>{ operation.second, value });
+                }
+                else
+                {
+                    container.erase(operation.second);
+                }
+            }
+            found += hits;
+        });
+    }
+
+    while (ready.load() < threads)
+    {
+        std::this_thread::yield();
+    }
+    Timer timer;
+    start = true;
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    double duration{ timer.elapsed() };
+    result.time_ = static_cast<int>(duration);
+    result.mops_ = (duration > 0.0) ? result.operations_ / (duration * 1000.0) : 0.0;
+
+    if (VERBOSE)
+    {
+        std::cout << "Found " << found.load() << " keys in " << getDescription<Container>().name_;
+        std::cout << ", which contains " << container.size() << " keys" << std::endl;
+        std::cout << std::endl;
     }
+
+    return result;
 }
 
-template<typename Container, typename Key, typename Value>
-int insertValues(Container& container, const std::vector<Key>& keys,
-                 const std::vector<Value>& values)
+// Lets each of the threads create nodes and retire them, one node per operation,
+// with the thread pinned by a guard during the operation like in the concurrent
+// trees. The pending nodes are counted before the threads exit, because an exiting
+// thread frees what it can.
+template<typename Reclaimer>
+ReclamationTime runReclamationTest(Reclaimer& reclaimer, int operations, int threads)
 {
-    if (keys.size() != values.size())
+    ReclamationTime result;
+    std::cout << std::setw(9) << " " << getDescription<Reclaimer>().name_ << ", "
+              << threads << " threads" << std::endl;
+    result.tree_ = getDescription<Reclaimer>().identifier_;
+    result.threads_ = threads;
+    result.operations_ = static_cast<long long>(operations) * threads;
+
+    std::atomic<int> ready{ 0 };
+    std::atomic<bool> start{ false };
+    std::atomic<long long> pending{ 0 };
+    std::atomic<long long> checksum{ 0 };
+    std::vector<std::thread> workers;
+    for (int t{ 0 }; t < threads; ++t)
     {
-        return -1;
+        workers.emplace_back([&]()
+        {
+            const data_type value{ "value" };
+            long long sum{ 0 };
+
+            ++ready;
+            while (not start.load())
+            {
+                std::this_thread::yield();
+            }
+
+            for (int i{ 0 }; i < operations; ++i)
+            {
+                typename Reclaimer::Guard guard;
+                auto node = reclaimer.create(i, value);
+                sum += node->first;
+                reclaimer.retire(node);
+            }
+            pending += static_cast<long long>(EpochReclamation::pending());
+            checksum += sum;
+        });
     }
-    size_t length{ keys.size() };
 
+    while (ready.load() < threads)
+    {
+        std::this_thread::yield();
+    }
     Timer timer;
-    for (size_t i{ 0 }; i < length; ++i)
+    start = true;
+    for (auto& worker : workers)
     {
-        container.insert(std::pair<Key, Value>{ keys[i], values[i] });
+        worker.join();
     }
-    double duration{ timer.elapsed() };
+    long long duration{ timer.elapsedNanoseconds() };
+    result.time_ = static_cast<int>(duration / 1000000);
+    result.perOperation_ = (result.operations_ > 0) ? static_cast<double>(duration) / result.operations_ : 0.0;
+    result.pending_ = (std::is_same<Reclaimer, DeleteReclaimer>::value) ? 0 : pending.load();
 
     if (VERBOSE)
     {
-        std::cout << "Inserted " << keys.size() << " to ";
-        std::cout << getDescription<Container>().name_ << std::endl;
-        std::cout << "Time duration: " << duration << " ms" << std::endl;
-        std::cout << getDescription<Container>().name_;
-        std::cout << " contains " << container.size() << " nodes. ";
-        std::cout << "Tree height is " << getHeight(container) << std::endl;
+        std::cout << "Retired " << result.operations_ << " nodes with "
+                  << getDescription<Reclaimer>().name_ << ", checksum " << checksum.load() << std::endl;
         std::cout << std::endl;
     }
 
-    return static_cast<int>(duration);
+    return result;
 }
 
-template<typename Container, typename Key>
-int searchValues(Container& container, const std::vector<Key>& keys)
+template<typename Node, typename Compare, bool Multi>
+bool containsKey(const BinarySearchTree<Node, Compare, Multi>& tree, const typename Node::key_type& key)
+{
+    return tree.find(key) != tree.nil();
+}
+
+template<typename Tree, ConcurrencyMode Mode>
+bool containsKey(const ConcurrentTree<Tree, Mode>& tree, const typename Tree::key_type& key)
+{
+    return tree.contains(key);
+}
+
+template<typename Tree, ShardingMode Mode>
+bool containsKey(const ShardedTree<Tree, Mode>& tree, const typename Tree::key_type& key)
+{
+    return tree.contains(key);
+}
+
+template<typename Node, typename Compare>
+bool containsKey(const SkipList<Node, Compare>& list, const typename Node::key_type& key)
 {
+    return list.contains(key);
+}
+
+template<typename Key, typename Value, typename Compare>
+bool containsKey(const MultiVersionTree<Key, Value, Compare>& tree, const Key& key)
+{
+    return tree.contains(key);
+}
+
+// Lets each of the pinned threads run its own sequence of operations from the mix,
+// either on the shared container or on a container of its own that starts with the
+// same keys. All the threads stop when the first of them has done all its operations,
+// so every thread competes for the whole time and the counts show how fairly the
+// container served them.
+template<typename Container>
+ScalingTime runScalingTest(Container& container, const std::vector<key_type>& keys, int keyRange,
+                           int operations, int threads, const OperationMix& mix, ContainerSharing sharing)
+{
+    ScalingTime result;
+    bool shared{ sharing == ContainerSharing::Shared };
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << ", "
+              << threads << " threads, " << mix.name_ << (shared ? ", shared" : ", per thread") << std::endl;
+    result.tree_ = getDescription<Container>().identifier_;
+    result.mix_ = mix.name_;
+    result.shared_ = shared;
+    result.n_ = keys.size();
+    result.threads_ = threads;
+
+    // The first thread uses the given container in both modes
+    std::vector<std::unique_ptr<Container>> owned;
+    for (int t{ 1 }; t < threads and not shared; ++t)
+    {
+        owned.push_back(std::make_unique<Container>());
+    }
+    container.clear();
+    for (auto key : keys)
+    {
+        container.insert(std::pair<key_type, data_type>{ key, std::to_string(key) });
+        for (auto& own : owned)
+        {
+            own->insert(std::pair<key_type, data_type>{ key, std::to_string(key) });
+        }
+    }
+
+    std::atomic<int> ready{ 0 };
+    std::atomic<bool> start{ false };
+    std::atomic<bool> stop{ false };
+    std::atomic<long long> found{ 0 };
+    std::vector<long long> completed(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t{ 0 }; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+        {
+            pinThread(t);
+            Container& target{ (shared or t == 0) ? container : *owned[t - 1] };
+            std::mt19937 generator{ static_cast<unsigned int>(t + 1) };
+            std::uniform_int_distribution<int> keyDistribution(1, keyRange);
+            std::uniform_int_distribution<int> operationDistribution(0, 99);
+            std::vector<std::pair<int, key_type>> work;
+            for (int i{ 0 }; i < operations; ++i)
+            {
+                work.push_back({ operationDistribution(generator), keyDistribution(generator) });
+            }
+            const data_type value{ "value" };
+            long long hits{ 0 };
+            long long done{ 0 };
+
+            ++ready;
+            while (not start.load())
+            {
+                std::this_thread::yield();
+            }
+
+            for (auto& operation : work)
+            {
+                if (stop.load(std::memory_order_relaxed))
+                {
+                    break;
+                }
+
+                if (operation.first < mix.find_)
+                {
+                    hits += containsKey(target, operation.second);
+                }
+                else if (operation.first < mix.find_ + mix.insert_)
+                {
+                    target.insert(std::pair<key_type, data_type>{ operation.second, value });
+                }
+                else if (operation.first < mix.find_ + mix.insert_ + mix.erase_)
+                {
+                    target.erase(operation.second);
+                }
+                else
+                {
+                    hits += scanRange(target, operation.second, RANGE_SCAN_LENGTH);
+                }
+                ++done;
+            }
+            stop.store(true, std::memory_order_relaxed);
+            completed[t] = done;
+            found += hits;
+        });
+    }
+
+    while (ready.load() < threads)
+    {
+        std::this_thread::yield();
+    }
     Timer timer;
+    start = true;
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    long long duration{ timer.elapsedNanoseconds() };
+
+    long long total{ 0 };
+    double squares{ 0.0 };
+    long long fewest{ completed.front() };
+    long long most{ completed.front() };
+    for (auto done : completed)
+    {
+        total += done;
+        squares += static_cast<double>(done) * done;
+        fewest = std::min(fewest, done);
+        most = std::max(most, done);
+    }
+    result.operations_ = total;
+    result.time_ = static_cast<int>(duration / 1000000);
+    result.mops_ = (duration > 0) ? total * 1000.0 / duration : 0.0;
+    result.efficiency_ = 1.0;
+    result.fairness_ = (squares > 0.0) ? static_cast<double>(total) * total / (threads * squares) : 1.0;
+    result.minMax_ = (most > 0) ? static_cast<double>(fewest) / most : 1.0;
+
+    if (VERBOSE)
+    {
+        std::cout << "Found " << found.load() << " keys in " << getDescription<Container>().name_;
+        std::cout << ", which contains " << container.size() << " keys" << std::endl;
+        std::cout << std::endl;
+    }
+
+    return result;
+}
+
+// Lets each of the producers make its requests to a new service window requests at
+// a time and wait for their results before the next window. Of the requests 80% are
+// lookups and the rest inserts and erases in equal parts. The batches and the
+// latencies are taken from the counters of the service, less the initial inserts.
+template<typename Service>
+ServiceTime runServiceTest(const std::vector<key_type>& keys, int keyRange, int operations,
+                           int producers, int window)
+{
+    ServiceTime result;
+    std::cout << std::setw(9) << " " << getDescription<Service>().name_ << ", "
+              << producers << " producers, window " << window << std::endl;
+    result.tree_ = getDescription<Service>().identifier_;
+    result.producers_ = producers;
+    result.window_ = window;
+    result.operations_ = static_cast<long long>(operations) * producers;
+
+    Service service;
+    std::vector<std::future<bool>> inserted;
     for (auto key : keys)
     {
-        container.find(key);
+        inserted.push_back(service.insert(std::pair<key_type, data_type>{ key, std::to_string(key) }));
     }
-    double duration{ timer.elapsed() };
+    for (auto& future : inserted)
+    {
+        future.get();
+    }
+    auto before{ service.counters() };
+
+    std::atomic<int> ready{ 0 };
+    std::atomic<bool> start{ false };
+    std::atomic<long long> found{ 0 };
+    std::vector<std::thread> workers;
+    for (int t{ 0 }; t < producers; ++t)
+    {
+        workers.emplace_back([&, t]()
+        {
+            std::mt19937 generator{ static_cast<unsigned int>(t + 1) };
+            std::uniform_int_distribution<int> keyDistribution(1, keyRange);
+            std::uniform_int_distribution<int> operationDistribution(0, 9);
+            std::vector<std::pair<int, key_type>> work;
+            for (int i{ 0 }; i < operations; ++i)
+            {
+                work.push_back({ operationDistribution(generator), keyDistribution(generator) });
+            }
+            const data_type value{ "value" };
+            std::vector<std::future<bool>> flags;
+            std::vector<std::future<typename Service::size_type>> counts;
+            long long hits{ 0 };
+
+            ++ready;
+            while (not start.load())
+            {
+                std::this_thread::yield();
+            }
+
+            for (size_t i{ 0 }; i < work.size(); ++i)
+            {
+                if (work[i].first < 8)
+                {
+                    flags.push_back(service.contains(work[i].second));
+                }
+                else if (work[i].first == 8)
+                {
+                    flags.push_back(service.insert(std::pair<key_type, data_type>{ work[i].second, value }));
+                }
+                else
+                {
+                    counts.push_back(service.erase(work[i].second));
+                }
+
+                if ((i + 1) % window == 0 or i + 1 == work.size())
+                {
+                    for (auto& future : flags)
+                    {
+                        hits += future.get();
+                    }
+                    for (auto& future : counts)
+                    {
+                        future.get();
+                    }
+                    flags.clear();
+                    counts.clear();
+                }
+            }
+            found += hits;
+        });
+    }
+
+    while (ready.load() < producers)
+    {
+        std::this_thread::yield();
+    }
+    Timer timer;
+    start = true;
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    long long duration{ timer.elapsedNanoseconds() };
+    auto after{ service.counters() };
+
+    unsigned long long requests{ after.requests_ - before.requests_ };
+    unsigned long long batches{ after.batches_ - before.batches_ };
+    result.time_ = static_cast<int>(duration / 1000000);
+    result.mops_ = (duration > 0) ? result.operations_ * 1000.0 / duration : 0.0;
+    result.batch_ = (batches > 0) ? static_cast<double>(requests) / batches : 0.0;
+    result.latency_ = (requests > 0) ? (after.latency_ - before.latency_) / (requests * 1000.0) : 0.0;
+    result.maxLatency_ = after.maxLatency_ / 1000.0;
 
     if (VERBOSE)
     {
-        std::cout << "Searched " << keys.size() << " values from ";
-        std::cout << getDescription<Container>().name_ << std::endl;
-        std::cout << "Time duration: " << duration << " ms" << std::endl;
+        std::cout << "Found " << found.load() << " keys in " << getDescription<Service>().name_;
+        std::cout << ", which contains " << service.size() << " keys" << std::endl;
         std::cout << std::endl;
     }
 
-    return static_cast<int>(duration);
+    return result;
 }
 
-template<typename Container, typename Key>
-int deleteValues(Container& container, const std::vector<Key>& keys)
+template<typename Container>
+long long storedVersions(const Container& container)
+{
+    return container.size();
+}
+
+template<typename Key, typename Value, typename Compare>
+long long storedVersions(const MultiVersionTree<Key, Value, Compare>& tree)
+{
+    return tree.versions();
+}
+
+// Lets one writer insert and erase random keys while the scanners visit all the
+// keys over and over. Every scanner finishes at least one scan, so the last scans
+// may run after the writer has finished. The versions are counted when the writer
+// finishes, before the collector has caught up.
+template<typename Container>
+SnapshotTime runSnapshotTest(Container& container, const std::vector<key_type>& keys,
+                             int keyRange, int writes, int scanners)
 {
+    SnapshotTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << ", "
+              << scanners << " scanners" << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = keys.size();
+    result.scanners_ = scanners;
+    result.writes_ = writes;
+
+    for (auto key : keys)
+    {
+        container.insert(std::pair<key_type, data_type>{ key, std::to_string(key) });
+    }
+
+    std::mt19937 generator{ 1 };
+    std::uniform_int_distribution<int> keyDistribution(1, keyRange);
+    std::vector<key_type> work;
+    for (int i{ 0 }; i < writes; ++i)
+    {
+        work.push_back(keyDistribution(generator));
+    }
+    const data_type value{ "value" };
+
+    std::atomic<int> ready{ 0 };
+    std::atomic<bool> start{ false };
+    std::atomic<bool> done{ false };
+    std::atomic<long long> scans{ 0 };
+    std::atomic<long long> visited{ 0 };
+    std::atomic<long long> scanTime{ 0 };
+    std::vector<std::thread> workers;
+    for (int t{ 0 }; t < scanners; ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            long long ownScans{ 0 };
+            long long ownVisited{ 0 };
+            long long ownTime{ 0 };
+
+            ++ready;
+            while (not start.load())
+            {
+                std::this_thread::yield();
+            }
+
+            do
+            {
+                Timer timer;
+                ownVisited += scanAll(container);
+                ownTime += timer.elapsedNanoseconds();
+                ++ownScans;
+            }
+            while (not done.load());
+
+            scans += ownScans;
+            visited += ownVisited;
+            scanTime += ownTime;
+        });
+    }
+
+    while (ready.load() < scanners)
+    {
+        std::this_thread::yield();
+    }
+    start = true;
     Timer timer;
+    for (size_t i{ 0 }; i < work.size(); ++i)
+    {
+        if (i % 2 == 0)
+        {
+            container.insert(std::pair<key_type, data_type>{ work[i], value });
+        }
+        else
+        {
+            container.erase(work[i]);
+        }
+    }
+    long long duration{ timer.elapsedNanoseconds() };
+    result.versions_ = storedVersions(container);
+    done = true;
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    result.writeTime_ = static_cast<int>(duration / 1000000);
+    result.writeMops_ = (duration > 0) ? result.writes_ * 1000.0 / duration : 0.0;
+    result.scans_ = scans.load();
+    result.scanKey_ = (visited.load() > 0) ? static_cast<double>(scanTime.load()) / visited.load() : 0.0;
+
+    if (VERBOSE)
+    {
+        std::cout << "Scanned " << visited.load() << " keys in " << result.scans_ << " scans of "
+                  << getDescription<Container>().name_ << ", which contains " << container.size()
+                  << " keys" << std::endl;
+        std::cout << std::endl;
+    }
+
+    return result;
+}
+
+// Changes the key of every entry by offset, first by copying the value to a new
+// entry and then back by moving the node with a node handle. Finally moves all
+// the entries to another container of the same type with node handles.
+template<typename Container>
+RekeyTime runRekeyTest(Container& container, const std::vector<key_type>& keys,
+                       const std::vector<data_type>& values, key_type offset)
+{
+    RekeyTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = keys.size();
+
+    for (size_t i{ 0 }; i < keys.size() and i < values.size(); ++i)
+    {
+        container.insert(std::pair<key_type, data_type>{ keys[i], values[i] });
+    }
+
+    Timer copyTimer;
     for (auto key : keys)
     {
+        auto value{ findValue(container, key) };
         container.erase(key);
+        container.insert(std::pair<key_type, data_type>{ key + offset, value });
     }
-    double duration{ timer.elapsed() };
+    result.copy_ = static_cast<int>(copyTimer.elapsed());
+
+    Timer handleTimer;
+    for (auto key : keys)
+    {
+        auto handle{ container.extract(key + offset) };
+        handle.key() = key;
+        container.insert(std::move(handle));
+    }
+    result.handle_ = static_cast<int>(handleTimer.elapsed());
+
+    Container other;
+    Timer moveTimer;
+    for (auto key : keys)
+    {
+        other.insert(container.extract(key));
+    }
+    result.move_ = static_cast<int>(moveTimer.elapsed());
 
     if (VERBOSE)
     {
-        std::cout << "Deleted " << keys.size() << " from ";
+        std::cout << "Re-keyed " << keys.size() << " entries of ";
         std::cout << getDescription<Container>().name_ << std::endl;
-        std::cout << "Time duration: " << duration << " ms" << std::endl;
-        std::cout << getDescription<Container>().name_;
-        std::cout << " contains " << container.size() << " nodes. ";
-        std::cout << "Tree height is " << getHeight(container) << std::endl;
+        std::cout << "Copying: " << result.copy_ << " ms, node handles: "
+                  << result.handle_ << " ms" << std::endl;
         std::cout << std::endl;
     }
 
-    return static_cast<int>(duration);
+    return result;
+}
+
+// Inserts the string keys and searches all of them with the probes,
+// counting the memory allocations made by the search
+template<typename Container, typename Key, typename Probe>
+StringTime runStringTest(Container& container, const std::vector<Key>& keys,
+                         const std::vector<data_type>& values,
+                         const std::vector<Probe>& probes)
+{
+    StringTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = keys.size();
+    result.insert_ = insertValues(container, keys, values);
+
+    auto allocationsBefore{ allocations() };
+    result.search_ = searchValues(container, probes);
+    result.allocations_ = allocations() - allocationsBefore;
+
+    if (VERBOSE)
+    {
+        std::cout << "Searched " << probes.size() << " string keys from ";
+        std::cout << getDescription<Container>().name_ << std::endl;
+        std::cout << "Memory allocations: " << result.allocations_ << std::endl;
+        std::cout << std::endl;
+    }
+
+    return result;
 }
 
+// Inserts, searches and deletes the keys and counts the key comparisons
 template<typename Container>
-TestTime runTest(Container& container, const TestData& testData)
+CompareTime runCompareTest(Container& container, const std::vector<CountedKey>& keys,
+                           const std::vector<data_type>& values,
+                           const std::vector<CountedKey>& searchKeys)
 {
-    TestTime newTest;
-    newTest.n_ = 0;
+    CompareTime result;
+    std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
+    container.clear();
+    result.tree_ = getDescription<Container>().identifier_;
+    result.n_ = keys.size();
 
-    if (testData.bst or getDescription<Container>().balanced_)
+    auto perOperation = [](unsigned long long comparisons, size_t operations)
     {
-        newTest.test_ = testData.testName;
-        newTest.n_ = testData.insertKeys1.size();
+        return operations == 0 ? 0.0 : static_cast<double>(comparisons) / operations;
+    };
 
-        std::cout << std::setw(9) << " " << getDescription<Container>().name_ << std::endl;
-        container.clear();
-        newTest.tree_ = getDescription<Container>().identifier_;
-        newTest.insert1_ = insertValues(container, testData.insertKeys1, testData.insertData1);
-        newTest.height1_ = getHeight(container);
-        newTest.search1a_ = searchValues(container, testData.searchKeys1);
-        newTest.search1b_ = searchValues(container, testData.searchKeysAll);
-        newTest.delete1_ = deleteValues(container, testData.deleteKeys1);
-        newTest.height2_ = getHeight(container);
-        newTest.search2a_ = searchValues(container, testData.searchKeys2);
-        newTest.search2b_ = searchValues(container, testData.searchKeysAll);
-        newTest.insert2_ = insertValues(container, testData.insertKeys2, testData.insertData2);
-        newTest.height3_ = getHeight(container);
-        newTest.search3a_ = searchValues(container, testData.searchKeys3);
-        newTest.search3b_ = searchValues(container, testData.searchKeysAll);
-        newTest.delete2_ = deleteValues(container, testData.deleteKeys2);
-        newTest.total_ = newTest.insert1_ + newTest.insert2_ +
-                         newTest.delete1_ + newTest.delete2_ +
-                         newTest.search1a_ + newTest.search2a_ + newTest.search3a_ +
-                         newTest.search1b_ + newTest.search2b_ + newTest.search3b_;
+    auto comparisons{ CountedKey::comparisons_ };
+    insertValues(container, keys, values);
+    result.insert_ = perOperation(CountedKey::comparisons_ - comparisons, keys.size());
+
+    comparisons = CountedKey::comparisons_;
+    searchValues(container, searchKeys);
+    result.search_ = perOperation(CountedKey::comparisons_ - comparisons, searchKeys.size());
+
+    comparisons = CountedKey::comparisons_;
+    deleteValues(container, searchKeys);
+    result.delete_ = perOperation(CountedKey::comparisons_ - comparisons, searchKeys.size());
+
+    if (VERBOSE)
+    {
+        std::cout << "Counted the key comparisons of ";
+        std::cout << getDescription<Container>().name_ << std::endl;
+        std::cout << "Comparisons per search: " << result.search_ << std::endl;
+        std::cout << std::endl;
     }
 
-    return newTest;
+    return result;
+}
+
+template<typename TupleType, typename Function, std::size_t... I>
+void forEachContainer(TupleType& t, Function& function, std::index_sequence<I...>)
+{
+    // The braced initializer list calls the function for the containers in order
+    int order[]{ 0, (function(std::get<I>(t)), 0)... };
+    static_cast<void>(order);
+}
+
+// Calls the function for each container in the tuple
+template<typename TupleType, typename Function>
+void forEachContainer(TupleType& t, Function function)
+{
+    forEachContainer(t, function, std::make_index_sequence<std::tuple_size<TupleType>::value>{});
 }
 
 template<typename TupleType>
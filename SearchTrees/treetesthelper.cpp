@@ -1,8 +1,36 @@
 #include "treetesthelper.hh"
+#include <algorithm>
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
 #include <vector>
 
+namespace
+{
+
+// The number of memory allocations and deallocations made by each thread,
+// counted by the replaced global operator new and operator delete
+thread_local unsigned long long allocationCount{ 0 };
+thread_local unsigned long long deallocationCount{ 0 };
+
+// Formats the number of rotations per operation, or "-" if it is not available
+std::string formatRotations(double rotations)
+{
+    if (rotations < 0.0)
+    {
+        return "-";
+    }
+
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(2) << rotations;
+    return stream.str();
+}
+
+} // namespace
+
 void printTestHeader()
 {
     std::cout << std::setw(5) << std::left << "tree"
@@ -15,16 +43,18 @@ void printTestHeader()
               << std::setw(7) << std::right << "st1a"
               << std::setw(7) << std::right << "st1b"
               << std::setw(7) << std::right << "dt1"
+              << std::setw(7) << std::right << "rot1"
               << std::setw(7) << std::right << "st2a"
               << std::setw(7) << std::right << "st2b"
               << std::setw(7) << std::right << "it2"
               << std::setw(7) << std::right << "st3a"
               << std::setw(7) << std::right << "st3b"
               << std::setw(7) << std::right << "dt2"
+              << std::setw(7) << std::right << "rot2"
               << std::setw(7) << std::right << "total"
               << std::endl;
 
-    for (int i{ 0 }; i < 115; ++i)
+    for (int i{ 0 }; i < 129; ++i)
     {
         std::cout << "-";
     }
@@ -43,12 +73,14 @@ void printTestTime(const TestTime& test)
               << std::setw(7) << std::right << test.search1a_
               << std::setw(7) << std::right << test.search1b_
               << std::setw(7) << std::right << test.delete1_
+              << std::setw(7) << std::right << formatRotations(test.rotations1_)
               << std::setw(7) << std::right << test.search2a_
               << std::setw(7) << std::right << test.search2b_
               << std::setw(7) << std::right << test.insert2_
               << std::setw(7) << std::right << test.search3a_
               << std::setw(7) << std::right << test.search3b_
               << std::setw(7) << std::right << test.delete2_
+              << std::setw(7) << std::right << formatRotations(test.rotations2_)
               << std::setw(7) << std::right << test.total_
               << std::endl;
 }
@@ -87,6 +119,8 @@ std::vector<TestTime> takeAverages(const std::vector<TestTime>& testTimes)
         newTest.insert2_ = 0;
         newTest.delete1_ = 0;
         newTest.delete2_ = 0;
+        newTest.rotations1_ = 0.0;
+        newTest.rotations2_ = 0.0;
         newTest.search1a_ = 0;
         newTest.search1b_ = 0;
         newTest.search2a_ = 0;
@@ -110,6 +144,8 @@ std::vector<TestTime> takeAverages(const std::vector<TestTime>& testTimes)
                 newTest.insert2_ += testTimes[i].insert2_;
                 newTest.delete1_ += testTimes[i].delete1_;
                 newTest.delete2_ += testTimes[i].delete2_;
+                newTest.rotations1_ += testTimes[i].rotations1_;
+                newTest.rotations2_ += testTimes[i].rotations2_;
                 newTest.search1a_ += testTimes[i].search1a_;
                 newTest.search1b_ += testTimes[i].search1b_;
                 newTest.search2a_ += testTimes[i].search2a_;
@@ -129,6 +165,8 @@ std::vector<TestTime> takeAverages(const std::vector<TestTime>& testTimes)
             newTest.insert2_ /= count;
             newTest.delete1_ /= count;
             newTest.delete2_ /= count;
+            newTest.rotations1_ /= count;
+            newTest.rotations2_ /= count;
             newTest.search1a_ /= count;
             newTest.search1b_ /= count;
             newTest.search2a_ /= count;
@@ -143,3 +181,518 @@ std::vector<TestTime> takeAverages(const std::vector<TestTime>& testTimes)
 
     return averageTimes;
 }
+
+void printLatencyHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(7) << std::right << "burst"
+              << std::setw(9) << std::right << "p50"
+              << std::setw(9) << std::right << "p99"
+              << std::setw(9) << std::right << "max"
+              << std::setw(7) << std::right << "h1"
+              << std::setw(7) << std::right << "h2"
+              << std::setw(9) << std::right << "rebal"
+              << std::endl;
+
+    for (int i{ 0 }; i < 74; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printLatencyTime(const LatencyTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(9) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(5) << std::right << test.burst_
+              << std::setw(9) << std::right << test.p50_
+              << std::setw(9) << std::right << test.p99_
+              << std::setw(9) << std::right << test.max_
+              << std::setw(7) << std::right << test.height1_
+              << std::setw(7) << std::right << test.height2_
+              << std::setw(9) << std::right << test.rebalance_
+              << std::endl;
+}
+
+void printQueueHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(9) << std::right << "fill"
+              << std::setw(9) << std::right << "queue"
+              << std::setw(9) << std::right << "drain"
+              << std::setw(7) << std::right << "h"
+              << std::endl;
+
+    for (int i{ 0 }; i < 48; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printQueueTime(const QueueTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(9) << std::right << test.fill_
+              << std::setw(9) << std::right << test.queue_
+              << std::setw(9) << std::right << test.drain_
+              << std::setw(7) << std::right << test.height_
+              << std::endl;
+}
+
+void printScanHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(9) << std::right << "full"
+              << std::setw(9) << std::right << "range"
+              << std::setw(12) << std::right << "visited"
+              << std::endl;
+
+    for (int i{ 0 }; i < 45; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printScanTime(const ScanTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(9) << std::right << test.full_
+              << std::setw(9) << std::right << test.range_
+              << std::setw(12) << std::right << test.visited_
+              << std::endl;
+}
+
+void printRekeyHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(9) << std::right << "copy"
+              << std::setw(9) << std::right << "handle"
+              << std::setw(9) << std::right << "move"
+              << std::endl;
+
+    for (int i{ 0 }; i < 41; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printRekeyTime(const RekeyTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(9) << std::right << test.copy_
+              << std::setw(9) << std::right << test.handle_
+              << std::setw(9) << std::right << test.move_
+              << std::endl;
+}
+
+void printStringHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(9) << std::right << "insert"
+              << std::setw(9) << std::right << "search"
+              << std::setw(12) << std::right << "allocs"
+              << std::endl;
+
+    for (int i{ 0 }; i < 42; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printStringTime(const StringTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(9) << std::right << test.insert_
+              << std::setw(9) << std::right << test.search_
+              << std::setw(12) << std::right << test.allocations_
+              << std::endl;
+}
+
+void printMultiHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(9) << std::right << "insert"
+              << std::setw(9) << std::right << "count"
+              << std::setw(9) << std::right << "range"
+              << std::setw(9) << std::right << "erase"
+              << std::setw(12) << std::right << "entries"
+              << std::endl;
+
+    for (int i{ 0 }; i < 60; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printMultiTime(const MultiTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(9) << std::right << test.insert_
+              << std::setw(9) << std::right << test.count_
+              << std::setw(9) << std::right << test.range_
+              << std::setw(9) << std::right << test.erase_
+              << std::setw(12) << std::right << test.entries_
+              << std::endl;
+}
+
+void printAggregateHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(9) << std::right << "width"
+              << std::setw(11) << std::right << "aggregate"
+              << std::setw(9) << std::right << "scan"
+              << std::setw(18) << std::right << "sum"
+              << std::endl;
+
+    for (int i{ 0 }; i < 59; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printAggregateTime(const AggregateTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(9) << std::right << test.width_
+              << std::setw(11) << std::right << test.aggregate_
+              << std::setw(9) << std::right << test.scan_
+              << std::setw(18) << std::right << test.sum_
+              << std::endl;
+}
+
+void printIntervalHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(9) << std::right << "insert"
+              << std::setw(9) << std::right << "stab"
+              << std::setw(9) << std::right << "window"
+              << std::setw(12) << std::right << "found"
+              << std::endl;
+
+    for (int i{ 0 }; i < 51; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printIntervalTime(const IntervalTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(9) << std::right << test.insert_
+              << std::setw(9) << std::right << test.stab_
+              << std::setw(9) << std::right << test.window_
+              << std::setw(12) << std::right << test.found_
+              << std::endl;
+}
+
+void printPersistentHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(9) << std::right << "insert"
+              << std::setw(10) << std::right << "snapshot"
+              << std::setw(9) << std::right << "erase"
+              << std::setw(11) << std::right << "retained"
+              << std::endl;
+
+    for (int i{ 0 }; i < 51; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printPersistentTime(const PersistentTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(9) << std::right << test.insert_
+              << std::setw(10) << std::right << test.snapshot_
+              << std::setw(9) << std::right << test.erase_
+              << std::setw(11) << std::right << test.retained_
+              << std::endl;
+}
+
+void printConcurrentHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(9) << std::right << "threads"
+              << std::setw(7) << std::right << "reads"
+              << std::setw(11) << std::right << "ops"
+              << std::setw(9) << std::right << "time"
+              << std::setw(9) << std::right << "Mops/s"
+              << std::endl;
+
+    for (int i{ 0 }; i < 50; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printConcurrentTime(const ConcurrentTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(9) << std::right << test.threads_
+              << std::setw(6) << std::right << test.reads_ << "%"
+              << std::setw(11) << std::right << test.operations_
+              << std::setw(9) << std::right << test.time_
+              << std::fixed << std::setprecision(2)
+              << std::setw(9) << std::right << test.mops_
+              << std::defaultfloat
+              << std::endl;
+}
+
+void printReclamationHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(9) << std::right << "threads"
+              << std::setw(11) << std::right << "ops"
+              << std::setw(9) << std::right << "time"
+              << std::setw(9) << std::right << "ns/op"
+              << std::setw(10) << std::right << "pending"
+              << std::endl;
+
+    for (int i{ 0 }; i < 53; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printReclamationTime(const ReclamationTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(9) << std::right << test.threads_
+              << std::setw(11) << std::right << test.operations_
+              << std::setw(9) << std::right << test.time_
+              << std::fixed << std::setprecision(2)
+              << std::setw(9) << std::right << test.perOperation_
+              << std::defaultfloat
+              << std::setw(10) << std::right << test.pending_
+              << std::endl;
+}
+
+void printSnapshotHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(10) << std::right << "scanners"
+              << std::setw(10) << std::right << "writes"
+              << std::setw(9) << std::right << "time"
+              << std::setw(9) << std::right << "Mops/s"
+              << std::setw(8) << std::right << "scans"
+              << std::setw(9) << std::right << "ns/key"
+              << std::setw(10) << std::right << "versions"
+              << std::endl;
+
+    for (int i{ 0 }; i < 77; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printSnapshotTime(const SnapshotTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::right << test.n_
+              << std::setw(10) << std::right << test.scanners_
+              << std::setw(10) << std::right << test.writes_
+              << std::setw(9) << std::right << test.writeTime_
+              << std::fixed << std::setprecision(2)
+              << std::setw(9) << std::right << test.writeMops_
+              << std::setw(8) << std::right << test.scans_
+              << std::setw(9) << std::right << test.scanKey_
+              << std::defaultfloat
+              << std::setw(10) << std::right << test.versions_
+              << std::endl;
+}
+
+std::vector<int> threadCounts()
+{
+    int hardware{ std::max(1, static_cast<int>(std::thread::hardware_concurrency())) };
+    std::vector<int> counts;
+    for (int threads{ 1 }; threads < hardware; threads *= 2)
+    {
+        counts.push_back(threads);
+    }
+    counts.push_back(hardware);
+    return counts;
+}
+
+std::vector<int> scalingThreads()
+{
+    int hardware{ std::max(1, static_cast<int>(std::thread::hardware_concurrency())) };
+    std::vector<int> counts;
+    for (int threads{ 1 }; threads <= hardware; ++threads)
+    {
+        counts.push_back(threads);
+    }
+    return counts;
+}
+
+void printScalingHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(9) << std::left << "  n"
+              << std::setw(5) << std::left << "mix"
+              << std::setw(7) << std::right << "share"
+              << std::setw(9) << std::right << "threads"
+              << std::setw(11) << std::right << "ops"
+              << std::setw(9) << std::right << "time"
+              << std::setw(9) << std::right << "Mops/s"
+              << std::setw(7) << std::right << "eff"
+              << std::setw(7) << std::right << "fair"
+              << std::setw(9) << std::right << "min/max"
+              << std::endl;
+
+    for (int i{ 0 }; i < 87; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printScalingTime(const ScalingTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(9) << std::left << (std::to_string(test.n_) + ":")
+              << std::setw(5) << std::left << (test.mix_ + ":")
+              << std::setw(7) << std::right << (test.shared_ ? "shared" : "own")
+              << std::setw(9) << std::right << test.threads_
+              << std::setw(11) << std::right << test.operations_
+              << std::setw(9) << std::right << test.time_
+              << std::fixed << std::setprecision(2)
+              << std::setw(9) << std::right << test.mops_
+              << std::setw(7) << std::right << test.efficiency_
+              << std::setw(7) << std::right << test.fairness_
+              << std::setw(9) << std::right << test.minMax_
+              << std::defaultfloat
+              << std::endl;
+}
+
+void printServiceHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(11) << std::right << "producers"
+              << std::setw(8) << std::right << "window"
+              << std::setw(11) << std::right << "ops"
+              << std::setw(9) << std::right << "time"
+              << std::setw(9) << std::right << "Mops/s"
+              << std::setw(8) << std::right << "batch"
+              << std::setw(10) << std::right << "lat(us)"
+              << std::setw(10) << std::right << "max(us)"
+              << std::endl;
+
+    for (int i{ 0 }; i < 81; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printServiceTime(const ServiceTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(11) << std::right << test.producers_
+              << std::setw(8) << std::right << test.window_
+              << std::setw(11) << std::right << test.operations_
+              << std::setw(9) << std::right << test.time_
+              << std::fixed << std::setprecision(2)
+              << std::setw(9) << std::right << test.mops_
+              << std::setw(8) << std::right << test.batch_
+              << std::setw(10) << std::right << test.latency_
+              << std::setw(10) << std::right << test.maxLatency_
+              << std::defaultfloat
+              << std::endl;
+}
+
+void printCompareHeader()
+{
+    std::cout << std::setw(5) << std::left << "tree"
+              << std::setw(7) << std::left << "  n"
+              << std::setw(9) << std::right << "insert"
+              << std::setw(9) << std::right << "search"
+              << std::setw(9) << std::right << "delete"
+              << std::endl;
+
+    for (int i{ 0 }; i < 39; ++i)
+    {
+        std::cout << "-";
+    }
+    std::cout << std::endl;
+}
+
+void printCompareTime(const CompareTime& test)
+{
+    std::cout << std::setw(5) << std::left << (test.tree_ + ":")
+              << std::setw(7) << std::left << (std::to_string(test.n_) + ":")
+              << std::fixed << std::setprecision(2)
+              << std::setw(9) << std::right << test.insert_
+              << std::setw(9) << std::right << test.search_
+              << std::setw(9) << std::right << test.delete_
+              << std::defaultfloat
+              << std::endl;
+}
+
+unsigned long long allocations()
+{
+    return allocationCount;
+}
+
+unsigned long long deallocations()
+{
+    return deallocationCount;
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocationCount;
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+    {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* memory) noexcept
+{
+    if (memory != nullptr)
+    {
+        ++deallocationCount;
+    }
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    if (memory != nullptr)
+    {
+        ++deallocationCount;
+    }
+    std::free(memory);
+}
@@ -8,20 +8,336 @@
 #include "aatree.hh"
 #include "avltree.hh"
 #include "binarysearchtree.hh"
+#include "concurrentavltree.hh"
+#include "concurrenttree.hh"
+#include "epochreclamation.hh"
+#include "flatcombiningtree.hh"
+#include "intervaltree.hh"
+#include "lockfreetree.hh"
+#include "nodepool.hh"
+#include "persistentavltree.hh"
+#include "monoid.hh"
+#include "multiversiontree.hh"
+#include "prefixkey.hh"
 #include "redblacktree.hh"
+#include "relaxedredblacktree.hh"
+#include "scapegoattree.hh"
+#include "shardedtree.hh"
+#include "skiplist.hh"
+#include "threadaffinity.hh"
+#include "treeservice.hh"
+#include "wavltree.hh"
+#include "weightbalancedtree.hh"
 #include <map>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <set>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 const bool VERBOSE = false;
 
+// The number of full scans and the length of the range scans in the scan test.
+// One range scan is started for every RANGE_SCAN_LENGTH / 10 keys.
+const int FULL_SCANS = 10;
+const int RANGE_SCAN_LENGTH = 100;
+
+// The average number of entries per key in the multimap test
+const int MULTI_DUPLICATES = 10;
+
+// The widths of the key ranges in the aggregate test. The keys are spread over
+// 10*n values, so a range contains about width / 10 keys.
+const std::vector<int> AGGREGATE_WIDTHS{ 100, 10000, 1000000 };
+
+// The longest interval and the width of the query windows in the interval test
+const int INTERVAL_LENGTH = 1000;
+const int INTERVAL_WINDOW = 1000;
+
+// The number of snapshots taken while inserting the keys in the persistence test
+const int PERSISTENT_SNAPSHOTS = 10;
+
+// The percentages of reads in the operation mixes of the concurrent test. The rest
+// of the operations are inserts and erases in equal parts.
+const std::vector<int> CONCURRENT_READS{ 50, 90, 99 };
+
+// The thread counts of the reclamation test. They go past the number of hardware
+// threads, because the epoch can only advance when every pinned thread has run.
+const std::vector<int> RECLAMATION_THREADS{ 1, 2, 4, 8, 16, 32, 64 };
+
+// The numbers of scanning threads in the snapshot test, which run alongside one writer
+const std::vector<int> SNAPSHOT_SCANNERS{ 0, 1, 2, 4 };
+
+// An operation mix of the scaling test in percentages. A scan visits at most
+// RANGE_SCAN_LENGTH keys from a random key.
+struct OperationMix
+{
+    std::string name_;
+    int find_;
+    int insert_;
+    int erase_;
+    int scan_;
+};
+
+// The operation mixes of the scaling test: mostly reads, half updates, and reads
+// with range scans
+const std::vector<OperationMix> SCALING_MIXES{ { "rd", 90, 5, 5, 0 },
+                                               { "up", 50, 25, 25, 0 },
+                                               { "sc", 70, 10, 10, 10 } };
+
+// The numbers of producer threads in the service test, and how many requests a
+// producer makes before it waits for their results
+const std::vector<int> SERVICE_PRODUCERS{ 1, 2, 4, 8 };
+const std::vector<int> SERVICE_WINDOWS{ 1, 16, 256 };
+
+// Whether the threads of the scaling test share one container or each have their own
+enum class ContainerSharing
+{
+    Shared,
+    PerThread
+};
+
+// The number of keys found by the last searchValues call
+inline volatile size_t foundKeys{ 0 };
+
 using key_type = int;
 using data_type = std::string;
 using bst_tree = BinarySearchTree<TreeNode<key_type, data_type>>;
 using rbt_tree = RedBlackTree<RedBlackNode<key_type, data_type>>;
+using relaxed_tree = RelaxedRedBlackTree<RelaxedRedBlackNode<key_type, data_type>>;
 using avl_tree = AVLTree<AVLNode<key_type, data_type>>;
+using wavl_tree = WAVLTree<WAVLNode<key_type, data_type>>;
 using aa_tree = AATree<AANode<key_type, data_type>>;
+using wbt_tree = WeightBalancedTree<WeightBalancedNode<key_type, data_type>>;
+using sgt_tree = ScapegoatTree<TreeNode<key_type, data_type>>;
 using map_tree = std::map<key_type, data_type>;
+using threaded_rbt_tree = RedBlackTree<RedBlackNode<key_type, data_type, true>>;
+using threaded_avl_tree = AVLTree<AVLNode<key_type, data_type, true>>;
+using threaded_aa_tree = AATree<AANode<key_type, data_type, true>>;
+
+// The set containers, whose nodes store no value
+using set_bst_tree = BinarySearchTree<TreeNode<key_type, void>>;
+using set_rbt_tree = RedBlackTree<RedBlackNode<key_type, void>>;
+using set_avl_tree = AVLTree<AVLNode<key_type, void>>;
+using set_aa_tree = AATree<AANode<key_type, void>>;
+using set_tree = std::set<key_type>;
+
+// The multimap containers, which keep all the entries with equal keys
+using multi_rbt_tree = RedBlackTree<RedBlackNode<key_type, data_type>, std::less<key_type>, true>;
+using multi_avl_tree = AVLTree<AVLNode<key_type, data_type>, std::less<key_type>, true>;
+using multi_aa_tree = AATree<AANode<key_type, data_type>, std::less<key_type>, true>;
+using multi_bst_tree = BinarySearchTree<TreeNode<key_type, data_type>, std::less<key_type>, true>;
+using multimap_tree = std::multimap<key_type, data_type>;
+
+// The containers of the aggregate test, whose values are summed over key ranges
+using sum_type = long long;
+using sum_rbt_tree = RedBlackTree<RedBlackNode<key_type, sum_type, false, SumMonoid<sum_type>>>;
+using sum_avl_tree = AVLTree<AVLNode<key_type, sum_type, false, SumMonoid<sum_type>>>;
+using sum_aa_tree = AATree<AANode<key_type, sum_type, false, SumMonoid<sum_type>>>;
+using sum_map_tree = std::map<key_type, sum_type>;
+
+// The containers of the interval test. The multimap of intervals keyed by the low
+// endpoint can only be searched by scanning all the intervals that start early enough.
+using interval_type = Interval<key_type, key_type>;
+using interval_tree = IntervalTree<IntervalNode<key_type, key_type>>;
+using interval_map_tree = std::multimap<key_type, interval_type>;
+
+// The persistent tree, whose versions share the unchanged subtrees
+using persistent_avl_tree = PersistentAVLTree<PersistentAVLNode<key_type, data_type>>;
+
+// The trees whose nodes have atomic links, so that readers can search them without locking
+using atomic_rbt_tree = RedBlackTree<RedBlackNode<key_type, data_type, false, void, true>>;
+using atomic_avl_tree = AVLTree<AVLNode<key_type, data_type, false, void, true>>;
+
+// The thread-safe containers
+using mutex_rbt_tree = ConcurrentTree<rbt_tree, ConcurrencyMode::Exclusive>;
+using mutex_avl_tree = ConcurrentTree<avl_tree, ConcurrencyMode::Exclusive>;
+using mutex_aa_tree = ConcurrentTree<aa_tree, ConcurrencyMode::Exclusive>;
+using fc_rbt_tree = FlatCombiningTree<rbt_tree>;
+using fc_avl_tree = FlatCombiningTree<avl_tree>;
+using fc_aa_tree = FlatCombiningTree<aa_tree>;
+using rw_rbt_tree = ConcurrentTree<rbt_tree, ConcurrencyMode::ReaderWriter>;
+using optimistic_rbt_tree = ConcurrentTree<atomic_rbt_tree, ConcurrencyMode::Optimistic>;
+using striped_rbt_tree = ConcurrentTree<rbt_tree, ConcurrencyMode::Striped>;
+using rw_avl_tree = ConcurrentTree<avl_tree, ConcurrencyMode::ReaderWriter>;
+using optimistic_avl_tree = ConcurrentTree<atomic_avl_tree, ConcurrencyMode::Optimistic>;
+using striped_avl_tree = ConcurrentTree<avl_tree, ConcurrencyMode::Striped>;
+using lockfree_tree = LockFreeTree<LockFreeNode<key_type, data_type>>;
+using concurrent_avl_tree = ConcurrentAVLTree<ConcurrentAVLNode<key_type, data_type>>;
+using skiplist_tree = SkipList<SkipListNode<key_type, data_type>>;
+using sharded_rbt_tree = ShardedTree<rbt_tree, ShardingMode::Locked>;
+using sharded_avl_tree = ShardedTree<avl_tree, ShardingMode::Locked>;
+using delegated_rbt_tree = ShardedTree<rbt_tree, ShardingMode::Delegated>;
+using delegated_avl_tree = ShardedTree<avl_tree, ShardingMode::Delegated>;
+using mvcc_rbt_tree = MultiVersionTree<key_type, data_type>;
+using service_rbt_tree = TreeService<rbt_tree>;
+using service_avl_tree = TreeService<avl_tree>;
+
+// std::map behind a reader-writer lock, with the interface of the thread-safe trees
+class LockedMap
+{
+public:
+    using size_type = map_tree::size_type;
+
+    size_type size() const
+    {
+        std::shared_lock<std::shared_mutex> lock{ mutex_ };
+        return map_.size();
+    }
+
+    void clear()
+    {
+        std::unique_lock<std::shared_mutex> lock{ mutex_ };
+        map_.clear();
+    }
+
+    bool contains(const key_type& key) const
+    {
+        std::shared_lock<std::shared_mutex> lock{ mutex_ };
+        return map_.find(key) != map_.end();
+    }
+
+    bool insert(const map_tree::value_type& value)
+    {
+        std::unique_lock<std::shared_mutex> lock{ mutex_ };
+        return map_.insert(value).second;
+    }
+
+    size_type erase(const key_type& key)
+    {
+        std::unique_lock<std::shared_mutex> lock{ mutex_ };
+        return map_.erase(key);
+    }
+
+private:
+    mutable std::shared_mutex mutex_;
+    map_tree map_;
+};
+
+// The ways to free the nodes in the reclamation test. DeleteReclaimer frees a node
+// as soon as it is retired, which is the cost without concurrent readers.
+// EpochReclaimer frees the nodes with delete and PooledReclaimer returns them to a
+// NodePool after no pinned thread can be reading them.
+using retired_type = std::pair<key_type, data_type>;
+
+struct DeleteReclaimer
+{
+    // Pins nothing
+    struct Guard
+    {
+        Guard()
+        {}
+    };
+
+    retired_type* create(key_type key, const data_type& value)
+    {
+        return new retired_type{ key, value };
+    }
+
+    void retire(retired_type* node)
+    {
+        delete node;
+    }
+};
+
+struct EpochReclaimer
+{
+    using Guard = EpochReclamation::Guard;
+
+    retired_type* create(key_type key, const data_type& value)
+    {
+        return new retired_type{ key, value };
+    }
+
+    void retire(retired_type* node)
+    {
+        EpochReclamation::retire(node);
+    }
+};
+
+struct PooledReclaimer
+{
+    using Guard = EpochReclamation::Guard;
+
+    NodePool& pool_{ NodePool::shared(sizeof(retired_type)) };
+
+    retired_type* create(key_type key, const data_type& value)
+    {
+        return new (pool_.allocate()) retired_type{ key, value };
+    }
+
+    void retire(retired_type* node)
+    {
+        EpochReclamation::retire(node, pool_);
+    }
+};
+
+// The containers with string keys for the string lookup test. The transparent
+// ones use std::less<>, so they can be searched without constructing a key.
+using string_key_type = std::string;
+using string_rbt_tree = RedBlackTree<RedBlackNode<string_key_type, data_type>>;
+using transparent_rbt_tree = RedBlackTree<RedBlackNode<string_key_type, data_type>, std::less<>>;
+using string_avl_tree = AVLTree<AVLNode<string_key_type, data_type>>;
+using transparent_avl_tree = AVLTree<AVLNode<string_key_type, data_type>, std::less<>>;
+using string_map_tree = std::map<string_key_type, data_type>;
+using transparent_map_tree = std::map<string_key_type, data_type, std::less<>>;
+
+// The string keys with an inline order-preserving prefix. The containers are
+// searched with PrefixView probes.
+using prefix_key_type = PrefixKey;
+using prefix_rbt_tree = RedBlackTree<RedBlackNode<prefix_key_type, data_type>, PrefixCompare>;
+using prefix_avl_tree = AVLTree<AVLNode<prefix_key_type, data_type>, PrefixCompare>;
+using prefix_map_tree = std::map<prefix_key_type, data_type, PrefixCompare>;
+
+// An int key that counts how many times keys are compared
+struct CountedKey
+{
+    int value_;
+
+    static inline unsigned long long comparisons_{ 0 };
+};
+
+inline bool operator<(const CountedKey& a, const CountedKey& b)
+{
+    ++CountedKey::comparisons_;
+    return a.value_ < b.value_;
+}
+
+inline std::ostream& operator<<(std::ostream& stream, const CountedKey& key)
+{
+    return stream << key.value_;
+}
+
+// A comparator for CountedKey with a three-way compare member function,
+// so that the trees compare the keys only once per visited node
+struct CountedCompare
+{
+    bool operator()(const CountedKey& a, const CountedKey& b) const
+    {
+        return a < b;
+    }
+
+    int compare(const CountedKey& a, const CountedKey& b) const
+    {
+        ++CountedKey::comparisons_;
+        return (a.value_ > b.value_) - (a.value_ < b.value_);
+    }
+};
+
+// The containers for the comparison count test. The three-way ones use CountedCompare.
+using counted_bst_tree = BinarySearchTree<TreeNode<CountedKey, data_type>>;
+using threeway_bst_tree = BinarySearchTree<TreeNode<CountedKey, data_type>, CountedCompare>;
+using counted_rbt_tree = RedBlackTree<RedBlackNode<CountedKey, data_type>>;
+using threeway_rbt_tree = RedBlackTree<RedBlackNode<CountedKey, data_type>, CountedCompare>;
+using counted_avl_tree = AVLTree<AVLNode<CountedKey, data_type>>;
+using threeway_avl_tree = AVLTree<AVLNode<CountedKey, data_type>, CountedCompare>;
+using counted_aa_tree = AATree<AANode<CountedKey, data_type>>;
+using threeway_aa_tree = AATree<AANode<CountedKey, data_type>, CountedCompare>;
+using counted_map_tree = std::map<CountedKey, data_type>;
 
 // A struct for storing the test results
 struct TestTime
@@ -36,6 +352,8 @@ struct TestTime
     int insert2_;
     int delete1_;
     int delete2_;
+    double rotations1_;
+    double rotations2_;
     int search1a_;
     int search1b_;
     int search2a_;
@@ -45,6 +363,256 @@ struct TestTime
     int total_;
 };
 
+// A struct for storing the results of the insert latency test
+//  burst_: how many keys are inserted between two rebalancing rounds
+//  p50_, p99_, max_: the insert latency percentiles in nanoseconds
+//  height1_: the tree height after the last burst before rebalancing
+//  height2_: the tree height after rebalancing
+//  rebalance_: the total rebalancing time in microseconds
+struct LatencyTime
+{
+    std::string tree_;
+    int n_;
+    int burst_;
+    int p50_;
+    int p99_;
+    int max_;
+    int height1_;
+    int height2_;
+    int rebalance_;
+};
+
+// A struct for storing the results of the priority queue test
+//  fill_: the time to insert n increasing keys
+//  queue_: the time of n steady state steps, each inserting a new maximum and removing the minimum
+//  drain_: the time to remove all the keys in increasing order
+//  height_: the tree height after the steady state steps
+struct QueueTime
+{
+    std::string tree_;
+    int n_;
+    int fill_;
+    int queue_;
+    int drain_;
+    int height_;
+};
+
+// A struct for storing the results of the scan test
+//  full_: the time of the full in-order scans
+//  range_: the time of the short range scans starting from random keys
+//  visited_: the number of nodes visited in all the scans
+struct ScanTime
+{
+    std::string tree_;
+    int n_;
+    int full_;
+    int range_;
+    long long visited_;
+};
+
+// A struct for storing the results of the re-keying test
+//  copy_: the time to re-key all the entries with erase and insert
+//  handle_: the time to re-key all the entries with extract and node handle insert
+//  move_: the time to move all the entries to another container with node handles
+struct RekeyTime
+{
+    std::string tree_;
+    int n_;
+    int copy_;
+    int handle_;
+    int move_;
+};
+
+// A struct for storing the results of the string lookup test
+//  insert_: the time to insert the string keys
+//  search_: the time to search all the keys with the probes
+//  allocations_: the number of memory allocations made during the search
+struct StringTime
+{
+    std::string tree_;
+    int n_;
+    int insert_;
+    int search_;
+    unsigned long long allocations_;
+};
+
+// A struct for storing the results of the comparison count test
+//  insert_, search_, delete_: the average number of key comparisons per operation
+struct CompareTime
+{
+    std::string tree_;
+    int n_;
+    double insert_;
+    double search_;
+    double delete_;
+};
+
+// A struct for storing the results of the multimap test
+//  insert_: the time to insert all the entries
+//  count_: the time to count the entries of every key
+//  range_: the time to visit the entries of every key through the equal range
+//  erase_: the time to erase all the keys
+//  entries_: the number of entries counted for all the keys
+struct MultiTime
+{
+    std::string tree_;
+    int n_;
+    int insert_;
+    int count_;
+    int range_;
+    int erase_;
+    long long entries_;
+};
+
+// A struct for storing the results of the aggregate test
+//  width_: the width of the key ranges
+//  aggregate_: the time to sum the ranges with the subtree summaries
+//  scan_: the time to sum the ranges by visiting every entry in them
+//  sum_: the sum of all the ranges
+struct AggregateTime
+{
+    std::string tree_;
+    int n_;
+    int width_;
+    int aggregate_;
+    int scan_;
+    long long sum_;
+};
+
+// A struct for storing the results of the interval test
+//  insert_: the time to insert all the intervals
+//  stab_: the time to find the intervals that contain the query points
+//  window_: the time to find the intervals that overlap the query windows
+//  found_: the number of intervals found by all the queries
+struct IntervalTime
+{
+    std::string tree_;
+    int n_;
+    int insert_;
+    int stab_;
+    int window_;
+    long long found_;
+};
+
+// A struct for storing the results of the persistence test
+//  insert_: the time to insert all the keys, not counting the snapshots
+//  snapshot_: the time to take all the snapshots
+//  erase_: the time to erase all the keys after the snapshots have been dropped
+//  retained_: the number of memory blocks held by the container and the
+//             snapshots after all the keys have been inserted
+struct PersistentTime
+{
+    std::string tree_;
+    int n_;
+    int insert_;
+    int snapshot_;
+    int erase_;
+    long long retained_;
+};
+
+// A struct for storing the results of the concurrent test
+//  threads_: the number of threads
+//  reads_: the percentage of reads in the operation mix
+//  operations_: the number of operations done by all the threads
+//  time_: the time to do all the operations
+//  mops_: millions of operations per second
+struct ConcurrentTime
+{
+    std::string tree_;
+    int threads_;
+    int reads_;
+    long long operations_;
+    int time_;
+    double mops_;
+};
+
+// A struct for storing the results of the reclamation test
+//  threads_: the number of threads
+//  operations_: the number of nodes created and retired by all the threads
+//  time_: the time to create and retire all the nodes
+//  perOperation_: nanoseconds per node
+//  pending_: the number of retired nodes that were not yet freed when the
+//            threads finished
+struct ReclamationTime
+{
+    std::string tree_;
+    int threads_;
+    long long operations_;
+    int time_;
+    double perOperation_;
+    long long pending_;
+};
+
+// A struct for storing the results of the snapshot test
+//  scanners_: the number of threads that scan the whole container while the writer runs
+//  writes_: the number of inserts and erases done by the writer
+//  writeTime_: the time to do all the writes
+//  writeMops_: millions of writes per second
+//  scans_: the number of full scans done by all the scanners
+//  scanKey_: nanoseconds per visited key in the scans
+//  versions_: the number of stored versions when the writer finished
+struct SnapshotTime
+{
+    std::string tree_;
+    int n_;
+    int scanners_;
+    long long writes_;
+    int writeTime_;
+    double writeMops_;
+    long long scans_;
+    double scanKey_;
+    long long versions_;
+};
+
+// A struct for storing the results of the scaling test
+//  mix_: the name of the operation mix
+//  shared_: whether the threads shared one container
+//  threads_: the number of threads
+//  operations_: the number of operations done by all the threads. The threads stop
+//               when the first of them has done n operations.
+//  time_: the time to do all the operations
+//  mops_: millions of operations per second
+//  efficiency_: mops_ divided by threads_ times the mops_ of one thread
+//  fairness_: Jain's fairness index of the operations done by each thread, from
+//             1 / threads_ when one thread did all the work to 1 when all did the same
+//  minMax_: the fewest operations done by a thread divided by the most
+struct ScalingTime
+{
+    std::string tree_;
+    std::string mix_;
+    bool shared_;
+    int n_;
+    int threads_;
+    long long operations_;
+    int time_;
+    double mops_;
+    double efficiency_;
+    double fairness_;
+    double minMax_;
+};
+
+// A struct for storing the results of the service test
+//  producers_: the number of threads that make requests
+//  window_: how many requests a producer makes before it waits for their results
+//  operations_: the number of requests made by all the producers
+//  time_: the time to make the requests and get all the results
+//  mops_: millions of requests per second
+//  batch_: the average number of requests in a batch
+//  latency_: the average time from a request to its result in microseconds
+//  maxLatency_: the longest time from a request to its result in microseconds
+struct ServiceTime
+{
+    std::string tree_;
+    int producers_;
+    int window_;
+    long long operations_;
+    int time_;
+    double mops_;
+    double batch_;
+    double latency_;
+    double maxLatency_;
+};
+
 struct TestData
 {
     std::string testName;
@@ -76,16 +644,115 @@ void printTestTime(const TestTime& test);
 // Calculates and returns the average results for similar tree, test type, and n
 std::vector<TestTime> takeAverages(const std::vector<TestTime>& testTimes);
 
+// Prints out the header line for the insert latency results
+void printLatencyHeader();
+// Prints out the insert latency results
+void printLatencyTime(const LatencyTime& test);
+
+// Prints out the header line for the priority queue results
+void printQueueHeader();
+// Prints out the priority queue results
+void printQueueTime(const QueueTime& test);
+
+// Prints out the header line for the scan results
+void printScanHeader();
+// Prints out the scan results
+void printScanTime(const ScanTime& test);
+
+// Prints out the header line for the re-keying results
+void printRekeyHeader();
+// Prints out the re-keying results
+void printRekeyTime(const RekeyTime& test);
+
+// Prints out the header line for the string lookup results
+void printStringHeader();
+// Prints out the string lookup results
+void printStringTime(const StringTime& test);
+
+// Prints out the header line for the multimap results
+void printMultiHeader();
+// Prints out the multimap results
+void printMultiTime(const MultiTime& test);
+
+// Prints out the header line for the aggregate results
+void printAggregateHeader();
+// Prints out the aggregate results
+void printAggregateTime(const AggregateTime& test);
+
+// Prints out the header line for the interval results
+void printIntervalHeader();
+// Prints out the interval results
+void printIntervalTime(const IntervalTime& test);
+
+// Prints out the header line for the persistence results
+void printPersistentHeader();
+// Prints out the persistence results
+void printPersistentTime(const PersistentTime& test);
+
+// Prints out the header line for the concurrent results
+void printConcurrentHeader();
+// Prints out the concurrent results
+void printConcurrentTime(const ConcurrentTime& test);
+
+// Prints out the header line for the reclamation results
+void printReclamationHeader();
+// Prints out the reclamation results
+void printReclamationTime(const ReclamationTime& test);
+
+// Prints out the header line for the snapshot results
+void printSnapshotHeader();
+// Prints out the snapshot results
+void printSnapshotTime(const SnapshotTime& test);
+
+// Prints out the header line for the scaling results
+void printScalingHeader();
+// Prints out the scaling results
+void printScalingTime(const ScalingTime& test);
+
+// Prints out the header line for the service results
+void printServiceHeader();
+// Prints out the service results
+void printServiceTime(const ServiceTime& test);
+
+// Prints out the header line for the comparison count results
+void printCompareHeader();
+// Prints out the comparison count results
+void printCompareTime(const CompareTime& test);
+
+// Returns the thread counts of the concurrent test: the powers of two up to the
+// number of hardware threads, and the number of hardware threads
+std::vector<int> threadCounts();
+// Returns the thread counts of the scaling test: every count from one to the
+// number of hardware threads
+std::vector<int> scalingThreads();
+
+// Returns the number of memory allocations made by the calling thread so far
+unsigned long long allocations();
+// Returns the number of memory deallocations made by the calling thread so far
+unsigned long long deallocations();
+
 template<typename Container>
 ContainerDescription getDescription();
 
 template<typename Container>
 int getHeight(const Container& container);
 
+template<typename Container>
+long long getRotations(const Container& container);
+
+template<typename Container>
+double getRotationRate(const Container& container, long long rotationsBefore, size_t operations);
+
+template<typename Container, typename Key, typename Value>
+void insertEntry(Container& container, const Key& key, const Value& value);
+
 template<typename Container, typename Key, typename Value>
 int insertValues(Container& container, const std::vector<Key>& keys,
                  const std::vector<Value>& values);
 
+template<typename Container, typename Key>
+bool findKey(const Container& container, const Key& key);
+
 template<typename Container, typename Key>
 int searchValues(Container& container, const std::vector<Key>& keys);
 
@@ -95,6 +762,196 @@ int deleteValues(Container& container, const std::vector<Key>& keys);
 template<typename Container>
 TestTime runTest(Container& container, const TestData& testData);
 
+template<typename Container>
+void rebalanceContainer(Container& container);
+
+template<typename Container>
+void popMinimum(Container& container);
+
+template<typename Container, typename Key, typename Value>
+LatencyTime insertLatency(Container& container, const std::vector<Key>& keys,
+                          const std::vector<Value>& values, int burst);
+
+template<typename Container>
+QueueTime runQueueTest(Container& container, int n);
+
+// Ignores the keys and the values that a scan visits
+struct IgnoreVisit
+{
+    template<typename Key, typename Value>
+    void operator()(const Key&, const Value&) const
+    {}
+};
+
+// Whether the container visits its keys in order with forEach and scan, like the
+// skip list, the thread-safe trees and the multi-version tree
+template<typename Container, typename = void>
+struct HasScan : std::false_type
+{};
+
+template<typename Container>
+struct HasScan<Container, std::void_t<decltype(std::declval<const Container&>().scan(
+        std::declval<const typename Container::key_type&>(), 0, IgnoreVisit{}))>> : std::true_type
+{};
+
+template<typename Node, typename Compare, bool Multi>
+long long scanAll(const BinarySearchTree<Node, Compare, Multi>& tree);
+
+template<typename Key, typename Value, typename Compare>
+long long scanAll(const std::map<Key, Value, Compare>& container);
+
+template<typename Container>
+typename std::enable_if<HasScan<Container>::value, long long>::type scanAll(const Container& container);
+
+template<typename Node, typename Compare, bool Multi>
+long long scanRange(const BinarySearchTree<Node, Compare, Multi>& tree, const typename Node::key_type& first, int length);
+
+template<typename Key, typename Value, typename Compare>
+long long scanRange(const std::map<Key, Value, Compare>& container, const Key& first, int length);
+
+template<typename Container>
+typename std::enable_if<HasScan<Container>::value, long long>::type
+scanRange(const Container& container, const typename Container::key_type& first, int length);
+
+template<typename Container>
+ScanTime runScanTest(Container& container, const std::vector<key_type>& keys,
+                     const std::vector<data_type>& values, const std::vector<key_type>& starts);
+
+template<typename Node, typename Compare, bool Multi>
+typename Node::mapped_type findValue(const BinarySearchTree<Node, Compare, Multi>& tree, const typename Node::key_type& key);
+
+template<typename Key, typename Value, typename Compare>
+Value findValue(const std::map<Key, Value, Compare>& container, const Key& key);
+
+template<typename Node, typename Compare, bool Multi>
+Node* notFound(const BinarySearchTree<Node, Compare, Multi>& tree);
+
+template<typename Key, typename Value, typename Compare>
+typename std::map<Key, Value, Compare>::const_iterator notFound(const std::map<Key, Value, Compare>& container);
+
+template<typename Key, typename Compare>
+typename std::set<Key, Compare>::const_iterator notFound(const std::set<Key, Compare>& container);
+
+template<typename Node, typename Compare>
+Node* notFound(const SkipList<Node, Compare>& list);
+
+template<typename Node, typename Compare, bool Multi>
+long long scanEqual(const BinarySearchTree<Node, Compare, Multi>& tree, const typename Node::key_type& key);
+
+template<typename Key, typename Value, typename Compare>
+long long scanEqual(const std::multimap<Key, Value, Compare>& container, const Key& key);
+
+template<typename Container>
+MultiTime runMultiTest(Container& container, const std::vector<key_type>& keys,
+                       const std::vector<data_type>& values, const std::vector<key_type>& probes);
+
+template<typename Node, typename Compare, bool Multi>
+sum_type sumRange(const BinarySearchTree<Node, Compare, Multi>& tree, key_type lo, key_type hi);
+
+template<typename Key, typename Compare>
+sum_type sumRange(const std::map<Key, sum_type, Compare>& container, const Key& lo, const Key& hi);
+
+template<typename Node, typename Compare, bool Multi>
+sum_type aggregateRange(const BinarySearchTree<Node, Compare, Multi>& tree, key_type lo, key_type hi);
+
+template<typename Key, typename Compare>
+sum_type aggregateRange(const std::map<Key, sum_type, Compare>& container, const Key& lo, const Key& hi);
+
+template<typename Container>
+AggregateTime runAggregateTest(Container& container, const std::vector<key_type>& keys,
+                               const std::vector<key_type>& starts, int width);
+
+template<typename Node>
+long long countOverlapping(const IntervalTree<Node>& tree, key_type low, key_type high);
+
+template<typename Key, typename Value, typename Compare>
+long long countOverlapping(const std::multimap<Key, Interval<Key, Value>, Compare>& container,
+                           const Key& low, const Key& high);
+
+template<typename Container>
+IntervalTime runIntervalTest(Container& container, const std::vector<key_type>& lows,
+                             const std::vector<key_type>& lengths, const std::vector<key_type>& points);
+
+template<typename Node, typename Compare, bool Multi>
+void insertVersion(BinarySearchTree<Node, Compare, Multi>& tree, key_type key, const data_type& value);
+
+template<typename Node, typename Compare>
+void insertVersion(PersistentAVLTree<Node, Compare>& tree, key_type key, const data_type& value);
+
+template<typename Node, typename Compare, bool Multi>
+void eraseVersion(BinarySearchTree<Node, Compare, Multi>& tree, key_type key);
+
+template<typename Node, typename Compare>
+void eraseVersion(PersistentAVLTree<Node, Compare>& tree, key_type key);
+
+template<typename Container>
+std::unique_ptr<Container> takeSnapshot(const Container& container);
+
+template<typename Node, typename Compare>
+std::unique_ptr<PersistentAVLTree<Node, Compare>> takeSnapshot(const PersistentAVLTree<Node, Compare>& tree);
+
+template<typename Container>
+PersistentTime runPersistentTest(Container& container, const std::vector<key_type>& keys,
+                                 const std::vector<data_type>& values,
+                                 const std::vector<key_type>& eraseKeys);
+
+template<typename Container>
+ConcurrentTime runConcurrentTest(Container& container, const std::vector<key_type>& keys,
+                                 int keyRange, int operations, int threads, int reads);
+
+template<typename Reclaimer>
+ReclamationTime runReclamationTest(Reclaimer& reclaimer, int operations, int threads);
+
+template<typename Service>
+ServiceTime runServiceTest(const std::vector<key_type>& keys, int keyRange, int operations,
+                           int producers, int window);
+
+template<typename Container>
+long long storedVersions(const Container& container);
+
+template<typename Key, typename Value, typename Compare>
+long long storedVersions(const MultiVersionTree<Key, Value, Compare>& tree);
+
+template<typename Node, typename Compare, bool Multi>
+bool containsKey(const BinarySearchTree<Node, Compare, Multi>& tree, const typename Node::key_type& key);
+
+template<typename Tree, ConcurrencyMode Mode>
+bool containsKey(const ConcurrentTree<Tree, Mode>& tree, const typename Tree::key_type& key);
+
+template<typename Tree, ShardingMode Mode>
+bool containsKey(const ShardedTree<Tree, Mode>& tree, const typename Tree::key_type& key);
+
+template<typename Node, typename Compare>
+bool containsKey(const SkipList<Node, Compare>& list, const typename Node::key_type& key);
+
+template<typename Key, typename Value, typename Compare>
+bool containsKey(const MultiVersionTree<Key, Value, Compare>& tree, const Key& key);
+
+template<typename Container>
+ScalingTime runScalingTest(Container& container, const std::vector<key_type>& keys, int keyRange,
+                           int operations, int threads, const OperationMix& mix, ContainerSharing sharing);
+
+template<typename Container>
+SnapshotTime runSnapshotTest(Container& container, const std::vector<key_type>& keys,
+                             int keyRange, int writes, int scanners);
+
+template<typename Container>
+RekeyTime runRekeyTest(Container& container, const std::vector<key_type>& keys,
+                       const std::vector<data_type>& values, key_type offset);
+
+template<typename Container, typename Key, typename Probe>
+StringTime runStringTest(Container& container, const std::vector<Key>& keys,
+                         const std::vector<data_type>& values,
+                         const std::vector<Probe>& probes);
+
+template<typename Container>
+CompareTime runCompareTest(Container& container, const std::vector<CountedKey>& keys,
+                           const std::vector<data_type>& values,
+                           const std::vector<CountedKey>& searchKeys);
+
+template<typename TupleType, typename Function>
+void forEachContainer(TupleType& t, Function function);
+
 template<typename TupleType>
 void runTest_for_each(TupleType&&,
                       std::integral_constant<size_t, std::tuple_size<typename std::remove_reference<TupleType>::type >::value>,
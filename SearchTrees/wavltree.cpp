@@ -0,0 +1,353 @@
+// Weak AVL (WAVL) tree implementation
+//
+// Implementation is based on B. Haeupler, S. Sen, R.E. Tarjan, Rank-balanced trees,
+// ACM Transactions on Algorithms 11(4), 2015, Article 30
+
+#ifndef WAVLTREE_CPP
+#define WAVLTREE_CPP
+
+#include "wavltree.hh"
+
+template<typename Node, typename Compare>
+WAVLTree<Node, Compare>::WAVLTree() :
+    BinarySearchTree<Node, Compare>{}
+{
+}
+
+template<typename Node, typename Compare>
+WAVLTree<Node, Compare>::WAVLTree(const Compare& compare) :
+    BinarySearchTree<Node, Compare>{ compare }
+{
+}
+
+template<typename Node, typename Compare>
+WAVLTree<Node, Compare>::~WAVLTree()
+{
+}
+
+template<typename Node, typename Compare>
+bool WAVLTree<Node, Compare>::insertNode(Node* node)
+{
+    Node* x{ this->root_ };
+    Node* parent{ this->nil_ };
+    int order{ 0 };
+
+    while (x != this->nil_)
+    {
+        parent = x;
+        order = this->compareKeys(node->key_, x->key_);
+        if (order < 0)
+        {
+            x = x->left_;
+        }
+        else if (order > 0)
+        {
+            x = x->right_;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    node->parent_ = parent;
+    node->left_ = this->nil_;
+    node->right_ = this->nil_;
+    node->rank_ = 0;
+
+    if (parent == this->nil_)
+    {
+        this->root_ = node;
+    }
+    else if (order < 0)
+    {
+        parent->left_ = node;
+    }
+    else
+    {
+        parent->right_ = node;
+    }
+    ++this->nodes_;
+    this->linkInOrder(node);
+
+    insertBalance(node);
+
+    return true;
+}
+
+template<typename Node, typename Compare>
+void WAVLTree<Node, Compare>::removeNode(Node* node)
+{
+    // x is the node that takes the place of the removed node and parent is its new parent
+    Node* x{ this->nil_ };
+    Node* parent{ node->parent_ };
+
+    if (node->left_ == this->nil_)
+    {
+        x = node->right_;
+        transplant(node, node->right_);
+    }
+    else if (node->right_ == this->nil_)
+    {
+        x = node->left_;
+        transplant(node, node->left_);
+    }
+    else
+    {
+        Node* y{ this->minimum(node->right_) };
+        x = y->right_;
+
+        if (y->parent_ == node)
+        {
+            parent = y;
+        }
+        else
+        {
+            parent = y->parent_;
+            transplant(y, y->right_);
+            y->right_ = node->right_;
+            y->right_->parent_ = y;
+        }
+        transplant(node, y);
+        y->left_ = node->left_;
+        y->left_->parent_ = y;
+        y->rank_ = node->rank_;
+    }
+
+    deleteBalance(x, parent);
+}
+
+// Restores the rank rule after x has been inserted as a leaf.
+// At most two rotations are done.
+template<typename Node, typename Compare>
+void WAVLTree<Node, Compare>::insertBalance(Node* x)
+{
+    Node* parent{ x->parent_ };
+
+    // x is a 0-child as long as it has the same rank as its parent
+    while (parent != this->nil_ and parent->rank_ == x->rank_)
+    {
+        bool isLeft{ x == parent->left_ };
+        Node* sibling{ isLeft ? parent->right_ : parent->left_ };
+
+        if (parent->rank_ - sibling->rank_ == 1)
+        {
+            ++parent->rank_;
+            x = parent;
+            parent = x->parent_;
+            continue;
+        }
+
+        if (isLeft)
+        {
+            Node* y{ x->right_ };
+            if (x->rank_ - y->rank_ == 2)
+            {
+                rotateRight(parent);
+                --parent->rank_;
+            }
+            else
+            {
+                rotateLeft(x);
+                rotateRight(parent);
+                ++y->rank_;
+                --x->rank_;
+                --parent->rank_;
+            }
+        }
+        else
+        {
+            Node* y{ x->left_ };
+            if (x->rank_ - y->rank_ == 2)
+            {
+                rotateLeft(parent);
+                --parent->rank_;
+            }
+            else
+            {
+                rotateRight(x);
+                rotateLeft(parent);
+                ++y->rank_;
+                --x->rank_;
+                --parent->rank_;
+            }
+        }
+        return;
+    }
+}
+
+// Restores the rank rule after a node has been removed and x (possibly nil)
+// has taken its place as a child of parent. At most two rotations are done.
+template<typename Node, typename Compare>
+void WAVLTree<Node, Compare>::deleteBalance(Node* x, Node* parent)
+{
+    if (parent == this->nil_)
+    {
+        return;
+    }
+
+    // A leaf may not be a 2,2-node
+    if (parent->left_ == this->nil_ and parent->right_ == this->nil_ and parent->rank_ == 1)
+    {
+        parent->rank_ = 0;
+        x = parent;
+        parent = x->parent_;
+    }
+
+    // x is a 3-child
+    while (parent != this->nil_ and parent->rank_ - x->rank_ == 3)
+    {
+        bool isLeft{ x == parent->left_ };
+        Node* sibling{ isLeft ? parent->right_ : parent->left_ };
+
+        if (parent->rank_ - sibling->rank_ == 2)
+        {
+            --parent->rank_;
+            x = parent;
+            parent = x->parent_;
+            continue;
+        }
+
+        if (sibling->rank_ - sibling->left_->rank_ == 2 and
+            sibling->rank_ - sibling->right_->rank_ == 2)
+        {
+            --parent->rank_;
+            --sibling->rank_;
+            x = parent;
+            parent = x->parent_;
+            continue;
+        }
+
+        if (isLeft)
+        {
+            Node* outer{ sibling->right_ };
+            if (sibling->rank_ - outer->rank_ == 1)
+            {
+                rotateLeft(parent);
+                ++sibling->rank_;
+                --parent->rank_;
+                if (parent->left_ == this->nil_ and parent->right_ == this->nil_)
+                {
+                    --parent->rank_;
+                }
+            }
+            else
+            {
+                Node* inner{ sibling->left_ };
+                rotateRight(sibling);
+                rotateLeft(parent);
+                inner->rank_ += 2;
+                --sibling->rank_;
+                parent->rank_ -= 2;
+            }
+        }
+        else
+        {
+            Node* outer{ sibling->left_ };
+            if (sibling->rank_ - outer->rank_ == 1)
+            {
+                rotateRight(parent);
+                ++sibling->rank_;
+                --parent->rank_;
+                if (parent->left_ == this->nil_ and parent->right_ == this->nil_)
+                {
+                    --parent->rank_;
+                }
+            }
+            else
+            {
+                Node* inner{ sibling->right_ };
+                rotateLeft(sibling);
+                rotateRight(parent);
+                inner->rank_ += 2;
+                --sibling->rank_;
+                parent->rank_ -= 2;
+            }
+        }
+        return;
+    }
+}
+
+template<typename Node, typename Compare>
+void WAVLTree<Node, Compare>::rotateLeft(Node* x)
+{
+    Node* y{ x->right_ };
+
+    x->right_ = y->left_;
+    if (y->left_ != this->nil_)
+    {
+        y->left_->parent_ = x;
+    }
+
+    y->parent_ = x->parent_;
+    if (x->parent_ == this->nil_)
+    {
+        this->root_ = y;
+    }
+    else if (x == x->parent_->left_)
+    {
+        x->parent_->left_ = y;
+    }
+    else
+    {
+        x->parent_->right_ = y;
+    }
+
+    y->left_ = x;
+    x->parent_ = y;
+    ++this->rotations_;
+}
+
+template<typename Node, typename Compare>
+void WAVLTree<Node, Compare>::rotateRight(Node* x)
+{
+    Node* y{ x->left_ };
+
+    x->left_ = y->right_;
+    if (y->right_ != this->nil_)
+    {
+        y->right_->parent_ = x;
+    }
+
+    y->parent_ = x->parent_;
+    if (x->parent_ == this->nil_)
+    {
+        this->root_ = y;
+    }
+    else if (x == x->parent_->left_)
+    {
+        x->parent_->left_ = y;
+    }
+    else
+    {
+        x->parent_->right_ = y;
+    }
+
+    y->right_ = x;
+    x->parent_ = y;
+    ++this->rotations_;
+}
+
+template<typename Node, typename Compare>
+void WAVLTree<Node, Compare>::transplant(Node* u, Node* v)
+{
+    if (u->parent_ == this->nil_)
+    {
+        this->root_ = v;
+    }
+    else if (u == u->parent_->left_)
+    {
+        u->parent_->left_ = v;
+    }
+    else
+    {
+        u->parent_->right_ = v;
+    }
+
+    if (v != this->nil_)
+    {
+        v->parent_ = u->parent_;
+    }
+}
+
+#endif // WAVLTREE_CPP
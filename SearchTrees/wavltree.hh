@@ -0,0 +1,85 @@
+// Weak AVL (WAVL) tree implementation
+//
+// Implementation is based on B. Haeupler, S. Sen, R.E. Tarjan, Rank-balanced trees,
+// ACM Transactions on Algorithms 11(4), 2015, Article 30
+
+#ifndef WAVLTREE_HH
+#define WAVLTREE_HH
+
+#include "binarysearchtree.hh"
+#include <utility>
+
+template<typename Key, typename Value>
+struct WAVLNode
+{
+    using key_type = Key;
+    using mapped_type = Value;
+    using rank_type = signed char;
+    const static rank_type NULL_RANK = -1;
+
+    key_type key_;
+    mapped_type value_;
+    WAVLNode<key_type, mapped_type>* parent_;
+    WAVLNode<key_type, mapped_type>* left_;
+    WAVLNode<key_type, mapped_type>* right_;
+    // The rank of the node. The rank difference of a child is always 1 or 2
+    // (outside of rebalancing), so a single byte is enough even for huge trees.
+    rank_type rank_;
+
+    WAVLNode() :
+        key_{}, value_{},
+        parent_{}, left_{}, right_{},
+        rank_{ NULL_RANK }
+    {}
+
+    WAVLNode(const key_type& key, const mapped_type& value,
+             WAVLNode<key_type, mapped_type>* parent,
+             WAVLNode<key_type, mapped_type>* left,
+             WAVLNode<key_type, mapped_type>* right) :
+        key_{ key }, value_{ value },
+        parent_{ parent }, left_{ left }, right_{ right },
+        rank_{ 0 }
+    {}
+
+    PrintColor getPrintColor()
+    {
+        if (parent_ != nullptr and parent_->rank_ - rank_ == 2)
+        {
+            return PrintColor::Blue;
+        }
+        else
+        {
+            return PrintColor::White;
+        }
+    }
+};
+
+template<typename Node, typename Compare = std::less<typename Node::key_type>>
+class WAVLTree : public BinarySearchTree<Node, Compare>
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+    using value_type = typename BinarySearchTree<Node, Compare>::value_type;
+    using size_type = typename BinarySearchTree<Node, Compare>::size_type;
+    using node_type = Node;
+
+    WAVLTree();
+    explicit WAVLTree(const Compare& compare);
+    virtual ~WAVLTree();
+
+protected:
+    virtual bool insertNode(Node* node);
+    virtual void removeNode(Node* node);
+
+private:
+    void insertBalance(Node* x);
+    void deleteBalance(Node* x, Node* parent);
+    void rotateLeft(Node* x);
+    void rotateRight(Node* x);
+    void transplant(Node* u, Node* v);
+};
+
+#include "wavltree.cpp"
+
+#endif // WAVLTREE_HH
@@ -0,0 +1,329 @@
+// Weight balanced tree implementation
+//
+// Implementation is based on Y. Hirai, K. Yamamoto, Balancing weight-balanced trees,
+// Journal of Functional Programming 21(3), 2011, pp. 287-307
+
+#ifndef WEIGHTBALANCEDTREE_CPP
+#define WEIGHTBALANCEDTREE_CPP
+
+#include "weightbalancedtree.hh"
+
+template<typename Node, typename Compare>
+WeightBalancedTree<Node, Compare>::WeightBalancedTree() :
+    BinarySearchTree<Node, Compare>{}
+{
+}
+
+template<typename Node, typename Compare>
+WeightBalancedTree<Node, Compare>::WeightBalancedTree(const Compare& compare) :
+    BinarySearchTree<Node, Compare>{ compare }
+{
+}
+
+template<typename Node, typename Compare>
+WeightBalancedTree<Node, Compare>::~WeightBalancedTree()
+{
+}
+
+template<typename Node, typename Compare>
+bool WeightBalancedTree<Node, Compare>::insertNode(Node* node)
+{
+    Node* x{ this->root_ };
+    Node* parent{ this->nil_ };
+    int order{ 0 };
+
+    while (x != this->nil_)
+    {
+        parent = x;
+        order = this->compareKeys(node->key_, x->key_);
+        if (order < 0)
+        {
+            x = x->left_;
+        }
+        else if (order > 0)
+        {
+            x = x->right_;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    node->parent_ = parent;
+    node->left_ = this->nil_;
+    node->right_ = this->nil_;
+    node->size_ = 1;
+
+    if (parent == this->nil_)
+    {
+        this->root_ = node;
+    }
+    else if (order < 0)
+    {
+        parent->left_ = node;
+    }
+    else
+    {
+        parent->right_ = node;
+    }
+    ++this->nodes_;
+    this->linkInOrder(node);
+
+    x = parent;
+    while (x != this->nil_)
+    {
+        ++x->size_;
+        x = balance(x)->parent_;
+    }
+
+    return true;
+}
+
+template<typename Node, typename Compare>
+void WeightBalancedTree<Node, Compare>::removeNode(Node* node)
+{
+    // The lowest node whose subtree changed
+    Node* x{ node->parent_ };
+
+    if (node->left_ == this->nil_)
+    {
+        transplant(node, node->right_);
+    }
+    else if (node->right_ == this->nil_)
+    {
+        transplant(node, node->left_);
+    }
+    else
+    {
+        Node* y{ this->minimum(node->right_) };
+        if (y->parent_ == node)
+        {
+            x = y;
+        }
+        else
+        {
+            x = y->parent_;
+            transplant(y, y->right_);
+            y->right_ = node->right_;
+            y->right_->parent_ = y;
+        }
+        transplant(node, y);
+        y->left_ = node->left_;
+        y->left_->parent_ = y;
+    }
+
+    while (x != this->nil_)
+    {
+        x->size_ = x->left_->size_ + x->right_->size_ + 1;
+        x = balance(x)->parent_;
+    }
+}
+
+template<typename Node, typename Compare>
+typename WeightBalancedTree<Node, Compare>::size_type WeightBalancedTree<Node, Compare>::subtreeSize(Node* node) const
+{
+    return node->size_;
+}
+
+template<typename Node, typename Compare>
+Node* WeightBalancedTree<Node, Compare>::select(size_type index) const
+{
+    Node* x{ this->root_ };
+    while (x != this->nil_)
+    {
+        size_type leftSize{ x->left_->size_ };
+        if (index < leftSize)
+        {
+            x = x->left_;
+        }
+        else if (index == leftSize)
+        {
+            return x;
+        }
+        else
+        {
+            index -= leftSize + 1;
+            x = x->right_;
+        }
+    }
+    return x;
+}
+
+template<typename Node, typename Compare>
+typename WeightBalancedTree<Node, Compare>::size_type WeightBalancedTree<Node, Compare>::rank(const key_type& key) const
+{
+    size_type smaller{ 0 };
+    Node* x{ this->root_ };
+    while (x != this->nil_)
+    {
+        int order{ this->compareKeys(key, x->key_) };
+        if (order < 0)
+        {
+            x = x->left_;
+        }
+        else if (order > 0)
+        {
+            smaller += x->left_->size_ + 1;
+            x = x->right_;
+        }
+        else
+        {
+            return smaller + x->left_->size_;
+        }
+    }
+    return smaller;
+}
+
+template<typename Node, typename Compare>
+std::vector<Node*> WeightBalancedTree<Node, Compare>::splitPoints(size_type parts) const
+{
+    std::vector<Node*> points;
+    if (parts == 0)
+    {
+        return points;
+    }
+
+    points.reserve(parts);
+    for (size_type i{ 0 }; i < parts; ++i)
+    {
+        // The 64-bit product avoids overflow with large trees and many parts
+        auto index{ static_cast<unsigned long long>(this->nodes_) * i / parts };
+        points.push_back(select(static_cast<size_type>(index)));
+    }
+    return points;
+}
+
+// Returns true if subtree a is not too light compared with subtree b
+template<typename Node, typename Compare>
+bool WeightBalancedTree<Node, Compare>::isBalanced(Node* a, Node* b) const
+{
+    return DELTA * (a->size_ + 1) >= b->size_ + 1;
+}
+
+// Returns true if a single rotation is enough to rebalance a subtree whose
+// heavier child has the children a (inner) and b (outer)
+template<typename Node, typename Compare>
+bool WeightBalancedTree<Node, Compare>::isSingle(Node* a, Node* b) const
+{
+    return a->size_ + 1 < GAMMA * (b->size_ + 1);
+}
+
+// Restores the balance of x after one node has been added to or removed from
+// one of its subtrees. Returns the root of the rebalanced subtree.
+template<typename Node, typename Compare>
+Node* WeightBalancedTree<Node, Compare>::balance(Node* x)
+{
+    if (not isBalanced(x->left_, x->right_))
+    {
+        Node* y{ x->right_ };
+        if (not isSingle(y->left_, y->right_))
+        {
+            rotateRight(y);
+        }
+        rotateLeft(x);
+        return x->parent_;
+    }
+    else if (not isBalanced(x->right_, x->left_))
+    {
+        Node* y{ x->left_ };
+        if (not isSingle(y->right_, y->left_))
+        {
+            rotateLeft(y);
+        }
+        rotateRight(x);
+        return x->parent_;
+    }
+
+    return x;
+}
+
+template<typename Node, typename Compare>
+void WeightBalancedTree<Node, Compare>::rotateLeft(Node* x)
+{
+    Node* y{ x->right_ };
+
+    x->right_ = y->left_;
+    if (y->left_ != this->nil_)
+    {
+        y->left_->parent_ = x;
+    }
+
+    y->parent_ = x->parent_;
+    if (x->parent_ == this->nil_)
+    {
+        this->root_ = y;
+    }
+    else if (x == x->parent_->left_)
+    {
+        x->parent_->left_ = y;
+    }
+    else
+    {
+        x->parent_->right_ = y;
+    }
+
+    y->left_ = x;
+    x->parent_ = y;
+
+    y->size_ = x->size_;
+    x->size_ = x->left_->size_ + x->right_->size_ + 1;
+    ++this->rotations_;
+}
+
+template<typename Node, typename Compare>
+void WeightBalancedTree<Node, Compare>::rotateRight(Node* x)
+{
+    Node* y{ x->left_ };
+
+    x->left_ = y->right_;
+    if (y->right_ != this->nil_)
+    {
+        y->right_->parent_ = x;
+    }
+
+    y->parent_ = x->parent_;
+    if (x->parent_ == this->nil_)
+    {
+        this->root_ = y;
+    }
+    else if (x == x->parent_->left_)
+    {
+        x->parent_->left_ = y;
+    }
+    else
+    {
+        x->parent_->right_ = y;
+    }
+
+    y->right_ = x;
+    x->parent_ = y;
+
+    y->size_ = x->size_;
+    x->size_ = x->left_->size_ + x->right_->size_ + 1;
+    ++this->rotations_;
+}
+
+template<typename Node, typename Compare>
+void WeightBalancedTree<Node, Compare>::transplant(Node* u, Node* v)
+{
+    if (u->parent_ == this->nil_)
+    {
+        this->root_ = v;
+    }
+    else if (u == u->parent_->left_)
+    {
+        u->parent_->left_ = v;
+    }
+    else
+    {
+        u->parent_->right_ = v;
+    }
+
+    if (v != this->nil_)
+    {
+        v->parent_ = u->parent_;
+    }
+}
+
+#endif // WEIGHTBALANCEDTREE_CPP
@@ -0,0 +1,90 @@
+// Weight balanced tree implementation
+//
+// Implementation is based on Y. Hirai, K. Yamamoto, Balancing weight-balanced trees,
+// Journal of Functional Programming 21(3), 2011, pp. 287-307
+//
+// Every node stores the size of its subtree, which is also the balance information
+// of the tree. This makes subtree sizes available in O(1) and order statistics
+// (select, rank and splitting the keys into equal sized parts) in O(log n).
+
+#ifndef WEIGHTBALANCEDTREE_HH
+#define WEIGHTBALANCEDTREE_HH
+
+#include "binarysearchtree.hh"
+#include <utility>
+#include <vector>
+
+template<typename Key, typename Value>
+struct WeightBalancedNode
+{
+    using key_type = Key;
+    using mapped_type = Value;
+
+    key_type key_;
+    mapped_type value_;
+    WeightBalancedNode<key_type, mapped_type>* parent_;
+    WeightBalancedNode<key_type, mapped_type>* left_;
+    WeightBalancedNode<key_type, mapped_type>* right_;
+    unsigned int size_;
+
+    WeightBalancedNode() :
+        key_{}, value_{},
+        parent_{}, left_{}, right_{},
+        size_{ 0 }
+    {}
+
+    WeightBalancedNode(const key_type& key, const mapped_type& value,
+                       WeightBalancedNode<key_type, mapped_type>* parent,
+                       WeightBalancedNode<key_type, mapped_type>* left,
+                       WeightBalancedNode<key_type, mapped_type>* right) :
+        key_{ key }, value_{ value },
+        parent_{ parent }, left_{ left }, right_{ right },
+        size_{ 1 }
+    {}
+};
+
+template<typename Node, typename Compare = std::less<typename Node::key_type>>
+class WeightBalancedTree : public BinarySearchTree<Node, Compare>
+{
+public:
+    using key_type = typename Node::key_type;
+    using mapped_type = typename Node::mapped_type;
+    using value_type = typename BinarySearchTree<Node, Compare>::value_type;
+    using size_type = typename BinarySearchTree<Node, Compare>::size_type;
+    using node_type = Node;
+
+    // The balance parameters (delta, gamma) = (3, 2) from Hirai and Yamamoto
+    const static size_type DELTA = 3;
+    const static size_type GAMMA = 2;
+
+    WeightBalancedTree();
+    explicit WeightBalancedTree(const Compare& compare);
+    virtual ~WeightBalancedTree();
+
+    // Returns the number of nodes in the subtree rooted at node
+    size_type subtreeSize(Node* node) const;
+    // Returns the node with the given zero based in-order index, or nil if out of range
+    Node* select(size_type index) const;
+    // Returns the number of keys in the tree that are smaller than key
+    size_type rank(const key_type& key) const;
+    // Splits the tree into the given number of in-order ranges of (almost) equal size.
+    // Returns the first node of each range; range i ends where range i+1 starts and
+    // the last range ends at nil. Empty ranges start at nil.
+    std::vector<Node*> splitPoints(size_type parts) const;
+
+protected:
+    virtual bool insertNode(Node* node);
+    virtual void removeNode(Node* node);
+
+private:
+    bool isBalanced(Node* a, Node* b) const;
+    bool isSingle(Node* a, Node* b) const;
+    Node* balance(Node* x);
+    void rotateLeft(Node* x);
+    void rotateRight(Node* x);
+    void transplant(Node* u, Node* v);
+};
+
+#include "weightbalancedtree.cpp"
+
+#endif // WEIGHTBALANCEDTREE_HH